@@ -4,57 +4,45 @@
 
 Dsp::Dsp(ImRt::DspSettings settings)
    : ImRt::Dsp<Dsp>(settings)
-   , _gainId(gainLayout.id())
-   , _panId(panLayout.id())
-   , _muteId(muteLayout.id())
 {
    addParameter(gainLayout);
    addParameter(panLayout);
    addParameter(muteLayout);
 
-   _oscBuffer.resize({ 2, _oscNumFrames });
-   _oscBuffer.clear();
+   _gain = parameterHandle(gainLayout.id());
+   _pan  = parameterHandle(panLayout.id());
+   _mute = parameterHandle(muteLayout.id());
 
-   _volBuffer.resize({ 2, _volNumFrames });
-   _volBuffer.clear();
+   oscRing.reset(2, 8192);
+   volRing.reset(2, 8192);
 }
 
 int Dsp::process(ImRt::Buffer& in, ImRt::Buffer& out, uint32_t numFrames)
 {
-   for (uint32_t frame = 0; frame < numFrames; ++frame)
+   if (_mute.value() > 0.5)
    {
-      float muteValue = updatedParameterValue(_muteId);
-
-      if (muteValue > 0.5)
-      {
-         out.clear();
-         volView.clear();
-         oscView.clear();
-         return 0;
-      }
-
-      float panValue   = updatedParameterValue(_panId);
+      out.clear();
+   }
+   else
+   {
+      float panValue   = _pan.value();
       float panAmountL = 1.0f - std::max(0.0f, panValue);
       float panAmountR = 1.0f + std::min(0.0f, panValue);
 
-      float _gainValue = updatedParameterValue(_gainId);
-
-      out.getSample(0, frame)
-         = in.getSample(0, frame) * panAmountL * _gainValue;
-      out.getSample(1, frame)
-         = in.getSample(1, frame) * panAmountR * _gainValue;
-
-      _oscBuffer.getSample(0, _oscPos) = out.getSample(0, frame);
-      _oscBuffer.getSample(1, _oscPos) = out.getSample(1, frame);
-      _oscPos                          = (_oscPos + 1) % _oscNumFrames;
+      float gainValue = _gain.value();
 
-      _volBuffer.getSample(0, _volPos) = out.getSample(0, frame);
-      _volBuffer.getSample(1, _volPos) = out.getSample(1, frame);
-      _volPos                          = (_volPos + 1) % _volNumFrames;
+      for (uint32_t frame = 0; frame < numFrames; ++frame)
+      {
+         out.getSample(0, frame)
+            = in.getSample(0, frame) * panAmountL * gainValue;
+         out.getSample(1, frame)
+            = in.getSample(1, frame) * panAmountR * gainValue;
+      }
    }
 
-   volView = _volBuffer;
-   oscView = _oscBuffer;
+   // The GUI reads the output for its meters and its oscilloscope.
+   oscRing.write(out, numFrames);
+   volRing.write(out, numFrames);
 
    return 0;
 }
@@ -10,24 +10,40 @@ Gui::Gui(Dsp& dsp, ImRt::GuiSettings settings)
    , _gainKnob(*this, _gainId)
    , _panKnob(*this, _panId)
    , _muteButton(*this, _muteId)
-   , _volumeBarL(*this, dsp.volView, 0, { 15, 230 })
-   , _volumeBarR(*this, dsp.volView, 1, { 15, 230 })
-   , oscilloscope(*this, dsp.oscView, { 870, 230 })
+   , _volumeBarL(*this, _volView, 0, { 15, 230 })
+   , _volumeBarR(*this, _volView, 1, { 15, 230 })
+   , oscilloscope(*this, _oscView, { 870, 230 })
 {
+   _oscWindow.resize({ 2, 4096 });
+   _oscWindow.clear();
+   _oscView = _oscWindow;
+
+   _volWindow.resize({ 2, 1024 });
+   _volWindow.clear();
+   _volView = _volWindow;
+
+   _batch.reserve(2, 2);
+
+   // The meters and the oscilloscope change whenever the DSP publishes.
+   registry().watchSource([this] { return dsp.volRing.size() > 0; });
 }
 
 void Gui::onStart() { }
 
 void Gui::onUpdate()
 {
+   dsp.oscRing.readLatest(_oscWindow);
+   dsp.volRing.readLatest(_volWindow);
+
    if (ImGui::BeginChild("#1", { 235, 0 }))
    {
-      _gainKnob.show();
+      _gainKnob.show(_batch);
 
       ImGui::SameLine();
-      _panKnob.show();
+      _panKnob.show(_batch);
 
       _muteButton.show();
+      _batch.render();
    }
    ImGui::EndChild();
 
@@ -35,10 +51,11 @@ void Gui::onUpdate()
 
    if (ImGui::BeginChild("#2", { 46, 0 }))
    {
-      _volumeBarL.show();
+      _volumeBarL.show(_batch);
 
       ImGui::SameLine();
-      _volumeBarR.show();
+      _volumeBarR.show(_batch);
+      _batch.render();
    }
    ImGui::EndChild();
 
@@ -14,8 +14,11 @@ public:
 
 private:
    uint32_t _gainId, _panId, _muteId;
+   ImRt::Buffer _oscWindow, _volWindow;
+   ImRt::BufferView _oscView, _volView;
    ImRt::Knob<Gui, Dsp> _gainKnob, _panKnob;
    ImRt::ToggleButton<Gui, Dsp> _muteButton;
    ImRt::VolumeBar<Gui, Dsp> _volumeBarL, _volumeBarR;
    ImRt::Oscilloscope<Gui, Dsp> oscilloscope;
+   ImRt::WidgetBatch _batch;
 };
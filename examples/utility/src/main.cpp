@@ -14,6 +14,7 @@ int main()
    settings.style.fontSize = 13.0f;
    settings.alwaysOnTop    = true;
    settings.decorated      = true;
+   settings.retained       = true;
 
    Gui gui(dsp, settings);
    gui.run();
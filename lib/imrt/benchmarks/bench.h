@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/* -------------------------------------------------------------------------- */
+/*                              TIMING                                        */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Calls a function repeatedly for at least the given time, after a
+ * short warm-up, and returns the average duration of a call in seconds.
+ */
+template <typename Function>
+double measure(Function&& function, double minSeconds = 0.5)
+{
+   using Clock = std::chrono::steady_clock;
+
+   for (int i = 0; i < 16; ++i)
+   {
+      function();
+   }
+
+   uint64_t numCalls = 0;
+   auto begin        = Clock::now();
+   std::chrono::duration<double> elapsed(0.0);
+   while (elapsed.count() < minSeconds)
+   {
+      for (int i = 0; i < 16; ++i)
+      {
+         function();
+      }
+      numCalls += 16;
+      elapsed = Clock::now() - begin;
+   }
+   return elapsed.count() / numCalls;
+}
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include "imrt-convolution.h"
+
+#include "bench.h"
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                  convolution benchmark                 */
+/* ------------------------------------------------------ */
+
+// Measures the cost of Convolver::process() per sample and channel for
+// impulse responses of several lengths with the default partitioning. The
+// total is measured with the tail on the calling thread, the audio thread
+// share with the tail on the worker, which falls behind since the blocks are
+// passed faster than real time and only mutes the tail then.
+int main()
+{
+   const uint32_t numChannels = 2;
+   const uint32_t blockSize   = 256;
+   const double sampleRate    = 48000.0;
+   const double lengths[]     = { 0.05, 0.25, 1.0, 4.0 };
+
+   Buffer input(numChannels, blockSize), block(numChannels, blockSize);
+   for (uint32_t channel = 0; channel < numChannels; ++channel)
+   {
+      for (uint32_t frame = 0; frame < blockSize; ++frame)
+      {
+         input.getSample(channel, frame) = std::sin(0.1f * frame);
+      }
+   }
+
+   std::printf("%-10s %10s %10s\n", "ir length", "total", "audio");
+   for (double length : lengths)
+   {
+      uint32_t numFrames = static_cast<uint32_t>(length * sampleRate);
+      Buffer ir(1, numFrames);
+      for (uint32_t frame = 0; frame < numFrames; ++frame)
+      {
+         ir.getSample(0, frame) = std::exp(-8.0f * frame / numFrames)
+            * std::sin(0.37f * frame);
+      }
+
+      double seconds[2];
+      for (int background = 0; background < 2; ++background)
+      {
+         ConvolverSettings settings;
+         settings.backgroundTail = background == 1;
+
+         Convolver convolver;
+         convolver.prepare(ir, numChannels, settings);
+         seconds[background] = measure(
+            [&]
+            {
+               // The block is processed in place, so it is refilled.
+               for (uint32_t channel = 0; channel < numChannels; ++channel)
+               {
+                  const float* samples = &input.getSample(channel, 0);
+                  std::copy(
+                     samples, samples + blockSize, &block.getSample(channel, 0)
+                  );
+               }
+               convolver.process(block, blockSize);
+            }
+         );
+      }
+
+      double samples = double(blockSize) * numChannels;
+      std::printf(
+         "%8.2f s %10.2f %10.2f  ns/sample\n", length,
+         seconds[0] * 1e9 / samples, seconds[1] * 1e9 / samples
+      );
+   }
+   return 0;
+}
@@ -0,0 +1,72 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "imrt-resampler.h"
+
+#include "bench.h"
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                   resampler benchmark                  */
+/* ------------------------------------------------------ */
+
+// Measures the cost of Resampler::process() per output sample and channel
+// for every quality, converting blocks of a device-sized buffer.
+int main()
+{
+   const uint32_t numChannels = 2;
+   const uint32_t blockSize   = 256;
+   const double rates[][2]    = { { 48000, 44100 }, { 44100, 48000 } };
+
+   const char* names[]                 = { "low", "medium", "high" };
+   const ResamplerQuality qualities[] = { ResamplerQuality::Low,
+                                          ResamplerQuality::Medium,
+                                          ResamplerQuality::High };
+
+   std::vector<std::vector<float>> input(numChannels), output(numChannels);
+   std::vector<const float*> inputPointers(numChannels);
+   std::vector<float*> outputPointers(numChannels);
+   for (uint32_t channel = 0; channel < numChannels; ++channel)
+   {
+      input[channel].resize(blockSize);
+      output[channel].resize(2 * blockSize);
+      for (uint32_t frame = 0; frame < blockSize; ++frame)
+      {
+         input[channel][frame] = std::sin(0.1f * frame);
+      }
+      inputPointers[channel]  = input[channel].data();
+      outputPointers[channel] = output[channel].data();
+   }
+
+   std::printf("%-8s %-14s %10s\n", "quality", "rates", "ns/sample");
+   for (const auto& rate : rates)
+   {
+      for (int q = 0; q < 3; ++q)
+      {
+         Resampler resampler;
+         resampler.prepare(
+            numChannels, rate[0], rate[1], qualities[q], blockSize
+         );
+
+         double seconds = measure(
+            [&]
+            {
+               resampler.process(
+                  inputPointers.data(), blockSize, outputPointers.data(),
+                  2 * blockSize
+               );
+            }
+         );
+
+         double framesPerCall = blockSize * rate[1] / rate[0];
+         std::printf(
+            "%-8s %5.1fk->%5.1fk %10.2f\n", names[q], rate[0] / 1000,
+            rate[1] / 1000, seconds * 1e9 / (framesPerCall * numChannels)
+         );
+      }
+   }
+   return 0;
+}
@@ -0,0 +1,111 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "imrt-ring.h"
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                     ring benchmark                     */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   /**
+    * @brief Passes the given number of items from a producer to a consumer
+    * thread, each calling the given function with the number of items it
+    * wants to pass and getting the number actually passed, and returns the
+    * throughput in items per second.
+    */
+   template <typename Produce, typename Consume>
+   double throughput(
+      uint64_t numItems, uint32_t batchSize, Produce&& produce,
+      Consume&& consume
+   )
+   {
+      auto begin = std::chrono::steady_clock::now();
+
+      std::thread producer(
+         [&]
+         {
+            uint64_t passed = 0;
+            while (passed < numItems)
+            {
+               uint32_t n = produce(batchSize);
+               if (n == 0)
+               {
+                  std::this_thread::yield();
+               }
+               passed += n;
+            }
+         }
+      );
+
+      uint64_t passed = 0;
+      while (passed < numItems)
+      {
+         uint32_t n = consume(batchSize);
+         if (n == 0)
+         {
+            std::this_thread::yield();
+         }
+         passed += n;
+      }
+      producer.join();
+
+      std::chrono::duration<double> elapsed
+         = std::chrono::steady_clock::now() - begin;
+      return passed / elapsed.count();
+   }
+
+} // namespace
+
+// Measures the throughput of a Ring of 64-bit items for several batch sizes
+// and of a stereo FrameRing for several block sizes, with the producer and
+// the consumer on separate threads.
+int main()
+{
+   const uint32_t batchSizes[] = { 1, 16, 256 };
+
+   std::printf("%-24s %12s\n", "ring", "M items/s");
+   for (uint32_t batchSize : batchSizes)
+   {
+      Ring<uint64_t> ring;
+      ring.reset(4096);
+      std::vector<uint64_t> in(batchSize, 1), out(batchSize);
+
+      double rate = throughput(
+         uint64_t(batchSize) * 200000, batchSize,
+         [&](uint32_t n) { return ring.push(in.data(), n); },
+         [&](uint32_t n) { return ring.pop(out.data(), n); }
+      );
+      std::printf("Ring<uint64_t>, batch %-3u %12.1f\n", batchSize, rate / 1e6);
+   }
+
+   const uint32_t numChannels = 2;
+   for (uint32_t blockSize : batchSizes)
+   {
+      FrameRing ring;
+      ring.reset(numChannels, 4096);
+
+      std::vector<std::vector<float>> in(
+         numChannels, std::vector<float>(blockSize, 0.5f)
+      );
+      std::vector<std::vector<float>> out(
+         numChannels, std::vector<float>(blockSize)
+      );
+      std::vector<const float*> inPointers { in[0].data(), in[1].data() };
+      std::vector<float*> outPointers { out[0].data(), out[1].data() };
+
+      double rate = throughput(
+         uint64_t(blockSize) * 200000, blockSize,
+         [&](uint32_t n) { return ring.write(inPointers.data(), n); },
+         [&](uint32_t n) { return ring.read(outPointers.data(), n); }
+      );
+      std::printf("FrameRing, block %-7u %12.1f\n", blockSize, rate / 1e6);
+   }
+   return 0;
+}
@@ -1,6 +1,29 @@
 #pragma once
 
+#include "../src/imrt-automation.h"
+#include "../src/imrt-batch.h"
+#include "../src/imrt-bridge.h"
+#include "../src/imrt-buffersize.h"
+#include "../src/imrt-chain.h"
+#include "../src/imrt-convert.h"
+#include "../src/imrt-convolution.h"
+#include "../src/imrt-devices.h"
 #include "../src/imrt-dsp.h"
+#include "../src/imrt-fft.h"
+#include "../src/imrt-fontcache.h"
 #include "../src/imrt-gui.h"
+#include "../src/imrt-latency.h"
+#include "../src/imrt-mapping.h"
+#include "../src/imrt-osc.h"
+#include "../src/imrt-oversampling.h"
 #include "../src/imrt-params.h"
+#include "../src/imrt-presets.h"
+#include "../src/imrt-realtime.h"
+#include "../src/imrt-registry.h"
+#include "../src/imrt-regression.h"
+#include "../src/imrt-resampler.h"
+#include "../src/imrt-ring.h"
+#include "../src/imrt-streams.h"
+#include "../src/imrt-trace.h"
+#include "../src/imrt-voices.h"
 #include "../src/imrt-widgets.h"
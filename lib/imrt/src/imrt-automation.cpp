@@ -0,0 +1,301 @@
+#include "imrt-automation.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                    automation lane                     */
+/* ------------------------------------------------------ */
+
+AutomationLane::AutomationLane(uint32_t paramId)
+   : _paramId(paramId)
+{
+}
+
+uint32_t AutomationLane::paramId() const
+{
+   return _paramId;
+}
+
+void AutomationLane::add(uint32_t frame, float value)
+{
+   if (_points.empty() || _points.back().frame < frame)
+   {
+      _points.push_back({ frame, value });
+      return;
+   }
+
+   auto iterator = std::lower_bound(
+      _points.begin(), _points.end(), frame,
+      [](const AutomationPoint& p, uint32_t f) { return p.frame < f; }
+   );
+
+   if (iterator != _points.end() && iterator->frame == frame)
+   {
+      iterator->value = value;
+   }
+   else
+   {
+      _points.insert(iterator, { frame, value });
+   }
+}
+
+bool AutomationLane::valueAt(uint32_t frame, float& value) const
+{
+   auto iterator = std::upper_bound(
+      _points.begin(), _points.end(), frame,
+      [](uint32_t f, const AutomationPoint& p) { return f < p.frame; }
+   );
+
+   if (iterator == _points.begin())
+   {
+      return false;
+   }
+
+   value = std::prev(iterator)->value;
+   return true;
+}
+
+void AutomationLane::compact()
+{
+   auto last = std::unique(
+      _points.begin(), _points.end(),
+      [](const AutomationPoint& a, const AutomationPoint& b)
+      { return a.value == b.value; }
+   );
+   _points.erase(last, _points.end());
+   _points.shrink_to_fit();
+}
+
+const std::vector<AutomationPoint>& AutomationLane::points() const
+{
+   return _points;
+}
+
+/* ------------------------------------------------------ */
+/*                    automation clip                     */
+/* ------------------------------------------------------ */
+
+AutomationClip::AutomationClip(std::vector<AutomationLane> lanes)
+   : _lanes(std::move(lanes))
+{
+   std::sort(
+      _lanes.begin(), _lanes.end(),
+      [](const AutomationLane& a, const AutomationLane& b)
+      { return a.paramId() < b.paramId(); }
+   );
+
+   size_t numEvents = 0;
+   for (auto& lane : _lanes)
+   {
+      numEvents += lane.points().size();
+   }
+
+   _events.reserve(numEvents);
+   for (auto& lane : _lanes)
+   {
+      for (auto& point : lane.points())
+      {
+         _events.push_back({ point.frame, lane.paramId(), point.value });
+      }
+   }
+
+   std::stable_sort(
+      _events.begin(), _events.end(),
+      [](const AutomationEvent& a, const AutomationEvent& b)
+      { return a.frame < b.frame; }
+   );
+}
+
+const std::vector<AutomationLane>& AutomationClip::lanes() const
+{
+   return _lanes;
+}
+
+const AutomationLane* AutomationClip::lane(uint32_t paramId) const
+{
+   auto iterator = std::lower_bound(
+      _lanes.begin(), _lanes.end(), paramId,
+      [](const AutomationLane& lane, uint32_t id)
+      { return lane.paramId() < id; }
+   );
+
+   if (iterator == _lanes.end() || iterator->paramId() != paramId)
+   {
+      return nullptr;
+   }
+
+   return &*iterator;
+}
+
+const std::vector<AutomationEvent>& AutomationClip::events() const
+{
+   return _events;
+}
+
+size_t AutomationClip::firstEventAt(uint32_t frame) const
+{
+   auto iterator = std::lower_bound(
+      _events.begin(), _events.end(), frame,
+      [](const AutomationEvent& e, uint32_t f) { return e.frame < f; }
+   );
+   return iterator - _events.begin();
+}
+
+uint32_t AutomationClip::length() const
+{
+   return _events.empty() ? 0 : _events.back().frame;
+}
+
+/* ------------------------------------------------------ */
+/*                  automation recorder                   */
+/* ------------------------------------------------------ */
+
+void AutomationRecorder::start(uint64_t streamFrame)
+{
+   _lanes.clear();
+   _startFrame = streamFrame;
+   _recording  = true;
+}
+
+std::unique_ptr<AutomationClip> AutomationRecorder::stop()
+{
+   _recording = false;
+
+   std::vector<AutomationLane> lanes;
+   lanes.reserve(_lanes.size());
+   for (auto& [id, lane] : _lanes)
+   {
+      lane.compact();
+      lanes.push_back(std::move(lane));
+   }
+   _lanes.clear();
+
+   return std::make_unique<AutomationClip>(std::move(lanes));
+}
+
+bool AutomationRecorder::isRecording() const
+{
+   return _recording;
+}
+
+void AutomationRecorder::record(
+   uint32_t paramId, float value, uint64_t streamFrame
+)
+{
+   if (!_recording)
+   {
+      return;
+   }
+
+   uint64_t frame = streamFrame > _startFrame ? streamFrame - _startFrame : 0;
+   frame = std::min<uint64_t>(frame, std::numeric_limits<uint32_t>::max());
+
+   auto iterator = _lanes.try_emplace(paramId, paramId).first;
+   iterator->second.add(static_cast<uint32_t>(frame), value);
+}
+
+/* ------------------------------------------------------ */
+/*                   automation player                    */
+/* ------------------------------------------------------ */
+
+void AutomationPlayer::play(
+   std::unique_ptr<AutomationClip> clip, uint64_t streamFrame
+)
+{
+   auto playback        = std::make_unique<Playback>();
+   playback->clip       = std::move(clip);
+   playback->startFrame = streamFrame;
+   _playback.publish(std::move(playback));
+}
+
+void AutomationPlayer::stop()
+{
+   _playback.publish(nullptr);
+}
+
+uint64_t AutomationPlayer::position() const
+{
+   return _position.load();
+}
+
+uint32_t AutomationPlayer::advance(
+   uint64_t blockFrame, uint32_t numFrames, AutomationBlockEvent* events,
+   uint32_t maxEvents
+)
+{
+   Playback* playback = _playback.acquire();
+
+   if (playback != _active)
+   {
+      _active = playback;
+      _cursor = 0;
+      _chase  = 0;
+
+      if (_active != nullptr && blockFrame > _active->startFrame)
+      {
+         uint64_t frame = std::min<uint64_t>(
+            blockFrame - _active->startFrame,
+            std::numeric_limits<uint32_t>::max()
+         );
+         _cursor = _active->clip->firstEventAt(static_cast<uint32_t>(frame));
+      }
+      else
+      {
+         _chase = std::numeric_limits<size_t>::max();
+      }
+   }
+
+   if (_active == nullptr)
+   {
+      return 0;
+   }
+
+   const auto& lanes = _active->clip->lanes();
+   uint32_t count    = 0;
+
+   // Chase the values the automated parameters have at the start position.
+   if (_chase < lanes.size() && _cursor > 0)
+   {
+      uint32_t frame = _active->clip->events()[_cursor - 1].frame;
+      for (; _chase < lanes.size() && count < maxEvents; ++_chase)
+      {
+         float value;
+         if (lanes[_chase].valueAt(frame, value))
+         {
+            events[count++] = { 0, lanes[_chase].paramId(), value };
+         }
+      }
+      if (_chase < lanes.size())
+      {
+         return count;
+      }
+   }
+
+   const auto& clipEvents = _active->clip->events();
+   uint64_t blockEnd      = blockFrame + numFrames;
+
+   for (; _cursor < clipEvents.size() && count < maxEvents; ++_cursor)
+   {
+      uint64_t frame = _active->startFrame + clipEvents[_cursor].frame;
+      if (frame >= blockEnd)
+      {
+         break;
+      }
+
+      uint32_t offset
+         = frame > blockFrame ? static_cast<uint32_t>(frame - blockFrame) : 0;
+      events[count++]
+         = { offset, clipEvents[_cursor].paramId, clipEvents[_cursor].value };
+   }
+
+   _position.store(
+      blockEnd > _active->startFrame ? blockEnd - _active->startFrame : 0
+   );
+
+   return count;
+}
+
+} // namespace ImRt
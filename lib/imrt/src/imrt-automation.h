@@ -0,0 +1,268 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "imrt-rcu.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                     AUTOMATION LANE                                        */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A point of an automation lane: the value a parameter takes from the
+ * given frame on. Frames are counted relative to the start of the clip.
+ */
+struct AutomationPoint
+{
+   uint32_t frame;
+   float value;
+};
+
+/**
+ * @brief The automation of a single parameter as a list of points sorted by
+ * frame.
+ */
+class AutomationLane
+{
+public:
+   /**
+    * @brief Constructs a new empty automation lane for the parameter with the
+    * given ID.
+    */
+   AutomationLane(uint32_t paramId);
+   AutomationLane() = delete;
+
+   /**
+    * @brief Returns the ID of the automated parameter.
+    */
+   uint32_t paramId() const;
+
+   /**
+    * @brief Adds a point to the lane. A point at the same frame as an existing
+    * point replaces that point.
+    */
+   void add(uint32_t frame, float value);
+
+   /**
+    * @brief Looks up the value of the parameter at the given frame by binary
+    * search.
+    *
+    * @return false if the lane has no point at or before the given frame.
+    */
+   bool valueAt(uint32_t frame, float& value) const;
+
+   /**
+    * @brief Removes all points that do not change the parameter value.
+    */
+   void compact();
+
+   /**
+    * @brief Returns the points of the lane sorted by frame.
+    */
+   const std::vector<AutomationPoint>& points() const;
+
+private:
+   uint32_t _paramId;
+   std::vector<AutomationPoint> _points;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                     AUTOMATION CLIP                                        */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A single automation event of an AutomationClip.
+ */
+struct AutomationEvent
+{
+   uint32_t frame;
+   uint32_t paramId;
+   float value;
+};
+
+/**
+ * @brief An immutable set of automation lanes. In addition to the lanes the
+ * clip holds all points of all lanes merged into one timeline, so a player
+ * only has to advance a single cursor no matter how many parameters are
+ * automated.
+ */
+class AutomationClip
+{
+public:
+   /**
+    * @brief Constructs a new automation clip from the given lanes.
+    */
+   AutomationClip(std::vector<AutomationLane> lanes);
+   AutomationClip() = delete;
+
+   /**
+    * @brief Returns the lanes of the clip sorted by parameter ID.
+    */
+   const std::vector<AutomationLane>& lanes() const;
+
+   /**
+    * @brief Returns the lane of the parameter with the given ID or nullptr if
+    * the parameter is not automated by the clip.
+    */
+   const AutomationLane* lane(uint32_t paramId) const;
+
+   /**
+    * @brief Returns the events of all lanes sorted by frame.
+    */
+   const std::vector<AutomationEvent>& events() const;
+
+   /**
+    * @brief Returns the index of the first event at or after the given frame
+    * (binary search).
+    */
+   size_t firstEventAt(uint32_t frame) const;
+
+   /**
+    * @brief Returns the frame of the last event of the clip.
+    */
+   uint32_t length() const;
+
+private:
+   std::vector<AutomationLane> _lanes;
+   std::vector<AutomationEvent> _events;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                   AUTOMATION RECORDER                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Records timestamped parameter changes into per-parameter automation
+ * lanes. The recorder is typically owned by the Gui<> object and fed with the
+ * parameter changes announced by the widgets (cf. Gui::startRecording()). It
+ * must only be used by a single thread.
+ */
+class AutomationRecorder
+{
+public:
+   /**
+    * @brief Starts a new recording. Previously recorded points are discarded.
+    *
+    * @param streamFrame The current frame of the stream clock (cf.
+    * Dsp::streamFrame()), which becomes frame 0 of the recorded clip.
+    */
+   void start(uint64_t streamFrame);
+
+   /**
+    * @brief Stops the recording and returns the recorded, compacted clip.
+    */
+   std::unique_ptr<AutomationClip> stop();
+
+   /**
+    * @brief Returns whether the recorder is recording.
+    */
+   bool isRecording() const;
+
+   /**
+    * @brief Records a parameter change. Changes are ignored if the recorder is
+    * not recording.
+    *
+    * @param paramId The ID of the changed parameter.
+    * @param value The new value of the parameter.
+    * @param streamFrame The frame of the stream clock at which the change
+    * happened.
+    */
+   void record(uint32_t paramId, float value, uint64_t streamFrame);
+
+private:
+   std::map<uint32_t, AutomationLane> _lanes;
+   uint64_t _startFrame = 0;
+   bool _recording      = false;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                    AUTOMATION PLAYER                                       */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A parameter change produced by the AutomationPlayer for the current
+ * audio block. The offset is the frame within the block at which the change
+ * takes effect.
+ */
+struct AutomationBlockEvent
+{
+   uint32_t offset;
+   uint32_t paramId;
+   float value;
+};
+
+/**
+ * @brief Plays back an AutomationClip with sample-accurate timing. The clip is
+ * handed over to the DSP thread without locks, and the DSP thread advances a
+ * cursor through the merged event timeline of the clip once per audio block,
+ * so the cost of playback only depends on the number of events in the block.
+ */
+class AutomationPlayer
+{
+public:
+   /**
+    * @brief Starts playing the given clip. The clip is deleted by this thread
+    * once the DSP thread does not use it anymore. This method must not be
+    * called from the DSP thread.
+    *
+    * @param clip The clip to play.
+    * @param streamFrame The frame of the stream clock at which frame 0 of the
+    * clip should be played.
+    */
+   void play(std::unique_ptr<AutomationClip> clip, uint64_t streamFrame);
+
+   /**
+    * @brief Stops the playback. This method must not be called from the DSP
+    * thread.
+    */
+   void stop();
+
+   /**
+    * @brief Returns the frame of the clip that the DSP thread is about to
+    * play.
+    */
+   uint64_t position() const;
+
+   /**
+    * @brief Collects the automation events of an audio block. When a clip
+    * starts playing, the automated parameters are first set to their values
+    * at the start position. Events that do not fit into the given event array
+    * are delivered at the beginning of the next block. This method never
+    * blocks and does not allocate memory. It must only be called from the DSP
+    * thread.
+    *
+    * @param blockFrame The frame of the stream clock at which the block
+    * starts.
+    * @param numFrames The number of frames of the block.
+    * @param events The array to which the events of the block are written.
+    * @param maxEvents The size of the event array.
+    * @return The number of events written to the event array.
+    */
+   uint32_t advance(
+      uint64_t blockFrame, uint32_t numFrames, AutomationBlockEvent* events,
+      uint32_t maxEvents
+   );
+
+private:
+   struct Playback
+   {
+      std::unique_ptr<AutomationClip> clip;
+      uint64_t startFrame;
+   };
+
+   Rcu<Playback> _playback;
+   std::atomic<uint64_t> _position { 0 };
+
+   // Only accessed by the DSP thread.
+   Playback* _active = nullptr;
+   size_t _cursor    = 0;
+   size_t _chase     = 0;
+};
+
+} // namespace ImRt
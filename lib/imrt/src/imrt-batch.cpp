@@ -0,0 +1,265 @@
+#include "imrt-batch.h"
+#include "imgui_internal.h"
+#include "imrt-trace.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                     batch helpers                      */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const float pi = 3.14159265358979323846f;
+
+   // Keeps the indices of a single reservation within 16 bits.
+   const uint32_t maxVerticesPerReservation = 1 << 15;
+
+   const uint32_t verticesPerBar  = 12;
+   const uint32_t indicesPerBar   = 18;
+   const uint32_t verticesPerKnob = 98;
+   const uint32_t indicesPerKnob  = 432;
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                      widget batch                      */
+/* ------------------------------------------------------ */
+
+WidgetBatch::WidgetBatch()
+{
+   for (uint32_t i = 0; i < circleResolution; ++i)
+   {
+      float angle    = 2.0f * pi * i / circleResolution;
+      _unitCircle[i] = ImVec2(std::cos(angle), std::sin(angle));
+   }
+}
+
+void WidgetBatch::reserve(uint32_t numBars, uint32_t numKnobs)
+{
+   _vertices.reserve(numBars * verticesPerBar + numKnobs * verticesPerKnob);
+   _indices.reserve(numBars * indicesPerBar + numKnobs * indicesPerKnob);
+   _widgetEnds.reserve(numBars + numKnobs);
+}
+
+void WidgetBatch::bar(float fraction, ImVec2 size)
+{
+   ImVec2 topLeft     = ImGui::GetCursorScreenPos();
+   ImVec2 bottomRight = topLeft + size;
+   ImGui::ItemSize(size);
+
+   if (!ImGui::IsRectVisible(topLeft, bottomRight))
+   {
+      return;
+   }
+
+   // This also maps NaN, e.g. the level of silence, to an empty bar.
+   fraction = fraction > 0.0f ? std::min(fraction, 1.0f) : 0.0f;
+
+   ImU32 background  = ImGui::GetColorU32(ImGuiCol_FrameBg);
+   ImU32 fill        = ImGui::GetColorU32(ImGuiCol_PlotHistogram);
+   ImU32 shadeTop    = ImGui::GetColorU32(ImGuiCol_FrameBg, 0.0f);
+   ImU32 shadeBottom = ImGui::GetColorU32(ImGuiCol_FrameBg, 0.9f);
+
+   beginWidget();
+   addQuad(topLeft, bottomRight, background, background);
+   addQuad(
+      { topLeft.x, topLeft.y + (1.0f - fraction) * size.y }, bottomRight, fill,
+      fill
+   );
+   addQuad(topLeft, bottomRight, shadeTop, shadeBottom);
+   endWidget();
+}
+
+bool WidgetBatch::knob(
+   const char* label, float* value, float min, float max, float speed,
+   const char* format, bool logarithmic, float size
+)
+{
+   float width = size * ImGui::GetIO().FontGlobalScale;
+
+   ImGui::PushID(label);
+   ImGui::BeginGroup();
+
+   const char* labelEnd = ImGui::FindRenderedTextEnd(label);
+   float labelWidth     = ImGui::CalcTextSize(label, labelEnd).x;
+   ImGui::SetCursorPosX(
+      ImGui::GetCursorPosX() + std::max(0.0f, 0.5f * (width - labelWidth))
+   );
+   ImGui::TextUnformatted(label, labelEnd);
+
+   ImVec2 topLeft = ImGui::GetCursorScreenPos();
+   ImGui::InvisibleButton("##knob", { width, width });
+   bool hovered = ImGui::IsItemHovered();
+   bool active  = ImGui::IsItemActive();
+
+   ImGuiSliderFlags flags
+      = ImGuiSliderFlags_Vertical | ImGuiSliderFlags_AlwaysClamp;
+   if (logarithmic)
+   {
+      flags |= ImGuiSliderFlags_Logarithmic;
+   }
+   bool changed = ImGui::DragBehavior(
+      ImGui::GetItemID(), ImGuiDataType_Float, value, speed, &min, &max,
+      format, flags
+   );
+
+   if (ImGui::IsRectVisible(topLeft, topLeft + ImVec2(width, width)))
+   {
+      float position = logarithmic && min > 0.0f
+                        ? std::log(*value / min) / std::log(max / min)
+                        : (*value - min) / (max - min);
+      float angle    = pi * (0.75f + 1.5f * std::clamp(position, 0.0f, 1.0f));
+      float radius   = 0.5f * width;
+      ImVec2 center  = topLeft + ImVec2(radius, radius);
+
+      // The same colors as the dot knobs of imgui-knobs.
+      ImVec4 dotColor = ImGui::GetStyleColorVec4(
+         hovered || active ? ImGuiCol_ButtonHovered : ImGuiCol_ButtonActive
+      );
+      ImVec4 bodyColor = dotColor * ImVec4(0.5f, 0.5f, 0.5f, 1.0f);
+
+      beginWidget();
+      addCircle(center, 0.85f * radius, ImGui::GetColorU32(bodyColor), 1);
+      addCircle(
+         center + ImVec2(std::cos(angle), std::sin(angle)) * (0.6f * radius),
+         0.12f * radius, ImGui::GetColorU32(dotColor), 3
+      );
+      endWidget();
+   }
+
+   char text[64];
+   std::snprintf(text, sizeof(text), format, *value);
+   float textWidth = ImGui::CalcTextSize(text).x;
+   ImGui::SetCursorPosX(
+      ImGui::GetCursorPosX() + std::max(0.0f, 0.5f * (width - textWidth))
+   );
+   ImGui::TextUnformatted(text);
+
+   ImGui::EndGroup();
+   ImGui::PopID();
+   return changed;
+}
+
+void WidgetBatch::render()
+{
+   IMRT_TRACE_SCOPE("WidgetBatch::render");
+   uint32_t numWidgets = uint32_t(_widgetEnds.size());
+   uint32_t begin      = 0;
+   while (begin < numWidgets)
+   {
+      uint32_t firstVertex = begin > 0 ? _widgetEnds[begin - 1].vertex : 0;
+      uint32_t end         = begin + 1;
+      while (end < numWidgets
+             && _widgetEnds[end].vertex - firstVertex
+                   <= maxVerticesPerReservation)
+      {
+         ++end;
+      }
+      emit(begin, end);
+      begin = end;
+   }
+
+   _vertices.clear();
+   _indices.clear();
+   _widgetEnds.clear();
+   _drawList = nullptr;
+}
+
+void WidgetBatch::beginWidget()
+{
+   ImDrawList* drawList = ImGui::GetWindowDrawList();
+   assert(_drawList == nullptr || _drawList == drawList);
+
+   _drawList   = drawList;
+   _whitePixel = ImGui::GetFontTexUvWhitePixel();
+}
+
+void WidgetBatch::endWidget()
+{
+   _widgetEnds.push_back(
+      { uint32_t(_vertices.size()), uint32_t(_indices.size()) }
+   );
+}
+
+void WidgetBatch::addQuad(
+   ImVec2 min, ImVec2 max, ImU32 colorTop, ImU32 colorBottom
+)
+{
+   uint32_t first = uint32_t(_vertices.size());
+   _vertices.push_back({ min, _whitePixel, colorTop });
+   _vertices.push_back({ { max.x, min.y }, _whitePixel, colorTop });
+   _vertices.push_back({ max, _whitePixel, colorBottom });
+   _vertices.push_back({ { min.x, max.y }, _whitePixel, colorBottom });
+
+   _indices.insert(
+      _indices.end(),
+      { first, first + 1, first + 2, first, first + 2, first + 3 }
+   );
+}
+
+void WidgetBatch::addCircle(
+   ImVec2 center, float radius, ImU32 color, uint32_t step
+)
+{
+   // A fan with a one pixel wide fringe that fades out to anti-alias the edge.
+   ImU32 transparent = color & ~IM_COL32_A_MASK;
+
+   uint32_t first = uint32_t(_vertices.size());
+   _vertices.push_back({ center, _whitePixel, color });
+   for (uint32_t i = 0; i < circleResolution; i += step)
+   {
+      ImVec2 direction = _unitCircle[i];
+      _vertices.push_back(
+         { center + direction * (radius - 0.5f), _whitePixel, color }
+      );
+      _vertices.push_back(
+         { center + direction * (radius + 0.5f), _whitePixel, transparent }
+      );
+   }
+
+   uint32_t numSegments = circleResolution / step;
+   for (uint32_t i = 0; i < numSegments; ++i)
+   {
+      uint32_t inner     = first + 1 + 2 * i;
+      uint32_t nextInner = first + 1 + 2 * ((i + 1) % numSegments);
+      _indices.insert(
+         _indices.end(),
+         { first, inner, nextInner, inner, inner + 1, nextInner + 1, inner,
+           nextInner + 1, nextInner }
+      );
+   }
+}
+
+void WidgetBatch::emit(uint32_t widgetBegin, uint32_t widgetEnd)
+{
+   WidgetEnd first = widgetBegin > 0 ? _widgetEnds[widgetBegin - 1]
+                                     : WidgetEnd { 0, 0 };
+   WidgetEnd last  = _widgetEnds[widgetEnd - 1];
+
+   uint32_t numVertices = last.vertex - first.vertex;
+   uint32_t numIndices  = last.index - first.index;
+   _drawList->PrimReserve(int(numIndices), int(numVertices));
+
+   std::copy(
+      _vertices.begin() + first.vertex, _vertices.begin() + last.vertex,
+      _drawList->_VtxWritePtr
+   );
+
+   // The reservation may have started a new vertex offset.
+   uint32_t base = _drawList->_VtxCurrentIdx - first.vertex;
+   for (uint32_t i = first.index; i < last.index; ++i)
+   {
+      _drawList->_IdxWritePtr[i - first.index] = ImDrawIdx(base + _indices[i]);
+   }
+
+   _drawList->_VtxWritePtr += numVertices;
+   _drawList->_IdxWritePtr += numIndices;
+   _drawList->_VtxCurrentIdx += numVertices;
+}
+
+} // namespace ImRt
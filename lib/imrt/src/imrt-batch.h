@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <imgui.h>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                          WIDGET BATCH                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Collects the geometry of meters and knobs and emits it into the draw
+ * list of the current window at once.
+ *
+ * ImGui already merges the primitives of a window into one draw call per
+ * texture and clip rectangle, so the cost of dense pages with hundreds of
+ * controls lies in building the geometry: every rounded rectangle and circle
+ * is tessellated and anti-aliased on the fly. A batch draws bars as plain
+ * quads and knobs as fans of precomputed unit circles, all textured with the
+ * white pixel of the font atlas, keeps its buffers between frames and copies
+ * the whole batch into the draw list with as few reservations as possible.
+ * Widgets that are scrolled out of view only handle their input.
+ *
+ * Widgets are added with the batch overloads of their show() methods (cf.
+ * ValueBar::show(), Knob::show()). All widgets of a batch must belong to the
+ * same window, and WidgetBatch::render() must be called before that window
+ * ends, e.g. before ImGui::EndChild().
+ */
+class WidgetBatch
+{
+public:
+   WidgetBatch();
+
+   /**
+    * @brief Preallocates the buffers for the given number of widgets, so the
+    * batch does not allocate memory while the GUI is running.
+    */
+   void reserve(uint32_t numBars, uint32_t numKnobs);
+
+   /**
+    * @brief Adds a vertical bar at the current ImGui CursorPos, filled from
+    * the bottom up to the given fraction of its height. Unlike the bars that
+    * are drawn directly, batched bars are not rounded.
+    */
+   void bar(float fraction, ImVec2 size);
+
+   /**
+    * @brief Adds a knob with its label above and its value below at the
+    * current ImGui CursorPos. The knob is dragged vertically like the knobs of
+    * imgui-knobs, but shows its value as text instead of an input field.
+    *
+    * @param label The label, which also serves as ImGui ID.
+    * @param value The value controlled by the knob.
+    * @param min The minimum value.
+    * @param max The maximum value.
+    * @param speed The change of the value per pixel dragged.
+    * @param format The format in which the value is shown.
+    * @param logarithmic Whether the knob is dragged on a logarithmic scale.
+    * @param size The diameter of the knob.
+    * @return true if the value was changed.
+    */
+   bool knob(
+      const char* label, float* value, float min, float max, float speed,
+      const char* format, bool logarithmic, float size
+   );
+
+   /**
+    * @brief Emits the geometry of all widgets added since the last call into
+    * the draw list of their window and empties the batch.
+    */
+   void render();
+
+private:
+   static constexpr uint32_t circleResolution = 36;
+
+   // The vertex and index counts after each widget, so that batches that are
+   // too large for 16-bit indices can be split between widgets.
+   struct WidgetEnd
+   {
+      uint32_t vertex, index;
+   };
+
+   std::vector<ImDrawVert> _vertices;
+   std::vector<uint32_t> _indices; // relative to the first vertex of the batch
+   std::vector<WidgetEnd> _widgetEnds;
+   ImDrawList* _drawList = nullptr;
+   ImVec2 _whitePixel;
+   ImVec2 _unitCircle[circleResolution];
+
+   void beginWidget();
+   void endWidget();
+   void addQuad(ImVec2 min, ImVec2 max, ImU32 colorTop, ImU32 colorBottom);
+   void addCircle(ImVec2 center, float radius, ImU32 color, uint32_t step);
+   void emit(uint32_t widgetBegin, uint32_t widgetEnd);
+};
+
+} // namespace ImRt
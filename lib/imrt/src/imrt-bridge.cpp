@@ -0,0 +1,607 @@
+#include "imrt-bridge.h"
+#include "imrt-ring.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <new>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                     bridge segment                     */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   // "IMRTBRDG", stored last by the server, so a GUI never attaches to a
+   // segment that is not yet initialized.
+   const uint64_t bridgeMagic   = 0x4744524254524d49;
+   const uint32_t bridgeVersion = 1;
+
+   const uint32_t numBridgeCommands = 4096;
+
+   enum BridgeCommandType : uint32_t
+   {
+      CommandChange,
+      CommandPresetBegin,
+      CommandPresetValue,
+      CommandPresetEnd
+   };
+
+   struct BridgeCommand
+   {
+      uint32_t type;
+      uint32_t paramId;
+      float value;
+   };
+
+   struct BridgeSlot
+   {
+      uint32_t paramId;
+      std::atomic<float> value;
+      std::atomic<bool> queued; // the slot is in the feedback ring
+   };
+
+   // A ring like Ring<T> whose items are stored inline, so it can live in
+   // shared memory. Its capacity must be a power of two.
+   template <typename T, uint32_t Capacity>
+   struct SharedRing
+   {
+      RingPositions positions;
+      T items[Capacity];
+
+      void reset()
+      {
+         positions.reset(Capacity);
+      }
+
+      bool push(const T& item)
+      {
+         uint32_t numItems = 1;
+         uint64_t position = positions.beginWrite(numItems);
+         if (numItems == 0)
+         {
+            return false;
+         }
+         items[position & (Capacity - 1)] = item;
+         positions.endWrite(position, 1);
+         return true;
+      }
+
+      bool pop(T& item)
+      {
+         uint32_t numItems = 1;
+         uint64_t position = positions.beginRead(numItems);
+         if (numItems == 0)
+         {
+            return false;
+         }
+         item = items[position & (Capacity - 1)];
+         positions.endRead(position, 1);
+         return true;
+      }
+   };
+
+   struct SharedTap
+   {
+      RingPositions positions;
+      std::atomic<uint32_t> numChannels;
+      float samples[maxBridgeTapChannels][bridgeTapCapacity];
+   };
+
+   static_assert(
+      std::atomic<uint64_t>::is_always_lock_free
+         && std::atomic<float>::is_always_lock_free
+         && std::atomic<bool>::is_always_lock_free,
+      "the bridge needs address-free atomics"
+   );
+   static_assert(
+      (bridgeTapCapacity & (bridgeTapCapacity - 1)) == 0,
+      "the tap capacity must be a power of two"
+   );
+
+} // namespace
+
+/**
+ * The layout of the shared memory segment. It only holds plain data and
+ * lock-free atomics, so both processes access it without copies or locks.
+ */
+struct BridgeSegment
+{
+   std::atomic<uint64_t> magic;
+   uint32_t version;
+   uint32_t numParameters;
+   uint64_t size;
+
+   std::atomic<uint32_t> sampleRate;
+   std::atomic<uint64_t> streamFrame;
+
+   BridgeSlot slots[maxBridgeParameters];
+   SharedRing<BridgeCommand, numBridgeCommands> commands; // GUI to DSP
+   SharedRing<uint32_t, 2 * maxBridgeParameters> feedback; // DSP to GUI
+   SharedTap taps[maxBridgeTaps];
+};
+
+/* ------------------------------------------------------ */
+/*                     shared memory                      */
+/* ------------------------------------------------------ */
+
+SharedMemory::~SharedMemory()
+{
+   close();
+}
+
+bool SharedMemory::create(const std::string& name, size_t size)
+{
+   close();
+
+#if defined(_WIN32)
+   return false;
+#else
+   std::string path = "/" + name;
+   shm_unlink(path.c_str());
+
+   int file = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+   if (file < 0)
+   {
+      return false;
+   }
+
+   void* data = MAP_FAILED;
+   if (ftruncate(file, off_t(size)) == 0)
+   {
+      data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+   }
+   ::close(file);
+
+   if (data == MAP_FAILED)
+   {
+      shm_unlink(path.c_str());
+      return false;
+   }
+
+   _data  = data;
+   _size  = size;
+   _name  = path;
+   _owner = true;
+   return true;
+#endif
+}
+
+bool SharedMemory::open(const std::string& name, size_t size)
+{
+   close();
+
+#if defined(_WIN32)
+   return false;
+#else
+   std::string path = "/" + name;
+   int file         = shm_open(path.c_str(), O_RDWR, 0);
+   if (file < 0)
+   {
+      return false;
+   }
+
+   void* data = MAP_FAILED;
+   struct stat status;
+   if (fstat(file, &status) == 0 && size_t(status.st_size) >= size)
+   {
+      data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+   }
+   ::close(file);
+
+   if (data == MAP_FAILED)
+   {
+      return false;
+   }
+
+   _data  = data;
+   _size  = size;
+   _name  = path;
+   _owner = false;
+   return true;
+#endif
+}
+
+void SharedMemory::close()
+{
+#if !defined(_WIN32)
+   if (_data)
+   {
+      munmap(_data, _size);
+      if (_owner)
+      {
+         shm_unlink(_name.c_str());
+      }
+   }
+#endif
+   _data  = nullptr;
+   _size  = 0;
+   _owner = false;
+   _name.clear();
+}
+
+void* SharedMemory::data() const
+{
+   return _data;
+}
+
+/* ------------------------------------------------------ */
+/*                     bridge server                      */
+/* ------------------------------------------------------ */
+
+BridgeServer::BridgeServer(
+   DspParameters& parameters, const std::atomic<uint64_t>& streamFrame
+)
+   : _parameters(parameters)
+   , _streamFrame(streamFrame)
+{
+}
+
+BridgeServer::~BridgeServer()
+{
+   stop();
+}
+
+bool BridgeServer::start(BridgeSettings settings)
+{
+   stop();
+   _settings = settings;
+
+   if (_segment)
+   {
+      _running = true;
+      _thread  = std::thread(&BridgeServer::poll, this);
+      return true;
+   }
+
+   _layouts.clear();
+   std::vector<float> values;
+   _parameters.forEach(
+      [this, &values](DspParameter& param)
+      {
+         _layouts.push_back(param);
+         values.push_back(param.value());
+      }
+   );
+   if (_layouts.size() > maxBridgeParameters
+       || !_memory.create(settings.name, sizeof(BridgeSegment)))
+   {
+      return false;
+   }
+
+   _segment                = new (_memory.data()) BridgeSegment();
+   _segment->version       = bridgeVersion;
+   _segment->numParameters = static_cast<uint32_t>(_layouts.size());
+   _segment->size          = sizeof(BridgeSegment);
+   _segment->streamFrame.store(_streamFrame.load());
+
+   for (size_t i = 0; i < _layouts.size(); ++i)
+   {
+      _segment->slots[i].paramId = _layouts[i].id();
+      _segment->slots[i].value.store(values[i]);
+   }
+
+   _segment->commands.reset();
+   _segment->feedback.reset();
+   for (SharedTap& tap : _segment->taps)
+   {
+      tap.positions.reset(bridgeTapCapacity);
+   }
+   _segment->magic.store(bridgeMagic, std::memory_order_release);
+
+   _running = true;
+   _thread  = std::thread(&BridgeServer::poll, this);
+   return true;
+}
+
+void BridgeServer::stop()
+{
+   _running = false;
+   if (_thread.joinable())
+   {
+      _thread.join();
+   }
+}
+
+bool BridgeServer::isRunning() const
+{
+   return _running.load();
+}
+
+void BridgeServer::setSampleRate(uint32_t sampleRate)
+{
+   if (_segment)
+   {
+      _segment->sampleRate.store(sampleRate);
+   }
+}
+
+uint32_t
+BridgeServer::writeTap(uint32_t tap, const Buffer& buffer, uint32_t numFrames)
+{
+   if (!_segment || tap >= maxBridgeTaps)
+   {
+      return 0;
+   }
+
+   SharedTap& shared    = _segment->taps[tap];
+   uint32_t numChannels = std::min(
+      buffer.getNumChannels(), static_cast<uint32_t>(maxBridgeTapChannels)
+   );
+   shared.numChannels.store(numChannels, std::memory_order_relaxed);
+
+   uint64_t position = shared.positions.beginWrite(numFrames);
+   uint32_t index = static_cast<uint32_t>(position) & (bridgeTapCapacity - 1);
+   uint32_t first = std::min(numFrames, bridgeTapCapacity - index);
+   for (uint32_t channel = 0; channel < numChannels; ++channel)
+   {
+      const float* samples = &buffer.getSample(channel, 0);
+      float* data          = shared.samples[channel];
+      std::copy(samples, samples + first, data + index);
+      std::copy(samples + first, samples + numFrames, data);
+   }
+   shared.positions.endWrite(position, numFrames);
+   return numFrames;
+}
+
+void BridgeServer::poll()
+{
+   auto interval = std::chrono::duration<double>(_settings.pollInterval);
+   while (_running)
+   {
+      receiveCommands();
+      sendChanges();
+      _segment->streamFrame.store(_streamFrame.load());
+      std::this_thread::sleep_for(interval);
+   }
+}
+
+void BridgeServer::receiveCommands()
+{
+   BridgeCommand command;
+   while (_segment->commands.pop(command))
+   {
+      uint32_t index = slot(command.paramId);
+      switch (command.type)
+      {
+      case CommandChange:
+         if (index < _layouts.size())
+         {
+            _parameters.announceChange(command.paramId, command.value);
+            _segment->slots[index].value.store(command.value);
+         }
+         break;
+
+      case CommandPresetBegin:
+         _preset = Preset();
+         break;
+
+      case CommandPresetValue:
+         if (index < _layouts.size())
+         {
+            _preset.setValue(command.paramId, command.value);
+         }
+         break;
+
+      case CommandPresetEnd:
+         _parameters.publishPreset(_preset);
+         for (const PresetValue& value : _preset.values())
+         {
+            uint32_t index = slot(value.paramId);
+            _segment->slots[index].value.store(
+               _layouts[index].constrain(value.value)
+            );
+         }
+         break;
+      }
+   }
+}
+
+void BridgeServer::sendChanges()
+{
+   _parameters.receiveChanges(
+      [this](uint32_t paramId, float value)
+      {
+         // parameters added after start() have no slot
+         uint32_t index = slot(paramId);
+         if (index >= _layouts.size())
+         {
+            return;
+         }
+
+         _segment->slots[index].value.store(value);
+         if (!_segment->slots[index].queued.exchange(true))
+         {
+            _segment->feedback.push(index);
+         }
+      }
+   );
+}
+
+uint32_t BridgeServer::slot(uint32_t paramId)
+{
+   auto iterator = std::lower_bound(
+      _layouts.begin(), _layouts.end(), paramId,
+      [](ParameterLayout& layout, uint32_t id) { return layout.id() < id; }
+   );
+   if (iterator == _layouts.end() || iterator->id() != paramId)
+   {
+      return static_cast<uint32_t>(_layouts.size());
+   }
+   return static_cast<uint32_t>(iterator - _layouts.begin());
+}
+
+/* ------------------------------------------------------ */
+/*                       remote dsp                       */
+/* ------------------------------------------------------ */
+
+RemoteDsp::~RemoteDsp()
+{
+   detach();
+}
+
+void RemoteDsp::addParameter(ParameterLayout& layout)
+{
+   assert(!_segment);
+   parameters.addParameter(layout);
+}
+
+bool RemoteDsp::attach(const std::string& name)
+{
+   detach();
+
+   if (!_memory.open(name, sizeof(BridgeSegment)))
+   {
+      return false;
+   }
+
+   auto segment = static_cast<BridgeSegment*>(_memory.data());
+   bool valid   = segment->magic.load(std::memory_order_acquire) == bridgeMagic
+      && segment->version == bridgeVersion
+      && segment->size == sizeof(BridgeSegment);
+
+   uint32_t numParameters = 0;
+   parameters.forEach(
+      [&](DspParameter& param)
+      {
+         valid = valid && numParameters < segment->numParameters
+            && segment->slots[numParameters].paramId == param.id();
+         ++numParameters;
+      }
+   );
+   if (!valid || numParameters != segment->numParameters)
+   {
+      _memory.close();
+      return false;
+   }
+
+   // Audio written to the taps while no GUI was attached is outdated.
+   for (SharedTap& tap : segment->taps)
+   {
+      uint32_t numFrames = bridgeTapCapacity;
+      uint64_t position  = tap.positions.beginRead(numFrames);
+      tap.positions.endRead(position, numFrames);
+   }
+
+   _segment  = segment;
+   _syncSlot = 0;
+   return true;
+}
+
+void RemoteDsp::detach()
+{
+   _segment = nullptr;
+   _memory.close();
+}
+
+bool RemoteDsp::isAttached() const
+{
+   return _segment != nullptr;
+}
+
+void RemoteDsp::announceParameterChange(uint32_t paramId, float& newValue)
+{
+   if (_segment)
+   {
+      _segment->commands.push({ CommandChange, paramId, newValue });
+   }
+}
+
+void RemoteDsp::applyPreset(const Preset& preset)
+{
+   auto numValues = static_cast<uint32_t>(preset.values().size());
+   if (!_segment || _segment->commands.positions.space() < numValues + 2)
+   {
+      return;
+   }
+
+   _segment->commands.push({ CommandPresetBegin, 0, 0.0f });
+   for (const PresetValue& value : preset.values())
+   {
+      _segment->commands.push({ CommandPresetValue, value.paramId, value.value }
+      );
+   }
+   _segment->commands.push({ CommandPresetEnd, 0, 0.0f });
+}
+
+uint64_t RemoteDsp::streamFrame()
+{
+   return _segment ? _segment->streamFrame.load() : 0;
+}
+
+uint32_t RemoteDsp::sampleRate()
+{
+   return _segment ? _segment->sampleRate.load() : 0;
+}
+
+uint32_t RemoteDsp::readTap(uint32_t tap, Buffer& window)
+{
+   if (!_segment || tap >= maxBridgeTaps)
+   {
+      return 0;
+   }
+
+   SharedTap& shared    = _segment->taps[tap];
+   uint32_t windowSize  = window.getNumFrames();
+   uint32_t numFrames   = bridgeTapCapacity;
+   uint64_t position    = shared.positions.beginRead(numFrames);
+   uint32_t numChannels = std::min(
+      shared.numChannels.load(std::memory_order_relaxed),
+      window.getNumChannels()
+   );
+
+   // Frames that do not fit into the window are skipped.
+   uint32_t skipped = numFrames > windowSize ? numFrames - windowSize : 0;
+   uint32_t kept    = numFrames - skipped;
+   uint32_t index
+      = static_cast<uint32_t>(position + skipped) & (bridgeTapCapacity - 1);
+   uint32_t first = std::min(kept, bridgeTapCapacity - index);
+   for (uint32_t channel = 0; channel < numChannels; ++channel)
+   {
+      float* samples    = &window.getSample(channel, 0);
+      float* end        = samples + windowSize;
+      const float* data = shared.samples[channel];
+      std::copy(samples + kept, end, samples);
+      std::copy(data + index, data + index + first, end - kept);
+      std::copy(data, data + kept - first, end - kept + first);
+   }
+   shared.positions.endRead(position, numFrames);
+   return numFrames;
+}
+
+bool RemoteDsp::popParameterChange(uint32_t& paramId, float& value)
+{
+   if (!_segment)
+   {
+      return false;
+   }
+
+   // After attaching, the values of all parameters are reported first.
+   uint32_t index = _syncSlot;
+   if (index < _segment->numParameters)
+   {
+      ++_syncSlot;
+   }
+   else if (_segment->feedback.pop(index))
+   {
+      _segment->slots[index].queued.store(false);
+   }
+   else
+   {
+      return false;
+   }
+
+   paramId = _segment->slots[index].paramId;
+   value   = _segment->slots[index].value.load();
+   return true;
+}
+
+} // namespace ImRt
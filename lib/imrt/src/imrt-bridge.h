@@ -0,0 +1,317 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "imrt-params.h"
+#include "imrt-presets.h"
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+struct BridgeSegment;
+
+/* -------------------------------------------------------------------------- */
+/*                          SHARED MEMORY                                     */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A named shared memory segment mapped into the address space of the
+ * process. The segment is removed when the process that created it unmaps
+ * it. Shared memory is only supported on POSIX systems so far.
+ */
+class SharedMemory
+{
+public:
+   SharedMemory() = default;
+   ~SharedMemory();
+
+   SharedMemory(const SharedMemory&)            = delete;
+   SharedMemory& operator=(const SharedMemory&) = delete;
+
+   /**
+    * @brief Creates a zero-filled segment of the given size and maps it. An
+    * existing segment of the same name, e.g. left behind by a crashed
+    * process, is replaced.
+    *
+    * @return false if the segment could not be created.
+    */
+   bool create(const std::string& name, size_t size);
+
+   /**
+    * @brief Maps an existing segment of the given size.
+    *
+    * @return false if the segment does not exist or is smaller.
+    */
+   bool open(const std::string& name, size_t size);
+
+   /**
+    * @brief Unmaps the segment and removes it if it was created by this
+    * object.
+    */
+   void close();
+
+   /**
+    * @brief Returns the mapped memory or nullptr if no segment is mapped.
+    */
+   void* data() const;
+
+private:
+   void* _data  = nullptr;
+   size_t _size = 0;
+   std::string _name;
+   bool _owner = false;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                          BRIDGE SERVER                                     */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Settings of a BridgeServer.
+ */
+struct BridgeSettings
+{
+   std::string name    = "imrt"; // name of the shared memory segment
+   double pollInterval = 0.002;  // seconds between two polls of the rings
+};
+
+/**
+ * @brief Limits of the shared memory segment of a bridge, which has a fixed
+ * size so that it can be laid out as plain old data.
+ */
+constexpr uint32_t maxBridgeParameters  = 1024;
+constexpr uint32_t maxBridgeTaps        = 4;
+constexpr uint32_t maxBridgeTapChannels = 2;
+constexpr uint32_t bridgeTapCapacity    = 16384; // frames per tap
+
+/**
+ * @brief The DSP side of a bridge that lets a GUI run in another process (cf.
+ * RemoteDsp), so a crashing or stalling GUI cannot take the audio engine down
+ * with it. It is typically owned by the Dsp<> object (cf. Dsp::startBridge()).
+ *
+ * The server creates a shared memory segment that holds a slot with the
+ * current value of every parameter, a lock-free ring of commands from the GUI
+ * and a lock-free ring of parameter changes made by the DSP, as well as taps,
+ * i.e. frame rings that carry audio for meters and scopes to the GUI. A
+ * thread of the server polls the command ring and announces the commands to
+ * the DspParameters, and it reports the changes made by the DSP to the GUI,
+ * so it takes the role of the GUI thread of the process: an in-process Gui<>
+ * must not be used at the same time. The audio thread only writes the taps.
+ * A GUI can attach to and detach from the segment at any time without
+ * affecting the audio.
+ */
+class BridgeServer
+{
+public:
+   /**
+    * @brief Constructs a new bridge server for the given DSP parameters and
+    * stream clock.
+    */
+   BridgeServer(
+      DspParameters& parameters, const std::atomic<uint64_t>& streamFrame
+   );
+   BridgeServer() = delete;
+
+   /**
+    * @brief Stops the server, unmaps the segment and destroys the object.
+    * The audio thread must not write taps anymore.
+    */
+   ~BridgeServer();
+
+   /**
+    * @brief Creates the shared memory segment, unless the server has created
+    * it already, and starts the polling thread. The segment has a slot for
+    * each parameter that exists at this point; parameters added later are
+    * not bridged.
+    *
+    * @return false if there are more than maxBridgeParameters parameters or
+    * the segment could not be created.
+    */
+   bool start(BridgeSettings settings = BridgeSettings());
+
+   /**
+    * @brief Stops the polling thread. The segment stays mapped, so the audio
+    * thread may keep writing taps.
+    */
+   void stop();
+
+   /**
+    * @brief Returns true if the polling thread is running.
+    */
+   bool isRunning() const;
+
+   /**
+    * @brief Publishes the sample rate of the stream to the GUI.
+    */
+   void setSampleRate(uint32_t sampleRate);
+
+   /**
+    * @brief Writes the first frames of a buffer into a tap. Frames that do
+    * not fit are dropped, e.g. while no GUI is attached. This method never
+    * blocks and does not allocate memory. It must only be called by the DSP
+    * thread.
+    *
+    * @param tap The index of the tap, less than maxBridgeTaps.
+    * @param buffer The buffer, of which at most maxBridgeTapChannels channels
+    * are written.
+    * @param numFrames The number of frames to write.
+    * @return The number of frames written.
+    */
+   uint32_t writeTap(uint32_t tap, const Buffer& buffer, uint32_t numFrames);
+
+private:
+   DspParameters& _parameters;
+   const std::atomic<uint64_t>& _streamFrame;
+
+   SharedMemory _memory;
+   BridgeSegment* _segment = nullptr;
+   BridgeSettings _settings;
+
+   std::thread _thread;
+   std::atomic<bool> _running { false };
+
+   std::vector<ParameterLayout> _layouts; // layout of each slot, by ID
+   Preset _preset;
+
+   void poll();
+   void receiveCommands();
+   void sendChanges();
+   uint32_t slot(uint32_t paramId);
+};
+
+/* -------------------------------------------------------------------------- */
+/*                            REMOTE DSP                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The GUI side of a bridge: a stand-in for a Dsp<> object that runs in
+ * another process and is reached through the shared memory segment of its
+ * BridgeServer. It offers the part of the Dsp<> interface a Gui<> uses, so a
+ * GUI class can be instantiated as Gui<MyGui, RemoteDsp> and show the same
+ * widgets as an in-process GUI. The parameters must be added with the same
+ * layouts as in the DSP process.
+ *
+ * Only one RemoteDsp may be attached to a segment at a time. While the
+ * RemoteDsp is detached, changes are dropped. After attaching, the
+ * current values of all parameters are reported to the GUI (cf.
+ * RemoteDsp::receiveParameterChanges()), so the GUI can detach and reattach
+ * at any time, e.g. when the window is closed and reopened or the GUI process
+ * is restarted.
+ */
+class RemoteDsp
+{
+   template <typename, typename>
+   friend class Gui;
+
+public:
+   RemoteDsp() = default;
+   ~RemoteDsp();
+
+   /**
+    * @brief Adds a parameter with the same layout as in the DSP process.
+    * Parameters must be added before the RemoteDsp is attached.
+    */
+   void addParameter(ParameterLayout& layout);
+
+   /**
+    * @brief Maps the segment of the BridgeServer with the given name.
+    *
+    * @return false if there is no such segment or its parameters differ from
+    * the parameters of the RemoteDsp.
+    */
+   bool attach(const std::string& name = "imrt");
+
+   /**
+    * @brief Unmaps the segment. The DSP process keeps running.
+    */
+   void detach();
+
+   /**
+    * @brief Returns true if the RemoteDsp is attached to a segment.
+    */
+   bool isAttached() const;
+
+   /**
+    * @brief Sends a change of a parameter value to the DSP process (cf.
+    * Dsp::announceParameterChange()). The change is dropped if the command
+    * ring is full, i.e. if the DSP process does not poll it.
+    */
+   void announceParameterChange(uint32_t paramId, float& newValue);
+
+   /**
+    * @brief Sends the values of a preset to the DSP process, which applies
+    * them as one batch (cf. Dsp::applyPreset()). The preset is dropped if the
+    * command ring is too full to hold all of its values.
+    */
+   void applyPreset(const Preset& preset);
+
+   /**
+    * @brief Returns the stream clock of the DSP process as of the last poll
+    * of its bridge server.
+    */
+   uint64_t streamFrame();
+
+   /**
+    * @brief Returns the sample rate of the DSP process or 0 if it is not
+    * known.
+    */
+   uint32_t sampleRate();
+
+   /**
+    * @brief Does nothing, since the buffer size is controlled by the DSP
+    * process (cf. Dsp::pollBufferSizeController()).
+    */
+   bool pollBufferSizeController()
+   {
+      return false;
+   }
+
+   /**
+    * @brief Calls the given function with the ID and the new value of every
+    * parameter that has been changed by the DSP process since the last call
+    * (cf. Dsp::receiveParameterChanges()), and with the values of all
+    * parameters after attaching.
+    *
+    * @param function A callable with the signature
+    * void(uint32_t paramId, float value).
+    */
+   template <typename Function>
+   void receiveParameterChanges(Function&& function)
+   {
+      uint32_t paramId;
+      float value;
+      while (popParameterChange(paramId, value))
+      {
+         function(paramId, value);
+      }
+   }
+
+   /**
+    * @brief Reads all frames from a tap and appends them to a window that
+    * holds the most recent frames, e.g. for a scope (cf.
+    * FrameRing::readLatest()).
+    *
+    * @param tap The index of the tap, less than maxBridgeTaps.
+    * @param window The window. Channels the tap does not have are left
+    * untouched.
+    * @return The number of frames read.
+    */
+   uint32_t readTap(uint32_t tap, Buffer& window);
+
+private:
+   DspParameters parameters;
+
+   SharedMemory _memory;
+   BridgeSegment* _segment = nullptr;
+   uint32_t _syncSlot      = 0; // next slot to report after attaching
+
+   bool popParameterChange(uint32_t& paramId, float& value);
+};
+
+} // namespace ImRt
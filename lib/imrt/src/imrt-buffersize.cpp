@@ -0,0 +1,248 @@
+#include "imrt-buffersize.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                 buffer size controller                 */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const auto monitorInterval = std::chrono::milliseconds(100);
+
+   // Upper limit of the factor by which failed attempts to shrink the buffer
+   // extend the low load period.
+   const double maxBackoff = 16.0;
+
+} // namespace
+
+BufferSizeController::BufferSizeController(
+   BufferSizeControllerSettings settings
+)
+   : _settings(settings)
+{
+}
+
+BufferSizeController::~BufferSizeController()
+{
+   stop();
+}
+
+void BufferSizeController::configure(BufferSizeControllerSettings settings)
+{
+   _settings = settings;
+}
+
+void BufferSizeController::measure(
+   double duration, uint32_t numFrames, double sampleRate, bool xrun
+)
+{
+   if (xrun)
+   {
+      _numXruns.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   if (numFrames == 0 || sampleRate <= 0.0)
+   {
+      return;
+   }
+
+   float load = static_cast<float>(duration * sampleRate / numFrames);
+   float peak = _windowPeakLoad.load(std::memory_order_relaxed);
+   while (load > peak
+          && !_windowPeakLoad.compare_exchange_weak(
+             peak, load, std::memory_order_relaxed
+          ))
+   {
+   }
+}
+
+void BufferSizeController::start(uint32_t bufferSize)
+{
+   stop();
+
+   _running = true;
+   _start   = std::chrono::steady_clock::now();
+   _size    = bufferSize;
+   _pending = false;
+   _thread  = std::thread(&BufferSizeController::monitor, this);
+}
+
+void BufferSizeController::stop()
+{
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _running = false;
+   }
+   _wakeUp.notify_all();
+
+   if (_thread.joinable())
+   {
+      _thread.join();
+   }
+}
+
+bool BufferSizeController::poll(
+   const std::function<uint32_t(uint32_t)>& renegotiate
+)
+{
+   BufferSizeDecision decision;
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_pending)
+      {
+         return false;
+      }
+      decision = _request;
+   }
+
+   uint32_t actual = renegotiate(decision.newSize);
+   if (actual == 0)
+   {
+      // Fall back to the size that worked before.
+      decision.reason += ", renegotiation failed";
+      actual = renegotiate(decision.oldSize);
+   }
+   decision.newSize = actual;
+   log(decision);
+
+   std::lock_guard<std::mutex> lock(_mutex);
+   if (actual != 0)
+   {
+      _size = actual;
+   }
+   _settleUntil = elapsed() + _settings.settlePeriod;
+   _pending     = false;
+   return true;
+}
+
+uint32_t BufferSizeController::update(uint32_t bufferSize, double time)
+{
+   float peak        = _windowPeakLoad.exchange(0.0f);
+   uint64_t xruns    = _numXruns.load();
+   uint64_t newXruns = xruns - _lastXruns;
+   _lastXruns        = xruns;
+   _peakLoad.store(peak);
+
+   // Reopening the stream causes glitches of its own.
+   if (time < _settleUntil)
+   {
+      _lowLoadSince = time;
+      return bufferSize;
+   }
+
+   std::ostringstream reason;
+
+   if (newXruns > 0)
+   {
+      _lowLoadSince = time;
+
+      if (time - _lastShrink < _settings.probationPeriod)
+      {
+         _backoff = std::min(2.0 * _backoff, maxBackoff);
+      }
+
+      uint32_t size = std::min(2 * bufferSize, _settings.maxBufferSize);
+      if (size > bufferSize)
+      {
+         reason << newXruns << " xrun(s), peak load " << peak;
+         _reason = reason.str();
+         return size;
+      }
+
+      // Already at the maximum, warn at most every ten seconds.
+      if (time - _lastWarning >= 10.0)
+      {
+         _lastWarning = time;
+         reason << newXruns << " xrun(s) at the maximum buffer size";
+         log({ time, bufferSize, bufferSize, peak, xruns, reason.str() });
+      }
+      return bufferSize;
+   }
+
+   if (peak > _settings.lowLoad)
+   {
+      _lowLoadSince = time;
+      return bufferSize;
+   }
+
+   double period = _settings.lowLoadPeriod * _backoff;
+   uint32_t size = std::max(bufferSize / 2, _settings.minBufferSize);
+   if (time - _lowLoadSince >= period && size < bufferSize)
+   {
+      _lastShrink = time;
+      reason << "peak load below " << _settings.lowLoad << " for " << period
+             << " s";
+      _reason = reason.str();
+      return size;
+   }
+   return bufferSize;
+}
+
+float BufferSizeController::peakLoad() const
+{
+   return _peakLoad.load();
+}
+
+uint64_t BufferSizeController::numXruns() const
+{
+   return _numXruns.load();
+}
+
+std::vector<BufferSizeDecision> BufferSizeController::decisions() const
+{
+   std::lock_guard<std::mutex> lock(_logMutex);
+   return _decisions;
+}
+
+void BufferSizeController::monitor()
+{
+   _lastXruns    = _numXruns.load();
+   _settleUntil  = _settings.settlePeriod;
+   _lowLoadSince = 0.0;
+   _windowPeakLoad.store(0.0f);
+
+   auto stopped = [this] { return !_running; };
+
+   std::unique_lock<std::mutex> lock(_mutex);
+   while (!_wakeUp.wait_for(lock, monitorInterval, stopped))
+   {
+      // Wait until the owning thread carried out the last decision.
+      if (_pending)
+      {
+         continue;
+      }
+
+      double time     = elapsed();
+      uint32_t wanted = update(_size, time);
+      if (wanted != _size)
+      {
+         _request = {
+            time, _size, wanted, _peakLoad.load(), _numXruns.load(), _reason
+         };
+         _pending = true;
+      }
+   }
+}
+
+double BufferSizeController::elapsed() const
+{
+   std::chrono::duration<double> duration
+      = std::chrono::steady_clock::now() - _start;
+   return duration.count();
+}
+
+void BufferSizeController::log(BufferSizeDecision decision)
+{
+   std::clog << "imrt: buffer size " << decision.oldSize << " -> "
+             << decision.newSize << " (" << decision.reason << ")" << std::endl;
+
+   std::lock_guard<std::mutex> lock(_logMutex);
+   _decisions.push_back(std::move(decision));
+}
+
+} // namespace ImRt
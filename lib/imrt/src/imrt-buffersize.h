@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                    BUFFER SIZE CONTROLLER                                  */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Settings of a BufferSizeController.
+ */
+struct BufferSizeControllerSettings
+{
+   uint32_t minBufferSize = 32;
+   uint32_t maxBufferSize = 2048;
+
+   // A smaller buffer is tried once the peak load of every callback stayed
+   // below lowLoad for lowLoadPeriod seconds.
+   float lowLoad        = 0.5f;
+   double lowLoadPeriod = 30.0;
+
+   // Xruns within probationPeriod seconds after shrinking the buffer double
+   // the low load period required for the next attempt.
+   double probationPeriod = 10.0;
+
+   // Xruns within settlePeriod seconds after a renegotiation are ignored.
+   double settlePeriod = 0.5;
+};
+
+/**
+ * @brief A decision of a BufferSizeController.
+ */
+struct BufferSizeDecision
+{
+   double time       = 0.0; // seconds since the controller was started
+   uint32_t oldSize  = 0;
+   uint32_t newSize  = 0; // the actual size after the renegotiation
+   float peakLoad    = 0.0f;
+   uint64_t numXruns = 0;
+   std::string reason;
+};
+
+/**
+ * @brief Adapts the buffer size of a stream to the load of the machine. The
+ * audio thread reports the duration of every callback and whether an xrun
+ * occurred (cf. BufferSizeController::measure()). A monitoring thread decides
+ * to double the buffer size when xruns happen and to halve it after a period
+ * of low load, within the configured bounds, so the stream runs at the lowest
+ * latency that is currently stable. If a smaller buffer turns out to be
+ * unstable, the controller waits longer before it tries again.
+ *
+ * The monitoring thread does not touch the stream. Its decision is carried
+ * out by the thread that owns the stream, which calls
+ * BufferSizeController::poll() periodically, so reopening the stream never
+ * races with other calls on it.
+ *
+ * Every decision is written to std::clog and kept in a log (cf.
+ * BufferSizeController::decisions()).
+ */
+class BufferSizeController
+{
+public:
+   /**
+    * @brief Constructs a new buffer size controller with the given settings.
+    */
+   BufferSizeController(
+      BufferSizeControllerSettings settings = BufferSizeControllerSettings()
+   );
+
+   /**
+    * @brief Stops the monitoring thread and destroys the object.
+    */
+   ~BufferSizeController();
+
+   /**
+    * @brief Replaces the settings. This method must not be called while the
+    * monitoring thread is running.
+    */
+   void configure(BufferSizeControllerSettings settings);
+
+   /**
+    * @brief Reports a callback of the stream. This method is realtime-safe
+    * and must be called from the audio thread.
+    *
+    * @param duration The time the callback took in seconds.
+    * @param numFrames The number of frames of the callback.
+    * @param sampleRate The sample rate of the stream.
+    * @param xrun true if the audio API reported an input overflow or output
+    * underflow.
+    */
+   void
+   measure(double duration, uint32_t numFrames, double sampleRate, bool xrun);
+
+   /**
+    * @brief Starts the monitoring thread.
+    *
+    * @param bufferSize The current buffer size of the stream.
+    */
+   void start(uint32_t bufferSize);
+
+   /**
+    * @brief Stops the monitoring thread.
+    */
+   void stop();
+
+   /**
+    * @brief Carries out a pending decision of the monitoring thread. This
+    * method must be called periodically from the thread that owns the stream.
+    * The monitoring thread makes no further decision until the pending one
+    * was carried out.
+    *
+    * @param renegotiate A function that reopens the stream with the given
+    * buffer size and returns the actual buffer size or 0 on failure. It is
+    * called from the calling thread, and only if a decision is pending.
+    * @return true if the stream was renegotiated.
+    */
+   bool poll(const std::function<uint32_t(uint32_t)>& renegotiate);
+
+   /**
+    * @brief Evaluates the measurements since the last call and returns the
+    * buffer size the stream should have. This method is called periodically
+    * by the monitoring thread, but can also be driven manually, e.g. by a
+    * simulation.
+    *
+    * @param bufferSize The current buffer size.
+    * @param time The current time in seconds.
+    * @return The desired buffer size, which equals bufferSize if nothing
+    * should change.
+    */
+   uint32_t update(uint32_t bufferSize, double time);
+
+   /**
+    * @brief Returns the peak load of the callbacks evaluated by the last
+    * update, i.e. the longest callback duration relative to the buffer
+    * duration.
+    */
+   float peakLoad() const;
+
+   /**
+    * @brief Returns the number of xruns reported so far.
+    */
+   uint64_t numXruns() const;
+
+   /**
+    * @brief Returns a copy of the log of all decisions.
+    */
+   std::vector<BufferSizeDecision> decisions() const;
+
+private:
+   BufferSizeControllerSettings _settings;
+
+   // Audio thread
+   std::atomic<float> _windowPeakLoad { 0.0f };
+   std::atomic<uint64_t> _numXruns { 0 };
+
+   // Monitoring thread
+   std::atomic<float> _peakLoad { 0.0f };
+   uint64_t _lastXruns  = 0;
+   double _settleUntil  = 0.0;
+   double _lowLoadSince = 0.0;
+   double _lastShrink   = -1e9;
+   double _lastWarning  = -1e9;
+   double _backoff      = 1.0;
+   std::string _reason;
+
+   std::thread _thread;
+   std::mutex _mutex;
+   std::condition_variable _wakeUp;
+   std::chrono::steady_clock::time_point _start;
+   bool _running = false;
+
+   // Monitoring thread and owning thread, guarded by _mutex
+   uint32_t _size = 0;
+   bool _pending  = false;
+   BufferSizeDecision _request; // newSize is the wanted size
+
+   mutable std::mutex _logMutex;
+   std::vector<BufferSizeDecision> _decisions;
+
+   void monitor();
+   double elapsed() const;
+   void log(BufferSizeDecision decision);
+};
+
+} // namespace ImRt
@@ -0,0 +1,177 @@
+#include "imrt-chain.h"
+#include <algorithm>
+#include <cassert>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                    processor chain                     */
+/* ------------------------------------------------------ */
+
+ProcessorChain::ProcessorChain()
+{
+   _nodes.publish(std::make_unique<Nodes>());
+}
+
+void ProcessorChain::prepare(
+   uint32_t sampleRate, uint32_t maxFrames, uint32_t numChannels,
+   uint32_t fadeFrames
+)
+{
+   _sampleRate  = sampleRate;
+   _maxFrames   = maxFrames;
+   _numChannels = numChannels;
+   _fadeStep    = fadeFrames > 0 ? 1.0f / fadeFrames : 1.0f;
+   _dry.assign(size_t(numChannels) * maxFrames, 0.0f);
+
+   for (Entry& entry : *_nodes.current())
+   {
+      entry.node->processor->prepare(sampleRate, maxFrames, numChannels);
+      entry.node->gain = entry.active ? 1.0f : 0.0f;
+   }
+}
+
+size_t ProcessorChain::size() const
+{
+   const Nodes& nodes = *_nodes.current();
+   return std::count_if(
+      nodes.begin(), nodes.end(), [](const Entry& e) { return e.active; }
+   );
+}
+
+Processor* ProcessorChain::processor(size_t index) const
+{
+   const Nodes& nodes = *_nodes.current();
+   size_t entry       = position(nodes, index);
+   assert(entry < nodes.size());
+
+   return nodes[entry].node->processor.get();
+}
+
+void ProcessorChain::insert(size_t index, std::unique_ptr<Processor> processor)
+{
+   assert(_maxFrames > 0);
+
+   // The processor is prepared before the DSP thread can see it and fades in
+   // from a gain of zero.
+   processor->prepare(_sampleRate, _maxFrames, _numChannels);
+   auto node       = std::make_shared<Node>();
+   node->processor = std::move(processor);
+
+   auto nodes = copyNodes();
+   nodes->insert(nodes->begin() + position(*nodes, index), { node, true });
+   _nodes.publish(std::move(nodes));
+}
+
+void ProcessorChain::remove(size_t index)
+{
+   auto nodes   = copyNodes();
+   size_t entry = position(*nodes, index);
+   assert(entry < nodes->size());
+
+   (*nodes)[entry].active = false;
+   _nodes.publish(std::move(nodes));
+}
+
+void ProcessorChain::move(size_t from, size_t to)
+{
+   auto nodes   = copyNodes();
+   size_t entry = position(*nodes, from);
+   assert(entry < nodes->size());
+
+   Entry moved = (*nodes)[entry];
+   nodes->erase(nodes->begin() + entry);
+   nodes->insert(nodes->begin() + position(*nodes, to), moved);
+   _nodes.publish(std::move(nodes));
+}
+
+void ProcessorChain::update()
+{
+   auto isSilent = [](const Entry& e)
+   { return !e.active && e.node->silent.load(std::memory_order_acquire); };
+
+   const Nodes& current = *_nodes.current();
+   if (std::none_of(current.begin(), current.end(), isSilent))
+   {
+      _nodes.reclaim();
+      return;
+   }
+
+   // The processors are deleted with the last list that contains them.
+   auto nodes = copyNodes();
+   nodes->erase(
+      std::remove_if(nodes->begin(), nodes->end(), isSilent), nodes->end()
+   );
+   _nodes.publish(std::move(nodes));
+}
+
+void ProcessorChain::process(Buffer& buffer, uint32_t numFrames)
+{
+   assert(numFrames <= _maxFrames);
+
+   for (Entry& entry : *_nodes.acquire())
+   {
+      Node& node   = *entry.node;
+      float target = entry.active ? 1.0f : 0.0f;
+      if (node.gain != target)
+      {
+         fade(node, target, buffer, numFrames);
+      }
+      else if (entry.active)
+      {
+         node.processor->process(buffer, numFrames);
+      }
+      else
+      {
+         node.silent.store(true, std::memory_order_release);
+      }
+   }
+}
+
+std::unique_ptr<ProcessorChain::Nodes> ProcessorChain::copyNodes() const
+{
+   return std::make_unique<Nodes>(*_nodes.current());
+}
+
+size_t ProcessorChain::position(const Nodes& nodes, size_t index) const
+{
+   for (size_t entry = 0; entry < nodes.size(); ++entry)
+   {
+      if (nodes[entry].active && index-- == 0)
+      {
+         return entry;
+      }
+   }
+   return nodes.size();
+}
+
+void ProcessorChain::fade(
+   Node& node, float target, Buffer& buffer, uint32_t numFrames
+)
+{
+   // The processed signal is crossfaded with the unprocessed one.
+   for (uint32_t channel = 0; channel < _numChannels; ++channel)
+   {
+      const float* signal = &buffer.getSample(channel, 0);
+      std::copy(signal, signal + numFrames, &_dry[channel * _maxFrames]);
+   }
+
+   node.processor->process(buffer, numFrames);
+
+   float step = target > node.gain ? _fadeStep : -_fadeStep;
+   for (uint32_t channel = 0; channel < _numChannels; ++channel)
+   {
+      const float* dry = &_dry[channel * _maxFrames];
+      float* signal    = &buffer.getSample(channel, 0);
+
+      float gain = node.gain;
+      for (uint32_t frame = 0; frame < numFrames; ++frame)
+      {
+         gain          = std::clamp(gain + step, 0.0f, 1.0f);
+         signal[frame] = dry[frame] + gain * (signal[frame] - dry[frame]);
+      }
+   }
+   node.gain = std::clamp(node.gain + step * numFrames, 0.0f, 1.0f);
+}
+
+} // namespace ImRt
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "imrt-rcu.h"
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                            PROCESSOR                                       */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A module that processes audio in place, e.g. an effect, and can be
+ * inserted into a ProcessorChain at runtime.
+ */
+class Processor
+{
+public:
+   virtual ~Processor() = default;
+
+   /**
+    * @brief Allocates memory and resets the state. It is called by the
+    * ProcessorChain on the GUI thread before the processor is inserted, so it
+    * is never called concurrently with Processor::process().
+    */
+   virtual void prepare(
+      uint32_t /*sampleRate*/, uint32_t /*maxFrames*/,
+      uint32_t /*numChannels*/
+   )
+   {
+   }
+
+   /**
+    * @brief Processes the first frames of a buffer in place. It is called on
+    * the DSP thread and must neither block nor allocate memory.
+    */
+   virtual void process(Buffer& buffer, uint32_t numFrames) = 0;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                         PROCESSOR CHAIN                                    */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A chain of processors that can be changed while the DSP thread runs
+ * it, e.g. to insert, remove and reorder effects live.
+ *
+ * The node list is an Rcu object: every change builds and prepares a new list
+ * on the GUI thread and publishes it atomically, so the DSP thread neither
+ * locks nor allocates. Replaced lists and removed processors are deleted on
+ * the GUI thread once the DSP thread has moved on. Inserted processors fade in
+ * and removed processors fade out over a few milliseconds to avoid clicks, a
+ * reordering takes effect immediately.
+ *
+ * @code
+ * // GUI thread
+ * chain.insert(0, std::make_unique<MyDelay>());
+ * chain.update(); // regularly, e.g. in Gui::onUpdate()
+ *
+ * // DSP thread, e.g. in Dsp::process()
+ * chain.process(out, numFrames);
+ * @endcode
+ */
+class ProcessorChain
+{
+public:
+   ProcessorChain();
+
+   /**
+    * @brief Prepares the chain and all of its processors and resets their
+    * state. This method must not be called concurrently with
+    * ProcessorChain::process().
+    *
+    * @param sampleRate The sample rate.
+    * @param maxFrames The maximum number of frames per call of
+    * ProcessorChain::process().
+    * @param numChannels The number of channels.
+    * @param fadeFrames The number of frames over which processors fade in
+    * and out.
+    */
+   void prepare(
+      uint32_t sampleRate, uint32_t maxFrames, uint32_t numChannels,
+      uint32_t fadeFrames = 256
+   );
+
+   /**
+    * @brief Returns the number of processors in the chain, not counting
+    * processors that are fading out.
+    */
+   size_t size() const;
+
+   /**
+    * @brief Returns the processor at the given position. The processor must
+    * only be configured in a way that is safe while the DSP thread runs it.
+    */
+   Processor* processor(size_t index) const;
+
+   /**
+    * @brief Prepares a processor and inserts it in front of the given
+    * position, or at the end if the position is not less than the size of the
+    * chain. This method must only be called by the GUI thread.
+    */
+   void insert(size_t index, std::unique_ptr<Processor> processor);
+
+   /**
+    * @brief Fades out the processor at the given position and removes it.
+    * This method must only be called by the GUI thread.
+    */
+   void remove(size_t index);
+
+   /**
+    * @brief Moves the processor at position from to position to, or to the
+    * end if to is not less than the size of the chain. This method must only
+    * be called by the GUI thread.
+    */
+   void move(size_t from, size_t to);
+
+   /**
+    * @brief Drops the processors that have faded out and deletes the replaced
+    * node lists. This method must be called regularly by the GUI thread.
+    */
+   void update();
+
+   /**
+    * @brief Processes the first frames of a buffer in place by all processors
+    * of the chain in order. This method never blocks and does not allocate
+    * memory. It must only be called by the DSP thread.
+    */
+   void process(Buffer& buffer, uint32_t numFrames);
+
+private:
+   struct Node
+   {
+      std::unique_ptr<Processor> processor;
+      float gain = 0.0f; // only accessed by the DSP thread
+      std::atomic<bool> silent { false };
+   };
+
+   struct Entry
+   {
+      std::shared_ptr<Node> node;
+      bool active; // false while fading out
+   };
+
+   using Nodes = std::vector<Entry>;
+
+   Rcu<Nodes> _nodes;
+   std::vector<float> _dry; // one range of maxFrames samples per channel
+   uint32_t _sampleRate = 0, _maxFrames = 0, _numChannels = 0;
+   float _fadeStep      = 1.0f;
+
+   std::unique_ptr<Nodes> copyNodes() const;
+   size_t position(const Nodes& nodes, size_t index) const;
+   void fade(Node& node, float target, Buffer& buffer, uint32_t numFrames);
+};
+
+} // namespace ImRt
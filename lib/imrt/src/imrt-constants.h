@@ -4,8 +4,10 @@
 
 namespace ImRt {
 
-using Buffer
-   = choc::buffer::AllocatedBuffer<float, choc::buffer::SeparateChannelLayout>;
+template <typename Sample>
+using SampleBuffer
+   = choc::buffer::AllocatedBuffer<Sample, choc::buffer::SeparateChannelLayout>;
+using Buffer = SampleBuffer<float>;
 using BufferView
    = choc::buffer::BufferView<float, choc::buffer::SeparateChannelLayout>;
 
@@ -0,0 +1,560 @@
+#include "imrt-convert.h"
+#include "imrt-simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                    scalar conversion                   */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const double int16Scale = 32768.0;
+   const double int24Scale = 8388608.0;
+   const double int32Scale = 2147483648.0;
+
+   int32_t readInt24(const uint8_t* bytes)
+   {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      int32_t value = (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8);
+#else
+      int32_t value = (bytes[2] << 24) | (bytes[1] << 16) | (bytes[0] << 8);
+#endif
+      return value >> 8; // sign extension
+   }
+
+   void writeInt24(uint8_t* bytes, int32_t value)
+   {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      bytes[0] = uint8_t(value >> 16);
+      bytes[1] = uint8_t(value >> 8);
+      bytes[2] = uint8_t(value);
+#else
+      bytes[0] = uint8_t(value);
+      bytes[1] = uint8_t(value >> 8);
+      bytes[2] = uint8_t(value >> 16);
+#endif
+   }
+
+   // Clips a sample to the range of the integer format and rounds it to the
+   // nearest integer.
+   int32_t toInteger(double sample, double scale)
+   {
+      double value = std::min(std::max(sample * scale, -scale), scale - 1.0);
+      return static_cast<int32_t>(std::lrint(value));
+   }
+
+   template <typename Sample, typename Load>
+   void deinterleaveWith(
+      Load&& load, uint32_t numChannels, SampleBuffer<Sample>& buffer,
+      uint32_t firstFrame, uint32_t numFrames
+   )
+   {
+      for (uint32_t channel = 0; channel < numChannels; ++channel)
+      {
+         Sample* samples = &buffer.getSample(channel, 0);
+         for (uint32_t frame = firstFrame; frame < numFrames; ++frame)
+         {
+            samples[frame] = static_cast<Sample>(
+               load(size_t(numChannels) * frame + channel)
+            );
+         }
+      }
+   }
+
+   template <typename Sample, typename Store>
+   void interleaveWith(
+      Store&& store, uint32_t numChannels, const SampleBuffer<Sample>& buffer,
+      uint32_t firstFrame, uint32_t numFrames
+   )
+   {
+      for (uint32_t channel = 0; channel < numChannels; ++channel)
+      {
+         const Sample* samples = &buffer.getSample(channel, 0);
+         for (uint32_t frame = firstFrame; frame < numFrames; ++frame)
+         {
+            store(size_t(numChannels) * frame + channel, samples[frame]);
+         }
+      }
+   }
+
+   template <typename Sample>
+   void deinterleaveScalar(
+      const void* data, SampleFormat format, uint32_t numChannels,
+      SampleBuffer<Sample>& buffer, uint32_t firstFrame, uint32_t numFrames
+   )
+   {
+      switch (format)
+      {
+      case SampleFormat::Int16:
+      {
+         auto samples = static_cast<const int16_t*>(data);
+         auto scale   = static_cast<Sample>(1.0 / int16Scale);
+         deinterleaveWith(
+            [=](size_t i) { return samples[i] * scale; }, numChannels, buffer,
+            firstFrame, numFrames
+         );
+         break;
+      }
+      case SampleFormat::Int24:
+      {
+         auto bytes = static_cast<const uint8_t*>(data);
+         auto scale = static_cast<Sample>(1.0 / int24Scale);
+         deinterleaveWith(
+            [=](size_t i) { return readInt24(bytes + 3 * i) * scale; },
+            numChannels, buffer, firstFrame, numFrames
+         );
+         break;
+      }
+      case SampleFormat::Int32:
+      {
+         auto samples = static_cast<const int32_t*>(data);
+         auto scale   = static_cast<Sample>(1.0 / int32Scale);
+         deinterleaveWith(
+            [=](size_t i) { return samples[i] * scale; }, numChannels, buffer,
+            firstFrame, numFrames
+         );
+         break;
+      }
+      case SampleFormat::Float32:
+      {
+         auto samples = static_cast<const float*>(data);
+         deinterleaveWith(
+            [=](size_t i) { return samples[i]; }, numChannels, buffer,
+            firstFrame, numFrames
+         );
+         break;
+      }
+      case SampleFormat::Float64:
+      {
+         auto samples = static_cast<const double*>(data);
+         deinterleaveWith(
+            [=](size_t i) { return samples[i]; }, numChannels, buffer,
+            firstFrame, numFrames
+         );
+         break;
+      }
+      }
+   }
+
+   template <typename Sample>
+   void interleaveScalar(
+      void* data, SampleFormat format, uint32_t numChannels,
+      const SampleBuffer<Sample>& buffer, uint32_t firstFrame,
+      uint32_t numFrames
+   )
+   {
+      switch (format)
+      {
+      case SampleFormat::Int16:
+      {
+         auto samples = static_cast<int16_t*>(data);
+         interleaveWith(
+            [=](size_t i, Sample sample)
+            { samples[i] = int16_t(toInteger(sample, int16Scale)); },
+            numChannels, buffer, firstFrame, numFrames
+         );
+         break;
+      }
+      case SampleFormat::Int24:
+      {
+         auto bytes = static_cast<uint8_t*>(data);
+         interleaveWith(
+            [=](size_t i, Sample sample)
+            { writeInt24(bytes + 3 * i, toInteger(sample, int24Scale)); },
+            numChannels, buffer, firstFrame, numFrames
+         );
+         break;
+      }
+      case SampleFormat::Int32:
+      {
+         auto samples = static_cast<int32_t*>(data);
+         interleaveWith(
+            [=](size_t i, Sample sample)
+            { samples[i] = toInteger(sample, int32Scale); },
+            numChannels, buffer, firstFrame, numFrames
+         );
+         break;
+      }
+      case SampleFormat::Float32:
+      {
+         auto samples = static_cast<float*>(data);
+         interleaveWith(
+            [=](size_t i, Sample sample) { samples[i] = float(sample); },
+            numChannels, buffer, firstFrame, numFrames
+         );
+         break;
+      }
+      case SampleFormat::Float64:
+      {
+         auto samples = static_cast<double*>(data);
+         interleaveWith(
+            [=](size_t i, Sample sample) { samples[i] = double(sample); },
+            numChannels, buffer, firstFrame, numFrames
+         );
+         break;
+      }
+      }
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                     simd conversion                    */
+/* ------------------------------------------------------ */
+
+#if defined(IMRT_SIMD_SSE2)                                                    \
+   || (defined(IMRT_SIMD_NEON) && defined(__aarch64__))
+#define IMRT_CONVERT_SIMD 1
+#endif
+
+#if defined(IMRT_CONVERT_SIMD)
+namespace {
+
+   // Each kernel converts four samples at a time, i.e. four frames of a mono
+   // or two frames of a stereo stream.
+#if defined(IMRT_SIMD_SSE2)
+   using Vector = __m128;
+
+   template <SampleFormat format>
+   Vector load(const void* data, size_t index)
+   {
+      if constexpr (format == SampleFormat::Int16)
+      {
+         __m128i samples = _mm_loadl_epi64(
+            reinterpret_cast<const __m128i*>(
+               static_cast<const int16_t*>(data) + index
+            )
+         );
+         samples = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+         return _mm_mul_ps(
+            _mm_cvtepi32_ps(samples), _mm_set1_ps(float(1.0 / int16Scale))
+         );
+      }
+      else if constexpr (format == SampleFormat::Int32)
+      {
+         __m128i samples = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(
+               static_cast<const int32_t*>(data) + index
+            )
+         );
+         return _mm_mul_ps(
+            _mm_cvtepi32_ps(samples), _mm_set1_ps(float(1.0 / int32Scale))
+         );
+      }
+      else
+      {
+         return _mm_loadu_ps(static_cast<const float*>(data) + index);
+      }
+   }
+
+   // The largest float below 2^31 is the upper limit of 32 bit samples,
+   // since the conversion of 2^31 overflows.
+   template <SampleFormat format>
+   void store(void* data, size_t index, Vector samples)
+   {
+      if constexpr (format == SampleFormat::Int16)
+      {
+         samples = _mm_mul_ps(samples, _mm_set1_ps(float(int16Scale)));
+         samples = _mm_min_ps(
+            _mm_max_ps(samples, _mm_set1_ps(-32768.0f)),
+            _mm_set1_ps(32767.0f)
+         );
+         __m128i integers = _mm_cvtps_epi32(samples);
+         _mm_storel_epi64(
+            reinterpret_cast<__m128i*>(static_cast<int16_t*>(data) + index),
+            _mm_packs_epi32(integers, integers)
+         );
+      }
+      else if constexpr (format == SampleFormat::Int32)
+      {
+         samples = _mm_mul_ps(samples, _mm_set1_ps(float(int32Scale)));
+         samples = _mm_min_ps(
+            _mm_max_ps(samples, _mm_set1_ps(-2147483648.0f)),
+            _mm_set1_ps(2147483520.0f)
+         );
+         _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(static_cast<int32_t*>(data) + index),
+            _mm_cvtps_epi32(samples)
+         );
+      }
+      else
+      {
+         _mm_storeu_ps(static_cast<float*>(data) + index, samples);
+      }
+   }
+
+   void unzip(Vector a, Vector b, Vector& left, Vector& right)
+   {
+      left  = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+      right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+   }
+
+   void zip(Vector left, Vector right, Vector& a, Vector& b)
+   {
+      a = _mm_unpacklo_ps(left, right);
+      b = _mm_unpackhi_ps(left, right);
+   }
+
+   Vector loadFloats(const float* samples)
+   {
+      return _mm_loadu_ps(samples);
+   }
+
+   void storeFloats(float* samples, Vector vector)
+   {
+      _mm_storeu_ps(samples, vector);
+   }
+#else
+   using Vector = float32x4_t;
+
+   template <SampleFormat format>
+   Vector load(const void* data, size_t index)
+   {
+      if constexpr (format == SampleFormat::Int16)
+      {
+         auto samples = vld1_s16(static_cast<const int16_t*>(data) + index);
+         return vmulq_n_f32(
+            vcvtq_f32_s32(vmovl_s16(samples)), float(1.0 / int16Scale)
+         );
+      }
+      else if constexpr (format == SampleFormat::Int32)
+      {
+         auto samples = vld1q_s32(static_cast<const int32_t*>(data) + index);
+         return vmulq_n_f32(vcvtq_f32_s32(samples), float(1.0 / int32Scale));
+      }
+      else
+      {
+         return vld1q_f32(static_cast<const float*>(data) + index);
+      }
+   }
+
+   template <SampleFormat format>
+   void store(void* data, size_t index, Vector samples)
+   {
+      if constexpr (format == SampleFormat::Int16)
+      {
+         samples = vmulq_n_f32(samples, float(int16Scale));
+         samples = vminq_f32(
+            vmaxq_f32(samples, vdupq_n_f32(-32768.0f)), vdupq_n_f32(32767.0f)
+         );
+         vst1_s16(
+            static_cast<int16_t*>(data) + index,
+            vqmovn_s32(vcvtnq_s32_f32(samples))
+         );
+      }
+      else if constexpr (format == SampleFormat::Int32)
+      {
+         samples = vmulq_n_f32(samples, float(int32Scale));
+         samples = vminq_f32(
+            vmaxq_f32(samples, vdupq_n_f32(-2147483648.0f)),
+            vdupq_n_f32(2147483520.0f)
+         );
+         vst1q_s32(
+            static_cast<int32_t*>(data) + index, vcvtnq_s32_f32(samples)
+         );
+      }
+      else
+      {
+         vst1q_f32(static_cast<float*>(data) + index, samples);
+      }
+   }
+
+   void unzip(Vector a, Vector b, Vector& left, Vector& right)
+   {
+      float32x4x2_t channels = vuzpq_f32(a, b);
+      left                   = channels.val[0];
+      right                  = channels.val[1];
+   }
+
+   void zip(Vector left, Vector right, Vector& a, Vector& b)
+   {
+      float32x4x2_t frames = vzipq_f32(left, right);
+      a                    = frames.val[0];
+      b                    = frames.val[1];
+   }
+
+   Vector loadFloats(const float* samples)
+   {
+      return vld1q_f32(samples);
+   }
+
+   void storeFloats(float* samples, Vector vector)
+   {
+      vst1q_f32(samples, vector);
+   }
+#endif
+
+   template <SampleFormat format>
+   uint32_t deinterleaveSimd(
+      const void* data, uint32_t numChannels, Buffer& buffer,
+      uint32_t numFrames
+   )
+   {
+      uint32_t frame = 0;
+      if (numChannels == 1)
+      {
+         float* samples = &buffer.getSample(0, 0);
+         for (; frame + 4 <= numFrames; frame += 4)
+         {
+            storeFloats(samples + frame, load<format>(data, frame));
+         }
+      }
+      else if (numChannels == 2)
+      {
+         float* left  = &buffer.getSample(0, 0);
+         float* right = &buffer.getSample(1, 0);
+         for (; frame + 4 <= numFrames; frame += 4)
+         {
+            Vector l, r;
+            unzip(
+               load<format>(data, 2 * frame),
+               load<format>(data, 2 * frame + 4), l, r
+            );
+            storeFloats(left + frame, l);
+            storeFloats(right + frame, r);
+         }
+      }
+      return frame;
+   }
+
+   template <SampleFormat format>
+   uint32_t interleaveSimd(
+      void* data, uint32_t numChannels, const Buffer& buffer,
+      uint32_t numFrames
+   )
+   {
+      uint32_t frame = 0;
+      if (numChannels == 1)
+      {
+         const float* samples = &buffer.getSample(0, 0);
+         for (; frame + 4 <= numFrames; frame += 4)
+         {
+            store<format>(data, frame, loadFloats(samples + frame));
+         }
+      }
+      else if (numChannels == 2)
+      {
+         const float* left  = &buffer.getSample(0, 0);
+         const float* right = &buffer.getSample(1, 0);
+         for (; frame + 4 <= numFrames; frame += 4)
+         {
+            Vector a, b;
+            zip(loadFloats(left + frame), loadFloats(right + frame), a, b);
+            store<format>(data, 2 * frame, a);
+            store<format>(data, 2 * frame + 4, b);
+         }
+      }
+      return frame;
+   }
+
+} // namespace
+#endif
+
+/* ------------------------------------------------------ */
+/*                   sample conversion                    */
+/* ------------------------------------------------------ */
+
+uint32_t sampleSize(SampleFormat format)
+{
+   switch (format)
+   {
+   case SampleFormat::Int16:
+      return 2;
+   case SampleFormat::Int24:
+      return 3;
+   case SampleFormat::Int32:
+   case SampleFormat::Float32:
+      return 4;
+   case SampleFormat::Float64:
+      return 8;
+   }
+   return 0;
+}
+
+void deinterleave(
+   const void* data, SampleFormat format, uint32_t numChannels, Buffer& buffer,
+   uint32_t numFrames
+)
+{
+   uint32_t frame = 0;
+
+#if defined(IMRT_CONVERT_SIMD)
+   switch (format)
+   {
+   case SampleFormat::Int16:
+      frame = deinterleaveSimd<SampleFormat::Int16>(
+         data, numChannels, buffer, numFrames
+      );
+      break;
+   case SampleFormat::Int32:
+      frame = deinterleaveSimd<SampleFormat::Int32>(
+         data, numChannels, buffer, numFrames
+      );
+      break;
+   case SampleFormat::Float32:
+      frame = deinterleaveSimd<SampleFormat::Float32>(
+         data, numChannels, buffer, numFrames
+      );
+      break;
+   default:
+      break;
+   }
+#endif
+
+   deinterleaveScalar(data, format, numChannels, buffer, frame, numFrames);
+}
+
+void deinterleave(
+   const void* data, SampleFormat format, uint32_t numChannels,
+   SampleBuffer<double>& buffer, uint32_t numFrames
+)
+{
+   deinterleaveScalar(data, format, numChannels, buffer, 0, numFrames);
+}
+
+void interleave(
+   void* data, SampleFormat format, uint32_t numChannels, const Buffer& buffer,
+   uint32_t numFrames
+)
+{
+   uint32_t frame = 0;
+
+#if defined(IMRT_CONVERT_SIMD)
+   switch (format)
+   {
+   case SampleFormat::Int16:
+      frame = interleaveSimd<SampleFormat::Int16>(
+         data, numChannels, buffer, numFrames
+      );
+      break;
+   case SampleFormat::Int32:
+      frame = interleaveSimd<SampleFormat::Int32>(
+         data, numChannels, buffer, numFrames
+      );
+      break;
+   case SampleFormat::Float32:
+      frame = interleaveSimd<SampleFormat::Float32>(
+         data, numChannels, buffer, numFrames
+      );
+      break;
+   default:
+      break;
+   }
+#endif
+
+   interleaveScalar(data, format, numChannels, buffer, frame, numFrames);
+}
+
+void interleave(
+   void* data, SampleFormat format, uint32_t numChannels,
+   const SampleBuffer<double>& buffer, uint32_t numFrames
+)
+{
+   interleaveScalar(data, format, numChannels, buffer, 0, numFrames);
+}
+
+} // namespace ImRt
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                         SAMPLE FORMAT                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The format of the interleaved samples exchanged with an audio
+ * device. Integer samples are converted to and from the range [-1, 1).
+ * Int24 samples are packed into three bytes in native byte order.
+ */
+enum class SampleFormat
+{
+   Int16,
+   Int24,
+   Int32,
+   Float32,
+   Float64
+};
+
+/**
+ * @brief Returns the number of bytes of a sample in the given format.
+ */
+uint32_t sampleSize(SampleFormat format);
+
+/* -------------------------------------------------------------------------- */
+/*                        SAMPLE CONVERSION                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Converts interleaved device samples to the first channels of a
+ * buffer in one pass. The common cases, i.e. mono and stereo streams of 16 or
+ * 32 bit integer or float samples converted to float, use SSE or NEON
+ * instructions if available. These methods never block and do not allocate
+ * memory.
+ *
+ * @param data The interleaved samples.
+ * @param format The format of the samples.
+ * @param numChannels The number of channels of the samples. The buffer must
+ * have at least as many channels.
+ * @param buffer The buffer to write to.
+ * @param numFrames The number of frames to convert.
+ */
+void deinterleave(
+   const void* data, SampleFormat format, uint32_t numChannels, Buffer& buffer,
+   uint32_t numFrames
+);
+
+void deinterleave(
+   const void* data, SampleFormat format, uint32_t numChannels,
+   SampleBuffer<double>& buffer, uint32_t numFrames
+);
+
+/**
+ * @brief Converts the first channels of a buffer to interleaved device
+ * samples in one pass (cf. deinterleave()). Samples outside of the range
+ * [-1, 1] are clipped when they are converted to integers.
+ *
+ * @param data The interleaved samples to write to.
+ * @param format The format of the samples.
+ * @param numChannels The number of channels of the samples. The buffer must
+ * have at least as many channels.
+ * @param buffer The buffer to read from.
+ * @param numFrames The number of frames to convert.
+ */
+void interleave(
+   void* data, SampleFormat format, uint32_t numChannels, const Buffer& buffer,
+   uint32_t numFrames
+);
+
+void interleave(
+   void* data, SampleFormat format, uint32_t numChannels,
+   const SampleBuffer<double>& buffer, uint32_t numFrames
+);
+
+} // namespace ImRt
@@ -0,0 +1,327 @@
+#include "imrt-convolution.h"
+#include "imrt-simd.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                   uniform convolver                    */
+/* ------------------------------------------------------ */
+
+void Convolver::UniformConvolver::prepare(
+   uint32_t partitionSize, const float* ir, uint32_t length
+)
+{
+   _size          = partitionSize;
+   _numPartitions = (length + partitionSize - 1) / partitionSize;
+   _current       = 0;
+
+   _fft.prepare(2 * partitionSize);
+   _numBins = _fft.numBins();
+
+   size_t spectraSize = size_t(_numPartitions) * _numBins;
+   _irRe.assign(spectraSize, 0.0f);
+   _irIm.assign(spectraSize, 0.0f);
+   _inRe.assign(spectraSize, 0.0f);
+   _inIm.assign(spectraSize, 0.0f);
+   _accRe.assign(_numBins, 0.0f);
+   _accIm.assign(_numBins, 0.0f);
+   _time.assign(2 * partitionSize, 0.0f);
+   _output.assign(2 * partitionSize, 0.0f);
+
+   // Each partition is zero-padded to the size of the transform.
+   for (uint32_t p = 0; p < _numPartitions; ++p)
+   {
+      uint32_t offset = p * partitionSize;
+      uint32_t n      = std::min(partitionSize, length - offset);
+
+      std::fill(_time.begin(), _time.end(), 0.0f);
+      std::copy(ir + offset, ir + offset + n, _time.begin());
+      _fft.forward(
+         _time.data(), &_irRe[size_t(p) * _numBins],
+         &_irIm[size_t(p) * _numBins]
+      );
+   }
+   std::fill(_time.begin(), _time.end(), 0.0f);
+}
+
+void Convolver::UniformConvolver::process(const float* in, float* out)
+{
+   if (_numPartitions == 0)
+   {
+      std::fill(out, out + _size, 0.0f);
+      return;
+   }
+
+   // The transform covers the previous and the current input partition, so
+   // the second half of the circular convolution is free of wrap-around.
+   std::copy(_time.begin() + _size, _time.end(), _time.begin());
+   std::copy(in, in + _size, _time.begin() + _size);
+
+   size_t offset = size_t(_current) * _numBins;
+   _fft.forward(_time.data(), &_inRe[offset], &_inIm[offset]);
+
+   std::fill(_accRe.begin(), _accRe.end(), 0.0f);
+   std::fill(_accIm.begin(), _accIm.end(), 0.0f);
+   float* accRe = _accRe.data();
+   float* accIm = _accIm.data();
+
+   uint32_t slot = _current;
+   for (uint32_t p = 0; p < _numPartitions; ++p)
+   {
+      const float* xRe = &_inRe[size_t(slot) * _numBins];
+      const float* xIm = &_inIm[size_t(slot) * _numBins];
+      const float* hRe = &_irRe[size_t(p) * _numBins];
+      const float* hIm = &_irIm[size_t(p) * _numBins];
+
+      for (uint32_t k = 0; k < _numBins; ++k)
+      {
+         accRe[k] += xRe[k] * hRe[k] - xIm[k] * hIm[k];
+         accIm[k] += xRe[k] * hIm[k] + xIm[k] * hRe[k];
+      }
+      slot = slot == 0 ? _numPartitions - 1 : slot - 1;
+   }
+   _current = _current + 1 == _numPartitions ? 0 : _current + 1;
+
+   _fft.inverse(accRe, accIm, _output.data());
+   std::copy(_output.begin() + _size, _output.end(), out);
+}
+
+/* ------------------------------------------------------ */
+/*                       convolver                        */
+/* ------------------------------------------------------ */
+
+Convolver::~Convolver()
+{
+   stopWorker();
+}
+
+void Convolver::prepare(
+   const Buffer& impulseResponse, uint32_t numChannels,
+   ConvolverSettings settings
+)
+{
+   uint32_t head = settings.headSize;
+   uint32_t tail = settings.tailPartitionSize;
+   assert(head >= 2 && (head & (head - 1)) == 0);
+   assert(tail >= head && (tail & (tail - 1)) == 0);
+   assert(impulseResponse.getNumChannels() > 0);
+
+   stopWorker();
+   _settings = settings;
+
+   uint32_t length  = impulseResponse.getNumFrames();
+   uint32_t bodyEnd = std::min(length, 2 * tail);
+   _headLength      = std::min(length, head);
+   _hasTail         = length > 2 * tail;
+
+   _channels.resize(numChannels);
+   for (uint32_t i = 0; i < numChannels; ++i)
+   {
+      uint32_t source = std::min(i, impulseResponse.getNumChannels() - 1);
+      const float* ir  = &impulseResponse.getSample(source, 0);
+      Channel& channel = _channels[i];
+
+      channel.head.assign(ir, ir + _headLength);
+      channel.history.assign(2 * std::max(_headLength, 1u), 0.0f);
+      channel.historyPosition = 0;
+
+      channel.body.prepare(head, ir + _headLength, bodyEnd - _headLength);
+      channel.bodyIn.assign(head, 0.0f);
+      channel.bodyOut.assign(head, 0.0f);
+
+      channel.tail.prepare(
+         tail, ir + bodyEnd, _hasTail ? length - bodyEnd : 0
+      );
+      channel.tailIn.assign(_hasTail ? 2 * tail : 0, 0.0f);
+      channel.tailOut.assign(_hasTail ? 2 * tail : 0, 0.0f);
+   }
+
+   _bodyPosition    = 0;
+   _tailPosition    = 0;
+   _tailBlock       = 0;
+   _tailMuted       = false;
+   _tailInBlocks[0] = _tailInBlocks[1] = ~uint64_t(0);
+   _silence.assign(_hasTail ? tail : 0, 0.0f);
+   _tailsSubmitted.store(0);
+   _tailsDone.store(0);
+   _numLateTails.store(0);
+
+   if (_hasTail && _settings.backgroundTail)
+   {
+      _running = true;
+      _thread  = std::thread(&Convolver::work, this);
+      configureWorkerThread(_thread, _settings.realtime);
+   }
+}
+
+void Convolver::process(Buffer& buffer, uint32_t numFrames)
+{
+   uint32_t head = _settings.headSize;
+   uint32_t tail = _settings.tailPartitionSize;
+   uint32_t done = 0;
+
+   while (done < numFrames)
+   {
+      // The output of the tail partition before the previous one is mixed
+      // into the current one, if the worker has finished it. Otherwise the
+      // worker still reads the input slot of the current partition, so its
+      // input is dropped.
+      if (_hasTail && _settings.backgroundTail && _tailPosition == 0
+          && _tailBlock >= 2)
+      {
+         _tailMuted = _tailsDone.load(std::memory_order_acquire)
+            < _tailBlock - 1;
+         if (_tailMuted)
+         {
+            _numLateTails.fetch_add(1, std::memory_order_relaxed);
+         }
+      }
+
+      uint32_t n = std::min(numFrames - done, head - _bodyPosition);
+      if (_hasTail)
+      {
+         n = std::min(n, tail - _tailPosition);
+      }
+
+      uint32_t slot = uint32_t(_tailBlock % 2) * tail + _tailPosition;
+      for (size_t i = 0; i < _channels.size(); ++i)
+      {
+         Channel& channel = _channels[i];
+         float* signal    = &buffer.getSample(i, done);
+
+         std::copy(signal, signal + n, &channel.bodyIn[_bodyPosition]);
+         if (_hasTail && !_tailMuted)
+         {
+            std::copy(signal, signal + n, &channel.tailIn[slot]);
+         }
+
+         // The history holds every sample twice, so the most recent samples
+         // are always contiguous.
+         float* history    = channel.history.data();
+         uint32_t size     = uint32_t(channel.history.size() / 2);
+         uint32_t position = channel.historyPosition;
+         const float* taps = channel.head.data();
+         const float* body = &channel.bodyOut[_bodyPosition];
+         for (uint32_t frame = 0; frame < n; ++frame)
+         {
+            position          = position == 0 ? size - 1 : position - 1;
+            history[position] = history[position + size] = signal[frame];
+            signal[frame] = Simd::dot(history + position, taps, _headLength)
+               + body[frame];
+         }
+         channel.historyPosition = position;
+
+         if (_hasTail && !_tailMuted)
+         {
+            const float* out = &channel.tailOut[slot];
+            for (uint32_t frame = 0; frame < n; ++frame)
+            {
+               signal[frame] += out[frame];
+            }
+         }
+      }
+
+      done += n;
+      _bodyPosition += n;
+      if (_bodyPosition == head)
+      {
+         for (auto& channel : _channels)
+         {
+            channel.body.process(
+               channel.bodyIn.data(), channel.bodyOut.data()
+            );
+         }
+         _bodyPosition = 0;
+      }
+
+      if (!_hasTail)
+      {
+         continue;
+      }
+      _tailPosition += n;
+      if (_tailPosition == tail)
+      {
+         if (!_tailMuted)
+         {
+            _tailInBlocks[_tailBlock % 2] = _tailBlock;
+         }
+
+         if (_settings.backgroundTail)
+         {
+            // The worker is woken up without taking the mutex, so the audio
+            // thread never blocks. A missed wake-up is caught by the timeout
+            // of the worker.
+            _tailsSubmitted.store(_tailBlock + 1, std::memory_order_release);
+            _wakeUp.notify_one();
+         }
+         else
+         {
+            processTail(_tailBlock);
+         }
+         _tailPosition = 0;
+         ++_tailBlock;
+      }
+   }
+}
+
+uint64_t Convolver::numLateTails() const
+{
+   return _numLateTails.load(std::memory_order_relaxed);
+}
+
+void Convolver::stopWorker()
+{
+   if (!_thread.joinable())
+   {
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _running = false;
+   }
+   _wakeUp.notify_one();
+   _thread.join();
+}
+
+void Convolver::work()
+{
+   // Decaying tails would otherwise be computed in slow denormals.
+   ScopedDenormals denormals(_settings.realtime.flushDenormals);
+
+   while (_running)
+   {
+      uint64_t block = _tailsDone.load(std::memory_order_relaxed);
+      if (_tailsSubmitted.load(std::memory_order_acquire) > block)
+      {
+         processTail(block);
+         _tailsDone.store(block + 1, std::memory_order_release);
+         continue;
+      }
+
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wakeUp.wait_for(
+         lock, std::chrono::milliseconds(1),
+         [this, block]
+         {
+            return !_running
+               || _tailsSubmitted.load(std::memory_order_acquire) > block;
+         }
+      );
+   }
+}
+
+void Convolver::processTail(uint64_t block)
+{
+   uint32_t slot = uint32_t(block % 2) * _settings.tailPartitionSize;
+   bool dropped  = _tailInBlocks[block % 2] != block;
+   for (auto& channel : _channels)
+   {
+      const float* in = dropped ? _silence.data() : &channel.tailIn[slot];
+      channel.tail.process(in, &channel.tailOut[slot]);
+   }
+}
+
+} // namespace ImRt
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "imrt-fft.h"
+#include "imrt-realtime.h"
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                           CONVOLVER                                        */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Settings of a Convolver.
+ */
+struct ConvolverSettings
+{
+   // The length of the direct-form head, which is also the partition size of
+   // the body. A power of two.
+   uint32_t headSize = 64;
+
+   // The partition size of the tail, which starts at twice this size. A
+   // power of two of at least the head size. The worker has one partition
+   // minus one buffer of time for each partition, so this should be several
+   // times the buffer size.
+   uint32_t tailPartitionSize = 1024;
+
+   // Computes the tail on a worker thread. Otherwise it is computed on the
+   // calling thread whenever a tail partition is complete, which gives the
+   // same output, e.g. for offline rendering.
+   bool backgroundTail = true;
+
+   // The priority and cores of the worker thread (cf. configureWorkerThread).
+   RealtimeSettings realtime;
+};
+
+/**
+ * @brief Convolves signals with long impulse responses, e.g. of reverbs or
+ * cabinets, without latency. The impulse response is split into three
+ * segments:
+ *
+ * - The head, i.e. the first ConvolverSettings::headSize samples, is
+ *   evaluated in direct form sample by sample, so there is no latency.
+ * - The body up to twice the tail partition size is evaluated by uniformly
+ *   partitioned FFT convolution on the audio thread, one head size partition
+ *   at a time.
+ * - The tail is evaluated by uniformly partitioned FFT convolution with
+ *   larger partitions on a worker thread. The audio thread hands complete
+ *   input partitions to the worker through lock-free counters and mixes the
+ *   result one partition later, so the worker has a whole partition of time
+ *   for each one. If it misses this deadline, the tail is muted for a
+ *   partition and the input of that partition is dropped, since the worker
+ *   still reads the slot it would be written to. The worker convolves
+ *   silence in its place, so the tail stays aligned (cf.
+ *   Convolver::numLateTails()).
+ *
+ * All memory is allocated in Convolver::prepare(), and any number of frames
+ * can be passed to Convolver::process().
+ */
+class Convolver
+{
+public:
+   /**
+    * @brief Stops the worker thread and destroys the object.
+    */
+   ~Convolver();
+
+   /**
+    * @brief Prepares the convolver for an impulse response and resets its
+    * state. This method must not be called concurrently with
+    * Convolver::process().
+    *
+    * @param impulseResponse The impulse response. Either it has a channel
+    * for every channel to convolve, or its first channel is used for all.
+    * @param numChannels The number of channels to convolve.
+    * @param settings The partitioning and the worker thread settings.
+    */
+   void prepare(
+      const Buffer& impulseResponse, uint32_t numChannels,
+      ConvolverSettings settings = ConvolverSettings()
+   );
+
+   /**
+    * @brief Convolves the first channels of the buffer in place. This method
+    * is realtime-safe.
+    *
+    * @param buffer The buffer to process.
+    * @param numFrames The number of frames to process.
+    */
+   void process(Buffer& buffer, uint32_t numFrames);
+
+   /**
+    * @brief Returns the number of tail partitions the worker thread did not
+    * finish in time.
+    */
+   uint64_t numLateTails() const;
+
+private:
+   /**
+    * @brief A uniformly partitioned overlap-save convolution with a
+    * frequency-domain delay line.
+    */
+   class UniformConvolver
+   {
+   public:
+      void prepare(uint32_t partitionSize, const float* ir, uint32_t length);
+      void process(const float* in, float* out);
+
+   private:
+      Fft _fft;
+      uint32_t _size = 0, _numBins = 0, _numPartitions = 0, _current = 0;
+      std::vector<float> _irRe, _irIm; // spectra of the partitions
+      std::vector<float> _inRe, _inIm; // spectra of the recent inputs
+      std::vector<float> _accRe, _accIm;
+      std::vector<float> _time, _output;
+   };
+
+   struct Channel
+   {
+      std::vector<float> head, history; // history is doubled
+      uint32_t historyPosition = 0;
+
+      UniformConvolver body, tail;
+      std::vector<float> bodyIn, bodyOut;
+      std::vector<float> tailIn, tailOut; // two partitions each
+   };
+
+   ConvolverSettings _settings;
+   std::vector<Channel> _channels;
+   uint32_t _headLength = 0;
+   bool _hasTail        = false;
+
+   uint32_t _bodyPosition = 0, _tailPosition = 0;
+   uint64_t _tailBlock       = 0;
+   bool _tailMuted           = false; // the input is dropped as well
+   uint64_t _tailInBlocks[2] = {};    // the block whose input a slot holds
+   std::vector<float> _silence;
+
+   std::atomic<uint64_t> _tailsSubmitted { 0 }, _tailsDone { 0 };
+   std::atomic<uint64_t> _numLateTails { 0 };
+
+   std::thread _thread;
+   std::mutex _mutex;
+   std::condition_variable _wakeUp;
+   std::atomic<bool> _running { false };
+
+   void stopWorker();
+   void work();
+   void processTail(uint64_t block);
+};
+
+} // namespace ImRt
@@ -0,0 +1,28 @@
+#include "imrt-devices.h"
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                        devices                         */
+/* ------------------------------------------------------ */
+
+std::vector<RtAudio::Api> audioApis()
+{
+   std::vector<RtAudio::Api> apis;
+   RtAudio::getCompiledApi(apis);
+   return apis;
+}
+
+std::vector<RtAudio::DeviceInfo> audioDevices(RtAudio::Api api)
+{
+   RtAudio dac(api);
+
+   std::vector<RtAudio::DeviceInfo> devices;
+   for (auto id : dac.getDeviceIds())
+   {
+      devices.push_back(dac.getDeviceInfo(id));
+   }
+   return devices;
+}
+
+} // namespace ImRt
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <RtAudio.h>
+#include <vector>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                           DEVICES                                          */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Returns the audio APIs RtAudio was compiled with, e.g. ALSA,
+ * PulseAudio and JACK on Linux. The name of an API can be obtained with
+ * RtAudio::getApiDisplayName().
+ */
+std::vector<RtAudio::Api> audioApis();
+
+/**
+ * @brief Returns information about the audio devices of the given API, e.g. to
+ * let the user choose the devices, channels and sample rate of a stream (cf.
+ * DspSettings). The ID of a device is the one to put into the settings, its
+ * position in the returned list has no meaning.
+ *
+ * @param api The audio API. If not specified, the API RtAudio would choose by
+ * default is used.
+ */
+std::vector<RtAudio::DeviceInfo>
+audioDevices(RtAudio::Api api = RtAudio::UNSPECIFIED);
+
+} // namespace ImRt
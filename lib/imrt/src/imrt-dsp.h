@@ -1,7 +1,24 @@
 #pragma once
 
 #include <RtAudio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "imrt-automation.h"
+#include "imrt-bridge.h"
+#include "imrt-buffersize.h"
+#include "imrt-convert.h"
+#include "imrt-osc.h"
 #include "imrt-params.h"
+#include "imrt-realtime.h"
+#include "imrt-resampler.h"
+#include "imrt-streams.h"
+#include "imrt-trace.h"
 
 #include "imrt-constants.h"
 
@@ -16,6 +33,23 @@ namespace ImRt {
  * constructor to specify the number of input and output channels, the sample
  * rate and the buffer size of the stream that the processor opens when its
  * Dsp::run() method is called.
+ *
+ * The input and output devices are identified by the IDs that audioDevices()
+ * reports for the given audio API. The channels of the stream start at the
+ * given first channel of the device, e.g. to use the inputs 3 and 4 of an
+ * interface set numChannelsIn to 2 and firstChannelIn to 2. A channel count
+ * of 0 opens an output-only or input-only stream.
+ *
+ * If an engine sample rate is given and the device runs at a different rate,
+ * the stream is converted to and from the engine sample rate with a Resampler
+ * of the given quality, so Dsp::process() always runs at the engine sample
+ * rate. The number of frames per Dsp::process() call then varies slightly
+ * around the buffer size scaled by the ratio of the two rates.
+ *
+ * The device format is the format in which the stream exchanges samples with
+ * the devices. Choosing the native format of an interface, e.g. Int32, saves
+ * the audio API a conversion pass, since the samples are converted directly
+ * to the sample type of the processor (cf. Dsp).
  */
 struct DspSettings
 {
@@ -23,6 +57,19 @@ struct DspSettings
    int numChannelsOut  = 2;
    uint32_t sampleRate = 44100;
    uint32_t bufferSize = 0; // 0 means as small as possible
+
+   uint32_t engineSampleRate = 0; // 0 means the sample rate of the device
+   ResamplerQuality resamplerQuality = ResamplerQuality::Medium;
+
+   RtAudio::Api api        = RtAudio::UNSPECIFIED;
+   uint32_t inputDeviceId  = 0; // 0 means the default input device
+   uint32_t outputDeviceId = 0; // 0 means the default output device
+   int firstChannelIn      = 0;
+   int firstChannelOut     = 0;
+
+   SampleFormat deviceFormat = SampleFormat::Float32;
+
+   RealtimeSettings realtime;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -32,9 +79,13 @@ struct DspSettings
 /**
  * @brief Digital signal processor (DSP) template class to inherit from.
  *
- * @tparam Use the inheritor class as template parameter.
+ * @tparam Derived Use the inheritor class as template parameter.
+ * @tparam Sample The sample type of the buffers passed to Dsp::process(),
+ * float or double. With double, e.g. long feedback paths run in double
+ * precision throughout. The resamplers and the auxiliary streams convert to
+ * and from float samples at their boundaries.
  */
-template <typename Derived>
+template <typename Derived, typename Sample = float>
 class Dsp
 {
    template <typename, typename>
@@ -54,21 +105,7 @@ public:
    Dsp(DspSettings settings = DspSettings())
       : _settings(settings)
    {
-      auto defaultIn  = _dac.getDefaultInputDevice();
-      auto defaultOut = _dac.getDefaultOutputDevice();
-
-      if ((defaultIn == 0) || (defaultOut == 0))
-      {
-         abort();
-      }
-
-      _paramsIn.deviceId     = defaultIn;
-      _paramsIn.nChannels    = _settings.numChannelsIn;
-      _paramsIn.firstChannel = 0;
-
-      _paramsOut.deviceId     = defaultOut;
-      _paramsOut.nChannels    = _settings.numChannelsIn;
-      _paramsOut.firstChannel = 0;
+      _automationEvents.resize(1024);
    }
 
    /**
@@ -77,67 +114,411 @@ public:
     */
    virtual ~Dsp()
    {
-      if (_dac.isStreamRunning())
-      {
-         _dac.stopStream();
-      }
-      if (_dac.isStreamOpen())
-      {
-         _dac.closeStream();
-      }
+      _bufferSizeController.stop();
+      closeStream();
    }
 
    /**
     * @brief Opens an input and an output stream with the settings passed to the
     * DSP constructor and passes the input buffer to and receives the output
     * buffer from the Dsp::process() callback method.
+    *
+    * @return false if the stream could not be opened or started, e.g. because
+    * a device is missing or does not support the settings.
     */
-   void run()
+   bool run()
    {
+      closeStream();
+
+      if (!_dac || _api != _settings.api)
+      {
+         _dac = std::make_unique<RtAudio>(_settings.api);
+         _api = _settings.api;
+      }
+
+      RtAudio::StreamParameters paramsIn, paramsOut;
+      paramsIn.deviceId      = _settings.inputDeviceId;
+      paramsIn.nChannels     = std::max(0, _settings.numChannelsIn);
+      paramsIn.firstChannel  = std::max(0, _settings.firstChannelIn);
+      paramsOut.deviceId     = _settings.outputDeviceId;
+      paramsOut.nChannels    = std::max(0, _settings.numChannelsOut);
+      paramsOut.firstChannel = std::max(0, _settings.firstChannelOut);
+
+      if (paramsIn.deviceId == 0)
+      {
+         paramsIn.deviceId = _dac->getDefaultInputDevice();
+      }
+      if (paramsOut.deviceId == 0)
+      {
+         paramsOut.deviceId = _dac->getDefaultOutputDevice();
+      }
+
+      const RealtimeSettings& realtime = _settings.realtime;
+
       auto options  = RtAudio::StreamOptions();
       options.flags = 0;
       // options.flags |= RTAUDIO_NONINTERLEAVED;
       options.flags |= RTAUDIO_MINIMIZE_LATENCY;
-      options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+      if (realtime.scheduleRealtime)
+      {
+         options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+      }
       // options.flags |= RTAUDIO_ALSA_USE_DEFAULT;
       options.streamName = "imrt-stream";
-      options.priority   = 10; // 99
+      options.priority   = realtime.priority;
+
+      if (realtime.lockMemory)
+      {
+         lockMemory();
+      }
 
-      if (_dac.openStream(
-             &_paramsOut, &_paramsIn, RTAUDIO_FLOAT32, _settings.sampleRate,
+      if (_dac->openStream(
+             paramsOut.nChannels > 0 ? &paramsOut : nullptr,
+             paramsIn.nChannels > 0 ? &paramsIn : nullptr,
+             rtAudioFormat(_settings.deviceFormat), _settings.sampleRate,
              &_settings.bufferSize, &AudioCallback, this, &options
           ))
       {
-         abort();
+         return false;
+      }
+
+      _deviceRate = _dac->getStreamSampleRate();
+      prepareResampling();
+
+      uint32_t maxFrames
+         = _resampling ? _in.getNumFrames() : _settings.bufferSize;
+      static_cast<Derived*>(this)->prepare(sampleRate(), maxFrames);
+      if (_bridge)
+      {
+         _bridge->setSampleRate(sampleRate());
+      }
+
+      // The auxiliary streams are started first, so their rings are filled
+      // by the time the main stream starts reading from them.
+      for (auto& stream : _auxiliaryStreams)
+      {
+         stream->start(sampleRate(), maxFrames, realtime);
+      }
+
+      // The callback thread configures itself when it is first called. Its
+      // trace buffer is reserved here, so that the first callback neither
+      // locks nor allocates, and the buffer of a previous stream is reused.
+      _configureThread = true;
+      IMRT_TRACE_RESERVE_THREADS(1);
+
+      if (_dac->startStream())
+      {
+         _dac->closeStream();
+         return false;
+      }
+      return true;
+   }
+
+   /**
+    * @brief Stops the stream and reopens it with new settings, e.g. to switch
+    * the devices or to change the buffer size. The state of the processor,
+    * i.e. the inheritor object, its parameters, a running automation and the
+    * stream clock, is preserved. Only Dsp::prepare() is called again. The
+    * audio API is only reinitialized if it changes, so changing the buffer
+    * size takes about as long as opening a stream. This method must not be
+    * called from within Dsp::process().
+    *
+    * @param settings The new settings.
+    * @return false if the stream could not be opened with the new settings.
+    * The stream is closed in this case and can be restarted with other
+    * settings.
+    */
+   bool restart(DspSettings settings)
+   {
+      closeStream();
+      _settings = settings;
+      return run();
+   }
+
+   /**
+    * @brief Returns the settings of the stream. Once the stream is open, the
+    * buffer size is the actual one.
+    */
+   const DspSettings& settings()
+   {
+      return _settings;
+   }
+
+   /**
+    * @brief Returns true if the stream is open and running.
+    */
+   bool isRunning()
+   {
+      return _dac && _dac->isStreamRunning();
+   }
+
+   /**
+    * @brief Runs the processor offline on a whole signal, block by block and
+    * without opening a stream, e.g. to render a file or to compare the output
+    * with a golden file (cf. runRegression()). Dsp::prepare() is called with
+    * the given sample rate and block size, the stream clock starts at zero and
+    * the automation clip, if any, is played from there. The channels of
+    * auxiliary streams are silent. This method must not be called while the
+    * stream is running.
+    *
+    * @param input The input signal. Missing channels are silent.
+    * @param output Receives the output signal, which has as many frames as
+    * the input signal.
+    * @param sampleRate The sample rate passed to Dsp::prepare().
+    * @param blockSize The number of frames per Dsp::process() call. The last
+    * block may be shorter.
+    * @param clip An automation clip to play or nullptr.
+    * @param blockTimes If not nullptr, receives the duration of every
+    * Dsp::process() call in seconds.
+    * @return false if the stream is running or Dsp::process() did not return
+    * 0, in which case the output ends with the last processed block.
+    */
+   bool renderOffline(
+      const Buffer& input, Buffer& output, uint32_t sampleRate,
+      uint32_t blockSize, std::unique_ptr<AutomationClip> clip = nullptr,
+      std::vector<double>* blockTimes = nullptr
+   )
+   {
+      if (isRunning() || sampleRate == 0 || blockSize == 0)
+      {
+         return false;
       }
 
-      if (_dac.startStream())
+      ScopedDenormals denormals(_settings.realtime.flushDenormals);
+
+      _offlineSampleRate = sampleRate;
+      static_cast<Derived*>(this)->prepare(sampleRate, blockSize);
+
+      _streamFrame.store(0);
+      _automation.stop();
+      if (clip)
       {
-         abort();
+         _automation.play(std::move(clip), 0);
       }
+
+      uint32_t numFrames = input.getNumFrames();
+      uint32_t n         = std::min<uint32_t>(
+         std::max(0, _settings.numChannelsIn), input.getNumChannels()
+      );
+      output = Buffer(numChannelsOut(), numFrames);
+
+      int r = 0;
+      for (uint32_t start = 0; start < numFrames && r == 0; start += blockSize)
+      {
+         uint32_t numBlockFrames = std::min(blockSize, numFrames - start);
+         _in.resize({ numChannelsIn(), numBlockFrames });
+         _out.resize({ numChannelsOut(), numBlockFrames });
+         _in.clear();
+
+         for (uint32_t channel = 0; channel < n; ++channel)
+         {
+            const float* signal = &input.getSample(channel, start);
+            std::copy(
+               signal, signal + numBlockFrames, &_in.getSample(channel, 0)
+            );
+         }
+
+         auto begin = std::chrono::steady_clock::now();
+         r          = processBlock(numBlockFrames, false);
+         std::chrono::duration<double> duration
+            = std::chrono::steady_clock::now() - begin;
+
+         if (blockTimes)
+         {
+            blockTimes->push_back(duration.count());
+         }
+
+         for (uint32_t channel = 0; channel < numChannelsOut(); ++channel)
+         {
+            const Sample* signal = &_out.getSample(channel, 0);
+            float* rendered      = &output.getSample(channel, start);
+            std::copy(signal, signal + numBlockFrames, rendered);
+         }
+      }
+
+      _automation.stop();
+      _offlineSampleRate = 0;
+      return r == 0;
+   }
+
+   /**
+    * @brief Enables a BufferSizeController that measures the load of every
+    * callback and the xruns reported by the audio API, and restarts the
+    * stream with a larger buffer when xruns happen or with a smaller one
+    * after a period of low load. The stream should be running already, since
+    * the current buffer size is the starting point. The stream is only
+    * restarted by Dsp::pollBufferSizeController(), which the thread that owns
+    * the Dsp has to call periodically; the Gui does so every frame. Every
+    * decision is logged to std::clog (cf. Dsp::bufferSizeController()).
+    *
+    * @param settings The bounds of the buffer size and the thresholds of the
+    * controller.
+    */
+   void enableBufferSizeController(
+      BufferSizeControllerSettings settings = BufferSizeControllerSettings()
+   )
+   {
+      disableBufferSizeController();
+      _bufferSizeController.configure(settings);
+      _measureLoad = true;
+      _bufferSizeController.start(_settings.bufferSize);
+   }
+
+   /**
+    * @brief Restarts the stream if the BufferSizeController decided to change
+    * the buffer size. This method must be called periodically from the thread
+    * that owns the Dsp, i.e. the thread that calls Dsp::restart() and the
+    * other methods of the stream, so the restart does not race with them.
+    *
+    * @return true if the stream was restarted.
+    */
+   bool pollBufferSizeController()
+   {
+      return _bufferSizeController.poll(
+         [this](uint32_t bufferSize) -> uint32_t
+         {
+            DspSettings settings = _settings;
+            settings.bufferSize  = bufferSize;
+            return restart(settings) ? _settings.bufferSize : 0;
+         }
+      );
+   }
+
+   /**
+    * @brief Stops the BufferSizeController. The buffer size stays as it is.
+    */
+   void disableBufferSizeController()
+   {
+      _bufferSizeController.stop();
+      _measureLoad = false;
+   }
+
+   /**
+    * @brief Returns the BufferSizeController, e.g. to read its decisions.
+    */
+   const BufferSizeController& bufferSizeController()
+   {
+      return _bufferSizeController;
    }
 
    /**
-    * @brief Returns the actual sample rate of the (open) stream, which may
-    * differ slightly from the specified one. one. If a stream is not open, a
-    * value of zero is returned.
+    * @brief Called by Dsp::run() and Dsp::restart() after the stream has been
+    * opened and before it is started, i.e. never concurrently with
+    * Dsp::process(). The inheritor class may implement this method to adapt
+    * to the sample rate, e.g. to compute filter coefficients, or to allocate
+    * buffers.
+    *
+    * @param sampleRate The sample rate at which Dsp::process() will run.
+    * @param maxNumFrames The maximum number of frames per Dsp::process()
+    * call.
+    */
+   void prepare(uint32_t sampleRate, uint32_t maxNumFrames)
+   {
+   }
+
+   /**
+    * @brief Returns the sample rate at which Dsp::process() runs. This is the
+    * engine sample rate if the stream is resampled (cf. DspSettings) and
+    * otherwise the actual sample rate of the (open) stream, which may differ
+    * slightly from the specified one. While Dsp::renderOffline() runs, this
+    * is its sample rate. If a stream is not open, a value of zero is
+    * returned.
     */
    uint32_t sampleRate()
    {
-      return _dac.getStreamSampleRate();
+      if (_offlineSampleRate > 0)
+      {
+         return _offlineSampleRate;
+      }
+      if (_resampling)
+      {
+         return _settings.engineSampleRate;
+      }
+      return _dac && _dac->isStreamOpen() ? _dac->getStreamSampleRate() : 0;
+   }
+
+   /**
+    * @brief Declares the latency of Dsp::process() in samples at the engine
+    * sample rate, e.g. the lookahead of a limiter or the latency of an
+    * Oversampler or a LatencyCompensator. The inheritor class should call
+    * this method in Dsp::prepare() and whenever the latency changes. It is
+    * realtime-safe.
+    */
+   void declareLatency(uint32_t samples)
+   {
+      _latency.store(samples, std::memory_order_relaxed);
+   }
+
+   /**
+    * @brief Returns the latency of Dsp::process() in samples as declared by
+    * the inheritor class (cf. Dsp::declareLatency()).
+    */
+   uint32_t latency()
+   {
+      return _latency.load(std::memory_order_relaxed);
+   }
+
+   /**
+    * @brief Returns the latency from the input to the output of the stream in
+    * samples at the sample rate of Dsp::process(). It combines the latency
+    * of the stream as reported by RtAudio, i.e. the buffering of the audio
+    * API and the devices, the latencies of the resamplers if the stream is
+    * resampled and the latency declared by the inheritor class. If a stream
+    * is not open, a value of zero is returned.
+    */
+   uint32_t roundTripLatency()
+   {
+      if (!_dac || !_dac->isStreamOpen())
+      {
+         return 0;
+      }
+
+      double engineRate = sampleRate();
+      double deviceRate = _deviceRate > 0.0 ? _deviceRate : engineRate;
+
+      // In device frames
+      double frames = _dac->getStreamLatency();
+      if (_resampling)
+      {
+         frames += _inputResampler.latency();
+         frames += _outputResampler.latency() * deviceRate / engineRate;
+      }
+
+      return uint32_t(std::lround(frames * engineRate / deviceRate))
+         + latency();
    }
 
    /**
     * @brief Creates a new DspParameter with the given ParameterLayout and
     * adds this parameter to the DspParameters collection managed by the Dsp
-    * object.
+    * object. Parameters can be added while the stream is running, e.g. when a
+    * processor is inserted into a chain; the Gui<> picks them up before its
+    * next frame. This method must not be called from the DSP thread.
     *
     * @param layout The skeleton for the new DSP parameter consisting of an
     * ID, a name, a maximum, minimum and initial value.
+    * @return false if there is a parameter with the same ID already.
     */
-   void addParameter(ParameterLayout& layout)
+   bool addParameter(ParameterLayout& layout)
    {
-      parameters.addParameter(layout);
+      return parameters.addParameter(layout);
+   }
+
+   /**
+    * @brief Removes a DspParameter from the DspParameters collection. This
+    * method can be called while the stream is running. Handles and widgets
+    * of the parameter keep it alive and see it as removed (cf.
+    * ParameterHandle::removed() and GuiParameter::removed), so it is deleted
+    * along with the last of them, or by the GUI thread once the DSP thread
+    * does not use it anymore. This method must not be called from the DSP
+    * thread.
+    *
+    * @param paramId The ID of the DspParameter.
+    * @return false if there is no parameter with the ID.
+    */
+   bool removeParameter(uint32_t paramId)
+   {
+      return parameters.removeParameter(paramId);
    }
 
    /**
@@ -154,6 +535,7 @@ public:
     */
    void announceParameterChange(uint32_t paramId, float& newValue)
    {
+      IMRT_TRACE_INSTANT("Dsp::announceParameterChange");
       parameters.announceChange(paramId, newValue);
    }
 
@@ -180,6 +562,224 @@ public:
       return parameters.value(paramId);
    }
 
+   /**
+    * @brief Returns a handle to a DspParameter, through which Dsp::process()
+    * reads the parameter without looking up its ID. The handles should be
+    * resolved once, e.g. in the constructor of the inheritor class or when a
+    * parameter is added while the stream is running, since this method must
+    * not be called from the DSP thread. The values of all handles are
+    * updated at the beginning of every audio block, so
+    * ParameterHandle::value() returns the current value. A handle keeps its
+    * parameter alive after it has been removed, and ParameterHandle::removed()
+    * tells Dsp::process() to stop using it.
+    *
+    * @param paramId The ID of the DspParameter.
+    */
+   ParameterHandle parameterHandle(uint32_t paramId)
+   {
+      return parameters.handle(paramId);
+   }
+
+   /**
+    * @brief Sets the value of a DspParameter from within the DSP, e.g. when a
+    * limit is enforced or a value is learned, and reports the change to the
+    * GUI, which updates the corresponding GuiParameter before it paints the
+    * next frame. Repeated changes of a parameter are coalesced, so calling
+    * this method many times per block is cheap. This method must only be
+    * called from within Dsp::process().
+    *
+    * @param paramId The ID of the DspParameter.
+    * @param newValue The new value of the DspParameter.
+    */
+   void setParameterValue(uint32_t paramId, float newValue)
+   {
+      parameters.setValue(paramId, newValue);
+   }
+
+   /**
+    * @brief Applies the values of a preset to the DspParameters as one batch.
+    * The values are prepared in the calling thread and consumed by the DSP
+    * thread at the beginning of the next audio block, before Dsp::process() is
+    * called, so the processor never sees a partially applied preset. This
+    * method must not be called from within Dsp::process().
+    *
+    * @param preset The preset whose values should be applied.
+    */
+   void applyPreset(const Preset& preset)
+   {
+      parameters.publishPreset(preset);
+   }
+
+   /**
+    * @brief Returns the stream clock, i.e. the number of frames that have been
+    * processed since the stream was started. Within Dsp::process() this is the
+    * frame at which the current audio block starts.
+    */
+   uint64_t streamFrame()
+   {
+      return _streamFrame.load();
+   }
+
+   /**
+    * @brief Starts playing an automation clip from the current position of
+    * the stream clock. The automation events are applied to the DspParameters
+    * with sample-accurate timing (cf. Dsp::applyAutomation()). This method
+    * must not be called from within Dsp::process().
+    *
+    * @param clip The clip to play, e.g. one recorded by Gui::stopRecording().
+    */
+   void playAutomation(std::unique_ptr<AutomationClip> clip)
+   {
+      _automation.play(std::move(clip), _streamFrame.load());
+   }
+
+   /**
+    * @brief Stops the automation playback. This method must not be called from
+    * within Dsp::process().
+    */
+   void stopAutomation()
+   {
+      _automation.stop();
+   }
+
+   /**
+    * @brief Applies all automation events of the current audio block that
+    * take effect at or before the given frame to the DspParameters and
+    * reports the changes to the GUI (cf. Dsp::setParameterValue()). Call this
+    * method in Dsp::process() before computing a frame to get sample-accurate
+    * automation. Events not applied by Dsp::process() are applied after it
+    * returns.
+    *
+    * @param frame The frame of the current audio block.
+    */
+   void applyAutomation(uint32_t frame)
+   {
+      while (_nextAutomationEvent < _numAutomationEvents
+             && _automationEvents[_nextAutomationEvent].offset <= frame)
+      {
+         auto& event = _automationEvents[_nextAutomationEvent++];
+         parameters.setValue(event.paramId, event.value);
+      }
+   }
+
+   /**
+    * @brief Starts an OscServer that receives parameter changes over UDP on
+    * its own thread (cf. OscServer). A running server is restarted with the
+    * new settings.
+    *
+    * @return false if the server could not be started.
+    */
+   bool startOscServer(OscSettings settings = OscSettings())
+   {
+      if (!_osc)
+      {
+         _osc = std::make_unique<OscServer>(parameters);
+      }
+      return _osc->start(settings);
+   }
+
+   /**
+    * @brief Stops the OscServer started by Dsp::startOscServer().
+    */
+   void stopOscServer()
+   {
+      if (_osc)
+      {
+         _osc->stop();
+      }
+   }
+
+   /**
+    * @brief Returns the UDP port of the OscServer or 0 if it is not running.
+    */
+   uint16_t oscPort()
+   {
+      return _osc ? _osc->port() : 0;
+   }
+
+   /**
+    * @brief Starts a BridgeServer, through which a GUI in another process
+    * controls the processor (cf. RemoteDsp), e.g. to run the DSP as a
+    * headless server. The server takes the role of the GUI thread, so it must
+    * not be combined with an in-process Gui<>. The first call must come before
+    * Dsp::run(), since the audio thread writes the taps of the server (cf.
+    * Dsp::writeBridgeTap()). A stopped server can be started again.
+    *
+    * @return false if the server could not be started.
+    */
+   bool startBridge(BridgeSettings settings = BridgeSettings())
+   {
+      if (!_bridge)
+      {
+         _bridge = std::make_unique<BridgeServer>(parameters, _streamFrame);
+      }
+      return _bridge->start(settings);
+   }
+
+   /**
+    * @brief Stops the BridgeServer started by Dsp::startBridge(). The GUI
+    * stops receiving changes, but the audio keeps running.
+    */
+   void stopBridge()
+   {
+      if (_bridge)
+      {
+         _bridge->stop();
+      }
+   }
+
+   /**
+    * @brief Writes the first frames of a buffer into a tap of the
+    * BridgeServer, from which the GUI process reads them for its meters and
+    * scopes (cf. RemoteDsp::readTap()). Frames are dropped while no GUI reads
+    * them. This method must only be called from within Dsp::process().
+    *
+    * @param tap The index of the tap, less than maxBridgeTaps.
+    * @param buffer The buffer, of which at most maxBridgeTapChannels channels
+    * are written.
+    * @param numFrames The number of frames to write.
+    * @return The number of frames written.
+    */
+   uint32_t
+   writeBridgeTap(uint32_t tap, const Buffer& buffer, uint32_t numFrames)
+   {
+      return _bridge ? _bridge->writeTap(tap, buffer, numFrames) : 0;
+   }
+
+   /**
+    * @brief Calls the given function with the ID and the new value of every
+    * parameter that has been changed by the DSP thread since the last call
+    * (cf. DspParameters::receiveChanges()). The Gui<> calls this method before
+    * it paints a frame, so it must only be called by the GUI thread.
+    *
+    * @param function A callable with the signature
+    * void(uint32_t paramId, float value).
+    */
+   template <typename Function>
+   void receiveParameterChanges(Function&& function)
+   {
+      parameters.receiveChanges(std::forward<Function>(function));
+   }
+
+   /**
+    * @brief Adds an AuxiliaryStream, e.g. of a second audio interface, whose
+    * channels are processed together with the channels of the main stream.
+    * The input channels of the auxiliary stream are appended to the input
+    * buffer and its output channels to the output buffer passed to
+    * Dsp::process(), in the order in which the streams were added. The clock
+    * drift between the devices is compensated by resampling. This method must
+    * be called before Dsp::run().
+    *
+    * @param settings The settings of the auxiliary stream.
+    * @return The auxiliary stream, e.g. to query its drift or dropouts. Its
+    * stream is started by Dsp::run().
+    */
+   AuxiliaryStream& addAuxiliaryStream(AuxiliaryStreamSettings settings)
+   {
+      _auxiliaryStreams.push_back(std::make_unique<AuxiliaryStream>(settings));
+      return *_auxiliaryStreams.back();
+   }
+
 private:
    /**
     * @brief The audio callback method that is fed with the input and output
@@ -197,8 +797,11 @@ private:
     * To stop the stream and drain the output buffer, return 1.
     * To abort the stream immediately, the client should return 2.
     */
-   int process(Buffer& in, Buffer& out, uint32_t numFrames)
+   int process(
+      SampleBuffer<Sample>& in, SampleBuffer<Sample>& out, uint32_t numFrames
+   )
    {
+      IMRT_TRACE_SCOPE("Dsp::process");
       return static_cast<Derived*>(this)->process(in, out, numFrames);
    }
 
@@ -207,53 +810,331 @@ private:
    /* ----------------------------------------------------------------------- */
 
 private:
-   RtAudio _dac;
-   RtAudio::StreamParameters _paramsIn, _paramsOut;
+   std::unique_ptr<RtAudio> _dac;
+   RtAudio::Api _api = RtAudio::UNSPECIFIED;
    DspSettings _settings;
-   ImRt::Buffer _in, _out;
+   SampleBuffer<Sample> _in, _out;
    DspParameters parameters;
 
+   std::atomic<uint64_t> _streamFrame { 0 };
+   AutomationPlayer _automation;
+   std::vector<AutomationBlockEvent> _automationEvents;
+   uint32_t _numAutomationEvents = 0, _nextAutomationEvent = 0;
+
+   std::unique_ptr<OscServer> _osc;
+   std::unique_ptr<BridgeServer> _bridge;
+   std::vector<std::unique_ptr<AuxiliaryStream>> _auxiliaryStreams;
+
+   double _deviceRate = 0.0;
+   std::atomic<bool> _configureThread { false };
+   std::atomic<bool> _measureLoad { false };
+   std::atomic<uint32_t> _latency { 0 };
+   uint32_t _offlineSampleRate = 0;
+   BufferSizeController _bufferSizeController;
+
+   bool _resampling       = false;
+   uint32_t _deviceFrames = 0; // maximum frames per resampled chunk
+   Resampler _inputResampler, _outputResampler;
+   ImRt::Buffer _deviceIn, _deviceOut, _engineIn, _engineOut;
+   uint32_t _engineInCount = 0;
+   std::vector<float*> _inputPointers, _outputPointers;
+
 private:
    int
    audioCallback(void* outputBuffer, void* inputBuffer, uint32_t nBufferFrames)
    {
+      if (_resampling)
+      {
+         return resampledAudioCallback(
+            outputBuffer, inputBuffer, nBufferFrames
+         );
+      }
+
+      SampleFormat format = _settings.deviceFormat;
+
       uint32_t n = _settings.numChannelsIn;
-      _in.resize({ n, nBufferFrames });
+      _in.resize({ numChannelsIn(), nBufferFrames });
+      deinterleave(inputBuffer, format, n, _in, nBufferFrames);
+
+      uint32_t m = _settings.numChannelsOut;
+      _out.resize({ numChannelsOut(), nBufferFrames });
 
-      for (uint32_t frame = 0; frame < nBufferFrames; ++frame)
+      int r = processBlock(nBufferFrames);
+
+      interleave(outputBuffer, format, m, _out, nBufferFrames);
+      return r;
+   }
+
+   int resampledAudioCallback(
+      void* outputBuffer, void* inputBuffer, uint32_t nBufferFrames
+   )
+   {
+      SampleFormat format = _settings.deviceFormat;
+      size_t inputStride  = sampleSize(format) * _settings.numChannelsIn;
+      size_t outputStride = sampleSize(format) * _settings.numChannelsOut;
+
+      // Backends with variable callback sizes may deliver more frames than
+      // the resamplers were prepared for, so larger device buffers are
+      // processed in chunks of the prepared size.
+      auto input  = static_cast<uint8_t*>(inputBuffer);
+      auto output = static_cast<uint8_t*>(outputBuffer);
+      uint32_t start = 0;
+      int r          = 0;
+      while (start < nBufferFrames && r == 0)
       {
-         for (uint32_t channel = 0; channel < n; ++channel)
-         {
-            _in.getSample(channel, frame)
-               = ((float*)inputBuffer)[n * frame + channel];
-         }
+         uint32_t numFrames = std::min(_deviceFrames, nBufferFrames - start);
+         r                  = resampleChunk(
+            output ? output + start * outputStride : nullptr,
+            input ? input + start * inputStride : nullptr, numFrames
+         );
+         start += numFrames;
       }
 
-      uint32_t m = _settings.numChannelsOut;
-      _out.resize({ m, nBufferFrames });
+      // If the processor stopped the stream, the rest is silent.
+      if (output && start < nBufferFrames)
+      {
+         std::fill(
+            output + start * outputStride,
+            output + nBufferFrames * outputStride, uint8_t(0)
+         );
+      }
+      return r;
+   }
+
+   int
+   resampleChunk(void* outputBuffer, void* inputBuffer, uint32_t nBufferFrames)
+   {
+      SampleFormat format = _settings.deviceFormat;
+      uint32_t n          = _settings.numChannelsIn;
+      uint32_t m          = _settings.numChannelsOut;
+
+      deinterleave(inputBuffer, format, n, _deviceIn, nBufferFrames);
+
+      // The output resampler determines how many engine frames are needed to
+      // fill the device buffer exactly.
+      uint32_t numFrames = std::min(
+         _outputResampler.inputFramesFor(nBufferFrames), _in.getNumFrames()
+      );
 
-      int r = process(_in, _out, nBufferFrames);
+      // Convert the device input to the engine rate and append it to the
+      // engine input FIFO. Missing frames are filled with silence.
+      for (uint32_t channel = 0; channel < n; ++channel)
+      {
+         _inputPointers[channel]  = &_deviceIn.getSample(channel, 0);
+         _outputPointers[channel] = &_engineIn.getSample(channel, 0)
+            + _engineInCount;
+      }
+      _engineInCount += _inputResampler.process(
+         _inputPointers.data(), nBufferFrames, _outputPointers.data(),
+         _engineIn.getNumFrames() - _engineInCount
+      );
 
-      for (uint32_t frame = 0; frame < nBufferFrames; ++frame)
+      uint32_t available = std::min(_engineInCount, numFrames);
+      uint32_t missing   = numFrames - available;
+      for (uint32_t channel = 0; channel < n; ++channel)
       {
-         for (uint32_t channel = 0; channel < m; ++channel)
-         {
-            ((float*)outputBuffer)[m * frame + channel]
-               = _out.getSample(channel, frame);
-         }
+         float* fifo = &_engineIn.getSample(channel, 0);
+         Sample* in  = &_in.getSample(channel, 0);
+
+         std::fill(in, in + missing, Sample(0));
+         std::copy(fifo, fifo + available, in + missing);
+         std::copy(fifo + available, fifo + _engineInCount, fifo);
+      }
+      _engineInCount -= available;
+
+      int r = processBlock(numFrames);
+
+      for (uint32_t channel = 0; channel < m; ++channel)
+      {
+         _inputPointers[channel]  = enginePointer(channel, numFrames);
+         _outputPointers[channel] = &_deviceOut.getSample(channel, 0);
+      }
+      _outputResampler.process(
+         _inputPointers.data(), numFrames, _outputPointers.data(),
+         nBufferFrames
+      );
+
+      interleave(outputBuffer, format, m, _deviceOut, nBufferFrames);
+      return r;
+   }
+
+   int processBlock(uint32_t numFrames, bool streams = true)
+   {
+      parameters.applyPublishedPreset();
+      parameters.updateAll();
+
+      uint64_t blockFrame  = _streamFrame.load();
+      _numAutomationEvents = _automation.advance(
+         blockFrame, numFrames, _automationEvents.data(),
+         _automationEvents.size()
+      );
+      _nextAutomationEvent = 0;
+
+      uint32_t channel = _settings.numChannelsIn;
+      for (size_t i = 0; streams && i < _auxiliaryStreams.size(); ++i)
+      {
+         auto& stream = _auxiliaryStreams[i];
+         stream->readInput(_in, channel, numFrames);
+         channel += std::max(0, stream->settings().numChannelsIn);
+      }
+
+      int r = process(_in, _out, numFrames);
+
+      channel = _settings.numChannelsOut;
+      for (size_t i = 0; streams && i < _auxiliaryStreams.size(); ++i)
+      {
+         auto& stream = _auxiliaryStreams[i];
+         stream->writeOutput(_out, channel, numFrames);
+         channel += std::max(0, stream->settings().numChannelsOut);
       }
 
+      applyAutomation(numFrames);
+      _streamFrame.store(blockFrame + numFrames);
+
       return r;
    }
 
+   // Returns the samples of an output channel as float, converting them if
+   // the processor runs in double precision, for the output resampler.
+   float* enginePointer(uint32_t channel, uint32_t numFrames)
+   {
+      if constexpr (std::is_same_v<Sample, float>)
+      {
+         return &_out.getSample(channel, 0);
+      }
+      else
+      {
+         const Sample* samples = &_out.getSample(channel, 0);
+         float* converted      = &_engineOut.getSample(channel, 0);
+         std::copy(samples, samples + numFrames, converted);
+         return converted;
+      }
+   }
+
+   static RtAudioFormat rtAudioFormat(SampleFormat format)
+   {
+      switch (format)
+      {
+      case SampleFormat::Int16:
+         return RTAUDIO_SINT16;
+      case SampleFormat::Int24:
+         return RTAUDIO_SINT24;
+      case SampleFormat::Int32:
+         return RTAUDIO_SINT32;
+      case SampleFormat::Float64:
+         return RTAUDIO_FLOAT64;
+      default:
+         return RTAUDIO_FLOAT32;
+      }
+   }
+
+   uint32_t numChannelsIn()
+   {
+      uint32_t n = _settings.numChannelsIn;
+      for (auto& stream : _auxiliaryStreams)
+      {
+         n += std::max(0, stream->settings().numChannelsIn);
+      }
+      return n;
+   }
+
+   uint32_t numChannelsOut()
+   {
+      uint32_t m = _settings.numChannelsOut;
+      for (auto& stream : _auxiliaryStreams)
+      {
+         m += std::max(0, stream->settings().numChannelsOut);
+      }
+      return m;
+   }
+
+   void prepareResampling()
+   {
+      double deviceRate = _dac->getStreamSampleRate();
+      double engineRate = _settings.engineSampleRate;
+
+      _resampling = engineRate > 0 && engineRate != deviceRate;
+      if (!_resampling)
+      {
+         return;
+      }
+
+      uint32_t n = _settings.numChannelsIn;
+      uint32_t m = _settings.numChannelsOut;
+
+      // Leave room for the frames the resamplers need in addition to the
+      // scaled buffer size when they start or when the phases line up.
+      uint32_t deviceFrames = _settings.bufferSize;
+      uint32_t engineFrames
+         = uint32_t(std::ceil(deviceFrames * engineRate / deviceRate)) + 128;
+
+      _inputResampler.prepare(
+         n, deviceRate, engineRate, _settings.resamplerQuality, deviceFrames
+      );
+      _outputResampler.prepare(
+         m, engineRate, deviceRate, _settings.resamplerQuality, engineFrames
+      );
+
+      _deviceFrames = deviceFrames;
+      _deviceIn.resize({ n, deviceFrames });
+      _deviceOut.resize({ m, deviceFrames });
+      _in.resize({ numChannelsIn(), engineFrames });
+      _out.resize({ numChannelsOut(), engineFrames });
+      _engineIn.resize({ n, 2 * engineFrames });
+      if constexpr (!std::is_same_v<Sample, float>)
+      {
+         _engineOut.resize({ m, engineFrames });
+      }
+      _engineIn.clear();
+      _engineInCount = 0;
+
+      _inputPointers.resize(std::max(n, m));
+      _outputPointers.resize(std::max(n, m));
+   }
+
+   void closeStream()
+   {
+      if (_dac && _dac->isStreamRunning())
+      {
+         _dac->stopStream();
+      }
+      if (_dac && _dac->isStreamOpen())
+      {
+         _dac->closeStream();
+      }
+   }
+
    static int AudioCallback(
       void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames,
       double streamTime, unsigned int status, void* userData
    )
    {
-      return static_cast<Dsp*>(userData)->audioCallback(
-         outputBuffer, inputBuffer, nBufferFrames
+      auto dsp = static_cast<Dsp*>(userData);
+      ScopedDenormals denormals(dsp->_settings.realtime.flushDenormals);
+
+      if (dsp->_configureThread.load(std::memory_order_relaxed))
+      {
+         dsp->_configureThread.store(false, std::memory_order_relaxed);
+         configureAudioThread(dsp->_settings.realtime);
+         IMRT_TRACE_THREAD("audio");
+      }
+
+      IMRT_TRACE_SCOPE("Dsp::audioCallback");
+
+      if (!dsp->_measureLoad.load(std::memory_order_relaxed))
+      {
+         return dsp->audioCallback(outputBuffer, inputBuffer, nBufferFrames);
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      int r = dsp->audioCallback(outputBuffer, inputBuffer, nBufferFrames);
+      std::chrono::duration<double> duration
+         = std::chrono::steady_clock::now() - start;
+
+      dsp->_bufferSizeController.measure(
+         duration.count(), nBufferFrames, dsp->_deviceRate, status != 0
       );
+      return r;
    }
 };
 
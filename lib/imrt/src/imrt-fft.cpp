@@ -0,0 +1,148 @@
+#include "imrt-fft.h"
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                          fft                           */
+/* ------------------------------------------------------ */
+
+void Fft::prepare(uint32_t size)
+{
+   assert(size >= 4 && (size & (size - 1)) == 0);
+
+   _size = size;
+   _half = size / 2;
+
+   uint32_t bits = 0;
+   while ((1u << bits) < _half)
+   {
+      ++bits;
+   }
+   _reversed.resize(_half);
+   for (uint32_t i = 0; i < _half; ++i)
+   {
+      uint32_t r = 0;
+      for (uint32_t b = 0; b < bits; ++b)
+      {
+         r |= ((i >> b) & 1) << (bits - 1 - b);
+      }
+      _reversed[i] = r;
+   }
+
+   const double pi = 3.14159265358979323846;
+   _cos.resize(_half / 2);
+   _sin.resize(_half / 2);
+   for (uint32_t k = 0; k < _half / 2; ++k)
+   {
+      _cos[k] = float(std::cos(2.0 * pi * k / _half));
+      _sin[k] = float(std::sin(2.0 * pi * k / _half));
+   }
+   _realCos.resize(_half + 1);
+   _realSin.resize(_half + 1);
+   for (uint32_t k = 0; k <= _half; ++k)
+   {
+      _realCos[k] = float(std::cos(2.0 * pi * k / _size));
+      _realSin[k] = float(std::sin(2.0 * pi * k / _size));
+   }
+
+   _re.assign(_half, 0.0f);
+   _im.assign(_half, 0.0f);
+}
+
+uint32_t Fft::size() const
+{
+   return _size;
+}
+
+uint32_t Fft::numBins() const
+{
+   return _half + 1;
+}
+
+void Fft::forward(const float* in, float* re, float* im)
+{
+   // Pack the even samples into the real and the odd samples into the
+   // imaginary parts of a half size signal.
+   for (uint32_t i = 0; i < _half; ++i)
+   {
+      _re[_reversed[i]] = in[2 * i];
+      _im[_reversed[i]] = in[2 * i + 1];
+   }
+   transform(false);
+
+   // Separate the spectra of the even and odd samples and combine them.
+   for (uint32_t k = 0; k <= _half; ++k)
+   {
+      uint32_t a = k == _half ? 0 : k;
+      uint32_t b = k == 0 ? 0 : _half - k;
+
+      float evenRe = 0.5f * (_re[a] + _re[b]);
+      float evenIm = 0.5f * (_im[a] - _im[b]);
+      float oddRe  = 0.5f * (_im[a] + _im[b]);
+      float oddIm  = -0.5f * (_re[a] - _re[b]);
+
+      float c = _realCos[k], s = -_realSin[k];
+      re[k]   = evenRe + oddRe * c - oddIm * s;
+      im[k]   = evenIm + oddRe * s + oddIm * c;
+   }
+}
+
+void Fft::inverse(const float* re, const float* im, float* out)
+{
+   for (uint32_t k = 0; k < _half; ++k)
+   {
+      uint32_t b = _half - k;
+
+      float evenRe = 0.5f * (re[k] + re[b]);
+      float evenIm = 0.5f * (im[k] - im[b]);
+      float diffRe = 0.5f * (re[k] - re[b]);
+      float diffIm = 0.5f * (im[k] + im[b]);
+
+      float c = _realCos[k], s = _realSin[k];
+      float oddRe = diffRe * c - diffIm * s;
+      float oddIm = diffRe * s + diffIm * c;
+
+      _re[_reversed[k]] = evenRe - oddIm;
+      _im[_reversed[k]] = evenIm + oddRe;
+   }
+   transform(true);
+
+   float scale = 1.0f / _half;
+   for (uint32_t i = 0; i < _half; ++i)
+   {
+      out[2 * i]     = _re[i] * scale;
+      out[2 * i + 1] = _im[i] * scale;
+   }
+}
+
+void Fft::transform(bool inverse)
+{
+   float sign = inverse ? 1.0f : -1.0f;
+
+   for (uint32_t length = 2; length <= _half; length *= 2)
+   {
+      uint32_t half = length / 2;
+      uint32_t step = _half / length;
+      for (uint32_t i = 0; i < _half; i += length)
+      {
+         for (uint32_t j = 0; j < half; ++j)
+         {
+            float c = _cos[j * step], s = sign * _sin[j * step];
+
+            uint32_t a = i + j, b = i + j + half;
+            float re   = _re[b] * c - _im[b] * s;
+            float im   = _re[b] * s + _im[b] * c;
+
+            _re[b] = _re[a] - re;
+            _im[b] = _im[a] - im;
+            _re[a] += re;
+            _im[a] += im;
+         }
+      }
+   }
+}
+
+} // namespace ImRt
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                              FFT                                           */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A fast Fourier transform of real signals whose size is a power of
+ * two. A real signal of size N is transformed as a complex signal of size N/2
+ * by an iterative radix-2 transform. The spectra consist of the N/2+1 bins
+ * from DC to Nyquist, stored as separate arrays of real and imaginary parts,
+ * so products of spectra can be computed with plain loops that the compiler
+ * vectorizes. All memory is allocated in Fft::prepare().
+ */
+class Fft
+{
+public:
+   /**
+    * @brief Prepares the transform.
+    *
+    * @param size The size of the signals, a power of two of at least 4.
+    */
+   void prepare(uint32_t size);
+
+   /**
+    * @brief Returns the size of the signals.
+    */
+   uint32_t size() const;
+
+   /**
+    * @brief Returns the number of bins of the spectra, i.e. size / 2 + 1.
+    */
+   uint32_t numBins() const;
+
+   /**
+    * @brief Computes the spectrum of a signal. The spectrum is not scaled.
+    *
+    * @param in The signal of Fft::size() samples.
+    * @param re The real parts of the Fft::numBins() bins.
+    * @param im The imaginary parts of the Fft::numBins() bins.
+    */
+   void forward(const float* in, float* re, float* im);
+
+   /**
+    * @brief Computes the signal of a spectrum, so that inverse(forward(x))
+    * equals x.
+    *
+    * @param re The real parts of the Fft::numBins() bins.
+    * @param im The imaginary parts of the Fft::numBins() bins.
+    * @param out The signal of Fft::size() samples.
+    */
+   void inverse(const float* re, const float* im, float* out);
+
+private:
+   uint32_t _size = 0, _half = 0;
+   std::vector<uint32_t> _reversed;
+   std::vector<float> _cos, _sin;         // twiddles of the half transform
+   std::vector<float> _realCos, _realSin; // twiddles of the real transform
+   std::vector<float> _re, _im;
+
+   void transform(bool inverse);
+};
+
+} // namespace ImRt
@@ -0,0 +1,348 @@
+#include "imrt-fontcache.h"
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                     cache helpers                      */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const char cacheMagic[8]    = { 'I', 'M', 'R', 'T', 'F', 'O', 'N', 'T' };
+   const uint32_t cacheVersion = 1;
+
+   /**
+    * The header of a cached atlas. It is followed by the texture coordinates
+    * of the baked lines, the glyphs, the custom rectangles and the alpha
+    * texture, all stored in the native layout, which is fine for a cache that
+    * never leaves the machine. The fields up to the pixel size identify the
+    * atlas, the others describe it.
+    */
+   struct CacheHeader
+   {
+      char magic[8];
+      uint32_t version;
+      uint32_t imguiVersion;
+      uint32_t glyphSize, rectSize, linesSize;
+      uint32_t ttfSize;
+      uint64_t ttfHash;
+      float pixelSize;
+
+      float ascent, descent;
+      int32_t texWidth, texHeight;
+      float texUvScale[2], texUvWhitePixel[2];
+      int32_t packIdMouseCursors, packIdLines;
+      uint32_t numGlyphs, numRects;
+   };
+
+   uint64_t hashBytes(const uint8_t* data, size_t size)
+   {
+      uint64_t hash = 14695981039346656037ull; // FNV-1a
+      for (size_t i = 0; i < size; ++i)
+      {
+         hash = (hash ^ data[i]) * 1099511628211ull;
+      }
+      return hash;
+   }
+
+   bool identifiesSameAtlas(const CacheHeader& a, const CacheHeader& b)
+   {
+      return std::memcmp(a.magic, b.magic, sizeof(a.magic)) == 0
+          && a.version == b.version && a.imguiVersion == b.imguiVersion
+          && a.glyphSize == b.glyphSize && a.rectSize == b.rectSize
+          && a.linesSize == b.linesSize && a.ttfSize == b.ttfSize
+          && a.ttfHash == b.ttfHash && a.pixelSize == b.pixelSize;
+   }
+
+   // Bounds of a plausible atlas of one font: the texture is far smaller than
+   // the largest texture of common GPUs, there is at most one glyph per code
+   // point, and the custom rectangles are the few that ImGui adds itself.
+   const int32_t maxTextureSize = 16384;
+   const uint32_t maxGlyphs     = IM_UNICODE_CODEPOINT_MAX + 1;
+   const uint32_t maxRects      = 1024;
+
+   /**
+    * Checks the fields that describe a cached atlas, which was read from a
+    * file that may have been truncated or corrupted, against sane bounds and
+    * the size of the file, before anything is allocated for it.
+    */
+   bool describesPlausibleAtlas(const CacheHeader& header, uint64_t fileSize)
+   {
+      if (header.texWidth <= 0 || header.texWidth > maxTextureSize
+          || header.texHeight <= 0 || header.texHeight > maxTextureSize
+          || header.numGlyphs == 0 || header.numGlyphs > maxGlyphs
+          || header.numRects > maxRects)
+      {
+         return false;
+      }
+
+      // The pack ids index the custom rectangles or are -1.
+      int32_t numRects = int32_t(header.numRects);
+      if (header.packIdMouseCursors < -1
+          || header.packIdMouseCursors >= numRects
+          || header.packIdLines < -1 || header.packIdLines >= numRects)
+      {
+         return false;
+      }
+
+      if (!(header.texUvScale[0] == 1.0f / header.texWidth)
+          || !(header.texUvScale[1] == 1.0f / header.texHeight))
+      {
+         return false;
+      }
+
+      uint64_t expectedSize = sizeof(CacheHeader) + uint64_t(header.linesSize)
+         + uint64_t(header.numGlyphs) * header.glyphSize
+         + uint64_t(header.numRects) * header.rectSize
+         + uint64_t(header.texWidth) * uint64_t(header.texHeight);
+      return expectedSize == fileSize;
+   }
+
+   template <typename T>
+   bool read(std::ifstream& file, T* data, size_t count)
+   {
+      return static_cast<bool>(
+         file.read(reinterpret_cast<char*>(data), sizeof(T) * count)
+      );
+   }
+
+   template <typename T>
+   void write(std::ofstream& file, const T* data, size_t count)
+   {
+      file.write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+   }
+
+   bool loadAtlas(
+      ImFontAtlas& atlas, const ImFontConfig& config,
+      const CacheHeader& expected, const std::string& path
+   )
+   {
+      std::error_code error;
+      uint64_t fileSize = std::filesystem::file_size(path, error);
+      if (error)
+      {
+         return false;
+      }
+
+      std::ifstream file(path, std::ios::binary);
+      CacheHeader header;
+      if (!file || !read(file, &header, 1)
+          || !identifiesSameAtlas(header, expected)
+          || !describesPlausibleAtlas(header, fileSize))
+      {
+         return false;
+      }
+      size_t numPixels = size_t(header.texWidth) * size_t(header.texHeight);
+
+      std::vector<char> lines(header.linesSize);
+      std::vector<ImFontGlyph> glyphs(header.numGlyphs);
+      std::vector<ImFontAtlasCustomRect> rects(header.numRects);
+      std::vector<unsigned char> pixels(numPixels);
+      if (!read(file, lines.data(), lines.size())
+          || !read(file, glyphs.data(), glyphs.size())
+          || !read(file, rects.data(), rects.size())
+          || !read(file, pixels.data(), pixels.size()))
+      {
+         return false;
+      }
+
+      // The lookup table of the font is indexed by the code points.
+      for (const ImFontGlyph& glyph : glyphs)
+      {
+         if (glyph.Codepoint > IM_UNICODE_CODEPOINT_MAX)
+         {
+            return false;
+         }
+      }
+
+      // This restores what ImFontAtlas::Build() leaves behind.
+      ImFont* font          = atlas.AddFont(&config);
+      font->FontSize        = header.pixelSize;
+      font->ConfigData      = &atlas.ConfigData.back();
+      font->ConfigDataCount = 1;
+      font->ContainerAtlas  = &atlas;
+      font->Ascent          = header.ascent;
+      font->Descent         = header.descent;
+      font->Glyphs.resize(int(glyphs.size()));
+      std::memcpy(
+         font->Glyphs.Data, glyphs.data(), sizeof(ImFontGlyph) * glyphs.size()
+      );
+
+      atlas.TexWidth   = header.texWidth;
+      atlas.TexHeight  = header.texHeight;
+      atlas.TexUvScale = ImVec2(header.texUvScale[0], header.texUvScale[1]);
+      atlas.TexUvWhitePixel
+         = ImVec2(header.texUvWhitePixel[0], header.texUvWhitePixel[1]);
+      std::memcpy(atlas.TexUvLines, lines.data(), lines.size());
+
+      atlas.PackIdMouseCursors = header.packIdMouseCursors;
+      atlas.PackIdLines        = header.packIdLines;
+      atlas.CustomRects.resize(int(rects.size()));
+      std::memcpy(
+         atlas.CustomRects.Data, rects.data(),
+         sizeof(ImFontAtlasCustomRect) * rects.size()
+      );
+
+      atlas.TexPixelsAlpha8 = static_cast<unsigned char*>(IM_ALLOC(numPixels));
+      std::memcpy(atlas.TexPixelsAlpha8, pixels.data(), numPixels);
+
+      font->BuildLookupTable();
+      atlas.TexReady = true;
+      return true;
+   }
+
+   bool saveAtlas(
+      const ImFontAtlas& atlas, CacheHeader header,
+      const std::string& directory, const std::string& path
+   )
+   {
+      if (atlas.Fonts.Size != 1 || atlas.TexPixelsAlpha8 == nullptr)
+      {
+         return false;
+      }
+
+      // Rectangles that hold custom glyphs point to their font.
+      for (const ImFontAtlasCustomRect& rect : atlas.CustomRects)
+      {
+         if (rect.Font != nullptr)
+         {
+            return false;
+         }
+      }
+
+      const ImFont* font        = atlas.Fonts[0];
+      header.ascent             = font->Ascent;
+      header.descent            = font->Descent;
+      header.texWidth           = atlas.TexWidth;
+      header.texHeight          = atlas.TexHeight;
+      header.texUvScale[0]      = atlas.TexUvScale.x;
+      header.texUvScale[1]      = atlas.TexUvScale.y;
+      header.texUvWhitePixel[0] = atlas.TexUvWhitePixel.x;
+      header.texUvWhitePixel[1] = atlas.TexUvWhitePixel.y;
+      header.packIdMouseCursors = atlas.PackIdMouseCursors;
+      header.packIdLines        = atlas.PackIdLines;
+      header.numGlyphs          = uint32_t(font->Glyphs.Size);
+      header.numRects           = uint32_t(atlas.CustomRects.Size);
+
+      std::error_code error;
+      std::filesystem::create_directories(directory, error);
+
+      // Other instances must never see a partially written atlas.
+      std::string temporaryPath = path + ".tmp";
+      {
+         std::ofstream file(temporaryPath, std::ios::binary);
+         write(file, &header, 1);
+         write(file, &atlas.TexUvLines, 1);
+         write(file, font->Glyphs.Data, font->Glyphs.Size);
+         write(file, atlas.CustomRects.Data, atlas.CustomRects.Size);
+         write(
+            file, atlas.TexPixelsAlpha8,
+            size_t(atlas.TexWidth) * size_t(atlas.TexHeight)
+         );
+         if (!file)
+         {
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+         }
+      }
+
+      std::filesystem::rename(temporaryPath, path, error);
+      return !error;
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                    font atlas cache                    */
+/* ------------------------------------------------------ */
+
+std::string defaultFontCacheDirectory()
+{
+#if defined(_WIN32)
+   const char* base = std::getenv("LOCALAPPDATA");
+   if (base == nullptr || *base == '\0')
+   {
+      return "";
+   }
+   return (std::filesystem::path(base) / "imrt").string();
+#else
+   const char* xdg = std::getenv("XDG_CACHE_HOME");
+   if (xdg != nullptr && *xdg != '\0')
+   {
+      return (std::filesystem::path(xdg) / "imrt").string();
+   }
+
+   const char* home = std::getenv("HOME");
+   if (home == nullptr || *home == '\0')
+   {
+      return "";
+   }
+#if defined(__APPLE__)
+   return (std::filesystem::path(home) / "Library/Caches/imrt").string();
+#else
+   return (std::filesystem::path(home) / ".cache/imrt").string();
+#endif
+#endif
+}
+
+bool buildCachedFontAtlas(
+   ImFontAtlas& atlas, const uint8_t* ttf, size_t ttfSize, float pixelSize,
+   const std::string& cacheDirectory
+)
+{
+   assert(atlas.Fonts.Size == 0);
+
+   ImFontConfig config;
+   config.FontData             = const_cast<uint8_t*>(ttf);
+   config.FontDataSize         = int(ttfSize);
+   config.FontDataOwnedByAtlas = false;
+   config.SizePixels           = pixelSize;
+
+   if (cacheDirectory.empty())
+   {
+      atlas.AddFont(&config);
+      atlas.Build();
+      return false;
+   }
+
+   CacheHeader header = {};
+   std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+   header.version      = cacheVersion;
+   header.imguiVersion = IMGUI_VERSION_NUM;
+   header.glyphSize    = sizeof(ImFontGlyph);
+   header.rectSize     = sizeof(ImFontAtlasCustomRect);
+   header.linesSize    = sizeof(ImFontAtlas::TexUvLines);
+   header.ttfSize      = uint32_t(ttfSize);
+   header.ttfHash      = hashBytes(ttf, ttfSize);
+   header.pixelSize    = pixelSize;
+
+   char name[64];
+   std::snprintf(
+      name, sizeof(name), "imrt-font-%016llx-%ld.atlas",
+      static_cast<unsigned long long>(header.ttfHash),
+      std::lround(pixelSize * 100.0f)
+   );
+   std::string path = (std::filesystem::path(cacheDirectory) / name).string();
+
+   if (loadAtlas(atlas, config, header, path))
+   {
+      return true;
+   }
+
+   atlas.AddFont(&config);
+   if (atlas.Build())
+   {
+      saveAtlas(atlas, header, cacheDirectory, path);
+   }
+   return false;
+}
+
+} // namespace ImRt
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <imgui.h>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                        FONT ATLAS CACHE                                    */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Returns the directory in which the Gui caches its font atlases by
+ * default, i.e. the subdirectory "imrt" of the cache directory of the user
+ * ($XDG_CACHE_HOME or ~/.cache on Linux, ~/Library/Caches on macOS,
+ * %LOCALAPPDATA% on Windows), or an empty string if there is none.
+ */
+std::string defaultFontCacheDirectory();
+
+/**
+ * @brief Adds a TrueType font to an empty font atlas and builds the atlas.
+ *
+ * Rasterizing the glyphs is the slowest part of the startup of a Gui, so the
+ * built atlas, i.e. the texture, the glyphs and the font metrics, is stored in
+ * the cache directory, one file per font and pixel size. Later calls load the
+ * atlas from there, which leaves only the upload of the texture to the
+ * OpenGL backend. A cached atlas is ignored if it was built by a different
+ * version of ImGui.
+ *
+ * @param atlas The empty font atlas, e.g. ImGui::GetIO().Fonts.
+ * @param ttf The TrueType data of the font.
+ * @param ttfSize The size of the TrueType data in bytes.
+ * @param pixelSize The size of the font in pixels.
+ * @param cacheDirectory The directory of the cache, which is created if
+ * necessary. An empty string disables the cache.
+ * @return true if the atlas was loaded from the cache.
+ */
+bool buildCachedFontAtlas(
+   ImFontAtlas& atlas, const uint8_t* ttf, size_t ttfSize, float pixelSize,
+   const std::string& cacheDirectory
+);
+
+} // namespace ImRt
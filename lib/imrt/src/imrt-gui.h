@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -8,11 +9,16 @@
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
+#include <imgui_internal.h>
 #include <imgui_impl_opengl3.h>
 #include <implot.h>
 
 #include "../assets/imrt-font.embed"
+#include "imrt-automation.h"
+#include "imrt-fontcache.h"
 #include "imrt-params.h"
+#include "imrt-registry.h"
+#include "imrt-trace.h"
 
 namespace ImRt {
 
@@ -37,17 +43,52 @@ struct Style
  * window ...
  * - has a native window decoration,
  * - always stays on top.
+ *
+ * The font atlas is cached in fontCacheDirectory (cf. buildCachedFontAtlas()),
+ * an empty string disables the cache. If printStartupTimes is set, the
+ * durations of the startup phases are printed after the first frame (cf.
+ * Gui::startupTimes()).
+ *
+ * In retained mode the Gui renders frames only when its WidgetRegistry
+ * reports changes and otherwise sleeps until the next event, waking up every
+ * idleTimeout seconds to poll the DSP.
  */
 struct GuiSettings
 {
-   std::string title = "Default title";
-   ImVec2 size       = { 1024, 768 };
-   bool decorated    = true;
-   bool alwaysOnTop  = false;
-   ImVec4 clearColor = ImColor(22, 29, 38).Value;
+   std::string title              = "Default title";
+   ImVec2 size                    = { 1024, 768 };
+   bool decorated                 = true;
+   bool alwaysOnTop               = false;
+   ImVec4 clearColor              = ImColor(22, 29, 38).Value;
+   std::string fontCacheDirectory = defaultFontCacheDirectory();
+   bool printStartupTimes         = false;
+   bool retained                  = false;
+   double idleTimeout             = 1.0 / 60.0;
    Style style;
 };
 
+/**
+ * @brief The durations of the startup phases of a Gui in seconds.
+ */
+struct StartupTimes
+{
+   double glfwInit      = 0.0; // initializing GLFW
+   double context       = 0.0; // the window, OpenGL, ImGui and ImPlot
+   double fontAtlas     = 0.0; // building or loading the font atlas
+   double firstFrame    = 0.0; // the first frame incl. the texture upload
+   bool fontAtlasCached = false;
+
+   /**
+    * @brief Returns the time from the construction of the Gui until the
+    * first frame was presented, apart from the time between the end of the
+    * constructor and the call of Gui::run().
+    */
+   double timeToFirstFrame() const
+   {
+      return glfwInit + context + fontAtlas + firstFrame;
+   }
+};
+
 /* -------------------------------------------------------------------------- */
 /*                           GUI                                              */
 /* -------------------------------------------------------------------------- */
@@ -72,6 +113,8 @@ public:
       , dsp(dsp)
       , parameters(dsp.parameters)
    {
+      startPhase();
+
       glfwSetErrorCallback(ErrorCallback);
 
       if (!glfwInit())
@@ -79,6 +122,8 @@ public:
          std::exit(1);
       }
 
+      _startupTimes.glfwInit = endPhase();
+
       const char* glsl_version = "#version 130";
       glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
       glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
@@ -102,6 +147,8 @@ public:
          glfwSetWindowAttrib(_window, GLFW_FLOATING, GLFW_TRUE);
       }
 
+      glfwSetWindowRefreshCallback(_window, RefreshCallback);
+
       glfwMakeContextCurrent(_window);
       glfwSwapInterval(1);
 
@@ -118,15 +165,17 @@ public:
       ImGui_ImplGlfw_InitForOpenGL(_window, true);
       ImGui_ImplOpenGL3_Init(glsl_version);
 
+      _startupTimes.context = endPhase();
+
       ImGuiIO& io = ImGui::GetIO();
       io.Fonts->Clear();
-      ImFontConfig fontConfig;
-      fontConfig.FontDataOwnedByAtlas = false;
-      ImFont* notoMonoFont            = io.Fonts->AddFontFromMemoryTTF(
-         (void*)notoMonoRegularTtf, sizeof(notoMonoRegularTtf),
-         _settings.style.fontSize * _scale.x, &fontConfig
+      _startupTimes.fontAtlasCached = buildCachedFontAtlas(
+         *io.Fonts, notoMonoRegularTtf, sizeof(notoMonoRegularTtf),
+         _settings.style.fontSize * _scale.x, _settings.fontCacheDirectory
       );
-      io.FontDefault = notoMonoFont;
+      io.FontDefault = io.Fonts->Fonts[0];
+
+      _startupTimes.fontAtlas = endPhase();
    }
 
    virtual ~Gui()
@@ -144,47 +193,100 @@ public:
    {
       onStart();
 
+      bool firstFrame = true;
+      startPhase();
+      IMRT_TRACE_THREAD("gui");
+
       while (!glfwWindowShouldClose(_window))
       {
-         glfwPollEvents();
+         {
+            IMRT_TRACE_SCOPE("Gui::pollEvents");
+            glfwPollEvents();
+
+            if (parameters.update())
+            {
+               _registry.markDirty();
+            }
+
+            dsp.receiveParameterChanges(
+               [this](uint32_t paramId, float value)
+               {
+                  GuiParameter* param = parameters.find(paramId);
+                  if (param != nullptr)
+                  {
+                     param->value = value;
+                     _registry.parameterChanged(paramId);
+                  }
+               }
+            );
+
+            dsp.pollBufferSizeController();
+         }
 
-         ImGui_ImplOpenGL3_NewFrame();
-         ImGui_ImplGlfw_NewFrame();
-         ImGui::NewFrame();
+         if (_settings.retained && !_registry.needsFrame(inputPending()))
+         {
+            IMRT_TRACE_SCOPE("Gui::idle");
+            glfwWaitEventsTimeout(_settings.idleTimeout);
+            continue;
+         }
 
          ImGuiIO& io = ImGui::GetIO();
-         ImGui::SetNextWindowSize(io.DisplaySize);
-         ImGui::SetNextWindowPos({ 0, 0 });
-         if (ImGui::Begin(
-                "Main", nullptr,
-                ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize
-                   | ImGuiWindowFlags_NoScrollbar
-                   | ImGuiWindowFlags_NoScrollWithMouse
-                   | ImGuiWindowFlags_NoSavedSettings
-             ))
          {
-            onUpdate();
+            IMRT_TRACE_SCOPE("Gui::update");
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+
+            ImGui::SetNextWindowSize(io.DisplaySize);
+            ImGui::SetNextWindowPos({ 0, 0 });
+            if (ImGui::Begin(
+                   "Main", nullptr,
+                   ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize
+                      | ImGuiWindowFlags_NoScrollbar
+                      | ImGuiWindowFlags_NoScrollWithMouse
+                      | ImGuiWindowFlags_NoSavedSettings
+                ))
+            {
+               onUpdate();
+            }
+            ImGui::End();
          }
-         ImGui::End();
-
-         ImGui::Render();
-         int displayWidth, displayHeight;
-         glfwGetFramebufferSize(_window, &displayWidth, &displayHeight);
-         glViewport(0, 0, displayWidth, displayHeight);
-         glClearColor(
-            _settings.clearColor.x, _settings.clearColor.y,
-            _settings.clearColor.z, _settings.clearColor.w
-         );
-         glClear(GL_COLOR_BUFFER_BIT);
-         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-         if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+
          {
-            GLFWwindow* backupCurrentContext = glfwGetCurrentContext();
-            ImGui::UpdatePlatformWindows();
-            ImGui::RenderPlatformWindowsDefault();
-            glfwMakeContextCurrent(backupCurrentContext);
+            IMRT_TRACE_SCOPE("Gui::render");
+            ImGui::Render();
+            int displayWidth, displayHeight;
+            glfwGetFramebufferSize(_window, &displayWidth, &displayHeight);
+            glViewport(0, 0, displayWidth, displayHeight);
+            glClearColor(
+               _settings.clearColor.x, _settings.clearColor.y,
+               _settings.clearColor.z, _settings.clearColor.w
+            );
+            glClear(GL_COLOR_BUFFER_BIT);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+            {
+               GLFWwindow* backupCurrentContext = glfwGetCurrentContext();
+               ImGui::UpdatePlatformWindows();
+               ImGui::RenderPlatformWindowsDefault();
+               glfwMakeContextCurrent(backupCurrentContext);
+            }
+         }
+
+         {
+            IMRT_TRACE_SCOPE("Gui::swapBuffers");
+            glfwSwapBuffers(_window);
+         }
+
+         if (firstFrame)
+         {
+            firstFrame               = false;
+            _startupTimes.firstFrame = endPhase();
+            if (_settings.printStartupTimes)
+            {
+               printStartupTimes();
+            }
          }
-         glfwSwapBuffers(_window);
       }
    }
 
@@ -198,6 +300,89 @@ public:
       return dsp.sampleRate();
    }
 
+   /**
+    * @brief Returns the registry that tracks whether the content of the Gui
+    * changed. Widgets register their parameters, and meters and scopes can be
+    * covered by sources (cf. WidgetRegistry::watchSource()).
+    */
+   WidgetRegistry& registry()
+   {
+      return _registry;
+   }
+
+   /**
+    * @brief Returns the durations of the startup phases. The duration of the
+    * first frame is known once Gui::run() has presented it.
+    */
+   const StartupTimes& startupTimes()
+   {
+      return _startupTimes;
+   }
+
+   /**
+    * @brief Captures the current values of the GUI parameters in a preset.
+    *
+    * @param name The name of the new preset.
+    */
+   Preset preset(std::string name = "")
+   {
+      return parameters.preset(name);
+   }
+
+   /**
+    * @brief Applies a preset to the GUI parameters and hands its values over
+    * to the DSP as one batch (cf. Dsp::applyPreset()).
+    *
+    * @param preset The preset whose values should be applied.
+    */
+   void applyPreset(const Preset& preset)
+   {
+      parameters.applyPreset(preset);
+      dsp.applyPreset(preset);
+      _registry.markDirty();
+   }
+
+   /**
+    * @brief Announces a change of a parameter value to the DSP (cf.
+    * Dsp::announceParameterChange()) and records it if an automation
+    * recording is running. The widgets announce their changes through this
+    * method.
+    *
+    * @param paramId The ID of the parameter whose value should change.
+    * @param newValue The value to which the parameter value should change.
+    */
+   void announceParameterChange(uint32_t paramId, float& newValue)
+   {
+      dsp.announceParameterChange(paramId, newValue);
+      _recorder.record(paramId, newValue, dsp.streamFrame());
+   }
+
+   /**
+    * @brief Starts recording the parameter changes announced by the widgets
+    * against the stream clock of the DSP.
+    */
+   void startRecording()
+   {
+      _recorder.start(dsp.streamFrame());
+   }
+
+   /**
+    * @brief Stops the automation recording and returns the recorded clip,
+    * which can be played back with Dsp::playAutomation().
+    */
+   std::unique_ptr<AutomationClip> stopRecording()
+   {
+      return _recorder.stop();
+   }
+
+   /**
+    * @brief Returns whether an automation recording is running.
+    */
+   bool isRecording()
+   {
+      return _recorder.isRecording();
+   }
+
 private:
    void onStart()
    {
@@ -221,12 +406,68 @@ private:
    GLFWwindow* _window = nullptr;
    GuiSettings _settings;
    ImVec2 _scale;
+   AutomationRecorder _recorder;
+   StartupTimes _startupTimes;
+   std::chrono::steady_clock::time_point _phaseStart;
+   WidgetRegistry _registry;
+
+   static inline bool _refreshRequested = false;
 
 private:
+   /**
+    * @brief Returns whether input, a resize or a refresh of the window is
+    * waiting to be processed by the next frame.
+    */
+   bool inputPending()
+   {
+      int width, height;
+      glfwGetWindowSize(_window, &width, &height);
+
+      ImGuiIO& io  = ImGui::GetIO();
+      bool resized = width != int(io.DisplaySize.x)
+                  || height != int(io.DisplaySize.y);
+      bool refresh = _refreshRequested;
+
+      _refreshRequested = false;
+      return resized || refresh || io.WantTextInput
+          || ImGui::GetCurrentContext()->InputEventsQueue.Size > 0;
+   }
+
+   void startPhase()
+   {
+      _phaseStart = std::chrono::steady_clock::now();
+   }
+
+   double endPhase()
+   {
+      auto now = std::chrono::steady_clock::now();
+
+      std::chrono::duration<double> duration = now - _phaseStart;
+      _phaseStart                            = now;
+      return duration.count();
+   }
+
+   void printStartupTimes()
+   {
+      const StartupTimes& t = _startupTimes;
+      std::printf(
+         "Startup: GLFW %.1f ms, context %.1f ms, font atlas %.1f ms (%s), "
+         "first frame %.1f ms, total %.1f ms\n",
+         1000.0 * t.glfwInit, 1000.0 * t.context, 1000.0 * t.fontAtlas,
+         t.fontAtlasCached ? "cached" : "built", 1000.0 * t.firstFrame,
+         1000.0 * t.timeToFirstFrame()
+      );
+   }
+
    static void ErrorCallback(int error, const char* description)
    {
       std::cerr << "Glfw Error" << error << ": " << description << std::endl;
    }
+
+   static void RefreshCallback(GLFWwindow*)
+   {
+      _refreshRequested = true;
+   }
 };
 
 } // namespace ImRt
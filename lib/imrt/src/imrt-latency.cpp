@@ -0,0 +1,101 @@
+#include "imrt-latency.h"
+#include <algorithm>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                       delay line                       */
+/* ------------------------------------------------------ */
+
+void DelayLine::prepare(uint32_t numChannels, uint32_t maxDelay)
+{
+   _size = maxDelay + 1;
+   _lines.assign(numChannels, std::vector<float>(_size, 0.0f));
+   _delay    = std::min(_delay, maxDelay);
+   _position = 0;
+}
+
+void DelayLine::setDelay(uint32_t delay)
+{
+   _delay = std::min(delay, _size - 1);
+}
+
+uint32_t DelayLine::delay() const
+{
+   return _delay;
+}
+
+void DelayLine::process(Buffer& buffer, uint32_t numFrames)
+{
+   // The line is written even without a delay, so a later delay change reads
+   // recent samples instead of silence.
+   uint32_t position = _position;
+   for (size_t channel = 0; channel < _lines.size(); ++channel)
+   {
+      float* line   = _lines[channel].data();
+      float* signal = &buffer.getSample(channel, 0);
+
+      position      = _position;
+      uint32_t read = position >= _delay ? position - _delay
+                                         : position + _size - _delay;
+      for (uint32_t frame = 0; frame < numFrames; ++frame)
+      {
+         line[position] = signal[frame];
+         signal[frame]  = line[read];
+         position       = position + 1 == _size ? 0 : position + 1;
+         read           = read + 1 == _size ? 0 : read + 1;
+      }
+   }
+   _position = position;
+}
+
+void DelayLine::clear()
+{
+   for (auto& line : _lines)
+   {
+      std::fill(line.begin(), line.end(), 0.0f);
+   }
+}
+
+/* ------------------------------------------------------ */
+/*                  latency compensator                   */
+/* ------------------------------------------------------ */
+
+void LatencyCompensator::prepare(
+   uint32_t numPaths, uint32_t numChannels, uint32_t maxLatency
+)
+{
+   _latencies.assign(numPaths, 0);
+   _delays.resize(numPaths);
+   for (auto& delay : _delays)
+   {
+      delay.setDelay(0);
+      delay.prepare(numChannels, maxLatency);
+   }
+   _latency = 0;
+}
+
+void LatencyCompensator::setLatency(uint32_t path, uint32_t latency)
+{
+   _latencies[path] = latency;
+   _latency = *std::max_element(_latencies.begin(), _latencies.end());
+
+   for (size_t i = 0; i < _delays.size(); ++i)
+   {
+      _delays[i].setDelay(_latency - _latencies[i]);
+   }
+}
+
+uint32_t LatencyCompensator::latency() const
+{
+   return _latency;
+}
+
+void LatencyCompensator::process(
+   uint32_t path, Buffer& buffer, uint32_t numFrames
+)
+{
+   _delays[path].process(buffer, numFrames);
+}
+
+} // namespace ImRt
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                          DELAY LINE                                        */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A multichannel delay line with an integer delay that is changed
+ * without allocating memory, e.g. to delay a dry signal by the latency of a
+ * parallel lookahead or FFT path.
+ */
+class DelayLine
+{
+public:
+   /**
+    * @brief Allocates the delay line and clears it.
+    *
+    * @param numChannels The number of channels.
+    * @param maxDelay The maximum delay in samples.
+    */
+   void prepare(uint32_t numChannels, uint32_t maxDelay);
+
+   /**
+    * @brief Sets the delay, which is limited to the maximum delay. This method
+    * is realtime-safe.
+    */
+   void setDelay(uint32_t delay);
+
+   /**
+    * @brief Returns the delay in samples.
+    */
+   uint32_t delay() const;
+
+   /**
+    * @brief Delays the first channels of the buffer in place.
+    *
+    * @param buffer The buffer to delay, which must have at least as many
+    * channels as the delay line.
+    * @param numFrames The number of frames to process.
+    */
+   void process(Buffer& buffer, uint32_t numFrames);
+
+   /**
+    * @brief Clears the delay line.
+    */
+   void clear();
+
+private:
+   std::vector<std::vector<float>> _lines;
+   uint32_t _delay = 0, _position = 0, _size = 0;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                      LATENCY COMPENSATOR                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Aligns parallel processing paths with different latencies by
+ * delaying every path to the latency of the slowest one, e.g. a dry path, an
+ * oversampled path (cf. Oversampler::latency()) and a lookahead path, before
+ * they are mixed.
+ *
+ * @code
+ * _compensator.prepare(2, 2, 4096);
+ * _compensator.setLatency(1, _oversampler.latency());
+ * declareLatency(_compensator.latency());
+ * ...
+ * _compensator.process(0, dry, numFrames);
+ * _compensator.process(1, wet, numFrames);
+ * @endcode
+ */
+class LatencyCompensator
+{
+public:
+   /**
+    * @brief Allocates the delay lines of all paths and sets their latencies
+    * to zero.
+    *
+    * @param numPaths The number of parallel paths.
+    * @param numChannels The number of channels per path.
+    * @param maxLatency The maximum latency of a path in samples.
+    */
+   void prepare(uint32_t numPaths, uint32_t numChannels, uint32_t maxLatency);
+
+   /**
+    * @brief Declares the latency of a path and updates the delays of all
+    * paths. This method is realtime-safe.
+    *
+    * @param path The index of the path.
+    * @param latency The latency of the path in samples.
+    */
+   void setLatency(uint32_t path, uint32_t latency);
+
+   /**
+    * @brief Returns the latency of the aligned paths, i.e. the largest latency
+    * of all paths.
+    */
+   uint32_t latency() const;
+
+   /**
+    * @brief Delays the output of a path in place, so it is aligned with the
+    * other paths.
+    *
+    * @param path The index of the path.
+    * @param buffer The output of the path.
+    * @param numFrames The number of frames to process.
+    */
+   void process(uint32_t path, Buffer& buffer, uint32_t numFrames);
+
+private:
+   std::vector<uint32_t> _latencies;
+   std::vector<DelayLine> _delays;
+   uint32_t _latency = 0;
+};
+
+} // namespace ImRt
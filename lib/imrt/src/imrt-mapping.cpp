@@ -0,0 +1,157 @@
+#include "imrt-mapping.h"
+#include <cassert>
+#include <cmath>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                   parameter mapping                    */
+/* ------------------------------------------------------ */
+
+ParameterMapping::ParameterMapping(
+   float min, float max, ParameterCurve curve, float shape
+)
+   : _min(min)
+   , _max(max)
+   , _curve(curve)
+{
+   assert(min < max);
+
+   switch (curve)
+   {
+   case ParameterCurve::Logarithmic:
+      assert(min > 0.0f);
+      _ratio = std::log(max / min);
+      break;
+   case ParameterCurve::Exponential:
+      assert(shape > 0.0f);
+      _curvature = shape;
+      _ratio     = std::expm1(shape);
+      break;
+   case ParameterCurve::Stepped:
+      assert(shape >= 2.0f);
+      _numSteps = uint32_t(shape);
+      break;
+   case ParameterCurve::Enum:
+      assert(min == std::floor(min) && max == std::floor(max));
+      _numSteps = uint32_t(max - min) + 1;
+      break;
+   default:
+      break;
+   }
+}
+
+ParameterCurve ParameterMapping::curve() const
+{
+   return _curve;
+}
+
+uint32_t ParameterMapping::numSteps() const
+{
+   return _numSteps;
+}
+
+float ParameterMapping::toNormalized(float plain) const
+{
+   plain = std::clamp(plain, _min, _max);
+
+   float linear = (plain - _min) / (_max - _min);
+   switch (_curve)
+   {
+   case ParameterCurve::Logarithmic:
+      return std::log(plain / _min) / _ratio;
+   case ParameterCurve::Exponential:
+      return std::log1p(linear * _ratio) / _curvature;
+   case ParameterCurve::Stepped:
+   case ParameterCurve::Enum:
+      return std::round(linear * (_numSteps - 1)) / (_numSteps - 1);
+   default:
+      return linear;
+   }
+}
+
+float ParameterMapping::toPlain(float normalized) const
+{
+   normalized = std::clamp(normalized, 0.0f, 1.0f);
+
+   float linear = normalized;
+   switch (_curve)
+   {
+   case ParameterCurve::Logarithmic:
+      return std::clamp(_min * std::exp(normalized * _ratio), _min, _max);
+   case ParameterCurve::Exponential:
+      linear = std::expm1(normalized * _curvature) / _ratio;
+      break;
+   case ParameterCurve::Stepped:
+   case ParameterCurve::Enum:
+      linear = std::round(normalized * (_numSteps - 1)) / (_numSteps - 1);
+      break;
+   default:
+      break;
+   }
+   return std::clamp(_min + linear * (_max - _min), _min, _max);
+}
+
+float ParameterMapping::constrain(float plain) const
+{
+   if (_numSteps == 0)
+   {
+      return std::clamp(plain, _min, _max);
+   }
+   return toPlain(toNormalized(plain));
+}
+
+/* ------------------------------------------------------ */
+/*                     mapping table                      */
+/* ------------------------------------------------------ */
+
+void MappingTable::prepare(const ParameterMapping& mapping, uint32_t size)
+{
+   assert(size > 0);
+
+   _curve = mapping.curve();
+   _min   = mapping.toPlain(0.0f);
+   _range = mapping.toPlain(1.0f) - _min;
+
+   uint32_t numSteps = std::max(mapping.numSteps(), 2u);
+   _steps            = float(numSteps - 1);
+   _stepSize         = _range / _steps;
+
+   _size = size;
+   _table.resize(size + 1);
+   for (uint32_t i = 0; i <= size; ++i)
+   {
+      _table[i] = mapping.toPlain(float(i) / size);
+   }
+}
+
+void MappingTable::process(
+   const float* normalized, float* plain, uint32_t numValues
+) const
+{
+   if (_curve == ParameterCurve::Linear)
+   {
+      for (uint32_t i = 0; i < numValues; ++i)
+      {
+         plain[i] = _min + std::clamp(normalized[i], 0.0f, 1.0f) * _range;
+      }
+      return;
+   }
+
+   for (uint32_t i = 0; i < numValues; ++i)
+   {
+      plain[i] = (*this)(normalized[i]);
+   }
+}
+
+void MappingTable::ramp(float from, float to, float* plain, uint32_t numValues)
+   const
+{
+   float step = numValues > 0 ? (to - from) / numValues : 0.0f;
+   for (uint32_t i = 0; i < numValues; ++i)
+   {
+      plain[i] = (*this)(from + step * float(i + 1));
+   }
+}
+
+} // namespace ImRt
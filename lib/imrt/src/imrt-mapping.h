@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                       PARAMETER MAPPING                                    */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The curve that maps the normalized value of a parameter, i.e. a value
+ * from 0 to 1 that e.g. corresponds to the position of a knob, to its plain
+ * value between minimum and maximum.
+ *
+ * - Linear: Equal distances of the normalized value are equal distances of
+ *   the plain value.
+ * - Logarithmic: Equal distances of the normalized value are equal ratios of
+ *   the plain value, e.g. for frequencies. The minimum and the maximum must
+ *   be positive.
+ * - Exponential: The plain value grows exponentially with the normalized
+ *   value, so more of the range lies near the minimum, e.g. for gains or
+ *   times that may be zero. The shape is the curvature, where larger values
+ *   bend the curve more.
+ * - Stepped: The plain value is one of a number of equally spaced steps
+ *   including the minimum and the maximum. The shape is the number of steps.
+ * - Enum: The plain value is an integer index into a list of labels (cf.
+ *   ParameterLayout).
+ */
+enum class ParameterCurve
+{
+   Linear,
+   Logarithmic,
+   Exponential,
+   Stepped,
+   Enum
+};
+
+/**
+ * @brief Converts the values of a parameter between their plain and their
+ * normalized representation according to a ParameterCurve.
+ */
+class ParameterMapping
+{
+public:
+   /**
+    * @brief Constructs a new mapping. Invalid combinations of the arguments,
+    * e.g. a logarithmic curve that includes zero, trigger an assertion.
+    *
+    * @param min The minimum plain value.
+    * @param max The maximum plain value, which must be larger.
+    * @param curve The mapping curve.
+    * @param shape The curvature of exponential curves or the number of steps
+    * of stepped curves. It is ignored by the other curves.
+    */
+   ParameterMapping(
+      float min, float max, ParameterCurve curve = ParameterCurve::Linear,
+      float shape = 0.0f
+   );
+
+   /**
+    * @brief Returns the mapping curve.
+    */
+   ParameterCurve curve() const;
+
+   /**
+    * @brief Returns the number of discrete values of stepped and enum curves
+    * or zero for continuous curves.
+    */
+   uint32_t numSteps() const;
+
+   /**
+    * @brief Converts a plain value to a normalized value. The plain value is
+    * clamped to the range first.
+    */
+   float toNormalized(float plain) const;
+
+   /**
+    * @brief Converts a normalized value to a plain value. The normalized
+    * value is clamped to the range from 0 to 1 first.
+    */
+   float toPlain(float normalized) const;
+
+   /**
+    * @brief Clamps a plain value to the range and snaps it to the nearest
+    * step of stepped and enum curves.
+    */
+   float constrain(float plain) const;
+
+private:
+   float _min, _max;
+   ParameterCurve _curve;
+   float _curvature = 0.0f, _ratio = 1.0f;
+   uint32_t _numSteps = 0;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                        MAPPING TABLE                                       */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Converts normalized values to plain values on the audio thread
+ * without calling std::pow() or std::exp(), e.g. to map a smoothed normalized
+ * frequency sample by sample. Logarithmic and exponential curves are read
+ * from a precomputed table with linear interpolation, which is accurate to a
+ * few millionths of the value with the default size. Linear, stepped and enum
+ * curves are computed directly, since that is cheaper than a table.
+ *
+ * @code
+ * _cutoffTable.prepare(cutoffLayout.mapping());
+ * ...
+ * _cutoffTable.ramp(_lastCutoff, target, cutoff, numFrames);
+ * @endcode
+ */
+class MappingTable
+{
+public:
+   /**
+    * @brief Computes the table for a mapping.
+    *
+    * @param mapping The mapping to tabulate.
+    * @param size The number of intervals of the table.
+    */
+   void prepare(const ParameterMapping& mapping, uint32_t size = 1024);
+
+   /**
+    * @brief Converts a normalized value to a plain value.
+    */
+   float operator()(float normalized) const
+   {
+      normalized = std::clamp(normalized, 0.0f, 1.0f);
+      switch (_curve)
+      {
+      case ParameterCurve::Linear:
+         return _min + normalized * _range;
+      case ParameterCurve::Stepped:
+      case ParameterCurve::Enum:
+         return _min + float(int(normalized * _steps + 0.5f)) * _stepSize;
+      default:
+         break;
+      }
+
+      float position = normalized * _size;
+      uint32_t index = std::min(uint32_t(position), _size - 1);
+      float fraction = position - float(index);
+      return _table[index] + fraction * (_table[index + 1] - _table[index]);
+   }
+
+   /**
+    * @brief Converts a block of normalized values to plain values.
+    *
+    * @param normalized The normalized values.
+    * @param plain The plain values, which may be the same array.
+    * @param numValues The number of values.
+    */
+   void process(const float* normalized, float* plain, uint32_t numValues)
+      const;
+
+   /**
+    * @brief Converts a linear ramp of normalized values to plain values, e.g.
+    * to glide a frequency evenly in octaves during a block.
+    *
+    * @param from The normalized value before the first value of the ramp.
+    * @param to The normalized value at the last value of the ramp.
+    * @param plain The plain values.
+    * @param numValues The number of values.
+    */
+   void ramp(float from, float to, float* plain, uint32_t numValues) const;
+
+private:
+   ParameterCurve _curve = ParameterCurve::Linear;
+   float _min = 0.0f, _range = 1.0f;
+   float _steps = 1.0f, _stepSize = 1.0f;
+   uint32_t _size = 0;
+   std::vector<float> _table;
+};
+
+} // namespace ImRt
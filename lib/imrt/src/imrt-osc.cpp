@@ -0,0 +1,488 @@
+#include "imrt-osc.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                      osc helpers                       */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const size_t maxPacketSize   = 65536;
+   const size_t maxBatchSize    = 1024;
+   const int maxPacketsPerBatch = 256;
+   const int maxBundleDepth     = 8;
+
+   uint32_t hashAddress(const char* address, size_t length)
+   {
+      uint32_t hash = 2166136261u; // FNV-1a
+      for (size_t i = 0; i < length; ++i)
+      {
+         hash = (hash ^ static_cast<uint8_t>(address[i])) * 16777619u;
+      }
+      return hash;
+   }
+
+   uint32_t readUint32(const uint8_t* data)
+   {
+      return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16)
+         | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+   }
+
+   uint64_t readUint64(const uint8_t* data)
+   {
+      return (uint64_t(readUint32(data)) << 32) | readUint32(data + 4);
+   }
+
+   // Returns the size of the null-terminated, 4-byte aligned OSC string at
+   // the beginning of data, or 0 if the string is not terminated.
+   size_t paddedStringSize(const uint8_t* data, size_t size)
+   {
+      auto end = static_cast<const uint8_t*>(std::memchr(data, 0, size));
+      if (end == nullptr)
+      {
+         return 0;
+      }
+      return std::min(((end - data) + 4) & ~size_t(3), size);
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                    osc address map                     */
+/* ------------------------------------------------------ */
+
+void OscAddressMap::add(const std::string& address, uint32_t paramId)
+{
+   _addresses.emplace_back(address, paramId);
+}
+
+void OscAddressMap::build()
+{
+   uint32_t capacity = 16;
+   while (capacity < 2 * _addresses.size())
+   {
+      capacity *= 2;
+   }
+
+   _mask = capacity - 1;
+   _entries.assign(capacity, Entry());
+   _chars.clear();
+   _paramIds.clear();
+
+   std::map<uint32_t, int32_t> indices;
+
+   for (auto& [address, paramId] : _addresses)
+   {
+      if (find(address.data(), address.size()) >= 0)
+      {
+         continue; // the first parameter added for an address wins
+      }
+
+      auto [iterator, inserted] = indices.try_emplace(
+         paramId, static_cast<int32_t>(_paramIds.size())
+      );
+      if (inserted)
+      {
+         _paramIds.push_back(paramId);
+      }
+
+      uint32_t hash = hashAddress(address.data(), address.size());
+      uint32_t slot = hash & _mask;
+      while (_entries[slot].index >= 0)
+      {
+         slot = (slot + 1) & _mask;
+      }
+
+      _entries[slot].hash   = hash;
+      _entries[slot].offset = static_cast<uint32_t>(_chars.size());
+      _entries[slot].length = static_cast<uint32_t>(address.size());
+      _entries[slot].index  = iterator->second;
+      _chars.insert(_chars.end(), address.begin(), address.end());
+   }
+}
+
+int32_t OscAddressMap::find(const char* address, size_t length) const
+{
+   if (_entries.empty())
+   {
+      return -1;
+   }
+
+   uint32_t hash = hashAddress(address, length);
+   for (uint32_t slot = hash & _mask;; slot = (slot + 1) & _mask)
+   {
+      const Entry& entry = _entries[slot];
+      if (entry.index < 0)
+      {
+         return -1;
+      }
+      if (entry.hash == hash && entry.length == length
+          && std::memcmp(_chars.data() + entry.offset, address, length) == 0)
+      {
+         return entry.index;
+      }
+   }
+}
+
+uint32_t OscAddressMap::paramId(int32_t index) const
+{
+   return _paramIds[index];
+}
+
+uint32_t OscAddressMap::numParameters() const
+{
+   return static_cast<uint32_t>(_paramIds.size());
+}
+
+/* ------------------------------------------------------ */
+/*                       osc server                       */
+/* ------------------------------------------------------ */
+
+OscServer::OscServer(DspParameters& parameters)
+   : _parameters(parameters)
+{
+}
+
+OscServer::~OscServer()
+{
+   stop();
+}
+
+bool OscServer::start(OscSettings settings)
+{
+   stop();
+
+#if defined(_WIN32)
+   return false;
+#else
+   _prefix = settings.prefix;
+   buildMap();
+
+   _packet.resize(maxPacketSize);
+   _batch.reserve(maxBatchSize);
+   _batchIndices.reserve(maxBatchSize);
+
+   sockaddr_in address {};
+   address.sin_family = AF_INET;
+   address.sin_port   = htons(settings.port);
+   if (inet_pton(AF_INET, settings.address.c_str(), &address.sin_addr) != 1)
+   {
+      return false;
+   }
+
+   _socket = socket(AF_INET, SOCK_DGRAM, 0);
+   if (_socket < 0)
+   {
+      return false;
+   }
+
+   int receiveBufferSize = 1 << 20;
+   setsockopt(
+      _socket, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize,
+      sizeof(receiveBufferSize)
+   );
+
+   socklen_t addressSize = sizeof(address);
+   if (bind(_socket, (sockaddr*)&address, sizeof(address)) != 0
+       || getsockname(_socket, (sockaddr*)&address, &addressSize) != 0)
+   {
+      close(_socket);
+      _socket = -1;
+      return false;
+   }
+   _port = ntohs(address.sin_port);
+
+   _running = true;
+   _thread  = std::thread(&OscServer::receive, this);
+   return true;
+#endif
+}
+
+void OscServer::stop()
+{
+   _running = false;
+   if (_thread.joinable())
+   {
+      _thread.join();
+   }
+
+#if !defined(_WIN32)
+   if (_socket >= 0)
+   {
+      close(_socket);
+   }
+#endif
+   _socket = -1;
+   _port   = 0;
+}
+
+uint16_t OscServer::port() const
+{
+   return _port;
+}
+
+uint64_t OscServer::numMessages() const
+{
+   return _numMessages.load();
+}
+
+uint64_t OscServer::numRejected() const
+{
+   return _numRejected.load();
+}
+
+void OscServer::buildMap()
+{
+   // A parameter added or removed meanwhile changes the generation again, so
+   // the map is rebuilt with the next packets.
+   _generation = _parameters.generation();
+
+   _map = OscAddressMap();
+   _parameters.forEach(
+      [this](DspParameter& param)
+      {
+         std::string name = param.name();
+         std::replace(name.begin(), name.end(), ' ', '_');
+
+         _map.add(_prefix + std::to_string(param.id()), param.id());
+         _map.add(_prefix + name, param.id());
+      }
+   );
+   _map.build();
+
+   _batchPositions.assign(_map.numParameters(), -1);
+}
+
+void OscServer::receive()
+{
+#if !defined(_WIN32)
+   while (_running)
+   {
+      pollfd descriptor { _socket, POLLIN, 0 };
+      if (poll(&descriptor, 1, 50) <= 0)
+      {
+         continue;
+      }
+
+      // The batch is empty here, so its positions can be reset.
+      if (_parameters.generation() != _generation)
+      {
+         buildMap();
+      }
+
+      // Collect everything that arrived in the meantime into one batch.
+      for (int packet = 0; packet < maxPacketsPerBatch; ++packet)
+      {
+         auto size
+            = recv(_socket, _packet.data(), _packet.size(), MSG_DONTWAIT);
+         if (size <= 0)
+         {
+            break;
+         }
+         parsePacket(_packet.data(), static_cast<size_t>(size), 0);
+      }
+
+      flush();
+   }
+#endif
+}
+
+void OscServer::parsePacket(const uint8_t* data, size_t size, int depth)
+{
+   if (size >= 16 && std::memcmp(data, "#bundle", 8) == 0)
+   {
+      if (depth >= maxBundleDepth)
+      {
+         ++_numRejected;
+         return;
+      }
+
+      size_t pos = 16; // skip "#bundle" and the time tag
+      while (size - pos >= 4)
+      {
+         size_t elementSize = readUint32(data + pos);
+         pos += 4;
+         if (elementSize > size - pos)
+         {
+            ++_numRejected;
+            return;
+         }
+         parsePacket(data + pos, elementSize, depth + 1);
+         pos += elementSize;
+      }
+   }
+   else if (size >= 4 && data[0] == '/')
+   {
+      parseMessage(data, size);
+   }
+   else
+   {
+      ++_numRejected;
+   }
+}
+
+void OscServer::parseMessage(const uint8_t* data, size_t size)
+{
+   ++_numMessages;
+
+   size_t addressSize = paddedStringSize(data, size);
+   if (addressSize == 0 || addressSize >= size || data[addressSize] != ',')
+   {
+      ++_numRejected;
+      return;
+   }
+
+   auto address  = (const char*)data;
+   int32_t index = _map.find(address, std::strlen(address));
+   if (index < 0)
+   {
+      ++_numRejected;
+      return;
+   }
+
+   const uint8_t* tags = data + addressSize;
+   size_t tagsSize     = paddedStringSize(tags, size - addressSize);
+   size_t pos          = addressSize + tagsSize;
+   if (tagsSize == 0)
+   {
+      ++_numRejected;
+      return;
+   }
+
+   bool found  = false;
+   float value = 0.0f;
+
+   for (++tags; *tags != 0 && !found; ++tags) // skip the leading ','
+   {
+      size_t argumentSize = 0;
+      switch (*tags)
+      {
+      case 'i':
+      case 'f':
+      case 'c':
+      case 'r':
+      case 'm':
+         argumentSize = 4;
+         break;
+      case 'h':
+      case 'd':
+      case 't':
+         argumentSize = 8;
+         break;
+      case 's':
+      case 'S':
+         argumentSize = paddedStringSize(data + pos, size - pos);
+         break;
+      case 'b':
+         argumentSize = size - pos >= 4
+            ? 4 + ((readUint32(data + pos) + 3) & ~3u)
+            : 0;
+         break;
+      case 'T':
+      case 'F':
+      case 'N':
+      case 'I':
+         break;
+      default:
+         ++_numRejected;
+         return;
+      }
+
+      if (argumentSize > size - pos || (argumentSize == 0 && *tags == 's'))
+      {
+         ++_numRejected;
+         return;
+      }
+
+      const uint8_t* argument = data + pos;
+      pos += argumentSize;
+
+      switch (*tags)
+      {
+      case 'i':
+         value = static_cast<float>(static_cast<int32_t>(readUint32(argument)));
+         found = true;
+         break;
+      case 'h':
+         value = static_cast<float>(static_cast<int64_t>(readUint64(argument)));
+         found = true;
+         break;
+      case 'f':
+      {
+         uint32_t bits = readUint32(argument);
+         std::memcpy(&value, &bits, sizeof(float));
+         found = true;
+         break;
+      }
+      case 'd':
+      {
+         uint64_t bits = readUint64(argument);
+         double number;
+         std::memcpy(&number, &bits, sizeof(double));
+         value = static_cast<float>(number);
+         found = true;
+         break;
+      }
+      case 'T':
+      case 'F':
+         value = *tags == 'T' ? 1.0f : 0.0f;
+         found = true;
+         break;
+      default:
+         break;
+      }
+   }
+
+   if (!found)
+   {
+      ++_numRejected;
+      return;
+   }
+
+   int32_t position = _batchPositions[index];
+   if (position >= 0)
+   {
+      _batch[position].value = value;
+      return;
+   }
+
+   if (_batch.size() == maxBatchSize)
+   {
+      flush();
+   }
+
+   _batchPositions[index] = static_cast<int32_t>(_batch.size());
+   _batchIndices.push_back(index);
+   _batch.push_back({ _map.paramId(index), value });
+}
+
+void OscServer::flush()
+{
+   if (_batch.empty())
+   {
+      return;
+   }
+
+   _parameters.announceExternalChanges(_batch.data(), _batch.size());
+
+   for (auto index : _batchIndices)
+   {
+      _batchPositions[index] = -1;
+   }
+   _batchIndices.clear();
+   _batch.clear();
+}
+
+} // namespace ImRt
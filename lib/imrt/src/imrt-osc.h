@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "imrt-params.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                      OSC ADDRESS MAP                                       */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief An open-addressing hash table that maps OSC addresses to parameter
+ * IDs. The table is built once before the OscServer starts, after that lookups
+ * neither allocate nor copy the address.
+ */
+class OscAddressMap
+{
+public:
+   /**
+    * @brief Adds an address for the parameter with the given ID. Several
+    * addresses may refer to the same parameter. The table has to be rebuilt
+    * with OscAddressMap::build() after adding addresses.
+    */
+   void add(const std::string& address, uint32_t paramId);
+
+   /**
+    * @brief Builds the hash table from the added addresses.
+    */
+   void build();
+
+   /**
+    * @brief Looks up an address.
+    *
+    * @param address The address, not necessarily null-terminated.
+    * @param length The length of the address.
+    * @return The index of the parameter among all parameters of the map (cf.
+    * OscAddressMap::paramId()) or -1 if the address is unknown.
+    */
+   int32_t find(const char* address, size_t length) const;
+
+   /**
+    * @brief Returns the ID of the parameter with the given index.
+    */
+   uint32_t paramId(int32_t index) const;
+
+   /**
+    * @brief Returns the number of distinct parameters of the map.
+    */
+   uint32_t numParameters() const;
+
+private:
+   struct Entry
+   {
+      uint32_t hash   = 0;
+      uint32_t offset = 0;
+      uint32_t length = 0;
+      int32_t index   = -1;
+   };
+
+   std::vector<std::pair<std::string, uint32_t>> _addresses;
+   std::vector<Entry> _entries;
+   std::vector<char> _chars;
+   std::vector<uint32_t> _paramIds;
+   uint32_t _mask = 0;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                        OSC SERVER                                          */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Settings passed to the OscServer::start() method.
+ */
+struct OscSettings
+{
+   std::string address = "127.0.0.1"; // use "0.0.0.0" to listen on all hosts
+   uint16_t port       = 9000;        // 0 picks a free port
+   std::string prefix  = "/imrt/";
+};
+
+/**
+ * @brief A server that receives OSC messages over UDP on its own thread and
+ * announces them as parameter changes. Every parameter can be addressed by its
+ * ID and by its name with spaces replaced by underscores, e.g. "/imrt/1" or
+ * "/imrt/Gain" with the default prefix. The first numeric argument of a
+ * message is used as the new value. Bundles are unpacked recursively, their
+ * time tags are ignored. Parameters added or removed while the server runs
+ * are picked up by the receiving thread before it parses the next packets.
+ *
+ * Packets are parsed in place without allocating memory. All packets that
+ * arrived at the same time are collected into one batch, in which several
+ * changes of the same parameter are coalesced, before the batch is announced
+ * to the DSP. This way a console sending thousands of messages per second
+ * causes only a few FIFO pushes per parameter and GUI frame. The DSP reports
+ * the changes back to the GUI once it consumed them.
+ */
+class OscServer
+{
+public:
+   /**
+    * @brief Constructs a new OSC server for the given DSP parameters.
+    */
+   OscServer(DspParameters& parameters);
+   OscServer() = delete;
+
+   /**
+    * @brief Stops the server and destroys the object.
+    */
+   ~OscServer();
+
+   /**
+    * @brief Opens the UDP socket and starts the receiving thread.
+    *
+    * @return false if the socket could not be opened.
+    */
+   bool start(OscSettings settings = OscSettings());
+
+   /**
+    * @brief Stops the receiving thread and closes the socket.
+    */
+   void stop();
+
+   /**
+    * @brief Returns the UDP port the server listens on or 0 if it is not
+    * running.
+    */
+   uint16_t port() const;
+
+   /**
+    * @brief Returns the number of OSC messages received so far.
+    */
+   uint64_t numMessages() const;
+
+   /**
+    * @brief Returns the number of OSC messages that could not be applied
+    * because they were malformed or addressed an unknown parameter.
+    */
+   uint64_t numRejected() const;
+
+private:
+   DspParameters& _parameters;
+   OscAddressMap _map;
+   std::string _prefix;
+   uint64_t _generation = 0; // of the parameters the map was built for
+
+   std::thread _thread;
+   std::atomic<bool> _running { false };
+   int _socket    = -1;
+   uint16_t _port = 0;
+
+   std::atomic<uint64_t> _numMessages { 0 }, _numRejected { 0 };
+
+   std::vector<uint8_t> _packet;
+   std::vector<ParameterChange> _batch;
+   std::vector<int32_t> _batchIndices, _batchPositions;
+
+   void buildMap();
+   void receive();
+   void parsePacket(const uint8_t* data, size_t size, int depth);
+   void parseMessage(const uint8_t* data, size_t size);
+   void flush();
+};
+
+} // namespace ImRt
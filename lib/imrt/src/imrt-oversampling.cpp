@@ -0,0 +1,483 @@
+#include "imrt-oversampling.h"
+#include "imrt-simd.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                    filter design                       */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const double pi = 3.14159265358979323846;
+
+   // Number of non-zero side taps of the linear-phase half-band filter of
+   // each stage. Later stages run at higher rates where the signal has no
+   // content near their Nyquist frequency, so their transition band can be
+   // much wider and their filters shorter.
+   const uint32_t linearTaps[] = { 56, 16, 12 };
+   const double linearBeta[]   = { 8.0, 8.0, 8.0 };
+
+   // Number of allpass coefficients and transition bandwidth of the
+   // minimum-phase half-band filter of each stage.
+   const uint32_t minimumCoefficients[] = { 10, 6, 4 };
+   const double minimumTransition[]     = { 0.04, 0.13, 0.23 };
+   const uint32_t maxCoefficients       = 10;
+   const uint32_t numLanes              = 4; // channels per SIMD register
+
+   // Zeroth order modified Bessel function of the first kind.
+   double besselI0(double x)
+   {
+      double sum = 1.0, term = 1.0;
+      for (int k = 1; k < 50 && term > 1e-12 * sum; ++k)
+      {
+         term *= (x / (2.0 * k)) * (x / (2.0 * k));
+         sum += term;
+      }
+      return sum;
+   }
+
+   // Computes the non-zero side taps of a Kaiser-windowed half-band FIR
+   // filter with 2 * numTaps - 1 taps, i.e. the taps at odd distances from
+   // the center tap, which is 0.5. The taps are symmetric and scaled by 2,
+   // as needed by the upsampler.
+   std::vector<float> designLinearPhase(uint32_t numTaps, double beta)
+   {
+      std::vector<float> taps(numTaps);
+      for (uint32_t i = 0; i < numTaps; ++i)
+      {
+         double x      = 2.0 * i - (numTaps - 1.0);
+         double r      = x / numTaps;
+         double window = besselI0(beta * std::sqrt(1.0 - r * r));
+         taps[i]       = static_cast<float>(
+            std::sin(0.5 * pi * x) / (0.5 * pi * x) * window / besselI0(beta)
+         );
+      }
+      return taps;
+   }
+
+   // Computes the coefficients of a polyphase IIR half-band filter made of
+   // two parallel chains of first-order allpass sections in z^-2, as
+   // described by Valenzuela and Constantinides and implemented in Laurent
+   // de Soras' HIIR library.
+   std::vector<float>
+   designMinimumPhase(uint32_t numCoefficients, double transition)
+   {
+      double k = std::tan((1.0 - transition * 2.0) * pi / 4.0);
+      k *= k;
+      double kk = std::pow(1.0 - k * k, 0.25);
+      double e  = 0.5 * (1.0 - kk) / (1.0 + kk);
+      double e4 = e * e * e * e;
+      double q  = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+
+      const int order = numCoefficients * 2 + 1;
+
+      std::vector<float> coefficients(numCoefficients);
+      for (uint32_t index = 0; index < numCoefficients; ++index)
+      {
+         const int c = index + 1;
+
+         double numerator = 0.0, term;
+         int sign         = 1;
+         for (int i = 0;; ++i, sign = -sign)
+         {
+            term = std::pow(q, i * (i + 1))
+               * std::sin((i * 2 + 1) * c * pi / order) * sign;
+            numerator += term;
+            if (std::abs(term) <= 1e-100)
+            {
+               break;
+            }
+         }
+
+         double denominator = 0.0;
+         sign               = -1;
+         for (int i = 1;; ++i, sign = -sign)
+         {
+            term = std::pow(q, i * i) * std::cos(i * 2 * c * pi / order) * sign;
+            denominator += term;
+            if (std::abs(term) <= 1e-100)
+            {
+               break;
+            }
+         }
+
+         double w  = numerator * std::pow(q, 0.25) / (denominator + 0.5);
+         double ww = w * w;
+         double x  = std::sqrt((1.0 - ww * k) * (1.0 - ww / k)) / (1.0 + ww);
+         coefficients[index] = static_cast<float>((1.0 - x) / (1.0 + x));
+      }
+      return coefficients;
+   }
+
+   // Runs one sample of every lane through both paths of an allpass
+   // half-band filter. Every section keeps its last input and output. Even
+   // coefficients belong to the first path, odd ones to the second.
+   inline void allpassPaths(
+      const Simd::Float4* coefficients, size_t numCoefficients,
+      Simd::Float4* states, Simd::Float4& in0, Simd::Float4& in1
+   )
+   {
+      for (size_t i = 0; i < numCoefficients; i += 2)
+      {
+         Simd::Float4* state = states + 2 * i;
+         Simd::Float4 y      = coefficients[i] * (in0 - state[1]) + state[0];
+         state[0]            = in0;
+         state[1]            = y;
+         in0                 = y;
+
+         if (i + 1 < numCoefficients)
+         {
+            state    = states + 2 * (i + 1);
+            y        = coefficients[i + 1] * (in1 - state[1]) + state[0];
+            state[0] = in1;
+            state[1] = y;
+            in1      = y;
+         }
+      }
+   }
+
+   // Moves the states of the filters of a lane group into the SIMD lanes and
+   // back. Unused lanes start from zero.
+   void loadLanes(
+      const std::vector<float>* const* states, uint32_t numUsed,
+      Simd::Float4* lanes, size_t numStates
+   )
+   {
+      for (size_t i = 0; i < numStates; ++i)
+      {
+         float values[numLanes] = {};
+         for (uint32_t lane = 0; lane < numUsed; ++lane)
+         {
+            values[lane] = (*states[lane])[i];
+         }
+         lanes[i] = Simd::Float4::load(values);
+      }
+   }
+
+   void storeLanes(
+      std::vector<float>* const* states, uint32_t numUsed,
+      const Simd::Float4* lanes, size_t numStates
+   )
+   {
+      for (size_t i = 0; i < numStates; ++i)
+      {
+         float values[numLanes];
+         lanes[i].store(values);
+         for (uint32_t lane = 0; lane < numUsed; ++lane)
+         {
+            (*states[lane])[i] = values[lane];
+         }
+      }
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                    half-band filter                    */
+/* ------------------------------------------------------ */
+
+void Oversampler::HalfbandFilter::prepare(
+   OversamplingPhase phase, uint32_t stage
+)
+{
+   _phase = phase;
+
+   if (phase == OversamplingPhase::Linear)
+   {
+      _numTaps = linearTaps[stage];
+      _taps    = designLinearPhase(_numTaps, linearBeta[stage]);
+      _upLine.assign(2 * _numTaps, 0.0f);
+      _evenLine.assign(2 * _numTaps, 0.0f);
+      _oddLine.assign(2 * _numTaps, 0.0f);
+      _upPos   = 0;
+      _downPos = 0;
+   }
+   else
+   {
+      assert(minimumCoefficients[stage] <= maxCoefficients);
+      _coefficients = designMinimumPhase(
+         minimumCoefficients[stage], minimumTransition[stage]
+      );
+      _upStates.assign(2 * _coefficients.size(), 0.0f);
+      _downStates.assign(2 * _coefficients.size(), 0.0f);
+   }
+}
+
+void Oversampler::HalfbandFilter::up(
+   const float* in, float* out, uint32_t numFrames
+)
+{
+   // The even output samples are the input filtered with the side taps, the
+   // odd ones only see the center tap and are the delayed input.
+   const uint32_t n = _numTaps;
+   for (uint32_t i = 0; i < numFrames; ++i)
+   {
+      _upLine[_upPos] = _upLine[_upPos + n] = in[i];
+      const float* window = _upLine.data() + _upPos + 1;
+
+      out[2 * i]     = Simd::dot(window, _taps.data(), n);
+      out[2 * i + 1] = window[n / 2];
+      _upPos         = _upPos + 1 == n ? 0 : _upPos + 1;
+   }
+}
+
+void Oversampler::HalfbandFilter::down(
+   const float* in, float* out, uint32_t numFrames
+)
+{
+   // The even input samples are filtered with the side taps, the odd ones
+   // only with the center tap.
+   const uint32_t n = _numTaps;
+   for (uint32_t i = 0; i < numFrames; ++i)
+   {
+      _evenLine[_downPos] = _evenLine[_downPos + n] = in[2 * i];
+      _oddLine[_downPos] = _oddLine[_downPos + n] = in[2 * i + 1];
+      const float* even = _evenLine.data() + _downPos + 1;
+      const float* odd  = _oddLine.data() + _downPos + 1;
+
+      out[i]   = 0.5f * (Simd::dot(even, _taps.data(), n) + odd[n / 2 - 1]);
+      _downPos = _downPos + 1 == n ? 0 : _downPos + 1;
+   }
+}
+
+void Oversampler::HalfbandFilter::upLanes(
+   HalfbandFilter* filters, uint32_t numUsed, const float* const* in,
+   float* const* out, uint32_t numFrames
+)
+{
+   const size_t numCoefficients = filters[0]._coefficients.size();
+   const size_t numStates       = 2 * numCoefficients;
+
+   Simd::Float4 coefficients[maxCoefficients], states[2 * maxCoefficients];
+   std::vector<float>* laneStates[numLanes];
+   for (uint32_t lane = 0; lane < numUsed; ++lane)
+   {
+      laneStates[lane] = &filters[lane]._upStates;
+   }
+   for (size_t i = 0; i < numCoefficients; ++i)
+   {
+      coefficients[i] = Simd::Float4::fill(filters[0]._coefficients[i]);
+   }
+   loadLanes(laneStates, numUsed, states, numStates);
+
+   float out0[numLanes], out1[numLanes];
+   for (uint32_t i = 0; i < numFrames; ++i)
+   {
+      Simd::Float4 path0
+         = Simd::Float4::set(in[0][i], in[1][i], in[2][i], in[3][i]);
+      Simd::Float4 path1 = path0;
+      allpassPaths(coefficients, numCoefficients, states, path0, path1);
+      path0.store(out0);
+      path1.store(out1);
+
+      for (uint32_t lane = 0; lane < numUsed; ++lane)
+      {
+         out[lane][2 * i]     = out0[lane];
+         out[lane][2 * i + 1] = out1[lane];
+      }
+   }
+
+   storeLanes(laneStates, numUsed, states, numStates);
+}
+
+void Oversampler::HalfbandFilter::downLanes(
+   HalfbandFilter* filters, uint32_t numUsed, const float* const* in,
+   float* const* out, uint32_t numFrames
+)
+{
+   const size_t numCoefficients = filters[0]._coefficients.size();
+   const size_t numStates       = 2 * numCoefficients;
+
+   Simd::Float4 coefficients[maxCoefficients], states[2 * maxCoefficients];
+   std::vector<float>* laneStates[numLanes];
+   for (uint32_t lane = 0; lane < numUsed; ++lane)
+   {
+      laneStates[lane] = &filters[lane]._downStates;
+   }
+   for (size_t i = 0; i < numCoefficients; ++i)
+   {
+      coefficients[i] = Simd::Float4::fill(filters[0]._coefficients[i]);
+   }
+   loadLanes(laneStates, numUsed, states, numStates);
+
+   const Simd::Float4 half = Simd::Float4::fill(0.5f);
+   float sum[numLanes];
+   for (uint32_t i = 0, j = 0; i < numFrames; ++i, j += 2)
+   {
+      Simd::Float4 path0 = Simd::Float4::set(
+         in[0][j + 1], in[1][j + 1], in[2][j + 1], in[3][j + 1]
+      );
+      Simd::Float4 path1
+         = Simd::Float4::set(in[0][j], in[1][j], in[2][j], in[3][j]);
+      allpassPaths(coefficients, numCoefficients, states, path0, path1);
+      (half * (path0 + path1)).store(sum);
+
+      for (uint32_t lane = 0; lane < numUsed; ++lane)
+      {
+         out[lane][i] = sum[lane];
+      }
+   }
+
+   storeLanes(laneStates, numUsed, states, numStates);
+}
+
+double Oversampler::HalfbandFilter::latency() const
+{
+   if (_phase == OversamplingPhase::Linear)
+   {
+      return _numTaps - 1.0; // the center tap
+   }
+
+   // The phase delay of a first-order allpass section (a + z^-1) / (1 + a
+   // z^-1) at DC is (1 - a) / (1 + a), twice that in z^-2. The second path
+   // is delayed by one more sample, and both paths have the same delay at
+   // low frequencies, so their average is used.
+   double delay = 0.5;
+   for (auto a : _coefficients)
+   {
+      delay += (1.0 - a) / (1.0 + a);
+   }
+   return delay;
+}
+
+/* ------------------------------------------------------ */
+/*                      oversampler                       */
+/* ------------------------------------------------------ */
+
+void Oversampler::prepare(
+   uint32_t numChannels, uint32_t maxFrames, uint32_t factor,
+   OversamplingPhase phase
+)
+{
+   assert(factor == 1 || factor == 2 || factor == 4 || factor == 8);
+
+   _factor      = factor;
+   _numChannels = numChannels;
+   _maxFrames   = maxFrames;
+   _phase       = phase;
+   _latency     = 0.0;
+   _stages.clear();
+   _buffers.clear();
+
+   for (uint32_t stage = 0, rate = 2; rate <= factor; ++stage, rate *= 2)
+   {
+      _stages.emplace_back(numChannels);
+      for (auto& filter : _stages.back())
+      {
+         filter.prepare(phase, stage);
+      }
+      _buffers.emplace_back(numChannels, maxFrames * rate);
+
+      // The up- and the downsampling filter both run at this stage's rate.
+      _latency += 2.0 * _stages.back().front().latency() / rate;
+   }
+}
+
+uint32_t Oversampler::factor() const
+{
+   return _factor;
+}
+
+uint32_t Oversampler::latency() const
+{
+   return static_cast<uint32_t>(std::lround(_latency));
+}
+
+void Oversampler::upsample(const Buffer& buffer, uint32_t numFrames)
+{
+   assert(numFrames <= _maxFrames);
+   upsample(buffer, 0, std::min(numFrames, _maxFrames));
+}
+
+void Oversampler::downsample(Buffer& buffer, uint32_t numFrames)
+{
+   assert(numFrames <= _maxFrames);
+   downsample(buffer, 0, std::min(numFrames, _maxFrames));
+}
+
+void Oversampler::upsample(
+   const Buffer& buffer, uint32_t offset, uint32_t numFrames
+)
+{
+   const uint32_t numChannels = std::min(buffer.getNumChannels(), _numChannels);
+   for (size_t stage = 0; stage < _stages.size(); ++stage)
+   {
+      const Buffer& input = stage == 0 ? buffer : _buffers[stage - 1];
+      uint32_t first      = stage == 0 ? offset : 0;
+      if (_phase == OversamplingPhase::Minimum)
+      {
+         for (uint32_t ch = 0; ch < numChannels; ch += numLanes)
+         {
+            // Unused lanes read the last channel of the group.
+            uint32_t numUsed = std::min(numLanes, numChannels - ch);
+            const float* in[numLanes];
+            float* out[numLanes];
+            for (uint32_t lane = 0; lane < numLanes; ++lane)
+            {
+               uint32_t channel = ch + std::min(lane, numUsed - 1);
+               in[lane]         = &input.getSample(channel, first);
+               out[lane]        = &_buffers[stage].getSample(channel, 0);
+            }
+            HalfbandFilter::upLanes(
+               &_stages[stage][ch], numUsed, in, out, numFrames << stage
+            );
+         }
+         continue;
+      }
+
+      for (uint32_t ch = 0; ch < numChannels; ++ch)
+      {
+         _stages[stage][ch].up(
+            &input.getSample(ch, first), &_buffers[stage].getSample(ch, 0),
+            numFrames << stage
+         );
+      }
+   }
+}
+
+void Oversampler::downsample(
+   Buffer& buffer, uint32_t offset, uint32_t numFrames
+)
+{
+   // Each stage writes into the buffer of the previous stage, whose content
+   // is no longer needed.
+   const uint32_t numChannels = std::min(buffer.getNumChannels(), _numChannels);
+   for (size_t stage = _stages.size(); stage-- > 0;)
+   {
+      Buffer& output = stage == 0 ? buffer : _buffers[stage - 1];
+      uint32_t first = stage == 0 ? offset : 0;
+      if (_phase == OversamplingPhase::Minimum)
+      {
+         for (uint32_t ch = 0; ch < numChannels; ch += numLanes)
+         {
+            uint32_t numUsed = std::min(numLanes, numChannels - ch);
+            const float* in[numLanes];
+            float* out[numLanes];
+            for (uint32_t lane = 0; lane < numLanes; ++lane)
+            {
+               uint32_t channel = ch + std::min(lane, numUsed - 1);
+               in[lane]         = &_buffers[stage].getSample(channel, 0);
+               out[lane]        = &output.getSample(channel, first);
+            }
+            HalfbandFilter::downLanes(
+               &_stages[stage][ch], numUsed, in, out, numFrames << stage
+            );
+         }
+         continue;
+      }
+
+      for (uint32_t ch = 0; ch < numChannels; ++ch)
+      {
+         _stages[stage][ch].down(
+            &_buffers[stage].getSample(ch, 0), &output.getSample(ch, first),
+            numFrames << stage
+         );
+      }
+   }
+}
+
+} // namespace ImRt
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                         OVERSAMPLER                                        */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The filter type of an Oversampler.
+ *
+ * - Linear: Symmetric half-band FIR filters. The phase response is linear,
+ *   i.e. all frequencies are delayed by the same number of samples, at the
+ *   cost of a higher latency.
+ * - Minimum: Polyphase IIR half-band filters made of allpass sections. The
+ *   latency is very low and the filters are cheap, but the phase response is
+ *   not linear.
+ */
+enum class OversamplingPhase
+{
+   Linear,
+   Minimum
+};
+
+/**
+ * @brief Runs a processing kernel at 2, 4 or 8 times the sample rate, e.g. to
+ * reduce the aliasing of saturation or other nonlinear stages. The signal is
+ * upsampled by a cascade of 2x half-band stages, processed by the kernel and
+ * downsampled by the same cascade. The half-band filters are evaluated in
+ * polyphase form, so no zero is ever multiplied. The FIR filters use SIMD dot
+ * products, the allpass filters process up to four channels at once, one per
+ * SIMD lane. All memory is allocated in Oversampler::prepare().
+ *
+ * Only the channels that the oversampler was prepared for are processed,
+ * further channels of a buffer are left untouched.
+ *
+ * @code
+ * _oversampler.prepare(2, maxFrames, 4, ImRt::OversamplingPhase::Linear);
+ * ...
+ * _oversampler.process(
+ *    out, numFrames,
+ *    [](ImRt::Buffer& buffer, uint32_t n) { saturate(buffer, n); }
+ * );
+ * @endcode
+ */
+class Oversampler
+{
+public:
+   /**
+    * @brief Prepares the oversampler and resets its state.
+    *
+    * @param numChannels The number of channels.
+    * @param maxFrames The maximum number of frames passed to
+    * Oversampler::process().
+    * @param factor The oversampling factor: 1, 2, 4 or 8.
+    * @param phase The filter type.
+    */
+   void prepare(
+      uint32_t numChannels, uint32_t maxFrames, uint32_t factor,
+      OversamplingPhase phase = OversamplingPhase::Linear
+   );
+
+   /**
+    * @brief Upsamples the buffer, processes the upsampled signal with the
+    * kernel and writes the downsampled result back to the buffer. Buffers
+    * longer than the maximum passed to Oversampler::prepare() are processed
+    * in chunks of the maximum, calling the kernel once per chunk.
+    *
+    * @param buffer The buffer to process in place.
+    * @param numFrames The number of frames to process.
+    * @param kernel A callable with the signature
+    * void(ImRt::Buffer& upsampled, uint32_t numUpsampledFrames).
+    */
+   template <typename Kernel>
+   void process(Buffer& buffer, uint32_t numFrames, Kernel&& kernel)
+   {
+      if (_stages.empty())
+      {
+         kernel(buffer, numFrames);
+         return;
+      }
+
+      for (uint32_t start = 0; start < numFrames; start += _maxFrames)
+      {
+         uint32_t n = std::min(_maxFrames, numFrames - start);
+         upsample(buffer, start, n);
+         kernel(_buffers.back(), n * _factor);
+         downsample(buffer, start, n);
+      }
+   }
+
+   /**
+    * @brief Returns the oversampling factor.
+    */
+   uint32_t factor() const;
+
+   /**
+    * @brief Returns the latency added by the up- and downsampling filters in
+    * samples at the original sample rate, rounded to the nearest integer. For
+    * minimum-phase filters this is the group delay at low frequencies.
+    */
+   uint32_t latency() const;
+
+   /**
+    * @brief Upsamples the buffer into the internal buffer at the highest rate.
+    * The number of frames must not exceed the maximum passed to
+    * Oversampler::prepare().
+    */
+   void upsample(const Buffer& buffer, uint32_t numFrames);
+
+   /**
+    * @brief Downsamples the internal buffer at the highest rate into the
+    * buffer. The number of frames must not exceed the maximum passed to
+    * Oversampler::prepare().
+    */
+   void downsample(Buffer& buffer, uint32_t numFrames);
+
+private:
+   class HalfbandFilter
+   {
+   public:
+      void prepare(OversamplingPhase phase, uint32_t stage);
+      void up(const float* in, float* out, uint32_t numFrames);
+      void down(const float* in, float* out, uint32_t numFrames);
+      double latency() const;
+
+      // Minimum phase: runs the filters of up to four channels at once. The
+      // unused lanes of in must point to valid samples, their results are
+      // discarded.
+      static void upLanes(
+         HalfbandFilter* filters, uint32_t numLanes, const float* const* in,
+         float* const* out, uint32_t numFrames
+      );
+      static void downLanes(
+         HalfbandFilter* filters, uint32_t numLanes, const float* const* in,
+         float* const* out, uint32_t numFrames
+      );
+
+   private:
+      OversamplingPhase _phase = OversamplingPhase::Linear;
+
+      // Linear phase: the non-zero taps of the FIR filter, reversed, and the
+      // delay lines holding each sample twice so that every window of the
+      // last _numTaps samples is contiguous.
+      std::vector<float> _taps;
+      uint32_t _numTaps = 0;
+      std::vector<float> _upLine, _evenLine, _oddLine;
+      uint32_t _upPos = 0, _downPos = 0;
+
+      // Minimum phase: allpass coefficients and states of both paths of the
+      // up- and the downsampler.
+      std::vector<float> _coefficients;
+      std::vector<float> _upStates, _downStates;
+   };
+
+   uint32_t _factor         = 1;
+   uint32_t _numChannels    = 0;
+   uint32_t _maxFrames      = 0;
+   OversamplingPhase _phase = OversamplingPhase::Linear;
+   double _latency          = 0.0;
+   std::vector<std::vector<HalfbandFilter>> _stages; // stage, channel
+   std::vector<Buffer> _buffers;                     // output of each stage
+
+   // Up- and downsample the frames of the buffer from the given offset on.
+   void upsample(const Buffer& buffer, uint32_t offset, uint32_t numFrames);
+   void downsample(Buffer& buffer, uint32_t offset, uint32_t numFrames);
+};
+
+} // namespace ImRt
@@ -1,6 +1,9 @@
 #include "imrt-params.h"
+#include <algorithm>
+#include <cassert>
 #include <cstdint>
 #include <memory>
+#include <thread>
 
 namespace ImRt {
 
@@ -9,14 +12,33 @@ namespace ImRt {
 /* ------------------------------------------------------ */
 
 ParameterLayout::ParameterLayout(
-   uint32_t id, std::string name, float min, float max, float init
+   uint32_t id, std::string name, float min, float max, float init,
+   ParameterCurve curve, float shape
 )
    : _id(id)
    , _name(name)
    , _min(min)
    , _max(max)
    , _init(init)
+   , _mapping(min, max, curve, shape)
 {
+   assert(init >= min && init <= max);
+   assert(_mapping.constrain(init) == init);
+}
+
+ParameterLayout::ParameterLayout(
+   uint32_t id, std::string name, std::vector<std::string> labels,
+   uint32_t init
+)
+   : _id(id)
+   , _name(name)
+   , _min(0.0f)
+   , _max(float(labels.size()) - 1.0f)
+   , _init(float(init))
+   , _mapping(_min, _max, ParameterCurve::Enum)
+   , _labels(std::move(labels))
+{
+   assert(init < _labels.size());
 }
 
 uint32_t ParameterLayout::id()
@@ -44,35 +66,70 @@ float ParameterLayout::init()
    return _init;
 }
 
+const ParameterMapping& ParameterLayout::mapping()
+{
+   return _mapping;
+}
+
+ParameterCurve ParameterLayout::curve()
+{
+   return _mapping.curve();
+}
+
+float ParameterLayout::toNormalized(float value)
+{
+   return _mapping.toNormalized(value);
+}
+
+float ParameterLayout::toPlain(float normalized)
+{
+   return _mapping.toPlain(normalized);
+}
+
+float ParameterLayout::constrain(float value)
+{
+   return _mapping.constrain(value);
+}
+
+const char* ParameterLayout::label(float value)
+{
+   if (_labels.empty())
+   {
+      return nullptr;
+   }
+   return _labels[size_t(constrain(value) - _min)].c_str();
+}
+
 /* ------------------------------------------------------ */
 /*                      dsp parameter                     */
 /* ------------------------------------------------------ */
 
 DspParameter::DspParameter(ParameterLayout layout)
-   : ParameterLayout(
-        layout.id(), layout.name(), layout.min(), layout.max(), layout.init()
-     )
+   : ParameterLayout(layout)
    , _value(layout.init())
 {
-   _fifo.reset(120 * sizeof(float));
+   _fifo.reset(120 * sizeof(Change));
 }
 
 void DspParameter::announceChange(float& newValue)
 {
-   _fifo.push(&newValue, sizeof(float));
+   announce(newValue, false);
+}
+
+void DspParameter::announceExternalChange(float newValue)
+{
+   announce(newValue, true);
+}
+
+void DspParameter::announce(float newValue, bool external)
+{
+   Change change { newValue, external, _stamp.fetch_add(1) + 1 };
+   _fifo.push(&change, sizeof(Change));
 }
 
 float DspParameter::updatedValue()
 {
-   _fifo.pop(
-      [this](const void* data, uint32_t size)
-      {
-         if (size == sizeof(float))
-         {
-            _value = *(float*)data;
-         }
-      }
-   );
+   popChange();
    return _value;
 }
 
@@ -81,14 +138,62 @@ float DspParameter::value()
    return _value;
 }
 
+float DspParameter::consume()
+{
+   updatedValue();
+
+   if (_externalChange)
+   {
+      _externalChange = false;
+      _feedback->push(id(), _feedbackSlot, _value);
+   }
+
+   return _value;
+}
+
+void DspParameter::overwriteValue(float newValue, uint64_t stamp)
+{
+   _value        = newValue;
+   _droppedStamp = std::max(_droppedStamp, stamp);
+
+   while (popChange())
+   {
+   }
+}
+
+uint64_t DspParameter::stamp() const
+{
+   return _stamp.load();
+}
+
+void DspParameter::setValue(float newValue)
+{
+   _value = newValue;
+}
+
+bool DspParameter::popChange()
+{
+   return _fifo.pop(
+      [this](const void* data, uint32_t size)
+      {
+         const Change* change = static_cast<const Change*>(data);
+         if (size != sizeof(Change) || change->stamp <= _droppedStamp)
+         {
+            return;
+         }
+
+         _value          = change->value;
+         _externalChange = _externalChange || change->external;
+      }
+   );
+}
+
 /* ------------------------------------------------------ */
 /*                      gui parameter                     */
 /* ------------------------------------------------------ */
 
 GuiParameter::GuiParameter(ParameterLayout layout)
-   : ParameterLayout(
-        layout.id(), layout.name(), layout.min(), layout.max(), layout.init()
-     )
+   : ParameterLayout(layout)
    , value(layout.init())
 {
 }
@@ -97,38 +202,240 @@ GuiParameter::GuiParameter(ParameterLayout layout)
 /*                     dsp parameters                     */
 /* ------------------------------------------------------ */
 
-void DspParameters::addParameter(ParameterLayout& layout)
+DspParameters::DspParameters()
+{
+   _feedback.reset(maxQueuedParameterChanges);
+   _table.publish(std::make_unique<ParameterTable>());
+}
+
+bool DspParameters::addParameter(ParameterLayout& layout)
 {
+   std::lock_guard<std::mutex> lock(_mutex);
+
    auto iterator = _params.find(layout.id());
-   assert(iterator == _params.end());
+   if (iterator != _params.end())
+   {
+      return false;
+   }
 
-   auto parameter = std::make_unique<DspParameter>(layout);
+   auto parameter       = std::make_shared<DspParameter>(layout);
+   parameter->_feedback = &_feedback;
    _params.insert_or_assign(layout.id(), std::move(parameter));
+
+   publishTable();
+   return true;
+}
+
+bool DspParameters::removeParameter(uint32_t paramId)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+
+   auto iterator = _params.find(paramId);
+   if (iterator == _params.end())
+   {
+      return false;
+   }
+
+   // Handles keep the parameter alive, but it does not take changes anymore.
+   iterator->second->_removed.store(true);
+   _params.erase(iterator);
+
+   publishTable();
+   return true;
+}
+
+uint64_t DspParameters::generation() const
+{
+   return _generation.load();
 }
 
 void DspParameters::announceChange(uint32_t paramId, float& newValue)
 {
+   std::lock_guard<std::mutex> lock(_mutex);
+
+   // the parameter may have been removed while the GUI was announcing
    auto iterator = _params.find(paramId);
-   assert(iterator != _params.end());
+   if (iterator != _params.end())
+   {
+      iterator->second->announceChange(newValue);
+   }
+}
+
+void DspParameters::announceExternalChanges(
+   const ParameterChange* changes, size_t numChanges
+)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
 
-   iterator->second->announceChange(newValue);
+   for (size_t i = 0; i < numChanges; ++i)
+   {
+      auto iterator = _params.find(changes[i].paramId);
+      if (iterator == _params.end())
+      {
+         continue;
+      }
+
+      auto param = iterator->second.get();
+      param->announceExternalChange(param->constrain(changes[i].value));
+   }
 }
 
 float DspParameters::updatedValue(uint32_t paramId)
 {
-   auto iterator = _params.find(paramId);
-   assert(iterator != _params.end());
+   DspParameter* param = find(*_table.acquire(), paramId);
+   assert(param != nullptr);
 
-   iterator->second->updatedValue();
-   return iterator->second->value();
+   return param->consume();
 }
 
 float DspParameters::value(uint32_t paramId)
 {
+   DspParameter* param = find(*_table.acquire(), paramId);
+   assert(param != nullptr);
+
+   return param->value();
+}
+
+ParameterHandle DspParameters::handle(uint32_t paramId)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+
    auto iterator = _params.find(paramId);
    assert(iterator != _params.end());
 
-   return iterator->second->value();
+   std::shared_ptr<DspParameter>& param = iterator->second;
+   if (!param->_bound)
+   {
+      param->_bound = true;
+      publishTable();
+   }
+   return ParameterHandle(param);
+}
+
+void DspParameters::updateAll()
+{
+   for (DspParameter* param : _table.acquire()->bound)
+   {
+      param->consume();
+   }
+}
+
+void DspParameters::setValue(uint32_t paramId, float newValue)
+{
+   DspParameter* param = find(*_table.acquire(), paramId);
+   if (param != nullptr)
+   {
+      param->setValue(newValue);
+      _feedback.push(paramId, param->_feedbackSlot, newValue);
+   }
+}
+
+void DspParameters::publishPreset(const Preset& preset)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+
+   int state = _presetState.load();
+   while (!((state == PresetIdle || state == PresetPending)
+            && _presetState.compare_exchange_weak(state, PresetWriting)))
+   {
+      std::this_thread::yield();
+      state = _presetState.load();
+   }
+
+   _presetChanges.clear();
+   for (auto& [id, param] : _params)
+   {
+      float value = param->init();
+      if (preset.value(id, value))
+      {
+         _presetChanges.push_back(
+            { id, param->constrain(value), param->stamp() }
+         );
+      }
+   }
+
+   _presetState.store(PresetPending);
+}
+
+void DspParameters::applyPublishedPreset()
+{
+   int state = PresetPending;
+   if (!_presetState.compare_exchange_strong(state, PresetApplying))
+   {
+      return;
+   }
+
+   const ParameterTable& table = *_table.acquire();
+   for (const PresetChange& change : _presetChanges)
+   {
+      // parameters removed after publishing the preset are skipped
+      DspParameter* param = find(table, change.paramId);
+      if (param != nullptr)
+      {
+         param->overwriteValue(change.value, change.stamp);
+         _feedback.push(change.paramId, param->_feedbackSlot, param->_value);
+      }
+   }
+
+   _presetState.store(PresetIdle);
+}
+
+void DspParameters::publishTable()
+{
+   auto table = std::make_unique<ParameterTable>();
+   table->params.reserve(_params.size());
+   for (auto& [id, param] : _params)
+   {
+      table->params.push_back(param);
+      if (param->_bound)
+      {
+         table->bound.push_back(param.get());
+      }
+   }
+
+   _table.publish(std::move(table));
+   _generation.fetch_add(1);
+}
+
+bool DspParameters::popChange(uint32_t& paramId, float& value)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+
+   while (_feedback.pop(paramId))
+   {
+      auto iterator = _params.find(paramId);
+      if (iterator == _params.end())
+      {
+         continue;
+      }
+
+      // A parameter that was removed and added again while its ID was
+      // queued has a fresh slot, which is not queued.
+      ParameterFeedback::Slot& slot = iterator->second->_feedbackSlot;
+      if (!slot.queued.exchange(false))
+      {
+         continue;
+      }
+      value = slot.value.load();
+      return true;
+   }
+
+   _table.reclaim();
+   return false;
+}
+
+DspParameter* DspParameters::find(const ParameterTable& table, uint32_t paramId)
+{
+   auto iterator = std::lower_bound(
+      table.params.begin(), table.params.end(), paramId,
+      [](const std::shared_ptr<DspParameter>& param, uint32_t id)
+      { return param->id() < id; }
+   );
+   if (iterator == table.params.end() || (*iterator)->id() != paramId)
+   {
+      return nullptr;
+   }
+   return iterator->get();
 }
 
 /* ------------------------------------------------------ */
@@ -136,25 +443,104 @@ float DspParameters::value(uint32_t paramId)
 /* ------------------------------------------------------ */
 
 GuiParameters::GuiParameters(const DspParameters& audioParameters)
+   : _source(audioParameters)
 {
-   for (auto iterator = audioParameters._params.begin();
-        iterator != audioParameters._params.end(); iterator++)
+   update();
+}
+
+bool GuiParameters::update()
+{
+   uint64_t generation = _source.generation();
+   if (generation == _generation)
    {
-      auto dspParam = iterator->second.get();
-      auto guiParam = std::make_unique<GuiParameter>(ParameterLayout(
-         dspParam->id(), dspParam->name(), dspParam->min(), dspParam->max(),
-         dspParam->init()
-      ));
-      _params.insert_or_assign(iterator->first, std::move(guiParam));
+      return false;
    }
+
+   std::lock_guard<std::mutex> lock(_source._mutex);
+   _generation = _source.generation();
+
+   for (auto iterator = _params.begin(); iterator != _params.end();)
+   {
+      if (_source._params.count(iterator->first) == 0)
+      {
+         iterator->second->removed = true;
+         iterator = _params.erase(iterator);
+      }
+      else
+      {
+         ++iterator;
+      }
+   }
+
+   for (auto& [id, dspParam] : _source._params)
+   {
+      if (_params.count(id) == 0)
+      {
+         auto guiParam = std::make_shared<GuiParameter>(*dspParam);
+         _params.insert_or_assign(id, std::move(guiParam));
+      }
+   }
+   return true;
 }
 
 GuiParameter* GuiParameters::byId(uint32_t paramId)
 {
+   GuiParameter* param = find(paramId);
+   if (param == nullptr && update())
+   {
+      param = find(paramId);
+   }
+   assert(param != nullptr);
+
+   return param;
+}
+
+std::shared_ptr<GuiParameter> GuiParameters::share(uint32_t paramId)
+{
+   if (_params.count(paramId) == 0)
+   {
+      update();
+   }
+
    auto iterator = _params.find(paramId);
    assert(iterator != _params.end());
 
+   return iterator->second;
+}
+
+GuiParameter* GuiParameters::find(uint32_t paramId)
+{
+   auto iterator = _params.find(paramId);
+   if (iterator == _params.end())
+   {
+      return nullptr;
+   }
    return iterator->second.get();
 }
 
+Preset GuiParameters::preset(std::string name)
+{
+   Preset preset(name);
+   for (auto& [id, param] : _params)
+   {
+      preset.setValue(id, param->value);
+   }
+   return preset;
+}
+
+void GuiParameters::applyPreset(const Preset& preset)
+{
+   for (auto& v : preset.values())
+   {
+      auto iterator = _params.find(v.paramId);
+      if (iterator == _params.end())
+      {
+         continue;
+      }
+
+      auto param   = iterator->second.get();
+      param->value = param->constrain(v.value);
+   }
+}
+
 } // namespace ImRt
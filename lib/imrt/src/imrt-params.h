@@ -1,14 +1,22 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <cstring> // choc_...FIFO.h needs it
 
+#include <containers/choc_SingleReaderSingleWriterFIFO.h>
 #include <containers/choc_VariableSizeFIFO.h>
 
+#include "imrt-mapping.h"
+#include "imrt-presets.h"
+#include "imrt-rcu.h"
+
 namespace ImRt {
 
 /* -------------------------------------------------------------------------- */
@@ -35,9 +43,32 @@ public:
     * @param min The minimum value that the parameter can have.
     * @param max The maximum value that the parameter can have.
     * @param init The initial resp. default value for the parameter.
+    * @param curve The curve that maps normalized values, e.g. knob positions,
+    * to values of the parameter (cf. ParameterCurve).
+    * @param shape The curvature of exponential curves or the number of steps
+    * of stepped curves.
+    *
+    * The layout is validated when it is constructed, i.e. an invalid range or
+    * curve or an initial value outside of the range trigger an assertion.
     */
    ParameterLayout(
-      uint32_t id, std::string name, float min, float max, float init
+      uint32_t id, std::string name, float min, float max, float init,
+      ParameterCurve curve = ParameterCurve::Linear, float shape = 0.0f
+   );
+
+   /**
+    * @brief Constructs a new parameter layout for a choice between labeled
+    * options, e.g. filter types. The value of the parameter is the index of
+    * the chosen label.
+    *
+    * @param id A unique ID used to identify the parameter.
+    * @param name The name displayed in the GUI widgets of the parameter.
+    * @param labels The labels of the options. There must be at least two.
+    * @param init The index of the initial resp. default option.
+    */
+   ParameterLayout(
+      uint32_t id, std::string name, std::vector<std::string> labels,
+      uint32_t init = 0
    );
    ParameterLayout() = delete;
 
@@ -66,10 +97,140 @@ public:
     */
    float init();
 
+   /**
+    * @brief Returns the mapping between normalized and plain values of the
+    * parameter, e.g. to prepare a MappingTable.
+    */
+   const ParameterMapping& mapping();
+
+   /**
+    * @brief Returns the curve of the parameter.
+    */
+   ParameterCurve curve();
+
+   /**
+    * @brief Converts a value of the parameter to a normalized value from 0 to
+    * 1 according to the curve of the parameter.
+    */
+   float toNormalized(float value);
+
+   /**
+    * @brief Converts a normalized value from 0 to 1 to a value of the
+    * parameter according to the curve of the parameter.
+    */
+   float toPlain(float normalized);
+
+   /**
+    * @brief Clamps a value to the range of the parameter and snaps it to the
+    * nearest step of stepped and enum parameters.
+    */
+   float constrain(float value);
+
+   /**
+    * @brief Returns the label of the option with the given value of an enum
+    * parameter or nullptr if the parameter has no labels.
+    */
+   const char* label(float value);
+
 protected:
    const uint32_t _id;
    const std::string _name;
    const float _min, _max, _init;
+   const ParameterMapping _mapping;
+   const std::vector<std::string> _labels;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                   PARAMETER CHANGE                                         */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A change of a parameter value, e.g. one of a batch of changes
+ * received from a remote control surface (cf.
+ * DspParameters::announceExternalChanges()).
+ */
+struct ParameterChange
+{
+   uint32_t paramId;
+   float value;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                   PARAMETER FEEDBACK                                       */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The number of parameters whose changes by the DSP thread can be
+ * queued for the GUI thread at the same time (cf. ParameterFeedback).
+ */
+constexpr uint32_t maxQueuedParameterChanges = 4096;
+
+/**
+ * @brief A lock-free channel through which the DSP thread reports parameter
+ * values it changed itself (e.g. by automation) to the GUI thread. Each
+ * parameter has a slot holding its latest value. The ID of a parameter is
+ * queued only if its slot is not queued already, so repeated changes of a
+ * parameter are coalesced into a single entry until the GUI thread has
+ * received them. The slots are owned by the parameters, so parameters can be
+ * added and removed while the channel is in use.
+ */
+class ParameterFeedback
+{
+public:
+   /**
+    * @brief The latest value of a parameter and whether its ID is queued.
+    */
+   struct Slot
+   {
+      std::atomic<float> value { 0.0f };
+      std::atomic<bool> queued { false };
+   };
+
+   /**
+    * @brief Allocates the queue. This method must not be called while one of
+    * the other methods is in use.
+    *
+    * @param capacity The number of parameters whose changes can be queued at
+    * the same time.
+    */
+   void reset(uint32_t capacity)
+   {
+      _queue.reset(capacity);
+   }
+
+   /**
+    * @brief Stores the new value of a parameter and queues its ID unless it
+    * is already queued. If the queue is full, the change is reported with
+    * the next change of the parameter. This method never blocks and does not
+    * allocate memory. It must only be called by the DSP thread.
+    *
+    * @param paramId The ID of the parameter.
+    * @param slot The slot of the parameter.
+    * @param value The new value of the parameter.
+    */
+   void push(uint32_t paramId, Slot& slot, float value)
+   {
+      slot.value.store(value);
+      if (!slot.queued.exchange(true) && !_queue.push(paramId))
+      {
+         slot.queued.store(false);
+      }
+   }
+
+   /**
+    * @brief Pops the ID of a changed parameter. The caller has to clear the
+    * queued flag of the slot before it reads the value. This method must only
+    * be called by the GUI thread.
+    *
+    * @return false if no change is queued.
+    */
+   bool pop(uint32_t& paramId)
+   {
+      return _queue.pop(paramId);
+   }
+
+private:
+   choc::fifo::SingleReaderSingleWriterFIFO<uint32_t> _queue;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -85,6 +246,9 @@ protected:
  */
 class DspParameter : public ParameterLayout
 {
+   friend class DspParameters;
+   friend class ParameterHandle;
+
 public:
    /**
     * @brief Constructs a new DSP parameter object based on a ParameterLayout.
@@ -105,6 +269,16 @@ public:
     */
    void announceChange(float& newValue);
 
+   /**
+    * @brief Announces a change like DspParameter::announceChange(), but marks
+    * it as not originating from the GUI. When the DSP thread consumes the
+    * change, the new value is reported back to the GUI (cf.
+    * DspParameters::receiveChanges()).
+    *
+    * @param newValue The value to which the parameter value should change.
+    */
+   void announceExternalChange(float newValue);
+
    /**
     * @brief Updates a possible DspParameter value change by consuming the
     * value from the FIFO to which Dsp::announceChange()
@@ -120,9 +294,122 @@ public:
     */
    float value();
 
+   /**
+    * @brief Sets the value of the DspParameter directly, e.g. to apply a
+    * preset, and drops the changes that have been announced before the given
+    * stamp. Changes announced later are still applied, so an announcement
+    * racing with a preset is not lost. This must only be called by the
+    * thread that consumes the announced changes (typically the DSP thread).
+    *
+    * @param newValue The new value.
+    * @param stamp The stamp of the last change to drop (cf.
+    * DspParameter::stamp()).
+    */
+   void overwriteValue(float newValue, uint64_t stamp);
+
+   /**
+    * @brief Returns the stamp of the most recently announced change. Every
+    * announcement increments the stamp, so it tells the changes announced
+    * up to now from later ones.
+    */
+   uint64_t stamp() const;
+
+   /**
+    * @brief Sets the value of the DspParameter directly without consuming
+    * announced changes, e.g. when applying automation. This must only be
+    * called by the thread that consumes the announced changes (typically the
+    * DSP thread).
+    */
+   void setValue(float newValue);
+
 private:
    float _value;
    choc::fifo::VariableSizeFIFO _fifo;
+   std::atomic<uint64_t> _stamp { 0 };
+   uint64_t _droppedStamp = 0; // changes up to this stamp are dropped
+   ParameterFeedback::Slot _feedbackSlot;
+   ParameterFeedback* _feedback = nullptr;
+   bool _externalChange         = false;
+   bool _bound                  = false; // guarded by the DspParameters
+   std::atomic<bool> _removed { false };
+
+   struct Change
+   {
+      float value;
+      bool external;
+      uint64_t stamp;
+   };
+
+   void announce(float newValue, bool external);
+   bool popChange();
+
+   float consume();
+};
+
+/* -------------------------------------------------------------------------- */
+/*                     PARAMETER HANDLE                                       */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A reference to a DspParameter that is resolved once by
+ * DspParameters::handle(), e.g. in the constructor of the processor, so that
+ * Dsp::process() can read and update the parameter without looking up its ID.
+ * The handle shares the ownership of the parameter, so it stays valid when
+ * the parameter is removed from the DspParameters collection. Dsp::process()
+ * can check ParameterHandle::removed() to stop using it. Since the last
+ * handle may delete the parameter, handles must not be released by the DSP
+ * thread.
+ */
+class ParameterHandle
+{
+   friend class DspParameters;
+
+public:
+   ParameterHandle() = default;
+
+   /**
+    * @brief Consumes the changes announced for the parameter like
+    * DspParameters::updatedValue() and returns the new value.
+    */
+   float updatedValue()
+   {
+      return _param->consume();
+   }
+
+   /**
+    * @brief Returns the value of the parameter as of the last update, e.g. by
+    * DspParameters::updateAll().
+    */
+   float value() const
+   {
+      return _param->_value;
+   }
+
+   /**
+    * @brief Returns the ID of the parameter.
+    */
+   uint32_t id() const
+   {
+      return _param->id();
+   }
+
+   /**
+    * @brief Returns true once the parameter has been removed from the
+    * DspParameters collection. Changes are not announced to a removed
+    * parameter anymore, so its value stays as it is.
+    */
+   bool removed() const
+   {
+      return _param->_removed.load(std::memory_order_relaxed);
+   }
+
+private:
+   ParameterHandle(std::shared_ptr<DspParameter> param)
+      : _param(std::move(param))
+   {
+   }
+
+   std::shared_ptr<DspParameter> _param;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -153,6 +440,13 @@ struct GuiParameter : public ParameterLayout
     * @brief The current value of the GUI parameter.
     */
    float value;
+
+   /**
+    * @brief Set by GuiParameters::update() when the parameter has been
+    * removed. Widgets keep the parameter alive (cf. GuiParameters::share()),
+    * but do not paint it anymore.
+    */
+   bool removed = false;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -162,21 +456,51 @@ struct GuiParameter : public ParameterLayout
 /**
  * @brief A collection of DspParameter objects that typically is owned by the
  * Dsp<> object.
+ *
+ * Parameters can be added and removed at any time, also while the stream is
+ * running, e.g. when a plugin is loaded. The collection is guarded by a mutex
+ * on the side of the GUI and the other announcing threads. Every change
+ * builds a new parameter table, i.e. a list of the parameters sorted by ID,
+ * and publishes it to the DSP thread as an Rcu object, so the DSP thread
+ * neither locks nor allocates. Replaced tables and removed parameters are
+ * deleted by the GUI thread in receiveChanges() once the DSP thread has moved
+ * on. The GuiParameters pick up the changes by comparing the generation of
+ * the collection (cf. GuiParameters::update()).
  */
 class DspParameters
 {
    friend class GuiParameters;
 
 public:
+   DspParameters();
+
    /**
     * @brief Creates a new DspParameter with the given ParameterLayout and
     * adds this parameter to the DspParameters collection managed by the Dsp
-    * object.
+    * object. This method must not be called from the DSP thread.
     *
     * @param layout The skeleton for the new DSP parameter consisting of an
     * ID, a name, a maximum, minimum and initial value.
+    * @return false if the collection has a parameter with the same ID.
     */
-   void addParameter(ParameterLayout& layout);
+   bool addParameter(ParameterLayout& layout);
+
+   /**
+    * @brief Removes a DspParameter from the collection. Changes announced but
+    * not consumed are dropped. Handles to the parameter keep it alive and
+    * report it as removed (cf. ParameterHandle::removed()). This method must
+    * not be called from the DSP thread.
+    *
+    * @param paramId The ID of the DspParameter.
+    * @return false if the collection has no parameter with the ID.
+    */
+   bool removeParameter(uint32_t paramId);
+
+   /**
+    * @brief Returns a number that changes whenever a parameter is added or
+    * removed.
+    */
+   uint64_t generation() const;
 
    /**
     * @brief Announces a change of a parameter value by pushing the new value to
@@ -189,25 +513,164 @@ public:
     */
    void announceChange(uint32_t paramId, float& newValue);
 
+   /**
+    * @brief Announces a batch of changes that do not originate from the GUI
+    * (cf. DspParameter::announceExternalChange()). The values are constrained
+    * to the parameter ranges and steps (cf. ParameterLayout::constrain()).
+    * Changes of unknown parameters are ignored.
+    *
+    * @param changes The changes to announce.
+    * @param numChanges The number of changes.
+    */
+   void
+   announceExternalChanges(const ParameterChange* changes, size_t numChanges);
+
    /**
     * @brief Updates a possible DspParameter value change by consuming the
     * value from the FIFO to which announceChange()
     * pushes. The new value of the DspParameter can be obtained by calling the
-    * parameterValue() method.
+    * parameterValue() method. This method must only be called by the DSP
+    * thread.
     *
     * @param paramId The ID of the parameter whose value could have changed.
     */
    float updatedValue(uint32_t paramId);
 
    /**
-    * @brief Returns the value of a DspParameter.
+    * @brief Returns the value of a DspParameter. This method must only be
+    * called by the DSP thread.
     *
     * @param paramId The ID of the DspParameter.
     */
    float value(uint32_t paramId);
 
+   /**
+    * @brief Returns a handle to a DspParameter and binds it, so that its
+    * changes are consumed by updateAll(). The parameter must exist. This
+    * method must not be called from the DSP thread.
+    *
+    * @param paramId The ID of the DspParameter.
+    */
+   ParameterHandle handle(uint32_t paramId);
+
+   /**
+    * @brief Consumes the announced changes of all parameters bound by
+    * handle() in one pass, so ParameterHandle::value() returns the new
+    * values. It is called by the Dsp<> object at the beginning of every
+    * audio block.
+    */
+   void updateAll();
+
+   /**
+    * @brief Sets the value of a DspParameter directly (cf.
+    * DspParameter::setValue()) and reports the change to the GUI (cf.
+    * receiveChanges()). Unknown parameter IDs are ignored. This method must
+    * only be called by the DSP thread.
+    *
+    * @param paramId The ID of the DspParameter.
+    * @param newValue The new value of the DspParameter.
+    */
+   void setValue(uint32_t paramId, float newValue);
+
+   /**
+    * @brief Hands the values of a preset over to the DSP thread as one batch.
+    * The values are constrained to the parameter ranges and steps and copied
+    * into storage here, so the DSP thread only has to copy them when it calls
+    * applyPublishedPreset(). A preset that has been published but not yet
+    * applied is replaced. Parameters not contained in the preset keep their
+    * values. This method must not be called from the DSP thread. It may have
+    * to briefly spin-wait while the DSP thread applies a preset.
+    *
+    * @param preset The preset whose values should be applied.
+    */
+   void publishPreset(const Preset& preset);
+
+   /**
+    * @brief Applies a preset published by publishPreset(), if there is one, to
+    * all parameters at once. Changes announced before the preset was
+    * published are dropped, so no parameter keeps a stale value, while
+    * changes announced after publishing are applied on top of the preset.
+    * This method never
+    * blocks and does not allocate memory. It is called by the Dsp<> object at
+    * the beginning of every audio block.
+    */
+   void applyPublishedPreset();
+
+   /**
+    * @brief Calls the given function with the ID and the new value of every
+    * parameter that has been changed by the DSP thread (cf. setValue())
+    * since the last call. Multiple changes of a parameter are coalesced, so
+    * only the latest value is reported. Changes of removed parameters are
+    * skipped. Afterwards the parameter tables the DSP thread does not use
+    * anymore are deleted. This method must only be called by the GUI thread.
+    *
+    * @param function A callable with the signature
+    * void(uint32_t paramId, float value).
+    */
+   template <typename Function>
+   void receiveChanges(Function&& function)
+   {
+      uint32_t paramId;
+      float value;
+      while (popChange(paramId, value))
+      {
+         function(paramId, value);
+      }
+   }
+
+   /**
+    * @brief Calls the given function for every DspParameter of the collection
+    * in the order of their IDs, e.g. to set up a remote control surface. The
+    * collection is locked meanwhile, so the function must not add or remove
+    * parameters.
+    *
+    * @param function A callable with the signature void(DspParameter&).
+    */
+   template <typename Function>
+   void forEach(Function&& function)
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto& [id, param] : _params)
+      {
+         function(*param);
+      }
+   }
+
 private:
-   std::map<uint32_t, std::unique_ptr<DspParameter>> _params;
+   struct ParameterTable
+   {
+      std::vector<std::shared_ptr<DspParameter>> params; // sorted by ID
+      std::vector<DspParameter*> bound;
+   };
+
+   mutable std::mutex _mutex; // guards the parameters and their bound flags
+   std::map<uint32_t, std::shared_ptr<DspParameter>> _params;
+   std::atomic<uint64_t> _generation { 0 };
+   Rcu<ParameterTable> _table;
+
+   ParameterFeedback _feedback;
+
+   enum PresetState
+   {
+      PresetIdle,
+      PresetWriting,
+      PresetPending,
+      PresetApplying
+   };
+
+   struct PresetChange
+   {
+      uint32_t paramId;
+      float value;
+      uint64_t stamp; // of the last change announced before publishing
+   };
+
+   std::vector<PresetChange> _presetChanges;
+   std::atomic<int> _presetState { PresetIdle };
+
+   void publishTable();
+   bool popChange(uint32_t& paramId, float& value);
+   static DspParameter* find(const ParameterTable& table, uint32_t paramId);
 };
 
 /* -------------------------------------------------------------------------- */
@@ -227,18 +690,63 @@ public:
     * layouts of the DspParameters that are given in the constructor argument.
     *
     * @param audioParameters The collection of DSP Parameters whose parameter
-    * layouts are used as a blueprint for the GUI parameters.
+    * layouts are used as a blueprint for the GUI parameters. It must outlive
+    * the GUI parameters.
     */
    GuiParameters(const DspParameters& audioParameters);
    GuiParameters() = delete;
 
    /**
-    * @brief Returns the GuiParameter identified by the given parameter ID.
+    * @brief Adds GUI parameters for the DSP parameters that have been added
+    * since the last update and deletes the GUI parameters of removed DSP
+    * parameters. GUI parameters shared with widgets are marked as removed
+    * and deleted along with the last widget (cf. GuiParameter::removed).
+    * The Gui<> calls this method before it paints a frame.
+    *
+    * @return true if parameters have been added or removed.
+    */
+   bool update();
+
+   /**
+    * @brief Returns the GuiParameter identified by the given parameter ID,
+    * updating the collection first if the parameter is not known yet. The
+    * parameter must exist.
     */
    GuiParameter* byId(uint32_t paramId);
 
+   /**
+    * @brief Returns the GuiParameter identified by the given parameter ID like
+    * GuiParameters::byId(), but shares its ownership, so a widget can keep
+    * it beyond the removal of the parameter.
+    */
+   std::shared_ptr<GuiParameter> share(uint32_t paramId);
+
+   /**
+    * @brief Returns the GuiParameter identified by the given parameter ID or
+    * nullptr if the collection has no such parameter.
+    */
+   GuiParameter* find(uint32_t paramId);
+
+   /**
+    * @brief Captures the current values of all GUI parameters in a preset.
+    *
+    * @param name The name of the new preset.
+    */
+   Preset preset(std::string name = "");
+
+   /**
+    * @brief Sets the GUI parameter values to the values stored in the preset.
+    * The values are constrained to the parameter ranges and steps. Values of
+    * parameters that are unknown to the collection are ignored. Note that
+    * this does not announce the changes to the DSP parameters (cf.
+    * Gui::applyPreset()).
+    */
+   void applyPreset(const Preset& preset);
+
 private:
-   std::map<uint32_t, std::unique_ptr<GuiParameter>> _params;
+   const DspParameters& _source;
+   uint64_t _generation = 0;
+   std::map<uint32_t, std::shared_ptr<GuiParameter>> _params;
 };
 
 } // namespace ImRt
@@ -0,0 +1,266 @@
+#include "imrt-presets.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                    binary helpers                      */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const char presetMagic[4]     = { 'I', 'M', 'R', 'T' };
+   const uint32_t presetVersion  = 1;
+   const char presetTextHeader[] = "imrt-preset";
+
+   void writeUint32(std::vector<uint8_t>& data, uint32_t value)
+   {
+      for (int byte = 0; byte < 4; ++byte)
+      {
+         data.push_back(static_cast<uint8_t>(value >> (8 * byte)));
+      }
+   }
+
+   bool
+   readUint32(const std::vector<uint8_t>& data, size_t& pos, uint32_t& value)
+   {
+      if (data.size() - pos < 4)
+      {
+         return false;
+      }
+
+      value = 0;
+      for (int byte = 0; byte < 4; ++byte)
+      {
+         value |= static_cast<uint32_t>(data[pos++]) << (8 * byte);
+      }
+      return true;
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                         preset                         */
+/* ------------------------------------------------------ */
+
+Preset::Preset(std::string name)
+   : _name(name)
+{
+}
+
+const char* Preset::name() const
+{
+   return _name.c_str();
+}
+
+void Preset::setValue(uint32_t paramId, float value)
+{
+   auto iterator = std::lower_bound(
+      _values.begin(), _values.end(), paramId,
+      [](const PresetValue& v, uint32_t id) { return v.paramId < id; }
+   );
+
+   if (iterator != _values.end() && iterator->paramId == paramId)
+   {
+      iterator->value = value;
+   }
+   else
+   {
+      _values.insert(iterator, { paramId, value });
+   }
+}
+
+bool Preset::value(uint32_t paramId, float& value) const
+{
+   auto iterator = std::lower_bound(
+      _values.begin(), _values.end(), paramId,
+      [](const PresetValue& v, uint32_t id) { return v.paramId < id; }
+   );
+
+   if (iterator == _values.end() || iterator->paramId != paramId)
+   {
+      return false;
+   }
+
+   value = iterator->value;
+   return true;
+}
+
+const std::vector<PresetValue>& Preset::values() const
+{
+   return _values;
+}
+
+std::vector<uint8_t> Preset::toBinary() const
+{
+   std::vector<uint8_t> data;
+   data.reserve(16 + _name.size() + 8 * _values.size());
+
+   data.insert(data.end(), presetMagic, presetMagic + 4);
+   writeUint32(data, presetVersion);
+
+   writeUint32(data, static_cast<uint32_t>(_name.size()));
+   data.insert(data.end(), _name.begin(), _name.end());
+
+   writeUint32(data, static_cast<uint32_t>(_values.size()));
+   for (auto& v : _values)
+   {
+      uint32_t bits;
+      std::memcpy(&bits, &v.value, sizeof(float));
+
+      writeUint32(data, v.paramId);
+      writeUint32(data, bits);
+   }
+
+   return data;
+}
+
+bool Preset::fromBinary(const std::vector<uint8_t>& data)
+{
+   if (data.size() < 4 || std::memcmp(data.data(), presetMagic, 4) != 0)
+   {
+      return false;
+   }
+
+   size_t pos = 4;
+   uint32_t version, nameSize, numValues;
+
+   if (!readUint32(data, pos, version) || version != presetVersion)
+   {
+      return false;
+   }
+
+   if (!readUint32(data, pos, nameSize) || data.size() - pos < nameSize)
+   {
+      return false;
+   }
+   std::string name(data.begin() + pos, data.begin() + pos + nameSize);
+   pos += nameSize;
+
+   if (!readUint32(data, pos, numValues)
+       || (data.size() - pos) / 8 < numValues)
+   {
+      return false;
+   }
+
+   Preset preset(name);
+   for (uint32_t i = 0; i < numValues; ++i)
+   {
+      uint32_t paramId, bits;
+      if (!readUint32(data, pos, paramId) || !readUint32(data, pos, bits))
+      {
+         return false;
+      }
+
+      float value;
+      std::memcpy(&value, &bits, sizeof(float));
+      preset.setValue(paramId, value);
+   }
+
+   *this = std::move(preset);
+   return true;
+}
+
+std::string Preset::toText() const
+{
+   std::ostringstream text;
+   text.precision(9);
+
+   text << presetTextHeader << " " << presetVersion << "\n";
+   text << "name " << _name << "\n";
+   for (auto& v : _values)
+   {
+      text << v.paramId << " " << v.value << "\n";
+   }
+
+   return text.str();
+}
+
+bool Preset::fromText(const std::string& text)
+{
+   std::istringstream lines(text);
+   std::string line;
+
+   uint32_t version = 0;
+   if (!std::getline(lines, line) || line.compare(0, 11, presetTextHeader) != 0
+       || std::sscanf(line.c_str() + 11, "%u", &version) != 1
+       || version != presetVersion)
+   {
+      return false;
+   }
+
+   Preset preset;
+   while (std::getline(lines, line))
+   {
+      if (line.empty() || line[0] == '#')
+      {
+         continue;
+      }
+
+      if (line.compare(0, 5, "name ") == 0)
+      {
+         preset._name = line.substr(5);
+         continue;
+      }
+
+      std::istringstream fields(line);
+      uint32_t paramId;
+      float value;
+      if (!(fields >> paramId >> value))
+      {
+         return false;
+      }
+      preset.setValue(paramId, value);
+   }
+
+   *this = std::move(preset);
+   return true;
+}
+
+bool Preset::save(const std::string& path, bool binary) const
+{
+   std::ofstream file(path, std::ios::binary);
+   if (!file)
+   {
+      return false;
+   }
+
+   if (binary)
+   {
+      auto data = toBinary();
+      file.write(reinterpret_cast<const char*>(data.data()), data.size());
+   }
+   else
+   {
+      file << toText();
+   }
+
+   return static_cast<bool>(file);
+}
+
+bool Preset::load(const std::string& path)
+{
+   std::ifstream file(path, std::ios::binary);
+   if (!file)
+   {
+      return false;
+   }
+
+   std::vector<uint8_t> data(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()
+   );
+
+   if (data.size() >= 4 && std::memcmp(data.data(), presetMagic, 4) == 0)
+   {
+      return fromBinary(data);
+   }
+
+   return fromText(std::string(data.begin(), data.end()));
+}
+
+} // namespace ImRt
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                         PRESET VALUE                                       */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The value of a single parameter stored in a Preset.
+ */
+struct PresetValue
+{
+   uint32_t paramId;
+   float value;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                            PRESET                                          */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A named snapshot of parameter values. A preset can be captured from
+ * the GuiParameters, saved to and loaded from a binary or a text file and
+ * applied to the GUI and the DSP as a whole (cf. Gui::applyPreset()).
+ *
+ * The binary format starts with the magic bytes "IMRT" followed by a format
+ * version, the name and the (ID, value) pairs, all stored little-endian. The
+ * text format is human readable:
+ *
+ * @code
+ * imrt-preset 1
+ * name My preset
+ * 1 0.75
+ * 2 -0.5
+ * @endcode
+ */
+class Preset
+{
+public:
+   /**
+    * @brief Constructs a new empty preset with the given name.
+    */
+   Preset(std::string name = "");
+
+   /**
+    * @brief Returns the name of the preset.
+    */
+   const char* name() const;
+
+   /**
+    * @brief Sets the value of the parameter with the given ID, adding the
+    * parameter to the preset if necessary.
+    */
+   void setValue(uint32_t paramId, float value);
+
+   /**
+    * @brief Looks up the value of the parameter with the given ID.
+    *
+    * @return false if the preset does not contain the parameter.
+    */
+   bool value(uint32_t paramId, float& value) const;
+
+   /**
+    * @brief Returns all parameter values of the preset sorted by parameter ID.
+    */
+   const std::vector<PresetValue>& values() const;
+
+   /**
+    * @brief Serializes the preset to the binary preset format.
+    */
+   std::vector<uint8_t> toBinary() const;
+
+   /**
+    * @brief Replaces the content of the preset with the given binary data.
+    *
+    * @return false if the data is not a valid binary preset. In this case the
+    * preset is left unchanged.
+    */
+   bool fromBinary(const std::vector<uint8_t>& data);
+
+   /**
+    * @brief Serializes the preset to the text preset format.
+    */
+   std::string toText() const;
+
+   /**
+    * @brief Replaces the content of the preset with the given text.
+    *
+    * @return false if the text is not a valid text preset. In this case the
+    * preset is left unchanged.
+    */
+   bool fromText(const std::string& text);
+
+   /**
+    * @brief Writes the preset to a file, either in the binary or in the text
+    * format.
+    *
+    * @return false if the file could not be written.
+    */
+   bool save(const std::string& path, bool binary = true) const;
+
+   /**
+    * @brief Reads the preset from a file. The format is detected
+    * automatically.
+    *
+    * @return false if the file could not be read or is not a valid preset.
+    */
+   bool load(const std::string& path);
+
+private:
+   std::string _name;
+   std::vector<PresetValue> _values;
+};
+
+} // namespace ImRt
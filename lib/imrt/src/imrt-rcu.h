@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                 READ-COPY-UPDATE POINTER                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief An object that is shared between a publishing thread (typically the
+ * GUI thread) and exactly one realtime reader thread (typically the DSP
+ * thread) in a read-copy-update fashion: The publisher never modifies a
+ * published object but builds a new one and publishes it with
+ * Rcu::publish(). The reader picks up the most recent object with
+ * Rcu::acquire() without locking or allocating. Replaced objects are deleted
+ * by the publisher in Rcu::reclaim() as soon as the reader does not use them
+ * anymore, so the reader never has to free memory.
+ *
+ * @tparam T The type of the shared object.
+ */
+template <typename T>
+class Rcu
+{
+public:
+   Rcu()                      = default;
+   Rcu(const Rcu&)            = delete;
+   Rcu& operator=(const Rcu&) = delete;
+
+   ~Rcu()
+   {
+      delete _current.load();
+      for (auto object : _retired)
+      {
+         delete object;
+      }
+   }
+
+   /**
+    * @brief Replaces the shared object. The previous object is retired and
+    * deleted by a later call of Rcu::reclaim() once the reader has moved on.
+    * This method must only be called by the publishing thread.
+    *
+    * @param object The new shared object, may be empty.
+    */
+   void publish(std::unique_ptr<T> object)
+   {
+      T* previous = _current.exchange(object.release());
+      if (previous != nullptr)
+      {
+         _retired.push_back(previous);
+      }
+      reclaim();
+   }
+
+   /**
+    * @brief Deletes all retired objects that are not used by the reader
+    * anymore. This method must only be called by the publishing thread.
+    */
+   void reclaim()
+   {
+      T* inUse = _inUse.load();
+
+      auto unused = std::partition(
+         _retired.begin(), _retired.end(),
+         [inUse](T* object) { return object == inUse; }
+      );
+      for (auto iterator = unused; iterator != _retired.end(); ++iterator)
+      {
+         delete *iterator;
+      }
+      _retired.erase(unused, _retired.end());
+   }
+
+   /**
+    * @brief Returns the most recently published object and marks it as being
+    * in use by the reader until the next call of this method. This method
+    * never blocks and must only be called by the reader thread.
+    */
+   T* acquire()
+   {
+      T* object = _current.load();
+      while (true)
+      {
+         _inUse.store(object);
+
+         T* current = _current.load();
+         if (current == object)
+         {
+            return object;
+         }
+         object = current;
+      }
+   }
+
+   /**
+    * @brief Returns the most recently published object. The object must only
+    * be accessed by the publishing thread.
+    */
+   T* current() const
+   {
+      return _current.load();
+   }
+
+private:
+   std::atomic<T*> _current { nullptr };
+   std::atomic<T*> _inUse { nullptr };
+   std::vector<T*> _retired;
+};
+
+} // namespace ImRt
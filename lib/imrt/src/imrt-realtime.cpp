@@ -0,0 +1,106 @@
+#include "imrt-realtime.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                   thread configuration                 */
+/* ------------------------------------------------------ */
+
+namespace {
+
+#if !defined(_WIN32)
+   bool setPriority(pthread_t thread, int priority)
+   {
+      sched_param param {};
+      param.sched_priority = priority;
+      return pthread_setschedparam(thread, SCHED_FIFO, &param) == 0;
+   }
+
+   bool setAffinity(pthread_t thread, const std::vector<int>& cores)
+   {
+#if defined(__linux__)
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (int core : cores)
+      {
+         CPU_SET(core, &set);
+      }
+      return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+#else
+      return false;
+#endif
+   }
+#endif
+
+} // namespace
+
+bool setRealtimePriority(int priority)
+{
+#if defined(_WIN32)
+   return false;
+#else
+   return setPriority(pthread_self(), priority);
+#endif
+}
+
+bool pinToCores(const std::vector<int>& cores)
+{
+#if defined(_WIN32)
+   return false;
+#else
+   return setAffinity(pthread_self(), cores);
+#endif
+}
+
+bool configureAudioThread(const RealtimeSettings& settings)
+{
+   bool success = true;
+   if (settings.scheduleRealtime)
+   {
+      success = setRealtimePriority(settings.priority) && success;
+   }
+   if (!settings.audioCores.empty())
+   {
+      success = pinToCores(settings.audioCores) && success;
+   }
+   return success;
+}
+
+bool configureWorkerThread(
+   std::thread& thread, const RealtimeSettings& settings
+)
+{
+#if defined(_WIN32)
+   return false;
+#else
+   bool success = true;
+   if (settings.workerPriority > 0)
+   {
+      success = setPriority(thread.native_handle(), settings.workerPriority)
+         && success;
+   }
+   if (!settings.workerCores.empty())
+   {
+      success = setAffinity(thread.native_handle(), settings.workerCores)
+         && success;
+   }
+   return success;
+#endif
+}
+
+bool lockMemory()
+{
+#if defined(_WIN32)
+   return false;
+#else
+   return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+#endif
+}
+
+} // namespace ImRt
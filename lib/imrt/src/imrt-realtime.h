@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#endif
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                       REALTIME SETTINGS                                    */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Settings for the threads that process audio (cf. DspSettings).
+ *
+ * - The audio callback thread is scheduled with SCHED_FIFO at the given
+ *   priority and pinned to the given cores, so it is neither preempted by
+ *   normal threads nor migrated between cores. Worker threads of processors
+ *   can be configured the same way with configureWorkerThread().
+ * - Denormal numbers, which occur e.g. in decaying filter tails and are
+ *   extremely slow on many CPUs, are flushed to zero during the callback.
+ * - Locking the memory prevents page faults on the audio thread.
+ *
+ * Priorities and pinning need the corresponding privileges, e.g. an rtprio
+ * limit on Linux. If they are missing, the threads just keep their defaults.
+ */
+struct RealtimeSettings
+{
+   bool scheduleRealtime = true;
+   int priority          = 10; // SCHED_FIFO priority of the audio thread
+   int workerPriority    = 0;  // 0 keeps the default scheduling of workers
+   bool flushDenormals   = true;
+   bool lockMemory       = false;
+
+   std::vector<int> audioCores;  // empty means no pinning
+   std::vector<int> workerCores; // empty means no pinning
+};
+
+/**
+ * @brief Sets the scheduling of the calling thread to SCHED_FIFO with the
+ * given priority.
+ *
+ * @return false if the priority could not be set, e.g. due to missing
+ * privileges or on an unsupported platform.
+ */
+bool setRealtimePriority(int priority);
+
+/**
+ * @brief Pins the calling thread to the given CPU cores.
+ *
+ * @return false if the thread could not be pinned. Pinning is only supported
+ * on Linux.
+ */
+bool pinToCores(const std::vector<int>& cores);
+
+/**
+ * @brief Configures the calling thread as an audio thread according to the
+ * settings, i.e. sets its priority and pins it to the audio cores.
+ *
+ * @return false if any of the settings could not be applied.
+ */
+bool configureAudioThread(const RealtimeSettings& settings);
+
+/**
+ * @brief Configures a worker thread, e.g. one that computes the tail of a
+ * convolution, according to the settings, i.e. sets its priority to the
+ * worker priority and pins it to the worker cores.
+ *
+ * @return false if any of the settings could not be applied.
+ */
+bool configureWorkerThread(
+   std::thread& thread, const RealtimeSettings& settings
+);
+
+/**
+ * @brief Locks all current and future memory pages of the process into RAM.
+ *
+ * @return false if the memory could not be locked.
+ */
+bool lockMemory();
+
+/* -------------------------------------------------------------------------- */
+/*                        SCOPED DENORMALS                                    */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Sets the flush-to-zero and denormals-are-zero modes of the floating
+ * point unit of the calling thread for its lifetime and restores the previous
+ * modes when it is destroyed. On x86 this sets the FTZ and DAZ bits of the
+ * MXCSR register, on ARM the FZ bit of the FPCR or FPSCR register.
+ */
+class ScopedDenormals
+{
+public:
+   ScopedDenormals(bool enable = true)
+   {
+      if (!enable)
+      {
+         return;
+      }
+
+      _enabled = true;
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+      _previous = _mm_getcsr();
+      _mm_setcsr(static_cast<unsigned int>(_previous | 0x8040)); // FTZ, DAZ
+#elif defined(__aarch64__)
+      uint64_t fpcr;
+      asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+      _previous = fpcr;
+      asm volatile("msr fpcr, %0" : : "r"(fpcr | (1ull << 24))); // FZ
+#elif defined(__arm__) && defined(__ARM_FP)
+      uint32_t fpscr;
+      asm volatile("vmrs %0, fpscr" : "=r"(fpscr));
+      _previous = fpscr;
+      asm volatile("vmsr fpscr, %0" : : "r"(fpscr | (1u << 24))); // FZ
+#endif
+   }
+
+   ~ScopedDenormals()
+   {
+      if (!_enabled)
+      {
+         return;
+      }
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+      _mm_setcsr(static_cast<unsigned int>(_previous));
+#elif defined(__aarch64__)
+      asm volatile("msr fpcr, %0" : : "r"(_previous));
+#elif defined(__arm__) && defined(__ARM_FP)
+      asm volatile("vmsr fpscr, %0" : : "r"(uint32_t(_previous)));
+#endif
+   }
+
+   ScopedDenormals(const ScopedDenormals&)            = delete;
+   ScopedDenormals& operator=(const ScopedDenormals&) = delete;
+
+private:
+   bool _enabled      = false;
+   uint64_t _previous = 0;
+};
+
+} // namespace ImRt
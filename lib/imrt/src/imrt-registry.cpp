@@ -0,0 +1,61 @@
+#include "imrt-registry.h"
+#include <algorithm>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                    widget registry                     */
+/* ------------------------------------------------------ */
+
+void WidgetRegistry::watchParameter(uint32_t paramId)
+{
+   auto iterator
+      = std::lower_bound(_parameters.begin(), _parameters.end(), paramId);
+   if (iterator == _parameters.end() || *iterator != paramId)
+   {
+      _parameters.insert(iterator, paramId);
+   }
+   _dirty = true;
+}
+
+void WidgetRegistry::watchSource(std::function<bool()> hasNewData)
+{
+   _sources.push_back(std::move(hasNewData));
+   _dirty = true;
+}
+
+void WidgetRegistry::markDirty()
+{
+   _dirty = true;
+}
+
+void WidgetRegistry::parameterChanged(uint32_t paramId)
+{
+   if (std::binary_search(_parameters.begin(), _parameters.end(), paramId))
+   {
+      _dirty = true;
+   }
+}
+
+bool WidgetRegistry::needsFrame(bool inputPending)
+{
+   bool dirty = _dirty || inputPending;
+   for (size_t i = 0; !dirty && i < _sources.size(); ++i)
+   {
+      dirty = _sources[i]();
+   }
+   _dirty = false;
+
+   if (dirty)
+   {
+      _framesLeft = settleFrames;
+   }
+   if (_framesLeft == 0)
+   {
+      return false;
+   }
+   --_framesLeft;
+   return true;
+}
+
+} // namespace ImRt
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                        WIDGET REGISTRY                                     */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Tracks whether the content of a Gui is dirty, so that a Gui in
+ * retained mode (cf. GuiSettings::retained) renders frames only when
+ * something changed instead of rebuilding every widget at the refresh rate.
+ *
+ * The widgets register the parameters they show, so only changes of these
+ * parameters dirty the page. Widgets that show data published by the DSP,
+ * e.g. meters and scopes, are covered by sources, i.e. functions that return
+ * whether new data was published. Input events always dirty the page. After
+ * a change a few more frames are rendered, because ImGui needs them to settle
+ * hover and active states.
+ */
+class WidgetRegistry
+{
+public:
+   /**
+    * @brief Registers a parameter that is shown by a widget.
+    */
+   void watchParameter(uint32_t paramId);
+
+   /**
+    * @brief Registers a source of published data. It is polled on the GUI
+    * thread before each potential frame and returns true if new data is
+    * available, e.g. if a FrameRing is not empty.
+    */
+   void watchSource(std::function<bool()> hasNewData);
+
+   /**
+    * @brief Marks the page as dirty after a change the registry does not
+    * track itself.
+    */
+   void markDirty();
+
+   /**
+    * @brief Marks the page as dirty if the given parameter is shown by a
+    * widget.
+    */
+   void parameterChanged(uint32_t paramId);
+
+   /**
+    * @brief Returns whether the next frame must be rendered and clears the
+    * dirty state.
+    *
+    * @param inputPending Whether input events are waiting to be processed.
+    */
+   bool needsFrame(bool inputPending);
+
+private:
+   static constexpr uint32_t settleFrames = 3;
+
+   std::vector<uint32_t> _parameters; // sorted
+   std::vector<std::function<bool()>> _sources;
+   bool _dirty          = true;
+   uint32_t _framesLeft = 0;
+};
+
+} // namespace ImRt
@@ -0,0 +1,475 @@
+#include "imrt-regression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <sstream>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                    binary helpers                      */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const uint32_t wavPcm        = 1;
+   const uint32_t wavFloat      = 3;
+   const uint32_t wavExtensible = 0xfffe;
+
+   const uint32_t scriptVersion  = 1;
+   const char scriptTextHeader[] = "imrt-automation";
+   const uint32_t timingVersion  = 1;
+   const char timingTextHeader[] = "imrt-timing";
+
+   bool readFile(const std::string& path, std::vector<uint8_t>& data)
+   {
+      std::ifstream file(path, std::ios::binary);
+      if (!file)
+      {
+         return false;
+      }
+
+      using Iterator = std::istreambuf_iterator<char>;
+      data.assign(Iterator(file), Iterator());
+      return true;
+   }
+
+   bool writeFile(const std::string& path, const std::string& text)
+   {
+      std::ofstream file(path, std::ios::binary);
+      file << text;
+      return static_cast<bool>(file);
+   }
+
+   // Reads a little-endian unsigned integer of the given number of bytes.
+   uint32_t readLittleEndian(const uint8_t* data, int numBytes)
+   {
+      uint32_t value = 0;
+      for (int byte = 0; byte < numBytes; ++byte)
+      {
+         value |= static_cast<uint32_t>(data[byte]) << (8 * byte);
+      }
+      return value;
+   }
+
+   void writeLittleEndian(std::vector<uint8_t>& data, uint32_t value, int n)
+   {
+      for (int byte = 0; byte < n; ++byte)
+      {
+         data.push_back(static_cast<uint8_t>(value >> (8 * byte)));
+      }
+   }
+
+   float decodeSample(const uint8_t* data, uint32_t format, uint32_t bits)
+   {
+      if (format == wavFloat)
+      {
+         uint32_t sampleBits = readLittleEndian(data, 4);
+         float sample;
+         std::memcpy(&sample, &sampleBits, sizeof(float));
+         return sample;
+      }
+      if (bits == 16)
+      {
+         return int16_t(readLittleEndian(data, 2)) / 32768.0f;
+      }
+      // The 24 bit sample is sign-extended by shifting it to the top.
+      return int32_t(readLittleEndian(data, 3) << 8) / 2147483648.0f;
+   }
+
+   bool decodeWav(
+      const uint8_t* data, size_t size, uint32_t format, uint32_t numChannels,
+      uint32_t bits, Buffer& buffer
+   )
+   {
+      bool supported = (format == wavFloat && bits == 32)
+         || (format == wavPcm && (bits == 16 || bits == 24));
+      if (!supported || numChannels == 0)
+      {
+         return false;
+      }
+
+      uint32_t sampleSize = bits / 8;
+      uint32_t numFrames  = uint32_t(size / (sampleSize * numChannels));
+
+      buffer = Buffer(numChannels, numFrames);
+      for (uint32_t frame = 0; frame < numFrames; ++frame)
+      {
+         for (uint32_t channel = 0; channel < numChannels; ++channel)
+         {
+            const uint8_t* sample
+               = data + (size_t(frame) * numChannels + channel) * sampleSize;
+            buffer.getSample(channel, frame)
+               = decodeSample(sample, format, bits);
+         }
+      }
+      return true;
+   }
+
+   // Checks the header line of a text file, e.g. "imrt-timing 1".
+   bool
+   readTextHeader(std::istream& lines, const char* header, uint32_t version)
+   {
+      std::string line;
+      size_t length     = std::strlen(header);
+      uint32_t expected = 0;
+
+      return std::getline(lines, line) && line.compare(0, length, header) == 0
+         && std::sscanf(line.c_str() + length, "%u", &expected) == 1
+         && expected == version;
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                      signal files                      */
+/* ------------------------------------------------------ */
+
+bool loadWav(const std::string& path, Buffer& buffer, uint32_t& sampleRate)
+{
+   std::vector<uint8_t> data;
+   if (!readFile(path, data) || data.size() < 12
+       || std::memcmp(data.data(), "RIFF", 4) != 0
+       || std::memcmp(data.data() + 8, "WAVE", 4) != 0)
+   {
+      return false;
+   }
+
+   uint32_t format = 0, numChannels = 0, bits = 0;
+   bool hasFormat = false;
+
+   size_t pos = 12;
+   while (data.size() - pos >= 8)
+   {
+      const uint8_t* chunk = data.data() + pos;
+      size_t size          = readLittleEndian(chunk + 4, 4);
+      pos += 8;
+
+      // Streaming writers may leave the size of the last chunk too large.
+      size = std::min(size, data.size() - pos);
+
+      if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+      {
+         const uint8_t* fmt = data.data() + pos;
+         format             = readLittleEndian(fmt, 2);
+         numChannels        = readLittleEndian(fmt + 2, 2);
+         sampleRate         = readLittleEndian(fmt + 4, 4);
+         bits               = readLittleEndian(fmt + 14, 2);
+         if (format == wavExtensible && size >= 26)
+         {
+            format = readLittleEndian(fmt + 24, 2);
+         }
+         hasFormat = true;
+      }
+      else if (std::memcmp(chunk, "data", 4) == 0)
+      {
+         const uint8_t* samples = data.data() + pos;
+         return hasFormat
+            && decodeWav(samples, size, format, numChannels, bits, buffer);
+      }
+
+      pos += size + (size & 1);
+   }
+   return false;
+}
+
+bool saveWav(
+   const std::string& path, const Buffer& buffer, uint32_t sampleRate
+)
+{
+   uint32_t numChannels = buffer.getNumChannels();
+   uint32_t numFrames   = buffer.getNumFrames();
+   uint32_t dataSize    = 4 * numChannels * numFrames;
+
+   std::vector<uint8_t> data;
+   data.reserve(44 + dataSize);
+
+   data.insert(data.end(), { 'R', 'I', 'F', 'F' });
+   writeLittleEndian(data, 36 + dataSize, 4);
+   data.insert(data.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+   writeLittleEndian(data, 16, 4);
+   writeLittleEndian(data, wavFloat, 2);
+   writeLittleEndian(data, numChannels, 2);
+   writeLittleEndian(data, sampleRate, 4);
+   writeLittleEndian(data, 4 * numChannels * sampleRate, 4);
+   writeLittleEndian(data, 4 * numChannels, 2);
+   writeLittleEndian(data, 32, 2);
+   data.insert(data.end(), { 'd', 'a', 't', 'a' });
+   writeLittleEndian(data, dataSize, 4);
+
+   for (uint32_t frame = 0; frame < numFrames; ++frame)
+   {
+      for (uint32_t channel = 0; channel < numChannels; ++channel)
+      {
+         uint32_t bits;
+         std::memcpy(&bits, &buffer.getSample(channel, frame), sizeof(float));
+         writeLittleEndian(data, bits, 4);
+      }
+   }
+
+   std::ofstream file(path, std::ios::binary);
+   file.write(reinterpret_cast<const char*>(data.data()), data.size());
+   return static_cast<bool>(file);
+}
+
+/* ------------------------------------------------------ */
+/*                   automation scripts                   */
+/* ------------------------------------------------------ */
+
+std::unique_ptr<AutomationClip> loadAutomationScript(const std::string& path)
+{
+   std::vector<uint8_t> data;
+   if (!readFile(path, data))
+   {
+      return nullptr;
+   }
+
+   std::istringstream lines(std::string(data.begin(), data.end()));
+   if (!readTextHeader(lines, scriptTextHeader, scriptVersion))
+   {
+      return nullptr;
+   }
+
+   std::map<uint32_t, AutomationLane> lanes;
+   std::string line;
+   while (std::getline(lines, line))
+   {
+      if (line.empty() || line[0] == '#')
+      {
+         continue;
+      }
+
+      std::istringstream fields(line);
+      uint32_t frame, paramId;
+      float value;
+      if (!(fields >> frame >> paramId >> value))
+      {
+         return nullptr;
+      }
+      lanes.emplace(paramId, AutomationLane(paramId))
+         .first->second.add(frame, value);
+   }
+
+   std::vector<AutomationLane> clipLanes;
+   for (auto& [paramId, lane] : lanes)
+   {
+      clipLanes.push_back(std::move(lane));
+   }
+   return std::make_unique<AutomationClip>(std::move(clipLanes));
+}
+
+bool saveAutomationScript(const std::string& path, const AutomationClip& clip)
+{
+   std::ostringstream text;
+   text.precision(9);
+
+   text << scriptTextHeader << " " << scriptVersion << "\n";
+   for (auto& event : clip.events())
+   {
+      text << event.frame << " " << event.paramId << " " << event.value << "\n";
+   }
+
+   return writeFile(path, text.str());
+}
+
+/* ------------------------------------------------------ */
+/*                   signal comparison                    */
+/* ------------------------------------------------------ */
+
+SignalDifference compareSignals(const Buffer& signal, const Buffer& reference)
+{
+   SignalDifference difference;
+   difference.sameSize = signal.getNumChannels() == reference.getNumChannels()
+      && signal.getNumFrames() == reference.getNumFrames();
+
+   uint32_t numChannels
+      = std::min(signal.getNumChannels(), reference.getNumChannels());
+   uint32_t numFrames
+      = std::min(signal.getNumFrames(), reference.getNumFrames());
+
+   for (uint32_t channel = 0; channel < numChannels; ++channel)
+   {
+      for (uint32_t frame = 0; frame < numFrames; ++frame)
+      {
+         float error = std::abs(
+            signal.getSample(channel, frame)
+            - reference.getSample(channel, frame)
+         );
+         if (std::isnan(error))
+         {
+            error = std::numeric_limits<float>::infinity();
+         }
+
+         if (error > difference.maxError)
+         {
+            difference.maxError = error;
+            difference.channel  = channel;
+            difference.frame    = frame;
+         }
+      }
+   }
+   return difference;
+}
+
+/* ------------------------------------------------------ */
+/*                      block timing                      */
+/* ------------------------------------------------------ */
+
+BlockTiming blockTiming(std::vector<double> blockTimes)
+{
+   BlockTiming timing;
+   size_t n = blockTimes.size();
+   if (n == 0)
+   {
+      return timing;
+   }
+
+   std::sort(blockTimes.begin(), blockTimes.end());
+   timing.median = n % 2 ? blockTimes[n / 2]
+                         : 0.5 * (blockTimes[n / 2 - 1] + blockTimes[n / 2]);
+   timing.p99    = blockTimes[size_t(std::ceil(0.99 * n)) - 1];
+   timing.max    = blockTimes.back();
+   return timing;
+}
+
+bool loadBlockTiming(const std::string& path, BlockTiming& timing)
+{
+   std::vector<uint8_t> data;
+   if (!readFile(path, data))
+   {
+      return false;
+   }
+
+   std::istringstream lines(std::string(data.begin(), data.end()));
+   if (!readTextHeader(lines, timingTextHeader, timingVersion))
+   {
+      return false;
+   }
+
+   BlockTiming loaded;
+   bool hasMedian = false;
+   std::string line;
+   while (std::getline(lines, line))
+   {
+      std::istringstream fields(line);
+      std::string key;
+      double value;
+      if (line.empty() || line[0] == '#' || !(fields >> key >> value))
+      {
+         continue;
+      }
+
+      if (key == "median")
+      {
+         loaded.median = value;
+         hasMedian     = true;
+      }
+      else if (key == "p99")
+      {
+         loaded.p99 = value;
+      }
+      else if (key == "max")
+      {
+         loaded.max = value;
+      }
+   }
+
+   if (!hasMedian)
+   {
+      return false;
+   }
+   timing = loaded;
+   return true;
+}
+
+bool saveBlockTiming(const std::string& path, const BlockTiming& timing)
+{
+   std::ostringstream text;
+   text.precision(9);
+
+   text << timingTextHeader << " " << timingVersion << "\n";
+   text << "median " << timing.median << "\n";
+   text << "p99 " << timing.p99 << "\n";
+   text << "max " << timing.max << "\n";
+
+   return writeFile(path, text.str());
+}
+
+/* ------------------------------------------------------ */
+/*                    regression tests                    */
+/* ------------------------------------------------------ */
+
+void evaluateRegression(
+   const RegressionCase& test, const Buffer& output, uint32_t sampleRate,
+   const std::vector<double>& blockTimes, RegressionResult& result
+)
+{
+   result.timing = blockTiming(blockTimes);
+
+   if (test.record)
+   {
+      if (!saveWav(test.golden, output, sampleRate))
+      {
+         result.error = "cannot save " + test.golden;
+         return;
+      }
+      if (!test.timing.empty() && !saveBlockTiming(test.timing, result.timing))
+      {
+         result.error = "cannot save " + test.timing;
+         return;
+      }
+      result.baseline = result.timing;
+      result.passed   = true;
+      return;
+   }
+
+   Buffer golden;
+   uint32_t goldenRate = 0;
+   if (!loadWav(test.golden, golden, goldenRate))
+   {
+      result.error = "cannot load " + test.golden;
+      return;
+   }
+
+   result.difference = compareSignals(output, golden);
+   bool identical    = result.difference.sameSize && goldenRate == sampleRate
+      && result.difference.maxError <= test.tolerance;
+
+   bool fast = true;
+   if (!test.timing.empty())
+   {
+      if (!loadBlockTiming(test.timing, result.baseline))
+      {
+         result.error = "cannot load " + test.timing;
+         return;
+      }
+      fast = result.timing.median <= result.baseline.median * test.slowdown;
+   }
+
+   result.passed = identical && fast;
+}
+
+void printRegressionResult(const char* name, const RegressionResult& result)
+{
+   if (!result.error.empty())
+   {
+      std::printf("%s: FAILED, %s\n", name, result.error.c_str());
+      return;
+   }
+
+   std::printf(
+      "%s: %s, max error %g at channel %u frame %u%s, median block time "
+      "%.2f us (baseline %.2f us)\n",
+      name, result.passed ? "passed" : "FAILED", result.difference.maxError,
+      result.difference.channel, result.difference.frame,
+      result.difference.sameSize ? "" : ", size mismatch",
+      result.timing.median * 1e6, result.baseline.median * 1e6
+   );
+}
+
+} // namespace ImRt
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "imrt-automation.h"
+#include "imrt-dsp.h"
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                          SIGNAL FILES                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Loads a WAV file with 16 or 24 bit integer or 32 bit float samples.
+ *
+ * @param path The path of the file.
+ * @param buffer Receives the signal.
+ * @param sampleRate Receives the sample rate of the file.
+ * @return false if the file could not be read or has an unsupported format.
+ */
+bool loadWav(const std::string& path, Buffer& buffer, uint32_t& sampleRate);
+
+/**
+ * @brief Saves a signal as WAV file with 32 bit float samples, so that the
+ * file holds the signal bit-exactly.
+ *
+ * @return false if the file could not be written.
+ */
+bool saveWav(
+   const std::string& path, const Buffer& buffer, uint32_t sampleRate
+);
+
+/* -------------------------------------------------------------------------- */
+/*                       AUTOMATION SCRIPTS                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Loads an automation clip from a text file, e.g. written by
+ * saveAutomationScript(). Each line holds the frame, the parameter ID and the
+ * value of an automation point, empty lines and lines starting with '#' are
+ * ignored:
+ *
+ * @code
+ * imrt-automation 1
+ * 0 1 0.5
+ * 48000 1 0.75
+ * @endcode
+ *
+ * @return The clip or nullptr if the file could not be read or parsed.
+ */
+std::unique_ptr<AutomationClip> loadAutomationScript(const std::string& path);
+
+/**
+ * @brief Saves the points of an automation clip as a text file.
+ *
+ * @return false if the file could not be written.
+ */
+bool saveAutomationScript(const std::string& path, const AutomationClip& clip);
+
+/* -------------------------------------------------------------------------- */
+/*                       SIGNAL COMPARISON                                    */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The largest absolute difference between two signals and where it
+ * occurs.
+ */
+struct SignalDifference
+{
+   bool sameSize    = true; // false if the channel or frame counts differ
+   float maxError   = 0.0f;
+   uint32_t channel = 0;
+   uint32_t frame   = 0;
+};
+
+/**
+ * @brief Compares two signals sample by sample.
+ */
+SignalDifference compareSignals(const Buffer& signal, const Buffer& reference);
+
+/* -------------------------------------------------------------------------- */
+/*                          BLOCK TIMING                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Statistics of the durations of Dsp::process() calls in seconds. The
+ * median is robust against the outliers caused by the scheduler and is
+ * therefore what performance regressions are judged by.
+ */
+struct BlockTiming
+{
+   double median = 0.0;
+   double p99    = 0.0;
+   double max    = 0.0;
+};
+
+/**
+ * @brief Computes the statistics of the given block durations.
+ */
+BlockTiming blockTiming(std::vector<double> blockTimes);
+
+/**
+ * @brief Loads a timing baseline from a text file written by
+ * saveBlockTiming().
+ *
+ * @return false if the file could not be read or parsed.
+ */
+bool loadBlockTiming(const std::string& path, BlockTiming& timing);
+
+/**
+ * @brief Saves a timing baseline as a text file.
+ *
+ * @return false if the file could not be written.
+ */
+bool saveBlockTiming(const std::string& path, const BlockTiming& timing);
+
+/* -------------------------------------------------------------------------- */
+/*                        REGRESSION TESTS                                    */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A regression test case of a Dsp: an input signal and an optional
+ * automation script that are rendered offline and compared with a golden
+ * output file and, optionally, with a timing baseline.
+ */
+struct RegressionCase
+{
+   std::string input;      // WAV file
+   std::string automation; // automation script, empty for none
+   std::string golden;     // WAV file
+   std::string timing;     // timing baseline, empty to skip the timing check
+
+   uint32_t blockSize = 256;
+   float tolerance    = 1e-5f; // maximum absolute sample difference
+   double slowdown    = 1.5;   // maximum ratio of the median block times
+
+   bool record = false; // write the golden file and baseline instead
+};
+
+/**
+ * @brief The result of a regression test case.
+ */
+struct RegressionResult
+{
+   bool passed = false;
+   std::string error; // why the case could not be run, empty otherwise
+
+   SignalDifference difference;
+   BlockTiming timing, baseline;
+};
+
+/**
+ * @brief Finishes a regression test case after the output was rendered:
+ * compares the output with the golden file and the block timing with the
+ * baseline, or records both if RegressionCase::record is set. Called by
+ * runRegression().
+ */
+void evaluateRegression(
+   const RegressionCase& test, const Buffer& output, uint32_t sampleRate,
+   const std::vector<double>& blockTimes, RegressionResult& result
+);
+
+/**
+ * @brief Prints the result of a regression test case to stdout in one line.
+ */
+void printRegressionResult(const char* name, const RegressionResult& result);
+
+/**
+ * @brief Runs a regression test case of a processor: renders the input file
+ * offline with the automation script (cf. Dsp::renderOffline()) and compares
+ * the output with the golden file within the tolerance of the case. The
+ * block timing is compared with the baseline, so a performance regression
+ * fails just like a numeric one. A test program typically runs its cases
+ * and returns a non-zero exit code if any of them failed:
+ *
+ * @code
+ * MyDsp dsp;
+ * RegressionCase test;
+ * test.input      = "tests/sweep.wav";
+ * test.automation = "tests/sweep.automation";
+ * test.golden     = "tests/sweep.golden.wav";
+ * test.timing     = "tests/sweep.timing";
+ *
+ * RegressionResult result = runRegression(dsp, test);
+ * printRegressionResult("sweep", result);
+ * return result.passed ? 0 : 1;
+ * @endcode
+ *
+ * The processor is prepared anew by every run, but its parameters keep their
+ * values, so each case should start from a known state, e.g. by automating
+ * all parameters at frame 0.
+ */
+template <typename Derived, typename Sample>
+RegressionResult
+runRegression(Dsp<Derived, Sample>& dsp, const RegressionCase& test)
+{
+   RegressionResult result;
+
+   Buffer input;
+   uint32_t sampleRate = 0;
+   if (!loadWav(test.input, input, sampleRate))
+   {
+      result.error = "cannot load " + test.input;
+      return result;
+   }
+
+   std::unique_ptr<AutomationClip> clip;
+   if (!test.automation.empty())
+   {
+      clip = loadAutomationScript(test.automation);
+      if (!clip)
+      {
+         result.error = "cannot load " + test.automation;
+         return result;
+      }
+   }
+
+   Buffer output;
+   std::vector<double> blockTimes;
+   blockTimes.reserve(input.getNumFrames() / test.blockSize + 1);
+   if (!dsp.renderOffline(
+          input, output, sampleRate, test.blockSize, std::move(clip),
+          &blockTimes
+       ))
+   {
+      result.error = "rendering failed";
+      return result;
+   }
+
+   evaluateRegression(test, output, sampleRate, blockTimes, result);
+   return result;
+}
+
+} // namespace ImRt
@@ -0,0 +1,202 @@
+#include "imrt-resampler.h"
+#include "imrt-simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                    filter design                       */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const double pi = 3.14159265358979323846;
+
+   // Zeroth order modified Bessel function of the first kind.
+   double besselI0(double x)
+   {
+      double sum = 1.0, term = 1.0;
+      for (int k = 1; k < 50 && term > 1e-12 * sum; ++k)
+      {
+         term *= (x / (2.0 * k)) * (x / (2.0 * k));
+         sum += term;
+      }
+      return sum;
+   }
+
+   double kaiserSinc(double x, double cutoff, double halfWidth, double beta)
+   {
+      double r = x / halfWidth;
+      if (std::abs(r) >= 1.0)
+      {
+         return 0.0;
+      }
+
+      double window = besselI0(beta * std::sqrt(1.0 - r * r)) / besselI0(beta);
+      double arg    = pi * cutoff * x;
+      double sinc   = std::abs(arg) < 1e-9 ? 1.0 : std::sin(arg) / arg;
+      return cutoff * sinc * window;
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                       resampler                        */
+/* ------------------------------------------------------ */
+
+void Resampler::prepare(
+   uint32_t numChannels, double inputRate, double outputRate,
+   ResamplerQuality quality, uint32_t maxInputFrames
+)
+{
+   double rolloff, beta;
+   switch (quality)
+   {
+   case ResamplerQuality::Low:
+      _numTaps   = 16;
+      _numPhases = 64;
+      rolloff    = 0.90;
+      beta       = 6.0;
+      break;
+   case ResamplerQuality::Medium:
+      _numTaps   = 32;
+      _numPhases = 128;
+      rolloff    = 0.94;
+      beta       = 8.0;
+      break;
+   default:
+      _numTaps   = 64;
+      _numPhases = 256;
+      rolloff    = 0.97;
+      beta       = 10.0;
+      break;
+   }
+
+   const uint32_t halfTaps = _numTaps / 2;
+   const double cutoff     = rolloff * std::min(1.0, outputRate / inputRate);
+
+   // One row of coefficients per phase plus one, so the coefficients of
+   // every fractional position can be interpolated between two rows.
+   _coefficients.resize((_numPhases + 1) * _numTaps);
+   for (uint32_t phase = 0; phase <= _numPhases; ++phase)
+   {
+      float* row = &_coefficients[phase * _numTaps];
+      double sum = 0.0;
+      for (uint32_t tap = 0; tap < _numTaps; ++tap)
+      {
+         double x = double(tap) - double(halfTaps - 1)
+            - double(phase) / double(_numPhases);
+         row[tap] = static_cast<float>(kaiserSinc(x, cutoff, halfTaps, beta));
+         sum += row[tap];
+      }
+      for (uint32_t tap = 0; tap < _numTaps; ++tap)
+      {
+         row[tap] = static_cast<float>(row[tap] / sum);
+      }
+   }
+
+   _capacity = 2 * (_numTaps + maxInputFrames);
+   _history.assign(numChannels, std::vector<float>(_capacity, 0.0f));
+
+   // The history starts with silence, so the first output frame only needs
+   // a single input frame.
+   _count       = _numTaps - 1;
+   _time        = uint64_t(halfTaps - 1) << fractionBits;
+   _nominalStep = inputRate / outputRate;
+   adjustRatio(1.0);
+}
+
+void Resampler::adjustRatio(double factor)
+{
+   _step = static_cast<uint64_t>(
+      std::llround(_nominalStep * factor * double(1ull << fractionBits))
+   );
+}
+
+uint32_t Resampler::process(
+   const float* const* input, uint32_t numInputFrames, float* const* output,
+   uint32_t maxOutputFrames
+)
+{
+   const uint32_t halfTaps  = _numTaps / 2;
+   const uint32_t numFrames = std::min(numInputFrames, _capacity - _count);
+
+   for (size_t channel = 0; channel < _history.size(); ++channel)
+   {
+      std::memcpy(
+         _history[channel].data() + _count, input[channel],
+         numFrames * sizeof(float)
+      );
+   }
+   _count += numFrames;
+
+   uint32_t numOutputFrames = 0;
+   while (numOutputFrames < maxOutputFrames)
+   {
+      uint64_t index = _time >> fractionBits;
+      if (index + halfTaps >= _count)
+      {
+         break;
+      }
+
+      uint64_t position = (_time & 0xffffffffull) * _numPhases;
+      uint32_t phase    = static_cast<uint32_t>(position >> fractionBits);
+      float fraction    = float(position & 0xffffffffull) / 4294967296.0f;
+
+      const float* c0    = &_coefficients[phase * _numTaps];
+      const float* c1    = c0 + _numTaps;
+      const size_t start = index - (halfTaps - 1);
+
+      for (size_t channel = 0; channel < _history.size(); ++channel)
+      {
+         const float* x = _history[channel].data() + start;
+         float y0       = Simd::dot(x, c0, _numTaps);
+         float y1       = Simd::dot(x, c1, _numTaps);
+         output[channel][numOutputFrames] = y0 + fraction * (y1 - y0);
+      }
+
+      _time += _step;
+      ++numOutputFrames;
+   }
+
+   // Drop the frames that no future output frame depends on.
+   uint64_t index   = _time >> fractionBits;
+   uint32_t discard = static_cast<uint32_t>(
+      std::min<uint64_t>(index - (halfTaps - 1), _count)
+   );
+   if (discard > 0)
+   {
+      for (auto& history : _history)
+      {
+         std::memmove(
+            history.data(), history.data() + discard,
+            (_count - discard) * sizeof(float)
+         );
+      }
+      _count -= discard;
+      _time -= uint64_t(discard) << fractionBits;
+   }
+
+   return numOutputFrames;
+}
+
+uint32_t Resampler::inputFramesFor(uint32_t numOutputFrames) const
+{
+   if (numOutputFrames == 0)
+   {
+      return 0;
+   }
+
+   uint64_t last   = _time + uint64_t(numOutputFrames - 1) * _step;
+   uint64_t needed = (last >> fractionBits) + _numTaps / 2 + 1;
+   return needed > _count ? static_cast<uint32_t>(needed - _count) : 0;
+}
+
+uint32_t Resampler::latency() const
+{
+   return _numTaps / 2;
+}
+
+} // namespace ImRt
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                          RESAMPLER                                         */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The quality of a Resampler. Higher qualities use longer filters,
+ * which attenuate aliasing more and keep more of the passband, but cost more
+ * per sample and add more latency.
+ *
+ * - Low: 16 taps, passband up to 90% of the Nyquist frequency.
+ * - Medium: 32 taps, passband up to 94% of the Nyquist frequency.
+ * - High: 64 taps, passband up to 97% of the Nyquist frequency.
+ */
+enum class ResamplerQuality
+{
+   Low,
+   Medium,
+   High
+};
+
+/**
+ * @brief A streaming multichannel sample-rate converter using a polyphase
+ * Kaiser-windowed sinc filter. The filter coefficients for a fractional
+ * position are interpolated between the two nearest precomputed phases, and
+ * the filter itself is evaluated with SIMD dot products (cf. Simd::dot()).
+ * All memory is allocated in Resampler::prepare(), so Resampler::process()
+ * is realtime-safe.
+ */
+class Resampler
+{
+public:
+   /**
+    * @brief Prepares the resampler and resets its state.
+    *
+    * @param numChannels The number of channels.
+    * @param inputRate The sample rate of the input signal.
+    * @param outputRate The sample rate of the output signal.
+    * @param quality The quality of the filter.
+    * @param maxInputFrames The maximum number of input frames passed to a
+    * single Resampler::process() call.
+    */
+   void prepare(
+      uint32_t numChannels, double inputRate, double outputRate,
+      ResamplerQuality quality, uint32_t maxInputFrames
+   );
+
+   /**
+    * @brief Fine-tunes the conversion ratio, e.g. to compensate for the drift
+    * between two clocks. A factor greater than 1 consumes the input faster.
+    *
+    * @param factor The factor applied to the nominal ratio of the input rate
+    * to the output rate, typically very close to 1.
+    */
+   void adjustRatio(double factor);
+
+   /**
+    * @brief Converts the input frames and writes as many output frames as
+    * the input allows, but at most maxOutputFrames. Input frames that are not
+    * needed yet are kept for the next call.
+    *
+    * @param input One pointer per channel to the input samples.
+    * @param numInputFrames The number of input frames.
+    * @param output One pointer per channel to the output samples.
+    * @param maxOutputFrames The maximum number of output frames to write.
+    * @return The number of output frames written.
+    */
+   uint32_t process(
+      const float* const* input, uint32_t numInputFrames, float* const* output,
+      uint32_t maxOutputFrames
+   );
+
+   /**
+    * @brief Returns the exact number of input frames the next call of
+    * Resampler::process() needs to write the given number of output frames.
+    */
+   uint32_t inputFramesFor(uint32_t numOutputFrames) const;
+
+   /**
+    * @brief Returns the latency of the resampler in input frames.
+    */
+   uint32_t latency() const;
+
+private:
+   static constexpr int fractionBits = 32;
+
+   uint32_t _numTaps = 0, _numPhases = 0;
+   std::vector<float> _coefficients;
+   std::vector<std::vector<float>> _history;
+   uint32_t _capacity = 0;
+
+   uint32_t _count     = 0; // number of frames in the history
+   uint64_t _time      = 0; // position of the next output frame (32.32)
+   uint64_t _step      = 0; // input frames per output frame (32.32)
+   double _nominalStep = 1.0;
+};
+
+} // namespace ImRt
@@ -0,0 +1,110 @@
+#include "imrt-ring.h"
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                       frame ring                       */
+/* ------------------------------------------------------ */
+
+void FrameRing::reset(uint32_t numChannels, uint32_t capacity)
+{
+   _numChannels = numChannels;
+   _capacity    = _positions.reset(capacity);
+   _data.assign(size_t(_capacity) * numChannels, 0.0f);
+}
+
+uint32_t FrameRing::numChannels() const
+{
+   return _numChannels;
+}
+
+uint32_t FrameRing::size() const
+{
+   return _positions.size();
+}
+
+uint32_t FrameRing::space() const
+{
+   return _positions.space();
+}
+
+uint32_t FrameRing::write(const float* const* channels, uint32_t numFrames)
+{
+   uint64_t position = _positions.beginWrite(numFrames);
+   for (uint32_t channel = 0; channel < _numChannels; ++channel)
+   {
+      copyIn(channel, channels[channel], position, numFrames);
+   }
+   _positions.endWrite(position, numFrames);
+   return numFrames;
+}
+
+uint32_t FrameRing::write(const Buffer& buffer, uint32_t numFrames)
+{
+   uint64_t position = _positions.beginWrite(numFrames);
+   for (uint32_t channel = 0; channel < _numChannels; ++channel)
+   {
+      copyIn(channel, &buffer.getSample(channel, 0), position, numFrames);
+   }
+   _positions.endWrite(position, numFrames);
+   return numFrames;
+}
+
+uint32_t FrameRing::read(float* const* channels, uint32_t numFrames)
+{
+   uint64_t position = _positions.beginRead(numFrames);
+   for (uint32_t channel = 0; channel < _numChannels; ++channel)
+   {
+      copyOut(channel, channels[channel], position, numFrames);
+   }
+   _positions.endRead(position, numFrames);
+   return numFrames;
+}
+
+uint32_t FrameRing::readLatest(Buffer& window)
+{
+   uint32_t windowSize = window.getNumFrames();
+   uint32_t numFrames  = _capacity;
+   uint64_t position   = _positions.beginRead(numFrames);
+
+   // Frames that do not fit into the window are skipped.
+   uint32_t skipped = numFrames > windowSize ? numFrames - windowSize : 0;
+   uint32_t kept    = numFrames - skipped;
+   for (uint32_t channel = 0; channel < _numChannels; ++channel)
+   {
+      float* samples = &window.getSample(channel, 0);
+      std::copy(samples + kept, samples + windowSize, samples);
+      copyOut(
+         channel, samples + windowSize - kept, position + skipped, kept
+      );
+   }
+   _positions.endRead(position, numFrames);
+   return numFrames;
+}
+
+void FrameRing::copyIn(
+   uint32_t channel, const float* samples, uint64_t position,
+   uint32_t numFrames
+)
+{
+   float* data    = &_data[size_t(channel) * _capacity];
+   uint32_t index = static_cast<uint32_t>(position) & _positions.mask();
+   uint32_t first = std::min(numFrames, _capacity - index);
+
+   std::copy(samples, samples + first, data + index);
+   std::copy(samples + first, samples + numFrames, data);
+}
+
+void FrameRing::copyOut(
+   uint32_t channel, float* samples, uint64_t position, uint32_t numFrames
+)
+{
+   const float* data = &_data[size_t(channel) * _capacity];
+   uint32_t index    = static_cast<uint32_t>(position) & _positions.mask();
+   uint32_t first    = std::min(numFrames, _capacity - index);
+
+   std::copy(data + index, data + index + first, samples);
+   std::copy(data, data + numFrames - first, samples + first);
+}
+
+} // namespace ImRt
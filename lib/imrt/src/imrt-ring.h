@@ -0,0 +1,428 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                         RING POSITIONS                                     */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The size of a cache line, by which the positions of the producer and
+ * the consumer of a ring are separated, so the two threads do not invalidate
+ * each other's cache lines with every access.
+ */
+constexpr size_t cacheLineSize = 64;
+
+/**
+ * @brief The read and write positions of a lock-free single producer, single
+ * consumer ring with a power-of-two capacity (cf. Ring and FrameRing). The
+ * positions count all items ever written resp. read, so they are wrapped to
+ * indices with a mask instead of a modulo. Each side keeps a copy of the
+ * position of the other side and only reloads it when the copy suggests that
+ * the ring is full resp. empty, which avoids most cache misses.
+ */
+class RingPositions
+{
+public:
+   /**
+    * @brief Empties the ring and returns the capacity, i.e. the given
+    * capacity rounded up to the next power of two. This method must not be
+    * called while another thread uses the ring.
+    */
+   uint32_t reset(uint32_t capacity)
+   {
+      uint32_t size = 1;
+      while (size < capacity)
+      {
+         size *= 2;
+      }
+      _mask = size - 1;
+
+      _producer.position.store(0);
+      _producer.otherPosition = 0;
+      _consumer.position.store(0);
+      _consumer.otherPosition = 0;
+      return size;
+   }
+
+   /**
+    * @brief Returns the capacity of the ring.
+    */
+   uint32_t capacity() const
+   {
+      return _mask + 1;
+   }
+
+   /**
+    * @brief Returns the mask that wraps positions to indices.
+    */
+   uint32_t mask() const
+   {
+      return _mask;
+   }
+
+   /**
+    * @brief Returns the number of items that can be read.
+    */
+   uint32_t size() const
+   {
+      return static_cast<uint32_t>(
+         _producer.position.load(std::memory_order_acquire)
+         - _consumer.position.load(std::memory_order_acquire)
+      );
+   }
+
+   /**
+    * @brief Returns the number of items that can be written.
+    */
+   uint32_t space() const
+   {
+      return capacity() - size();
+   }
+
+   /**
+    * @brief Limits the number of items to write to the free space and returns
+    * the write position. This method must only be called by the producer.
+    */
+   uint64_t beginWrite(uint32_t& numItems)
+   {
+      uint64_t position = _producer.position.load(std::memory_order_relaxed);
+      uint64_t free = capacity() - (position - _producer.otherPosition);
+      if (free < numItems)
+      {
+         _producer.otherPosition
+            = _consumer.position.load(std::memory_order_acquire);
+         free = capacity() - (position - _producer.otherPosition);
+      }
+      numItems = static_cast<uint32_t>(std::min<uint64_t>(numItems, free));
+      return position;
+   }
+
+   /**
+    * @brief Publishes written items to the consumer.
+    */
+   void endWrite(uint64_t position, uint32_t numItems)
+   {
+      _producer.position.store(position + numItems, std::memory_order_release);
+   }
+
+   /**
+    * @brief Limits the number of items to read to the available items and
+    * returns the read position. This method must only be called by the
+    * consumer.
+    */
+   uint64_t beginRead(uint32_t& numItems)
+   {
+      uint64_t position  = _consumer.position.load(std::memory_order_relaxed);
+      uint64_t available = _consumer.otherPosition - position;
+      if (available < numItems)
+      {
+         _consumer.otherPosition
+            = _producer.position.load(std::memory_order_acquire);
+         available = _consumer.otherPosition - position;
+      }
+      numItems = static_cast<uint32_t>(std::min<uint64_t>(numItems, available));
+      return position;
+   }
+
+   /**
+    * @brief Releases read items to the producer.
+    */
+   void endRead(uint64_t position, uint32_t numItems)
+   {
+      _consumer.position.store(position + numItems, std::memory_order_release);
+   }
+
+private:
+   struct alignas(cacheLineSize) Side
+   {
+      std::atomic<uint64_t> position { 0 };
+      uint64_t otherPosition = 0; // copy of the position of the other side
+   };
+
+   Side _producer, _consumer;
+   alignas(cacheLineSize) uint32_t _mask = 0;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                              RING                                          */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A lock-free single producer, single consumer ring of trivially
+ * copyable items, e.g. small messages from the DSP thread to the GUI thread.
+ * Items are pushed and popped in batches, which are copied as at most two
+ * contiguous spans, or written and read in place through the spans returned
+ * by Ring::prepareWrite() and Ring::prepareRead().
+ */
+template <typename T>
+class Ring
+{
+   static_assert(
+      std::is_trivially_copyable<T>::value,
+      "The items of a ring must be trivially copyable."
+   );
+
+public:
+   /**
+    * @brief Up to two contiguous ranges of items in the ring.
+    */
+   struct Spans
+   {
+      T* first;
+      uint32_t firstSize;
+      T* second;
+      uint32_t secondSize;
+
+      uint32_t size() const
+      {
+         return firstSize + secondSize;
+      }
+   };
+
+   /**
+    * @brief Allocates the ring and empties it. This method must not be called
+    * while another thread uses the ring.
+    *
+    * @param capacity The minimum number of items the ring can hold. It is
+    * rounded up to the next power of two.
+    */
+   void reset(uint32_t capacity)
+   {
+      _data.assign(_positions.reset(capacity), T());
+   }
+
+   /**
+    * @brief Returns the number of items the ring can hold.
+    */
+   uint32_t capacity() const
+   {
+      return _positions.capacity();
+   }
+
+   /**
+    * @brief Returns the number of items that can be popped.
+    */
+   uint32_t size() const
+   {
+      return _positions.size();
+   }
+
+   /**
+    * @brief Returns the number of items that can be pushed.
+    */
+   uint32_t space() const
+   {
+      return _positions.space();
+   }
+
+   /**
+    * @brief Pushes an item. This method must only be called by the producer.
+    *
+    * @return false if the ring is full.
+    */
+   bool push(const T& item)
+   {
+      return push(&item, 1) == 1;
+   }
+
+   /**
+    * @brief Pushes a batch of items. This method must only be called by the
+    * producer.
+    *
+    * @return The number of items pushed, which is less than numItems if the
+    * ring is full.
+    */
+   uint32_t push(const T* items, uint32_t numItems)
+   {
+      Spans spans = prepareWrite(numItems);
+      std::copy(items, items + spans.firstSize, spans.first);
+      std::copy(items + spans.firstSize, items + spans.size(), spans.second);
+      commitWrite(spans.size());
+      return spans.size();
+   }
+
+   /**
+    * @brief Pops an item. This method must only be called by the consumer.
+    *
+    * @return false if the ring is empty.
+    */
+   bool pop(T& item)
+   {
+      return pop(&item, 1) == 1;
+   }
+
+   /**
+    * @brief Pops a batch of items. This method must only be called by the
+    * consumer.
+    *
+    * @return The number of items popped, which is less than numItems if the
+    * ring does not hold enough items.
+    */
+   uint32_t pop(T* items, uint32_t numItems)
+   {
+      Spans spans = prepareRead(numItems);
+      std::copy(spans.first, spans.first + spans.firstSize, items);
+      std::copy(
+         spans.second, spans.second + spans.secondSize,
+         items + spans.firstSize
+      );
+      commitRead(spans.size());
+      return spans.size();
+   }
+
+   /**
+    * @brief Returns the free space for up to numItems items, which the
+    * producer writes in place and publishes with Ring::commitWrite().
+    */
+   Spans prepareWrite(uint32_t numItems)
+   {
+      _writePosition = _positions.beginWrite(numItems);
+      return spans(_writePosition, numItems);
+   }
+
+   /**
+    * @brief Publishes the given number of items written to the spans returned
+    * by Ring::prepareWrite().
+    */
+   void commitWrite(uint32_t numItems)
+   {
+      _positions.endWrite(_writePosition, numItems);
+   }
+
+   /**
+    * @brief Returns up to numItems items, which the consumer reads in place
+    * and releases with Ring::commitRead().
+    */
+   Spans prepareRead(uint32_t numItems)
+   {
+      _readPosition = _positions.beginRead(numItems);
+      return spans(_readPosition, numItems);
+   }
+
+   /**
+    * @brief Releases the given number of items read from the spans returned
+    * by Ring::prepareRead().
+    */
+   void commitRead(uint32_t numItems)
+   {
+      _positions.endRead(_readPosition, numItems);
+   }
+
+private:
+   RingPositions _positions;
+   std::vector<T> _data;
+   uint64_t _writePosition = 0; // used by the producer only
+   alignas(cacheLineSize) uint64_t _readPosition = 0;
+
+   Spans spans(uint64_t position, uint32_t numItems)
+   {
+      uint32_t index = static_cast<uint32_t>(position) & _positions.mask();
+      uint32_t first = std::min(numItems, capacity() - index);
+      return { &_data[index], first, _data.data(), numItems - first };
+   }
+};
+
+/* -------------------------------------------------------------------------- */
+/*                          FRAME RING                                        */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A lock-free single producer, single consumer ring of multichannel
+ * float frames, e.g. to pass audio between the callbacks of two devices or
+ * from the DSP thread to the meters and scopes of the GUI. Each channel is
+ * stored contiguously, so a batch of frames is copied as at most two spans
+ * per channel.
+ */
+class FrameRing
+{
+public:
+   /**
+    * @brief Allocates the ring and empties it. This method must not be called
+    * while another thread uses the ring.
+    *
+    * @param numChannels The number of channels per frame.
+    * @param capacity The minimum number of frames the ring can hold. It is
+    * rounded up to the next power of two.
+    */
+   void reset(uint32_t numChannels, uint32_t capacity);
+
+   /**
+    * @brief Returns the number of channels per frame.
+    */
+   uint32_t numChannels() const;
+
+   /**
+    * @brief Returns the number of frames that can be read.
+    */
+   uint32_t size() const;
+
+   /**
+    * @brief Returns the number of frames that can be written.
+    */
+   uint32_t space() const;
+
+   /**
+    * @brief Writes frames into the ring. This method must only be called by
+    * the producer thread.
+    *
+    * @param channels One pointer per channel to the samples to write.
+    * @param numFrames The number of frames to write.
+    * @return The number of frames written, which is less than numFrames if
+    * the ring is full.
+    */
+   uint32_t write(const float* const* channels, uint32_t numFrames);
+
+   /**
+    * @brief Writes the first frames of a buffer into the ring (cf.
+    * FrameRing::write()). The buffer must have at least as many channels as
+    * the ring.
+    */
+   uint32_t write(const Buffer& buffer, uint32_t numFrames);
+
+   /**
+    * @brief Reads frames from the ring. This method must only be called by
+    * the consumer thread.
+    *
+    * @param channels One pointer per channel to write the samples to.
+    * @param numFrames The number of frames to read.
+    * @return The number of frames read, which is less than numFrames if the
+    * ring does not hold enough frames.
+    */
+   uint32_t read(float* const* channels, uint32_t numFrames);
+
+   /**
+    * @brief Reads all frames from the ring and appends them to a window that
+    * holds the most recent frames, e.g. for a scope, shifting the older
+    * frames towards its start. This method must only be called by the
+    * consumer thread.
+    *
+    * @param window The window, which must have at least as many channels as
+    * the ring.
+    * @return The number of frames read.
+    */
+   uint32_t readLatest(Buffer& window);
+
+private:
+   RingPositions _positions;
+   uint32_t _numChannels = 0, _capacity = 0;
+   std::vector<float> _data; // one contiguous range per channel
+
+   void copyIn(
+      uint32_t channel, const float* samples, uint64_t position,
+      uint32_t numFrames
+   );
+   void copyOut(
+      uint32_t channel, float* samples, uint64_t position, uint32_t numFrames
+   );
+};
+
+} // namespace ImRt
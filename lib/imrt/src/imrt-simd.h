@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define IMRT_SIMD_SSE 1
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define IMRT_SIMD_SSE2 1
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMRT_SIMD_NEON 1
+#endif
+
+namespace ImRt {
+namespace Simd {
+
+   /**
+    * @brief Returns the dot product of two float arrays using SSE or NEON
+    * instructions if available.
+    */
+   inline float dot(const float* a, const float* b, uint32_t n)
+   {
+      uint32_t i = 0;
+      float sum  = 0.0f;
+
+#if defined(IMRT_SIMD_SSE)
+      __m128 sum0 = _mm_setzero_ps();
+      __m128 sum1 = _mm_setzero_ps();
+      for (; i + 8 <= n; i += 8)
+      {
+         sum0 = _mm_add_ps(
+            sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i))
+         );
+         sum1 = _mm_add_ps(
+            sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4))
+         );
+      }
+      sum0 = _mm_add_ps(sum0, sum1);
+      sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+      sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+      sum  = _mm_cvtss_f32(sum0);
+#elif defined(IMRT_SIMD_NEON)
+      float32x4_t sum0 = vdupq_n_f32(0.0f);
+      for (; i + 4 <= n; i += 4)
+      {
+         sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+      }
+      float32x2_t half = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+      sum              = vget_lane_f32(vpadd_f32(half, half), 0);
+#endif
+
+      for (; i < n; ++i)
+      {
+         sum += a[i] * b[i];
+      }
+      return sum;
+   }
+
+   /**
+    * @brief Adds the products of the array x and the scalar gain to the array
+    * y (y += gain * x) using SSE or NEON instructions if available.
+    */
+   inline void multiplyAdd(float* y, const float* x, float gain, uint32_t n)
+   {
+      uint32_t i = 0;
+
+#if defined(IMRT_SIMD_SSE)
+      __m128 g = _mm_set1_ps(gain);
+      for (; i + 4 <= n; i += 4)
+      {
+         _mm_storeu_ps(
+            y + i,
+            _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(x + i), g))
+         );
+      }
+#elif defined(IMRT_SIMD_NEON)
+      float32x4_t g = vdupq_n_f32(gain);
+      for (; i + 4 <= n; i += 4)
+      {
+         vst1q_f32(y + i, vmlaq_f32(vld1q_f32(y + i), vld1q_f32(x + i), g));
+      }
+#endif
+
+      for (; i < n; ++i)
+      {
+         y[i] += gain * x[i];
+      }
+   }
+
+   /**
+    * @brief Four floats that are processed in parallel, e.g. one sample of
+    * four channels, using SSE or NEON instructions if available.
+    */
+   struct Float4
+   {
+#if defined(IMRT_SIMD_SSE)
+      __m128 v;
+#elif defined(IMRT_SIMD_NEON)
+      float32x4_t v;
+#else
+      float v[4];
+#endif
+
+      /**
+       * @brief Loads four consecutive floats.
+       */
+      static Float4 load(const float* lanes)
+      {
+#if defined(IMRT_SIMD_SSE)
+         return { _mm_loadu_ps(lanes) };
+#elif defined(IMRT_SIMD_NEON)
+         return { vld1q_f32(lanes) };
+#else
+         return { { lanes[0], lanes[1], lanes[2], lanes[3] } };
+#endif
+      }
+
+      /**
+       * @brief Combines four floats, e.g. gathered from four channels, without
+       * going through memory.
+       */
+      static Float4 set(float a, float b, float c, float d)
+      {
+#if defined(IMRT_SIMD_SSE)
+         return { _mm_setr_ps(a, b, c, d) };
+#elif defined(IMRT_SIMD_NEON)
+         float32x4_t v = vdupq_n_f32(a);
+         v             = vsetq_lane_f32(b, v, 1);
+         v             = vsetq_lane_f32(c, v, 2);
+         return { vsetq_lane_f32(d, v, 3) };
+#else
+         return { { a, b, c, d } };
+#endif
+      }
+
+      /**
+       * @brief Returns four copies of a float.
+       */
+      static Float4 fill(float x)
+      {
+#if defined(IMRT_SIMD_SSE)
+         return { _mm_set1_ps(x) };
+#elif defined(IMRT_SIMD_NEON)
+         return { vdupq_n_f32(x) };
+#else
+         return { { x, x, x, x } };
+#endif
+      }
+
+      /**
+       * @brief Stores the four floats consecutively.
+       */
+      void store(float* lanes) const
+      {
+#if defined(IMRT_SIMD_SSE)
+         _mm_storeu_ps(lanes, v);
+#elif defined(IMRT_SIMD_NEON)
+         vst1q_f32(lanes, v);
+#else
+         for (int lane = 0; lane < 4; ++lane)
+         {
+            lanes[lane] = v[lane];
+         }
+#endif
+      }
+   };
+
+#if defined(IMRT_SIMD_SSE)
+   inline Float4 operator+(Float4 a, Float4 b)
+   {
+      return { _mm_add_ps(a.v, b.v) };
+   }
+
+   inline Float4 operator-(Float4 a, Float4 b)
+   {
+      return { _mm_sub_ps(a.v, b.v) };
+   }
+
+   inline Float4 operator*(Float4 a, Float4 b)
+   {
+      return { _mm_mul_ps(a.v, b.v) };
+   }
+#elif defined(IMRT_SIMD_NEON)
+   inline Float4 operator+(Float4 a, Float4 b)
+   {
+      return { vaddq_f32(a.v, b.v) };
+   }
+
+   inline Float4 operator-(Float4 a, Float4 b)
+   {
+      return { vsubq_f32(a.v, b.v) };
+   }
+
+   inline Float4 operator*(Float4 a, Float4 b)
+   {
+      return { vmulq_f32(a.v, b.v) };
+   }
+#else
+   inline Float4 operator+(Float4 a, Float4 b)
+   {
+      return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2],
+                 a.v[3] + b.v[3] } };
+   }
+
+   inline Float4 operator-(Float4 a, Float4 b)
+   {
+      return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2],
+                 a.v[3] - b.v[3] } };
+   }
+
+   inline Float4 operator*(Float4 a, Float4 b)
+   {
+      return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2],
+                 a.v[3] * b.v[3] } };
+   }
+#endif
+
+} // namespace Simd
+} // namespace ImRt
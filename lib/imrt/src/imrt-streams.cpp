@@ -0,0 +1,520 @@
+#include "imrt-streams.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                    drift estimator                     */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const double pi = 3.14159265358979323846;
+
+   // Time constant of the smoothing of the fill level in seconds.
+   const double smoothingTime = 1.0;
+
+   double steadySeconds()
+   {
+      std::chrono::duration<double> time
+         = std::chrono::steady_clock::now().time_since_epoch();
+      return time.count();
+   }
+
+} // namespace
+
+void DriftEstimator::reset(
+   double sampleRate, double targetFill, double bandwidth, double maxDeviation
+)
+{
+   // The fill level changes by sampleRate * (drift - (factor - 1)) frames
+   // per second, so a PI controller with these gains yields a critically
+   // damped second order loop with the given natural frequency.
+   double omega = 2.0 * pi * bandwidth;
+   _kp          = 2.0 * omega / sampleRate;
+   _ki          = omega * omega / sampleRate;
+
+   _target       = targetFill;
+   _maxDeviation = maxDeviation;
+   _smoothed     = targetFill;
+   _integral     = 0.0;
+   _factor       = 1.0;
+   _started      = false;
+}
+
+double DriftEstimator::update(double fill, double elapsed)
+{
+   if (!_started)
+   {
+      _smoothed = fill;
+      _started  = true;
+   }
+
+   _smoothed += (fill - _smoothed) * (1.0 - std::exp(-elapsed / smoothingTime));
+
+   double error = _smoothed - _target;
+   _integral += error * elapsed;
+
+   // Limit the integral part to the largest drift that can be compensated,
+   // so it does not wind up during dropouts.
+   double limit = _maxDeviation / _ki;
+   _integral    = std::clamp(_integral, -limit, limit);
+
+   double deviation = _kp * error + _ki * _integral;
+   _factor = 1.0 + std::clamp(deviation, -_maxDeviation, _maxDeviation);
+   return _factor;
+}
+
+double DriftEstimator::factor() const
+{
+   return _factor;
+}
+
+double DriftEstimator::targetFill() const
+{
+   return _target;
+}
+
+/* ------------------------------------------------------ */
+/*                    auxiliary stream                    */
+/* ------------------------------------------------------ */
+
+AuxiliaryStream::AuxiliaryStream(AuxiliaryStreamSettings settings)
+   : _settings(settings)
+   , _clock(&steadySeconds)
+{
+}
+
+AuxiliaryStream::~AuxiliaryStream()
+{
+   stop();
+}
+
+void AuxiliaryStream::prepare(double engineRate, uint32_t maxEngineFrames)
+{
+   _deviceRate      = _settings.sampleRate;
+   _engineRate      = engineRate;
+   _numIn           = std::max(0, _settings.numChannelsIn);
+   _numOut          = std::max(0, _settings.numChannelsOut);
+   _maxDeviceFrames = std::max(1u, _settings.bufferSize);
+
+   // Each device buffer corresponds to a slightly varying number of engine
+   // frames. The rings have to bridge one block of either side plus the
+   // jitter of the conversion.
+   uint32_t converted = static_cast<uint32_t>(
+      std::ceil(_maxDeviceFrames * engineRate / _deviceRate)
+   );
+   _maxEngineFrames = converted + 128;
+
+   double target     = maxEngineFrames + converted + 16;
+   uint32_t capacity = 4 * (maxEngineFrames + _maxEngineFrames);
+   uint32_t channels = std::max(_numIn, _numOut);
+
+   _inputRing.reset(_numIn, capacity);
+   _outputRing.reset(_numOut, capacity);
+   _inputTarget  = static_cast<uint32_t>(target);
+   _outputTarget = static_cast<uint32_t>(target);
+   _inputDrift.reset(engineRate, target);
+   _outputDrift.reset(engineRate, target);
+
+   _inputResampler.prepare(
+      _numIn, _deviceRate, engineRate, _settings.resamplerQuality,
+      _maxDeviceFrames
+   );
+   _outputResampler.prepare(
+      _numOut, engineRate, _deviceRate, _settings.resamplerQuality,
+      _maxEngineFrames
+   );
+
+   _deviceFrames.assign(channels, std::vector<float>(_maxDeviceFrames));
+   _engineFrames.assign(channels, std::vector<float>(_maxEngineFrames));
+   _pointers.resize(channels);
+   _constPointers.resize(channels);
+   _enginePointers.resize(channels);
+   _constEnginePointers.resize(channels);
+   _engineBlock.resize({ channels, maxEngineFrames });
+
+   _inputFilled    = false;
+   _inputPrimed    = false;
+   _outputPrimed   = false;
+   _inputOverflow  = false;
+   _outputOverflow = false;
+   _inputTime.store(0.0);
+   _outputTime.store(0.0);
+   _drift.store(0.0);
+   _numDropouts.store(0);
+}
+
+bool AuxiliaryStream::start(
+   double engineRate, uint32_t maxEngineFrames, const RealtimeSettings& realtime
+)
+{
+   stop();
+
+   _realtime = realtime;
+
+   _dac = std::make_unique<RtAudio>(_settings.api);
+
+   RtAudio::StreamParameters paramsIn, paramsOut;
+   paramsIn.deviceId      = _settings.inputDeviceId;
+   paramsIn.nChannels     = std::max(0, _settings.numChannelsIn);
+   paramsIn.firstChannel  = std::max(0, _settings.firstChannelIn);
+   paramsOut.deviceId     = _settings.outputDeviceId;
+   paramsOut.nChannels    = std::max(0, _settings.numChannelsOut);
+   paramsOut.firstChannel = std::max(0, _settings.firstChannelOut);
+
+   if (paramsIn.deviceId == 0)
+   {
+      paramsIn.deviceId = _dac->getDefaultInputDevice();
+   }
+   if (paramsOut.deviceId == 0)
+   {
+      paramsOut.deviceId = _dac->getDefaultOutputDevice();
+   }
+
+   auto options  = RtAudio::StreamOptions();
+   options.flags = RTAUDIO_MINIMIZE_LATENCY;
+   if (realtime.scheduleRealtime)
+   {
+      options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+   }
+   options.streamName = "imrt-auxiliary-stream";
+   options.priority   = realtime.priority;
+
+   if (_dac->openStream(
+          paramsOut.nChannels > 0 ? &paramsOut : nullptr,
+          paramsIn.nChannels > 0 ? &paramsIn : nullptr, RTAUDIO_FLOAT32,
+          _settings.sampleRate, &_settings.bufferSize, &AudioCallback, this,
+          &options
+       ))
+   {
+      _dac.reset();
+      return false;
+   }
+
+   _settings.sampleRate = _dac->getStreamSampleRate();
+   prepare(engineRate, maxEngineFrames);
+   _configureThread = true;
+
+   if (_dac->startStream())
+   {
+      _dac->closeStream();
+      _dac.reset();
+      return false;
+   }
+   return true;
+}
+
+void AuxiliaryStream::stop()
+{
+   if (!_dac)
+   {
+      return;
+   }
+   if (_dac->isStreamRunning())
+   {
+      _dac->stopStream();
+   }
+   if (_dac->isStreamOpen())
+   {
+      _dac->closeStream();
+   }
+   _dac.reset();
+}
+
+bool AuxiliaryStream::isRunning() const
+{
+   return _dac && _dac->isStreamRunning();
+}
+
+const AuxiliaryStreamSettings& AuxiliaryStream::settings() const
+{
+   return _settings;
+}
+
+void AuxiliaryStream::deviceCallback(
+   const float* input, float* output, uint32_t numFrames
+)
+{
+   if (_maxDeviceFrames == 0)
+   {
+      return;
+   }
+
+   // The resamplers and the device frames are prepared for a maximum number
+   // of frames, so larger device buffers are processed in chunks of it.
+   for (uint32_t start = 0; start < numFrames; start += _maxDeviceFrames)
+   {
+      processChunk(
+         input ? input + size_t(_numIn) * start : nullptr,
+         output ? output + size_t(_numOut) * start : nullptr,
+         std::min(_maxDeviceFrames, numFrames - start)
+      );
+   }
+}
+
+void AuxiliaryStream::processChunk(
+   const float* input, float* output, uint32_t numFrames
+)
+{
+   double elapsed = numFrames / _deviceRate;
+
+   // The engine reads and writes the rings a block at a time, so their fill
+   // levels jump by a block depending on the phase between the callbacks of
+   // both sides, which slowly beats with the drift and would be taken for
+   // drift. The frames that an engine passing them continuously would have
+   // read or written since its last block make the fill levels independent
+   // of this phase. For the output ring this adds a constant block.
+   double now        = _clock();
+   double maxElapsed = _engineBlock.getNumFrames() / _engineRate;
+   double inputPassed
+      = std::clamp(now - _inputTime.load(), 0.0, maxElapsed) * _engineRate;
+   double outputPassed
+      = std::clamp(now - _outputTime.load(), 0.0, maxElapsed) * _engineRate;
+
+   if (_numIn > 0 && input != nullptr)
+   {
+      for (uint32_t channel = 0; channel < _numIn; ++channel)
+      {
+         float* samples = _deviceFrames[channel].data();
+         for (uint32_t frame = 0; frame < numFrames; ++frame)
+         {
+            samples[frame] = input[_numIn * frame + channel];
+         }
+         _constPointers[channel] = samples;
+         _pointers[channel]      = _engineFrames[channel].data();
+      }
+
+      uint32_t converted = _inputResampler.process(
+         _constPointers.data(), numFrames, _pointers.data(), _maxEngineFrames
+      );
+
+      for (uint32_t channel = 0; channel < _numIn; ++channel)
+      {
+         _constPointers[channel] = _engineFrames[channel].data();
+      }
+      bool overflow = _inputRing.write(_constPointers.data(), converted)
+         < converted;
+      if (overflow && !_inputOverflow)
+      {
+         ++_numDropouts;
+      }
+      _inputOverflow = overflow;
+
+      // The engine starts reading once the ring reached its target fill
+      // level, the drift can only be estimated from then on.
+      uint32_t fill = _inputRing.size();
+      _inputFilled  = _inputFilled || fill >= _inputTarget;
+      if (_inputFilled)
+      {
+         double factor = _inputDrift.update(fill - inputPassed, elapsed);
+         _inputResampler.adjustRatio(factor);
+
+         // The device delivers factor times as many frames as expected.
+         _drift.store((factor - 1.0) * 1e6);
+      }
+   }
+
+   if (_numOut > 0 && output != nullptr)
+   {
+      uint32_t needed = std::min(
+         _outputResampler.inputFramesFor(numFrames), _maxEngineFrames
+      );
+
+      for (uint32_t channel = 0; channel < _numOut; ++channel)
+      {
+         _pointers[channel] = _engineFrames[channel].data();
+      }
+
+      if (!_outputPrimed && _outputRing.size() >= _outputTarget + needed)
+      {
+         _outputPrimed = true;
+      }
+
+      uint32_t available = 0;
+      if (_outputPrimed)
+      {
+         available = _outputRing.read(_pointers.data(), needed);
+         if (available < needed)
+         {
+            ++_numDropouts;
+            _outputPrimed = false;
+         }
+      }
+
+      for (uint32_t channel = 0; channel < _numOut; ++channel)
+      {
+         std::fill(
+            _pointers[channel] + available, _pointers[channel] + needed, 0.0f
+         );
+         _constPointers[channel] = _pointers[channel];
+         _pointers[channel]      = _deviceFrames[channel].data();
+      }
+
+      uint32_t converted = _outputResampler.process(
+         _constPointers.data(), needed, _pointers.data(), numFrames
+      );
+
+      for (uint32_t channel = 0; channel < _numOut; ++channel)
+      {
+         const float* samples = _deviceFrames[channel].data();
+         for (uint32_t frame = 0; frame < numFrames; ++frame)
+         {
+            output[_numOut * frame + channel]
+               = frame < converted ? samples[frame] : 0.0f;
+         }
+      }
+
+      if (_outputPrimed)
+      {
+         double factor
+            = _outputDrift.update(_outputRing.size() + outputPassed, elapsed);
+         _outputResampler.adjustRatio(factor);
+
+         // The device consumes 1 / factor times as many frames as expected.
+         if (_numIn == 0)
+         {
+            _drift.store((1.0 / factor - 1.0) * 1e6);
+         }
+      }
+   }
+}
+
+void AuxiliaryStream::readInput(
+   Buffer& buffer, uint32_t firstChannel, uint32_t numFrames
+)
+{
+   if (_numIn == 0)
+   {
+      return;
+   }
+
+   for (uint32_t channel = 0; channel < _numIn; ++channel)
+   {
+      _enginePointers[channel] = &buffer.getSample(firstChannel + channel, 0);
+   }
+
+   if (!_inputPrimed && _inputRing.size() >= _inputTarget)
+   {
+      _inputPrimed = true;
+   }
+
+   uint32_t available = 0;
+   if (_inputPrimed)
+   {
+      available = _inputRing.read(_enginePointers.data(), numFrames);
+      if (available < numFrames)
+      {
+         ++_numDropouts;
+         _inputPrimed = false;
+      }
+   }
+
+   for (uint32_t channel = 0; channel < _numIn; ++channel)
+   {
+      std::fill(
+         _enginePointers[channel] + available,
+         _enginePointers[channel] + numFrames, 0.0f
+      );
+   }
+   _inputTime.store(_clock());
+}
+
+void AuxiliaryStream::writeOutput(
+   const Buffer& buffer, uint32_t firstChannel, uint32_t numFrames
+)
+{
+   if (_numOut == 0)
+   {
+      return;
+   }
+
+   for (uint32_t channel = 0; channel < _numOut; ++channel)
+   {
+      _constEnginePointers[channel]
+         = &buffer.getSample(firstChannel + channel, 0);
+   }
+
+   bool overflow = _outputRing.write(_constEnginePointers.data(), numFrames)
+      < numFrames;
+   _outputTime.store(_clock());
+   if (overflow && !_outputOverflow)
+   {
+      ++_numDropouts;
+   }
+   _outputOverflow = overflow;
+}
+
+void AuxiliaryStream::readInput(
+   SampleBuffer<double>& buffer, uint32_t firstChannel, uint32_t numFrames
+)
+{
+   numFrames = std::min(numFrames, _engineBlock.getNumFrames());
+   readInput(_engineBlock, 0, numFrames);
+
+   for (uint32_t channel = 0; channel < _numIn; ++channel)
+   {
+      const float* samples = &_engineBlock.getSample(channel, 0);
+      std::copy(
+         samples, samples + numFrames,
+         &buffer.getSample(firstChannel + channel, 0)
+      );
+   }
+}
+
+void AuxiliaryStream::writeOutput(
+   const SampleBuffer<double>& buffer, uint32_t firstChannel,
+   uint32_t numFrames
+)
+{
+   numFrames = std::min(numFrames, _engineBlock.getNumFrames());
+
+   for (uint32_t channel = 0; channel < _numOut; ++channel)
+   {
+      const double* samples = &buffer.getSample(firstChannel + channel, 0);
+      std::copy(
+         samples, samples + numFrames, &_engineBlock.getSample(channel, 0)
+      );
+   }
+
+   writeOutput(_engineBlock, 0, numFrames);
+}
+
+double AuxiliaryStream::driftPpm() const
+{
+   return _drift.load();
+}
+
+uint64_t AuxiliaryStream::numDropouts() const
+{
+   return _numDropouts.load();
+}
+
+void AuxiliaryStream::setClock(double (*clock)())
+{
+   _clock = clock;
+}
+
+int AuxiliaryStream::AudioCallback(
+   void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames,
+   double /*streamTime*/, unsigned int /*status*/, void* userData
+)
+{
+   auto stream = static_cast<AuxiliaryStream*>(userData);
+   ScopedDenormals denormals(stream->_realtime.flushDenormals);
+
+   if (stream->_configureThread.load(std::memory_order_relaxed))
+   {
+      stream->_configureThread.store(false, std::memory_order_relaxed);
+      configureAudioThread(stream->_realtime);
+   }
+
+   stream->deviceCallback(
+      (const float*)inputBuffer, (float*)outputBuffer, nBufferFrames
+   );
+   return 0;
+}
+
+} // namespace ImRt
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <RtAudio.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "imrt-realtime.h"
+#include "imrt-resampler.h"
+#include "imrt-ring.h"
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                        DRIFT ESTIMATOR                                     */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Estimates the drift between two clocks from the fill level of a ring
+ * buffer between them and returns the factor by which a Resampler has to
+ * adjust its ratio to compensate the drift (cf. Resampler::adjustRatio()).
+ *
+ * The fill level is smoothed to remove the jitter caused by the block sizes
+ * of both sides and fed to a proportional-integral controller that keeps it
+ * at the target. The integral part converges to the actual drift, so the
+ * ratio changes very slowly and never audibly.
+ */
+class DriftEstimator
+{
+public:
+   /**
+    * @brief Resets the estimator.
+    *
+    * @param sampleRate The sample rate at which the ring is filled and
+    * drained, i.e. the unit of the fill level.
+    * @param targetFill The fill level to maintain in frames.
+    * @param bandwidth The bandwidth of the control loop in Hz. Lower values
+    * react more slowly but average out more jitter.
+    * @param maxDeviation The maximum deviation of the returned factor from 1,
+    * i.e. the largest drift that can be compensated.
+    */
+   void reset(
+      double sampleRate, double targetFill, double bandwidth = 0.01,
+      double maxDeviation = 0.005
+   );
+
+   /**
+    * @brief Updates the estimate with a new measurement of the fill level.
+    *
+    * @param fill The current fill level in frames.
+    * @param elapsed The time since the last update in seconds.
+    * @return The factor to pass to Resampler::adjustRatio(). A factor greater
+    * than 1 means that the ring fills up and has to be drained faster.
+    */
+   double update(double fill, double elapsed);
+
+   /**
+    * @brief Returns the current factor.
+    */
+   double factor() const;
+
+   /**
+    * @brief Returns the target fill level in frames.
+    */
+   double targetFill() const;
+
+private:
+   double _target = 0.0, _smoothed = 0.0, _integral = 0.0;
+   double _kp = 0.0, _ki = 0.0, _maxDeviation = 0.0;
+   double _factor = 1.0;
+   bool _started  = false;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                       AUXILIARY STREAM                                     */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Settings of an AuxiliaryStream.
+ */
+struct AuxiliaryStreamSettings
+{
+   RtAudio::Api api        = RtAudio::UNSPECIFIED;
+   uint32_t inputDeviceId  = 0; // 0 means the default input device
+   uint32_t outputDeviceId = 0; // 0 means the default output device
+   int numChannelsIn       = 2; // 0 means no input
+   int numChannelsOut      = 2; // 0 means no output
+   int firstChannelIn      = 0;
+   int firstChannelOut     = 0;
+   uint32_t sampleRate     = 44100;
+   uint32_t bufferSize     = 256;
+
+   ResamplerQuality resamplerQuality = ResamplerQuality::Medium;
+};
+
+/**
+ * @brief An additional audio stream, usually of another device, whose
+ * channels are processed together with the channels of the main stream of a
+ * Dsp (cf. Dsp::addAuxiliaryStream()). The clocks of both devices are
+ * independent and drift apart, so the frames are passed through a FrameRing
+ * in each direction and converted between the rate of the auxiliary device
+ * and the engine rate by a Resampler whose ratio is steered by a
+ * DriftEstimator. All conversion work is done on the thread of the auxiliary
+ * device, the main stream only copies frames from and to the rings.
+ *
+ * The device side (AuxiliaryStream::deviceCallback()) and the engine side
+ * (AuxiliaryStream::readInput() and AuxiliaryStream::writeOutput()) can also
+ * be driven without opening a device, e.g. by a simulated clock (cf.
+ * AuxiliaryStream::setClock()).
+ */
+class AuxiliaryStream
+{
+public:
+   /**
+    * @brief Constructs a new auxiliary stream with the given settings.
+    */
+   AuxiliaryStream(AuxiliaryStreamSettings settings);
+   AuxiliaryStream() = delete;
+
+   /**
+    * @brief Stops the stream and destroys the object.
+    */
+   ~AuxiliaryStream();
+
+   /**
+    * @brief Allocates the rings and resamplers and resets the drift
+    * estimation. This method is called by AuxiliaryStream::start() and must
+    * not be called while the stream is running.
+    *
+    * @param engineRate The sample rate of the engine.
+    * @param maxEngineFrames The maximum number of frames per engine block.
+    */
+   void prepare(double engineRate, uint32_t maxEngineFrames);
+
+   /**
+    * @brief Opens and starts the stream of the auxiliary device.
+    *
+    * @param engineRate The sample rate of the engine.
+    * @param maxEngineFrames The maximum number of frames per engine block.
+    * @param realtime The priority, cores and denormal handling of the
+    * callback thread of the device.
+    * @return false if the stream could not be opened or started.
+    */
+   bool start(
+      double engineRate, uint32_t maxEngineFrames,
+      const RealtimeSettings& realtime = RealtimeSettings()
+   );
+
+   /**
+    * @brief Stops and closes the stream of the auxiliary device.
+    */
+   void stop();
+
+   /**
+    * @brief Returns true if the stream of the auxiliary device is running.
+    */
+   bool isRunning() const;
+
+   /**
+    * @brief Returns the settings of the stream. The buffer size and sample
+    * rate are the actual ones once the stream is open.
+    */
+   const AuxiliaryStreamSettings& settings() const;
+
+   /**
+    * @brief Processes one buffer of the auxiliary device. This method is
+    * called by the callback of the device and must only be called from one
+    * thread.
+    *
+    * @param input The interleaved input frames or nullptr.
+    * @param output The interleaved output frames or nullptr.
+    * @param numFrames The number of frames.
+    */
+   void deviceCallback(const float* input, float* output, uint32_t numFrames);
+
+   /**
+    * @brief Reads one engine block of input frames of the auxiliary device.
+    * Frames missing because the device has not started yet or because of a
+    * dropout are filled with silence. This method must only be called from
+    * the engine thread.
+    *
+    * @param buffer The engine input buffer.
+    * @param firstChannel The channel of the buffer to write the first
+    * channel of the device to.
+    * @param numFrames The number of frames to read.
+    */
+   void readInput(Buffer& buffer, uint32_t firstChannel, uint32_t numFrames);
+
+   /**
+    * @brief Writes one engine block of output frames for the auxiliary
+    * device. This method must only be called from the engine thread.
+    *
+    * @param buffer The engine output buffer.
+    * @param firstChannel The channel of the buffer holding the first channel
+    * of the device.
+    * @param numFrames The number of frames to write.
+    */
+   void
+   writeOutput(const Buffer& buffer, uint32_t firstChannel, uint32_t numFrames);
+
+   /**
+    * @brief Reads one engine block of input frames into a double precision
+    * buffer (cf. AuxiliaryStream::readInput()).
+    */
+   void readInput(
+      SampleBuffer<double>& buffer, uint32_t firstChannel, uint32_t numFrames
+   );
+
+   /**
+    * @brief Writes one engine block of output frames from a double precision
+    * buffer (cf. AuxiliaryStream::writeOutput()).
+    */
+   void writeOutput(
+      const SampleBuffer<double>& buffer, uint32_t firstChannel,
+      uint32_t numFrames
+   );
+
+   /**
+    * @brief Returns the estimated drift of the auxiliary clock relative to the
+    * engine clock in parts per million. Positive values mean that the
+    * auxiliary device runs faster than its nominal rate relative to the
+    * engine.
+    */
+   double driftPpm() const;
+
+   /**
+    * @brief Returns the number of dropouts, i.e. how often a ring ran empty
+    * or full, since the stream was started.
+    */
+   uint64_t numDropouts() const;
+
+   /**
+    * @brief Replaces the clock in seconds that relates the blocks of the
+    * device to the blocks of the engine. It defaults to the steady clock and
+    * is only replaced to drive both sides by a simulated clock.
+    */
+   void setClock(double (*clock)());
+
+private:
+   AuxiliaryStreamSettings _settings;
+   std::unique_ptr<RtAudio> _dac;
+
+   double _deviceRate = 0.0, _engineRate = 0.0;
+   double (*_clock)();
+   uint32_t _numIn = 0, _numOut = 0;
+   uint32_t _maxDeviceFrames = 0, _maxEngineFrames = 0;
+   uint32_t _inputTarget = 0, _outputTarget = 0;
+
+   // Device thread
+   FrameRing _inputRing, _outputRing;
+   Resampler _inputResampler, _outputResampler;
+   DriftEstimator _inputDrift, _outputDrift;
+   std::vector<std::vector<float>> _deviceFrames, _engineFrames;
+   std::vector<const float*> _constPointers;
+   std::vector<float*> _pointers;
+   bool _inputFilled = false, _inputOverflow = false, _outputPrimed = false;
+
+   // Engine thread
+   std::vector<float*> _enginePointers;
+   std::vector<const float*> _constEnginePointers;
+   Buffer _engineBlock; // float copy of a double precision engine block
+   bool _inputPrimed = false, _outputOverflow = false;
+
+   RealtimeSettings _realtime;
+   std::atomic<bool> _configureThread { false };
+
+   // Time of the last engine block read from or written to the rings
+   std::atomic<double> _inputTime { 0.0 }, _outputTime { 0.0 };
+
+   std::atomic<double> _drift { 0.0 };
+   std::atomic<uint64_t> _numDropouts { 0 };
+
+   void processChunk(const float* input, float* output, uint32_t numFrames);
+
+   static int AudioCallback(
+      void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames,
+      double streamTime, unsigned int status, void* userData
+   );
+};
+
+} // namespace ImRt
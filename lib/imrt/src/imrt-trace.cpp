@@ -0,0 +1,289 @@
+#include "imrt-trace.h"
+#include "imrt-ring.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                      trace state                       */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   // 64k events of 24 bytes per thread hold a few seconds of a busy thread.
+   const uint32_t eventsPerThread = 1 << 16;
+
+   // The most threads that can be traced at the same time.
+   const uint32_t maxThreads = 64;
+
+   enum ThreadState : int
+   {
+      freeThread,   // reserved and empty, can be claimed by a thread
+      activeThread, // claimed by a running thread
+      exitedThread  // the thread exited, its events are not saved yet
+   };
+
+   struct ThreadTrace
+   {
+      Ring<TraceEvent> events;
+      std::atomic<int> state { freeThread };
+      std::atomic<const char*> name { nullptr };
+      std::atomic<uint32_t> id { 0 };
+      std::atomic<uint64_t> numDropped { 0 };
+   };
+
+   /**
+    * The buffers of the threads are kept in a pool and recycled once their
+    * thread exited and its events were saved. Entries are only added under
+    * the mutex and published by incrementing numThreads, so they can be
+    * claimed without locking.
+    */
+   struct TraceState
+   {
+      std::mutex mutex;
+      std::unique_ptr<ThreadTrace> threads[maxThreads];
+      std::atomic<uint32_t> numThreads { 0 };
+      std::atomic<uint32_t> nextId { 1 };
+
+      // The origin of the trace, used to convert the ticks to microseconds.
+      uint64_t originTicks = traceClock();
+      std::chrono::steady_clock::time_point originTime
+         = std::chrono::steady_clock::now();
+   };
+
+   TraceState& traceState()
+   {
+      static TraceState state;
+      return state;
+   }
+
+   // Allocates entries until count of them are free, as far as the pool
+   // allows. The mutex must be held.
+   void reserve(TraceState& state, uint32_t count)
+   {
+      uint32_t numThreads = state.numThreads.load(std::memory_order_relaxed);
+      uint32_t numFree    = 0;
+      for (uint32_t i = 0; i < numThreads; ++i)
+      {
+         numFree += state.threads[i]->state.load() == freeThread;
+      }
+
+      for (; numFree < count && numThreads < maxThreads; ++numFree)
+      {
+         auto thread = std::make_unique<ThreadTrace>();
+         thread->events.reset(eventsPerThread);
+         state.threads[numThreads] = std::move(thread);
+         state.numThreads.store(++numThreads, std::memory_order_release);
+      }
+   }
+
+   ThreadTrace* claimFree(TraceState& state)
+   {
+      uint32_t numThreads = state.numThreads.load(std::memory_order_acquire);
+      for (uint32_t i = 0; i < numThreads; ++i)
+      {
+         ThreadTrace* thread = state.threads[i].get();
+         int expected        = freeThread;
+         if (thread->state.compare_exchange_strong(expected, activeThread))
+         {
+            thread->id.store(state.nextId.fetch_add(1));
+            thread->name.store(nullptr);
+            thread->numDropped.store(0);
+            return thread;
+         }
+      }
+      return nullptr;
+   }
+
+   // Claims a reserved entry, which is realtime-safe, or allocates one if
+   // none was reserved. Returns nullptr if the pool is exhausted.
+   ThreadTrace* claimThread()
+   {
+      TraceState& state   = traceState();
+      ThreadTrace* thread = claimFree(state);
+      while (!thread)
+      {
+         std::lock_guard<std::mutex> lock(state.mutex);
+         if (state.numThreads.load() == maxThreads)
+         {
+            return claimFree(state);
+         }
+         reserve(state, 1);
+         thread = claimFree(state);
+      }
+      return thread;
+   }
+
+   /**
+    * The entry of a thread, which is claimed with the first event or name of
+    * the thread and handed back when the thread exits.
+    */
+   struct ThisThread
+   {
+      ThreadTrace* trace = nullptr;
+      bool claimed       = false;
+
+      ThreadTrace* get()
+      {
+         if (!claimed)
+         {
+            trace   = claimThread();
+            claimed = true;
+         }
+         return trace;
+      }
+
+      ~ThisThread()
+      {
+         if (trace)
+         {
+            trace->state.store(exitedThread);
+         }
+      }
+   };
+
+   thread_local ThisThread thisThread;
+
+   void writeString(std::FILE* file, const char* text)
+   {
+      std::fputc('"', file);
+      for (; *text; ++text)
+      {
+         if (*text == '"' || *text == '\\')
+         {
+            std::fputc('\\', file);
+         }
+         std::fputc(*text, file);
+      }
+      std::fputc('"', file);
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                         trace                          */
+/* ------------------------------------------------------ */
+
+void reserveTraceThreads(uint32_t count)
+{
+   TraceState& state = traceState();
+   std::lock_guard<std::mutex> lock(state.mutex);
+   reserve(state, count);
+}
+
+void setTraceThreadName(const char* name)
+{
+   if (ThreadTrace* thread = thisThread.get())
+   {
+      thread->name.store(name);
+   }
+}
+
+void recordTraceEvent(const char* name, uint64_t begin, uint64_t end)
+{
+   ThreadTrace* thread = thisThread.get();
+   if (thread && !thread->events.push({ name, begin, end }))
+   {
+      thread->numDropped.fetch_add(1, std::memory_order_relaxed);
+   }
+}
+
+bool saveTrace(const std::string& path)
+{
+   TraceState& state = traceState();
+   std::lock_guard<std::mutex> lock(state.mutex);
+
+   std::FILE* file = std::fopen(path.c_str(), "w");
+   if (!file)
+   {
+      return false;
+   }
+
+   uint64_t ticks = traceClock() - state.originTicks;
+   std::chrono::duration<double, std::micro> elapsed
+      = std::chrono::steady_clock::now() - state.originTime;
+   double ticksPerMicrosecond
+      = elapsed.count() > 0.0 ? ticks / elapsed.count() : 1000.0;
+
+   // Events may begin shortly before the state was created on their end.
+   auto microseconds = [&](uint64_t time)
+   { return int64_t(time - state.originTicks) / ticksPerMicrosecond; };
+
+   std::fprintf(file, "{\"traceEvents\":[\n");
+   bool first = true;
+
+   std::vector<TraceEvent> events(1024);
+   uint32_t numThreads = state.numThreads.load(std::memory_order_acquire);
+   for (uint32_t i = 0; i < numThreads; ++i)
+   {
+      ThreadTrace* thread = state.threads[i].get();
+      int threadState     = thread->state.load();
+      if (threadState == freeThread)
+      {
+         continue;
+      }
+
+      uint32_t id      = thread->id.load();
+      const char* text = thread->name.load();
+      std::string name = text ? text : "thread " + std::to_string(id);
+      uint64_t dropped = thread->numDropped.exchange(0);
+      if (dropped > 0)
+      {
+         name += " (" + std::to_string(dropped) + " events dropped)";
+      }
+
+      std::fprintf(
+         file,
+         "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+         "\"args\":{\"name\":",
+         first ? "" : ",\n", id
+      );
+      writeString(file, name.c_str());
+      std::fprintf(file, "}}");
+      first = false;
+
+      uint32_t numEvents;
+      while ((numEvents = thread->events.pop(events.data(), events.size())))
+      {
+         for (uint32_t i = 0; i < numEvents; ++i)
+         {
+            const TraceEvent& event = events[i];
+            std::fprintf(file, ",\n{\"name\":");
+            writeString(file, event.name);
+
+            if (event.end == event.begin)
+            {
+               std::fprintf(
+                  file, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f",
+                  microseconds(event.begin)
+               );
+            }
+            else
+            {
+               std::fprintf(
+                  file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f",
+                  microseconds(event.begin),
+                  (event.end - event.begin) / ticksPerMicrosecond
+               );
+            }
+            std::fprintf(file, ",\"pid\":1,\"tid\":%u}", id);
+         }
+      }
+
+      // All events of an exited thread are saved, so its entry is recycled.
+      if (threadState == exitedThread)
+      {
+         thread->state.store(freeThread);
+      }
+   }
+
+   std::fprintf(file, "\n]}\n");
+   return std::fclose(file) == 0;
+}
+
+} // namespace ImRt
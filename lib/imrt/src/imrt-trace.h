@@ -0,0 +1,146 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+#include <intrin.h>
+#define IMRT_TRACE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define IMRT_TRACE_RDTSC 1
+#endif
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                            TRACE EVENT                                     */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A traced scope or, if begin and end are equal, an instant. The name
+ * must be a string literal, since only the pointer is stored.
+ */
+struct TraceEvent
+{
+   const char* name;
+   uint64_t begin; // cf. traceClock()
+   uint64_t end;
+};
+
+/**
+ * @brief Returns the timestamp of trace events: the time stamp counter of the
+ * CPU on x86 and the steady clock in nanoseconds elsewhere. The ticks are
+ * converted to microseconds when the trace is saved.
+ */
+inline uint64_t traceClock()
+{
+#if defined(IMRT_TRACE_RDTSC)
+   return __rdtsc();
+#else
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()
+   )
+      .count();
+#endif
+}
+
+/**
+ * @brief Makes sure that buffers for the given number of threads are
+ * allocated and not in use, so that as many threads can start tracing
+ * without locking or allocating. Call it before starting a thread that must
+ * not block, like the audio thread (cf. IMRT_TRACE_RESERVE_THREADS()). The
+ * buffers of threads that exited are reused once their events were saved.
+ */
+void reserveTraceThreads(uint32_t count);
+
+/**
+ * @brief Sets the name of the calling thread, which is shown in the trace
+ * viewer. The name must be a string literal, since only the pointer is
+ * stored. Threads that record events without calling this method are shown
+ * under a generic name.
+ *
+ * The first call of this method or recordTraceEvent() on a thread claims one
+ * of the reserved buffers, which is realtime-safe. If none is left, a buffer
+ * is allocated under a lock; if 64 threads are traced already, the events of
+ * the thread are dropped.
+ */
+void setTraceThreadName(const char* name);
+
+/**
+ * @brief Records an event in the lock-free buffer of the calling thread. The
+ * event is dropped if the buffer is full, i.e. if the trace was not saved
+ * for a long time.
+ */
+void recordTraceEvent(const char* name, uint64_t begin, uint64_t end);
+
+/**
+ * @brief Moves the events recorded by all threads to a JSON file in the
+ * Chrome trace event format, which can be opened in Perfetto
+ * (ui.perfetto.dev) or chrome://tracing. The buffers are empty afterwards,
+ * so a trace can be saved periodically. This method may be called by any
+ * thread, but not concurrently.
+ *
+ * @return false if the file could not be written.
+ */
+bool saveTrace(const std::string& path);
+
+/* -------------------------------------------------------------------------- */
+/*                            TRACE SCOPE                                     */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Records the lifetime of the object as trace event. Use the macro
+ * IMRT_TRACE_SCOPE() instead, which compiles to nothing unless
+ * IMRT_ENABLE_TRACE is defined.
+ */
+class TraceScope
+{
+public:
+   TraceScope(const char* name)
+      : _name(name)
+      , _begin(traceClock())
+   {
+   }
+
+   ~TraceScope()
+   {
+      recordTraceEvent(_name, _begin, traceClock());
+   }
+
+   TraceScope(const TraceScope&)            = delete;
+   TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+   const char* _name;
+   uint64_t _begin;
+};
+
+} // namespace ImRt
+
+/* -------------------------------------------------------------------------- */
+/*                           TRACE MACROS                                     */
+/* -------------------------------------------------------------------------- */
+
+// The markers record events if the library is built with the CMake option
+// IMRT_ENABLE_TRACE. Otherwise they compile to nothing.
+#if defined(IMRT_ENABLE_TRACE)
+#define IMRT_TRACE_CONCAT_(a, b) a##b
+#define IMRT_TRACE_CONCAT(a, b) IMRT_TRACE_CONCAT_(a, b)
+#define IMRT_TRACE_SCOPE(name)                                                \
+   ImRt::TraceScope IMRT_TRACE_CONCAT(imrtTraceScope, __LINE__)(name)
+#define IMRT_TRACE_INSTANT(name)                                              \
+   do                                                                         \
+   {                                                                          \
+      uint64_t imrtTraceNow = ImRt::traceClock();                             \
+      ImRt::recordTraceEvent(name, imrtTraceNow, imrtTraceNow);               \
+   } while (false)
+#define IMRT_TRACE_THREAD(name) ImRt::setTraceThreadName(name)
+#define IMRT_TRACE_RESERVE_THREADS(count) ImRt::reserveTraceThreads(count)
+#else
+#define IMRT_TRACE_SCOPE(name)
+#define IMRT_TRACE_INSTANT(name)
+#define IMRT_TRACE_THREAD(name)
+#define IMRT_TRACE_RESERVE_THREADS(count)
+#endif
@@ -0,0 +1,403 @@
+#include "imrt-voices.h"
+#include "imrt-simd.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace ImRt {
+
+/* ------------------------------------------------------ */
+/*                       constants                        */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   // Number of voices rendered at once, i.e. the SIMD width.
+   const uint32_t groupSize = 4;
+
+   // Maximum number of frames between two updates of the envelope stages.
+   const uint32_t controlInterval = 16;
+
+   // The attack ends at this level, a released voice is freed below silence.
+   const float attackEnd = 0.99f;
+   const float silence   = 1e-4f;
+
+   // Correction of the parabolic sine approximation.
+   const float parabolaCorrection = 0.225f;
+
+   float noteFrequency(uint32_t note)
+   {
+      return 440.0f * std::exp2((float(note) - 69.0f) / 12.0f);
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                       voice pool                       */
+/* ------------------------------------------------------ */
+
+void VoicePool::prepare(
+   uint32_t sampleRate, uint32_t maxFrames, uint32_t numVoices
+)
+{
+   assert(sampleRate > 0 && numVoices > 0);
+
+   _sampleRate = sampleRate;
+   _maxFrames  = maxFrames;
+   _numVoices  = numVoices;
+   _numActive  = 0;
+   _clock      = 0;
+   _numStolen  = 0;
+   _gain       = _settings.gain;
+
+   size_t padded = (numVoices + groupSize - 1) / groupSize * groupSize;
+   for (auto* state : { &_phase, &_increment, &_level, &_target, &_coefficient,
+                        &_velocity })
+   {
+      state->assign(padded, 0.0f);
+   }
+   _notes.assign(padded, 0);
+   _ages.assign(padded, 0);
+   _stages.assign(padded, Stage::Release);
+
+   _partials.assign(groupSize * controlInterval, 0.0f);
+   _mix.assign(maxFrames, 0.0f);
+
+   setSettings(_settings);
+}
+
+void VoicePool::setSettings(const VoiceSettings& settings)
+{
+   _settings           = settings;
+   _attackCoefficient  = coefficient(settings.attack);
+   _decayCoefficient   = coefficient(settings.decay);
+   _releaseCoefficient = coefficient(settings.release);
+
+   for (uint32_t voice = 0; voice < _numActive; ++voice)
+   {
+      setStage(voice, _stages[voice]);
+   }
+}
+
+void VoicePool::noteOn(uint32_t note, float velocity)
+{
+   uint32_t voice    = allocateVoice();
+   _notes[voice]     = note;
+   _increment[voice] = noteFrequency(note) / float(_sampleRate);
+   _velocity[voice]  = velocity;
+   _ages[voice]      = _clock++;
+   setStage(voice, Stage::Attack);
+}
+
+void VoicePool::noteOff(uint32_t note)
+{
+   for (uint32_t voice = 0; voice < _numActive; ++voice)
+   {
+      if (_notes[voice] == note && _stages[voice] != Stage::Release)
+      {
+         setStage(voice, Stage::Release);
+      }
+   }
+}
+
+void VoicePool::allNotesOff()
+{
+   for (uint32_t voice = 0; voice < _numActive; ++voice)
+   {
+      setStage(voice, Stage::Release);
+   }
+}
+
+uint32_t VoicePool::numActiveVoices() const
+{
+   return _numActive;
+}
+
+uint64_t VoicePool::numStolenVoices() const
+{
+   return _numStolen;
+}
+
+void VoicePool::process(
+   Buffer& buffer, uint32_t numFrames, const NoteEvent* events,
+   uint32_t numEvents
+)
+{
+   assert(numFrames <= _maxFrames);
+
+   std::fill(_mix.begin(), _mix.begin() + numFrames, 0.0f);
+
+   // The block is split at the event offsets and at least every control
+   // interval, where the envelope stages are updated.
+   uint32_t frame = 0, event = 0;
+   while (frame < numFrames)
+   {
+      for (; event < numEvents && events[event].offset <= frame; ++event)
+      {
+         handleEvent(events[event]);
+      }
+
+      uint32_t end = std::min(numFrames, frame + controlInterval);
+      if (event < numEvents)
+      {
+         end = std::min(end, events[event].offset);
+      }
+
+      updateStages();
+      render(frame, end - frame);
+      frame = end;
+   }
+   for (; event < numEvents; ++event)
+   {
+      handleEvent(events[event]);
+   }
+
+   float step = numFrames > 0 ? (_settings.gain - _gain) / numFrames : 0.0f;
+   for (uint32_t channel = 0; channel < buffer.getNumChannels(); ++channel)
+   {
+      float* signal = &buffer.getSample(channel, 0);
+      float gain    = _gain;
+      for (uint32_t i = 0; i < numFrames; ++i)
+      {
+         gain += step;
+         signal[i] += gain * _mix[i];
+      }
+   }
+   _gain = _settings.gain;
+}
+
+void VoicePool::handleEvent(const NoteEvent& event)
+{
+   if (event.velocity > 0.0f)
+   {
+      noteOn(event.note, event.velocity);
+   }
+   else
+   {
+      noteOff(event.note);
+   }
+}
+
+uint32_t VoicePool::allocateVoice()
+{
+   if (_numActive < _numVoices)
+   {
+      uint32_t voice = _numActive++;
+      _phase[voice]  = 0.0f;
+      _level[voice]  = 0.0f;
+      return voice;
+   }
+
+   // The quietest released voice is stolen, or the oldest voice if none is
+   // released.
+   uint32_t stolen = 0;
+   bool released   = false;
+   for (uint32_t voice = 0; voice < _numActive; ++voice)
+   {
+      if (_stages[voice] == Stage::Release)
+      {
+         if (!released || _level[voice] < _level[stolen])
+         {
+            stolen   = voice;
+            released = true;
+         }
+      }
+      else if (!released && _ages[voice] < _ages[stolen])
+      {
+         stolen = voice;
+      }
+   }
+   ++_numStolen;
+   return stolen;
+}
+
+void VoicePool::setStage(uint32_t voice, Stage stage)
+{
+   _stages[voice] = stage;
+   switch (stage)
+   {
+   case Stage::Attack:
+      _target[voice]      = 1.0f;
+      _coefficient[voice] = _attackCoefficient;
+      break;
+   case Stage::Decay:
+      _target[voice]      = _settings.sustain;
+      _coefficient[voice] = _decayCoefficient;
+      break;
+   case Stage::Release:
+      _target[voice]      = 0.0f;
+      _coefficient[voice] = _releaseCoefficient;
+      break;
+   }
+}
+
+void VoicePool::freeVoice(uint32_t voice)
+{
+   // The last active voice takes the place of the freed one, and its old
+   // place is silenced.
+   uint32_t last = --_numActive;
+   if (voice != last)
+   {
+      _phase[voice]       = _phase[last];
+      _increment[voice]   = _increment[last];
+      _level[voice]       = _level[last];
+      _target[voice]      = _target[last];
+      _coefficient[voice] = _coefficient[last];
+      _velocity[voice]    = _velocity[last];
+      _notes[voice]       = _notes[last];
+      _ages[voice]        = _ages[last];
+      _stages[voice]      = _stages[last];
+   }
+   _increment[last] = 0.0f;
+   _level[last]     = 0.0f;
+   _target[last]    = 0.0f;
+   _velocity[last]  = 0.0f;
+   _stages[last]    = Stage::Release;
+}
+
+void VoicePool::updateStages()
+{
+   for (uint32_t voice = 0; voice < _numActive;)
+   {
+      if (_stages[voice] == Stage::Attack && _level[voice] >= attackEnd)
+      {
+         setStage(voice, Stage::Decay);
+      }
+      else if (_stages[voice] == Stage::Release && _level[voice] < silence)
+      {
+         freeVoice(voice);
+         continue; // the moved voice is checked next
+      }
+      ++voice;
+   }
+}
+
+void VoicePool::render(uint32_t offset, uint32_t numFrames)
+{
+   if (_numActive == 0 || numFrames == 0)
+   {
+      return;
+   }
+
+   float* partials = _partials.data();
+   std::fill(partials, partials + groupSize * numFrames, 0.0f);
+
+   // Each group of voices is rendered for all frames, so that its state stays
+   // in registers, and accumulated into one partial sum per lane and frame.
+   for (uint32_t first = 0; first < _numActive; first += groupSize)
+   {
+#if defined(IMRT_SIMD_SSE)
+      const __m128 one  = _mm_set1_ps(1.0f);
+      const __m128 two  = _mm_set1_ps(2.0f);
+      const __m128 four = _mm_set1_ps(4.0f);
+      const __m128 sign = _mm_set1_ps(-0.0f);
+      const __m128 p    = _mm_set1_ps(parabolaCorrection);
+
+      __m128 phase       = _mm_loadu_ps(&_phase[first]);
+      __m128 increment   = _mm_loadu_ps(&_increment[first]);
+      __m128 level       = _mm_loadu_ps(&_level[first]);
+      __m128 target      = _mm_loadu_ps(&_target[first]);
+      __m128 coefficient = _mm_loadu_ps(&_coefficient[first]);
+      __m128 velocity    = _mm_loadu_ps(&_velocity[first]);
+
+      for (uint32_t frame = 0; frame < numFrames; ++frame)
+      {
+         phase = _mm_add_ps(phase, increment);
+         phase = _mm_sub_ps(phase, _mm_and_ps(_mm_cmpge_ps(phase, one), one));
+
+         __m128 x = _mm_sub_ps(_mm_mul_ps(phase, two), one);
+         __m128 y = _mm_mul_ps(
+            _mm_mul_ps(four, x), _mm_sub_ps(one, _mm_andnot_ps(sign, x))
+         );
+         __m128 error = _mm_sub_ps(_mm_mul_ps(y, _mm_andnot_ps(sign, y)), y);
+         y            = _mm_add_ps(_mm_mul_ps(p, error), y);
+
+         level = _mm_add_ps(
+            level, _mm_mul_ps(_mm_sub_ps(target, level), coefficient)
+         );
+
+         float* partial = partials + groupSize * frame;
+         _mm_storeu_ps(
+            partial,
+            _mm_add_ps(
+               _mm_loadu_ps(partial),
+               _mm_mul_ps(y, _mm_mul_ps(level, velocity))
+            )
+         );
+      }
+      _mm_storeu_ps(&_phase[first], phase);
+      _mm_storeu_ps(&_level[first], level);
+#elif defined(IMRT_SIMD_NEON)
+      const float32x4_t one = vdupq_n_f32(1.0f);
+      const float32x4_t two = vdupq_n_f32(2.0f);
+      const float32x4_t p   = vdupq_n_f32(parabolaCorrection);
+
+      float32x4_t phase       = vld1q_f32(&_phase[first]);
+      float32x4_t increment   = vld1q_f32(&_increment[first]);
+      float32x4_t level       = vld1q_f32(&_level[first]);
+      float32x4_t target      = vld1q_f32(&_target[first]);
+      float32x4_t coefficient = vld1q_f32(&_coefficient[first]);
+      float32x4_t velocity    = vld1q_f32(&_velocity[first]);
+
+      for (uint32_t frame = 0; frame < numFrames; ++frame)
+      {
+         phase = vaddq_f32(phase, increment);
+         phase = vbslq_f32(vcgeq_f32(phase, one), vsubq_f32(phase, one), phase);
+
+         float32x4_t x = vsubq_f32(vmulq_f32(phase, two), one);
+         float32x4_t y = vmulq_n_f32(
+            vmulq_f32(x, vsubq_f32(one, vabsq_f32(x))), 4.0f
+         );
+         y = vmlaq_f32(y, p, vsubq_f32(vmulq_f32(y, vabsq_f32(y)), y));
+
+         level = vmlaq_f32(level, vsubq_f32(target, level), coefficient);
+
+         float* partial = partials + groupSize * frame;
+         vst1q_f32(
+            partial,
+            vmlaq_f32(vld1q_f32(partial), y, vmulq_f32(level, velocity))
+         );
+      }
+      vst1q_f32(&_phase[first], phase);
+      vst1q_f32(&_level[first], level);
+#else
+      for (uint32_t lane = 0; lane < groupSize; ++lane)
+      {
+         uint32_t voice = first + lane;
+         float phase    = _phase[voice];
+         float level    = _level[voice];
+
+         for (uint32_t frame = 0; frame < numFrames; ++frame)
+         {
+            phase += _increment[voice];
+            phase -= phase >= 1.0f ? 1.0f : 0.0f;
+
+            float x = 2.0f * phase - 1.0f;
+            float y = 4.0f * x * (1.0f - std::abs(x));
+            y += parabolaCorrection * (y * std::abs(y) - y);
+
+            level += (_target[voice] - level) * _coefficient[voice];
+            partials[groupSize * frame + lane] += y * level * _velocity[voice];
+         }
+         _phase[voice] = phase;
+         _level[voice] = level;
+      }
+#endif
+   }
+
+   for (uint32_t frame = 0; frame < numFrames; ++frame)
+   {
+      const float* partial = partials + groupSize * frame;
+      _mix[offset + frame] = partial[0] + partial[1] + partial[2] + partial[3];
+   }
+}
+
+float VoicePool::coefficient(float time) const
+{
+   // The level of a one-pole filter covers 99 % of the distance to its target
+   // in the given time.
+   float frames = time * float(_sampleRate);
+   return frames > 1.0f ? 1.0f - std::exp(-std::log(100.0f) / frames) : 1.0f;
+}
+
+} // namespace ImRt
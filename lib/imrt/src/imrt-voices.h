@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "imrt-constants.h"
+
+namespace ImRt {
+
+/* -------------------------------------------------------------------------- */
+/*                            NOTE EVENT                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A note on or off for the current audio block. The offset is the
+ * frame within the block at which the event takes effect, a velocity of zero
+ * ends the note.
+ */
+struct NoteEvent
+{
+   uint32_t offset;
+   uint32_t note; // MIDI note number, 69 is A4 = 440 Hz
+   float velocity;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                             VOICE POOL                                     */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Settings of the voices of a VoicePool, typically read from
+ * ParameterHandles at the beginning of every block. Times are given in
+ * seconds.
+ */
+struct VoiceSettings
+{
+   float attack  = 0.005f;
+   float decay   = 0.2f;
+   float sustain = 0.7f;
+   float release = 0.3f;
+   float gain    = 0.25f;
+};
+
+/**
+ * @brief A polyphonic voice engine with a fixed number of preallocated voices,
+ * each consisting of an oscillator with a sine-like waveform and an ADSR
+ * envelope.
+ *
+ * The voice state is stored as structure of arrays, and the active voices are
+ * kept at the front of the arrays. Voices are rendered in groups of four
+ * with SSE or NEON instructions if available, so the state of a group stays
+ * in registers for a whole segment. Envelope stages advance at control rate,
+ * every 16 frames at most. When all voices are in use, a new note steals the
+ * quietest released voice or, if there is none, the oldest voice. The stolen
+ * voice continues from its current level and phase, so stealing does not
+ * click.
+ *
+ * Note events can be passed to VoicePool::process() with sample-accurate
+ * offsets, e.g. popped from a Ring<NoteEvent> that the GUI thread fills. All
+ * methods except VoicePool::prepare() must be called by the DSP thread.
+ *
+ * @code
+ * // DSP thread, e.g. in Dsp::process()
+ * voices.setSettings({ attack.value(), decay.value(), sustain.value(),
+ *                      release.value(), volume.value() });
+ * voices.process(out, numFrames, events, numEvents);
+ * @endcode
+ */
+class VoicePool
+{
+public:
+   /**
+    * @brief Allocates the voices and silences them. This method must not be
+    * called concurrently with VoicePool::process().
+    *
+    * @param sampleRate The sample rate.
+    * @param maxFrames The maximum number of frames per call of
+    * VoicePool::process().
+    * @param numVoices The number of voices.
+    */
+   void prepare(uint32_t sampleRate, uint32_t maxFrames, uint32_t numVoices);
+
+   /**
+    * @brief Applies new voice settings to all voices. The gain is ramped over
+    * the next call of VoicePool::process().
+    */
+   void setSettings(const VoiceSettings& settings);
+
+   /**
+    * @brief Starts a note, stealing a voice if all voices are in use.
+    */
+   void noteOn(uint32_t note, float velocity);
+
+   /**
+    * @brief Releases all voices that play the given note.
+    */
+   void noteOff(uint32_t note);
+
+   /**
+    * @brief Releases all voices.
+    */
+   void allNotesOff();
+
+   /**
+    * @brief Returns the number of voices that are playing or releasing.
+    */
+   uint32_t numActiveVoices() const;
+
+   /**
+    * @brief Returns the number of voices stolen since the last call of
+    * VoicePool::prepare().
+    */
+   uint64_t numStolenVoices() const;
+
+   /**
+    * @brief Renders the voices and adds them to every channel of the buffer.
+    * This method never blocks and does not allocate memory.
+    *
+    * @param buffer The buffer to add the voices to.
+    * @param numFrames The number of frames to render.
+    * @param events The note events of the block sorted by offset. Events at or
+    * beyond numFrames take effect at the end of the block.
+    * @param numEvents The number of note events.
+    */
+   void process(
+      Buffer& buffer, uint32_t numFrames, const NoteEvent* events = nullptr,
+      uint32_t numEvents = 0
+   );
+
+private:
+   enum class Stage : uint8_t
+   {
+      Attack,
+      Decay,
+      Release
+   };
+
+   uint32_t _sampleRate = 0, _maxFrames = 0, _numVoices = 0;
+   uint32_t _numActive = 0;
+   uint64_t _clock = 0, _numStolen = 0;
+
+   VoiceSettings _settings;
+   float _attackCoefficient = 1.0f, _decayCoefficient = 1.0f;
+   float _releaseCoefficient = 1.0f;
+   float _gain               = 0.0f; // the gain at the end of the last block
+
+   // The voice state, padded to a multiple of the group size. Inactive voices
+   // are silent, so partially active groups can be rendered as a whole.
+   std::vector<float> _phase, _increment;
+   std::vector<float> _level, _target, _coefficient, _velocity;
+   std::vector<uint32_t> _notes;
+   std::vector<uint64_t> _ages;
+   std::vector<Stage> _stages;
+
+   std::vector<float> _partials; // four partial sums per frame
+   std::vector<float> _mix;
+
+   void handleEvent(const NoteEvent& event);
+   uint32_t allocateVoice();
+   void setStage(uint32_t voice, Stage stage);
+   void freeVoice(uint32_t voice);
+   void updateStages();
+   void render(uint32_t offset, uint32_t numFrames);
+   float coefficient(float time) const;
+};
+
+} // namespace ImRt
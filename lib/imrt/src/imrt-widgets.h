@@ -3,14 +3,55 @@
 #include "imgui.h"
 #include "imgui_internal.h"
 #include <cstdint>
+#include <cstdio>
+#include <memory>
 #include <imgui-knobs.h>
 #include "implot.h"
 
+#include "imrt-batch.h"
 #include "imrt-gui.h"
 #include "imrt-constants.h"
 
 namespace ImRt {
 
+/**
+ * @brief Returns true if a widget controls the parameter in the normalized
+ * domain, i.e. if ImGui cannot map its curve itself.
+ */
+inline bool isNormalizedParameter(GuiParameter* param)
+{
+   ParameterCurve curve = param->curve();
+   return curve != ParameterCurve::Linear
+      && curve != ParameterCurve::Logarithmic;
+}
+
+/**
+ * @brief Writes the value of a parameter, or its label for enum parameters, as
+ * text without format specifiers. A widget that controls the normalized value
+ * passes this text as its format to display the actual value.
+ */
+inline void formatParameterValue(GuiParameter* param, char* text, size_t size)
+{
+   const char* label = param->label(param->value);
+   if (!label)
+   {
+      snprintf(text, size, "%.3f", param->value);
+      return;
+   }
+
+   // A percent sign would be taken for a format specifier.
+   size_t length = 0;
+   for (; *label && length + 2 < size; ++label)
+   {
+      text[length++] = *label;
+      if (*label == '%')
+      {
+         text[length++] = '%';
+      }
+   }
+   text[length] = '\0';
+}
+
 /* -------------------------------------------------------------------------- */
 /*                      TOGGLE BUTTON                                         */
 /* -------------------------------------------------------------------------- */
@@ -33,8 +74,9 @@ public:
    ToggleButton(Gui<Derived, Dsp>& gui, uint32_t paramId)
       : _gui(gui)
       , _paramId(paramId)
-      , _param(_gui.parameters.byId(_paramId))
+      , _param(_gui.parameters.share(_paramId))
    {
+      _gui.registry().watchParameter(_paramId);
    }
 
    /**
@@ -43,20 +85,26 @@ public:
     */
    void show()
    {
+      IMRT_TRACE_SCOPE("ToggleButton::show");
+      if (_param->removed)
+      {
+         return;
+      }
+
       _buttonState = (_param->value > 0.5) ? true : false;
       if (ImGui::RadioButton(_param->name(), _buttonState == true))
       {
          _buttonState = !_buttonState;
 
          _param->value = _buttonState ? 1.0f : 0.0f;
-         _gui.dsp.announceParameterChange(_paramId, _param->value);
+         _gui.announceParameterChange(_paramId, _param->value);
       }
    }
 
 private:
    Gui<Derived, Dsp>& _gui;
    const uint32_t _paramId;
-   GuiParameter* _param;
+   std::shared_ptr<GuiParameter> _param;
    bool _buttonState;
 };
 
@@ -81,8 +129,13 @@ public:
    Slider(Gui<Derived, Dsp>& gui, uint32_t paramId)
       : _gui(gui)
       , _paramId(paramId)
-      , _param(_gui.parameters.byId(_paramId))
+      , _param(_gui.parameters.share(_paramId))
    {
+      _gui.registry().watchParameter(_paramId);
+      if (_param->curve() == ParameterCurve::Logarithmic)
+      {
+         _sliderFlags |= ImGuiSliderFlags_Logarithmic;
+      }
    }
 
    /**
@@ -90,18 +143,48 @@ public:
     */
    void show()
    {
+      IMRT_TRACE_SCOPE("Slider::show");
+      if (_param->removed)
+      {
+         return;
+      }
+
+      if (isNormalizedParameter(_param.get()))
+      {
+         char format[64];
+         formatParameterValue(_param.get(), format, sizeof(format));
+
+         // The unsnapped position is kept, so small drags add up to a step.
+         if (_param->toPlain(_normalized) != _param->value)
+         {
+            _normalized = _param->toNormalized(_param->value);
+         }
+         if (ImGui::SliderFloat(
+                _param->name(), &_normalized, 0.0f, 1.0f, format, _sliderFlags
+             ))
+         {
+            _param->value = _param->toPlain(_normalized);
+            _gui.announceParameterChange(_paramId, _param->value);
+         }
+         return;
+      }
+
       if (ImGui::SliderFloat(
-             _param->name(), &_param->value, _param->min(), _param->max()
+             _param->name(), &_param->value, _param->min(), _param->max(),
+             "%.3f", _sliderFlags
           ))
       {
-         _gui.dsp.announce(_paramId, _param->value);
+         _gui.announceParameterChange(_paramId, _param->value);
       }
    }
 
 private:
    Gui<Derived, Dsp>& _gui;
    const uint32_t _paramId;
-   GuiParameter* _param;
+   std::shared_ptr<GuiParameter> _param;
+
+   ImGuiSliderFlags _sliderFlags = ImGuiSliderFlags_None;
+   float _normalized             = 0.0f;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -125,12 +208,16 @@ public:
    Knob(Gui<Derived, Dsp>& gui, uint32_t paramId)
       : _gui(gui)
       , _paramId(paramId)
-      , _param(_gui.parameters.byId(paramId))
+      , _param(_gui.parameters.share(paramId))
    {
+      _gui.registry().watchParameter(_paramId);
       _knobFlags = ImGuiKnobFlags_AlwaysClamp;
       // knobFlags |= ImGuiKnobFlags_ValueTooltip
       // knobFlags |= ImGuiKnobFlags_NoInput;
-      // knobFlags |= ImGuiKnobFlags_Logarithmic;
+      if (_param->curve() == ParameterCurve::Logarithmic)
+      {
+         _knobFlags |= ImGuiKnobFlags_Logarithmic;
+      }
    }
 
    /**
@@ -139,33 +226,91 @@ public:
     */
    void show()
    {
-      ImGui::GetCursorPos();
-      if (ImGuiKnobs::Knob(
-             _param->name(), &_param->value, _param->min(), _param->max(),
-             _speed, "%.3f", ImGuiKnobVariant_Dot, 100, _knobFlags
-          ))
+      IMRT_TRACE_SCOPE("Knob::show");
+      paint(nullptr);
+   }
+
+   /**
+    * @brief Adds the knob to a batch at the current ImGui CursorPos instead of
+    * painting it directly (cf. WidgetBatch::knob()).
+    */
+   void show(WidgetBatch& batch)
+   {
+      IMRT_TRACE_SCOPE("Knob::show");
+      paint(&batch);
+   }
+
+private:
+   Gui<Derived, Dsp>& _gui;
+   const uint32_t _paramId;
+   std::shared_ptr<GuiParameter> _param;
+
+   ImGuiKnobFlags _knobFlags;
+   float _speed      = 0.0f;
+   float _normalized = 0.0f;
+
+   void paint(WidgetBatch* batch)
+   {
+      if (_param->removed)
+      {
+         return;
+      }
+
+      if (isNormalizedParameter(_param.get()))
+      {
+         // Exponential, stepped and enum parameters are controlled through
+         // their normalized value, which is mapped by their curve.
+         char format[64];
+         formatParameterValue(_param.get(), format, sizeof(format));
+
+         // The unsnapped position is kept, so small drags add up to a step.
+         if (_param->toPlain(_normalized) != _param->value)
+         {
+            _normalized = _param->toNormalized(_param->value);
+         }
+         if (knob(batch, &_normalized, 0.0f, 1.0f, format))
+         {
+            _speed = ImGui::GetIO().KeyCtrl ? 1.0f / 1000 : 1.0f / 200;
+
+            _param->value = _param->toPlain(_normalized);
+            _gui.announceParameterChange(_paramId, _param->value);
+         }
+      }
+      else if (knob(
+                  batch, &_param->value, _param->min(), _param->max(), "%.3f"
+               ))
       {
          ImGui::GetIO().KeyCtrl
             ? _speed = (_param->max() - _param->min()) / 1000
             : _speed = (_param->max() - _param->min()) / 200;
 
-         _gui.dsp.announceParameterChange(_paramId, _param->value);
+         _gui.announceParameterChange(_paramId, _param->value);
       }
 
       if (ImGui::IsItemActive() && ImGui::IsMouseDoubleClicked(0))
       {
          _param->value = _param->init();
-         _gui.dsp.announceParameterChange(_paramId, _param->value);
+         _gui.announceParameterChange(_paramId, _param->value);
       }
    }
 
-private:
-   Gui<Derived, Dsp>& _gui;
-   const uint32_t _paramId;
-   GuiParameter* _param;
-
-   ImGuiKnobFlags _knobFlags;
-   float _speed = 0.0f;
+   bool knob(
+      WidgetBatch* batch, float* value, float min, float max,
+      const char* format
+   )
+   {
+      if (batch)
+      {
+         return batch->knob(
+            _param->name(), value, min, max, _speed, format,
+            _knobFlags & ImGuiKnobFlags_Logarithmic, 100
+         );
+      }
+      return ImGuiKnobs::Knob(
+         _param->name(), value, min, max, _speed, format, ImGuiKnobVariant_Dot,
+         100, _knobFlags
+      );
+   }
 };
 
 /* -------------------------------------------------------------------------- */
@@ -190,6 +335,7 @@ public:
 
    void show(float value)
    {
+      IMRT_TRACE_SCOPE("ValueBar::show");
       const ImGuiStyle& style = ImGui::GetStyle();
       ImDrawList* drawList    = ImGui::GetWindowDrawList();
       const ImVec2& cursorPos = ImGui::GetCursorScreenPos();
@@ -221,6 +367,16 @@ public:
       ImGui::ItemSize(_widgetSize);
    }
 
+   /**
+    * @brief Adds the bar to a batch instead of painting it directly (cf.
+    * WidgetBatch::bar()).
+    */
+   void show(float value, WidgetBatch& batch)
+   {
+      IMRT_TRACE_SCOPE("ValueBar::show");
+      batch.bar(std::abs(value - _min) / (_max - _min), _widgetSize);
+   }
+
 protected:
    Gui<Derived, Dsp>& _gui;
    const float _min, _max, _difference;
@@ -246,6 +402,26 @@ public:
    }
 
    void show()
+   {
+      IMRT_TRACE_SCOPE("VolumeBar::show");
+      ImRt::ValueBar<Derived, Dsp>::show(level());
+   }
+
+   /**
+    * @brief Adds the bar to a batch instead of painting it directly (cf.
+    * WidgetBatch::bar()).
+    */
+   void show(WidgetBatch& batch)
+   {
+      IMRT_TRACE_SCOPE("VolumeBar::show");
+      ImRt::ValueBar<Derived, Dsp>::show(level(), batch);
+   }
+
+private:
+   ImRt::BufferView& _view;
+   const uint32_t _channel;
+
+   float level()
    {
       float volume       = 0.0f;
       uint32_t numFrames = _view.getNumFrames();
@@ -255,12 +431,8 @@ public:
          float newVolume = std::abs(_view.getSample(_channel, frame));
          volume          = std::max(volume, newVolume);
       }
-      ImRt::ValueBar<Derived, Dsp>::show(20.0f * std::log(volume));
+      return 20.0f * std::log(volume);
    }
-
-private:
-   ImRt::BufferView& _view;
-   const uint32_t _channel;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -282,6 +454,7 @@ public:
 
    void show()
    {
+      IMRT_TRACE_SCOPE("Oscilloscope::show");
       uint32_t numChannels = std::min<uint32_t>(2, _view.getNumChannels());
       uint32_t numFrames   = _view.getNumFrames();
 
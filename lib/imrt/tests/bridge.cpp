@@ -0,0 +1,230 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "imrt-bridge.h"
+
+#include "check.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+using namespace ImRt;
+
+#if !defined(_WIN32)
+
+/* ------------------------------------------------------ */
+/*                        fixture                         */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   ParameterLayout gain()
+   {
+      return ParameterLayout(1, "gain", 0.0f, 1.0f, 0.5f);
+   }
+
+   ParameterLayout pan()
+   {
+      return ParameterLayout(2, "pan", -1.0f, 1.0f, 0.0f);
+   }
+
+   ParameterLayout mode()
+   {
+      return ParameterLayout(3, "mode", { "a", "b", "c" }, 1);
+   }
+
+   /**
+    * @brief Waits up to two seconds for the polling thread of the server to
+    * make the condition true.
+    */
+   template <typename Condition>
+   bool waitFor(Condition&& condition)
+   {
+      auto end = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+      while (!condition())
+      {
+         if (std::chrono::steady_clock::now() > end)
+         {
+            return false;
+         }
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return true;
+   }
+
+   /**
+    * @brief The DSP process and the GUI process in one: a server on a
+    * segment named after the process, so parallel test runs do not meet, and
+    * a RemoteDsp with the same parameters. The test thread takes the role
+    * of the DSP thread.
+    */
+   struct Bridge
+   {
+      Bridge()
+         : name("imrt-test-" + std::to_string(getpid()))
+         , server(parameters, streamFrame)
+      {
+         for (ParameterLayout layout : { gain(), pan(), mode() })
+         {
+            parameters.addParameter(layout);
+            remote.addParameter(layout);
+         }
+
+         BridgeSettings settings;
+         settings.name         = name;
+         settings.pollInterval = 0.001;
+         started               = server.start(settings);
+      }
+
+      // Collects the changes reported to the GUI until the given number has
+      // arrived.
+      bool receive(std::map<uint32_t, float>& changes, size_t numChanges)
+      {
+         return waitFor(
+            [&]
+            {
+               remote.receiveParameterChanges(
+                  [&](uint32_t paramId, float value)
+                  { changes[paramId] = value; }
+               );
+               return changes.size() >= numChanges;
+            }
+         );
+      }
+
+      std::string name;
+      DspParameters parameters;
+      std::atomic<uint64_t> streamFrame { 0 };
+      BridgeServer server;
+      RemoteDsp remote;
+      bool started = false;
+   };
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                       attaching                        */
+/* ------------------------------------------------------ */
+
+// A RemoteDsp attaches only to an existing segment with the same parameters
+// and receives the current values of all parameters after attaching, also
+// when it reattaches.
+void testAttach()
+{
+   Bridge bridge;
+   IMRT_CHECK(bridge.started && bridge.server.isRunning());
+
+   RemoteDsp missing;
+   IMRT_CHECK(!missing.attach(bridge.name + "-missing"));
+
+   RemoteDsp different;
+   ParameterLayout layout = gain();
+   different.addParameter(layout);
+   IMRT_CHECK(!different.attach(bridge.name));
+   IMRT_CHECK(!different.isAttached());
+
+   IMRT_CHECK(bridge.remote.attach(bridge.name));
+   std::map<uint32_t, float> changes;
+   IMRT_CHECK(bridge.receive(changes, 3));
+   IMRT_CHECK(changes[1] == 0.5f && changes[2] == 0.0f && changes[3] == 1.0f);
+
+   bridge.remote.detach();
+   IMRT_CHECK(!bridge.remote.isAttached());
+   IMRT_CHECK(bridge.remote.attach(bridge.name));
+   changes.clear();
+   IMRT_CHECK(bridge.receive(changes, 3));
+}
+
+/* ------------------------------------------------------ */
+/*                        commands                        */
+/* ------------------------------------------------------ */
+
+// Changes and presets sent by the GUI reach the DSP parameters, and changes
+// made by the DSP are reported back to the GUI.
+void testCommands()
+{
+   Bridge bridge;
+   IMRT_CHECK(bridge.started && bridge.remote.attach(bridge.name));
+   std::map<uint32_t, float> changes;
+   IMRT_CHECK(bridge.receive(changes, 3));
+
+   float value = 0.75f;
+   bridge.remote.announceParameterChange(1, value);
+   IMRT_CHECK(waitFor(
+      [&] { return bridge.parameters.updatedValue(1) == 0.75f; }
+   ));
+
+   Preset preset;
+   preset.setValue(2, -0.5f);
+   preset.setValue(3, 5.0f); // constrained to the last option
+   bridge.remote.applyPreset(preset);
+   IMRT_CHECK(waitFor(
+      [&]
+      {
+         bridge.parameters.applyPublishedPreset();
+         return bridge.parameters.updatedValue(2) == -0.5f;
+      }
+   ));
+   IMRT_CHECK(bridge.parameters.updatedValue(3) == 2.0f);
+
+   // The preset changes are reported back like changes made by the DSP.
+   changes.clear();
+   bridge.parameters.setValue(1, 0.25f);
+   IMRT_CHECK(bridge.receive(changes, 3));
+   IMRT_CHECK(changes[1] == 0.25f && changes[2] == -0.5f && changes[3] == 2.0f);
+}
+
+/* ------------------------------------------------------ */
+/*                     stream state                       */
+/* ------------------------------------------------------ */
+
+// The stream clock and the sample rate are published, and the taps carry
+// the most recent frames, while frames written before attaching are dropped.
+void testStreamState()
+{
+   Bridge bridge;
+   bridge.server.setSampleRate(48000);
+
+   Buffer block(2, 64);
+   for (uint32_t frame = 0; frame < 64; ++frame)
+   {
+      block.getSample(0, frame) = float(frame);
+      block.getSample(1, frame) = -float(frame);
+   }
+   IMRT_CHECK(bridge.server.writeTap(0, block, 64) == 64);
+   IMRT_CHECK(bridge.started && bridge.remote.attach(bridge.name));
+   IMRT_CHECK(bridge.remote.sampleRate() == 48000);
+
+   bridge.streamFrame.store(1234);
+   IMRT_CHECK(waitFor([&] { return bridge.remote.streamFrame() == 1234; }));
+
+   Buffer window(2, 32);
+   IMRT_CHECK(bridge.remote.readTap(0, window) == 0);
+   IMRT_CHECK(bridge.server.writeTap(0, block, 64) == 64);
+   IMRT_CHECK(bridge.remote.readTap(0, window) == 64);
+   IMRT_CHECK(window.getSample(0, 0) == 32.0f);
+   IMRT_CHECK(window.getSample(1, 31) == -63.0f);
+   IMRT_CHECK(bridge.remote.readTap(maxBridgeTaps, window) == 0);
+}
+
+#endif
+
+/* ------------------------------------------------------ */
+/*                          main                          */
+/* ------------------------------------------------------ */
+
+// Shared memory is only supported on POSIX systems so far.
+int main()
+{
+#if !defined(_WIN32)
+   testAttach();
+   testCommands();
+   testStreamState();
+#endif
+   return checkResult("bridge");
+}
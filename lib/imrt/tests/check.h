@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdio>
+
+/* -------------------------------------------------------------------------- */
+/*                              CHECKS                                        */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief The number of failed checks of the test program.
+ */
+inline int checkFailures = 0;
+
+/**
+ * @brief Checks a condition and reports its location if it does not hold.
+ * Unlike assert(), the test goes on, so one run reports all failures.
+ */
+#define IMRT_CHECK(condition)                                                  \
+   do                                                                          \
+   {                                                                           \
+      if (!(condition))                                                        \
+      {                                                                        \
+         std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,          \
+                     #condition);                                              \
+         ++checkFailures;                                                      \
+      }                                                                        \
+   } while (false)
+
+/**
+ * @brief Prints the summary of the test program and returns its exit code.
+ */
+inline int checkResult(const char* name)
+{
+   std::printf("%s: %s\n", name, checkFailures == 0 ? "passed" : "FAILED");
+   return checkFailures == 0 ? 0 : 1;
+}
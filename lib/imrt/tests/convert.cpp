@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "imrt-convert.h"
+
+#include "check.h"
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                    device samples                      */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const SampleFormat formats[] = {
+      SampleFormat::Int16, SampleFormat::Int24, SampleFormat::Int32,
+      SampleFormat::Float32, SampleFormat::Float64
+   };
+
+   // The vectorized conversions handle four samples at a time, so the frame
+   // counts lie below, at and above multiples of four to cover the vectorized
+   // loops as well as the scalar tail.
+   const uint32_t frameCounts[] = { 1, 2, 3, 4, 5, 7, 8, 9, 13, 63, 64, 67 };
+   const uint32_t maxFrames     = 67;
+   const uint32_t maxChannels   = 3;
+
+   // Marks bytes and samples that must not be written.
+   const uint8_t guardByte = 0xa5;
+   const float unwritten   = 7.0f;
+
+   /**
+    * @brief Returns the number of integer steps of a full-scale sample, or 0
+    * for float formats.
+    */
+   double fullScale(SampleFormat format)
+   {
+      switch (format)
+      {
+      case SampleFormat::Int16:
+         return 32768.0;
+      case SampleFormat::Int24:
+         return 8388608.0;
+      case SampleFormat::Int32:
+         return 2147483648.0;
+      default:
+         return 0.0;
+      }
+   }
+
+   /**
+    * @brief Reads the raw sample at the given index, i.e. the integer for
+    * integer formats.
+    */
+   double
+   readRaw(const std::vector<uint8_t>& data, SampleFormat format, size_t i)
+   {
+      const uint8_t* bytes = data.data() + i * sampleSize(format);
+      switch (format)
+      {
+      case SampleFormat::Int16:
+      {
+         int16_t value;
+         std::memcpy(&value, bytes, sizeof(value));
+         return value;
+      }
+      case SampleFormat::Int24:
+      {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+         int32_t value = (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8);
+#else
+         int32_t value = (bytes[2] << 24) | (bytes[1] << 16) | (bytes[0] << 8);
+#endif
+         return value >> 8;
+      }
+      case SampleFormat::Int32:
+      {
+         int32_t value;
+         std::memcpy(&value, bytes, sizeof(value));
+         return value;
+      }
+      case SampleFormat::Float32:
+      {
+         float value;
+         std::memcpy(&value, bytes, sizeof(value));
+         return value;
+      }
+      case SampleFormat::Float64:
+      {
+         double value;
+         std::memcpy(&value, bytes, sizeof(value));
+         return value;
+      }
+      }
+      return 0.0;
+   }
+
+   /**
+    * @brief Writes a raw sample to the given index (cf. readRaw()).
+    */
+   void writeRaw(
+      std::vector<uint8_t>& data, SampleFormat format, size_t i, double raw
+   )
+   {
+      uint8_t* bytes = data.data() + i * sampleSize(format);
+      switch (format)
+      {
+      case SampleFormat::Int16:
+      {
+         auto value = int16_t(raw);
+         std::memcpy(bytes, &value, sizeof(value));
+         break;
+      }
+      case SampleFormat::Int24:
+      {
+         auto value = int32_t(raw);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+         bytes[0] = uint8_t(value >> 16);
+         bytes[1] = uint8_t(value >> 8);
+         bytes[2] = uint8_t(value);
+#else
+         bytes[0] = uint8_t(value);
+         bytes[1] = uint8_t(value >> 8);
+         bytes[2] = uint8_t(value >> 16);
+#endif
+         break;
+      }
+      case SampleFormat::Int32:
+      {
+         auto value = int32_t(raw);
+         std::memcpy(bytes, &value, sizeof(value));
+         break;
+      }
+      case SampleFormat::Float32:
+      {
+         auto value = float(raw);
+         std::memcpy(bytes, &value, sizeof(value));
+         break;
+      }
+      case SampleFormat::Float64:
+      {
+         std::memcpy(bytes, &raw, sizeof(raw));
+         break;
+      }
+      }
+   }
+
+   /**
+    * @brief Returns the raw sample of the given format a buffer sample is
+    * expected to be converted to, i.e. the rounded and clipped integer for
+    * integer formats.
+    */
+   double expectedRaw(SampleFormat format, double sample)
+   {
+      double scale = fullScale(format);
+      if (format == SampleFormat::Float32)
+      {
+         return float(sample);
+      }
+      if (scale == 0.0)
+      {
+         return sample;
+      }
+      double value = std::nearbyint(sample * scale);
+      return std::min(std::max(value, -scale), scale - 1.0);
+   }
+
+   /**
+    * @brief Returns the largest allowed difference between a converted raw
+    * sample and the expected one. 32 bit integers are converted through
+    * floats with a 24 bit mantissa, whose vectorized conversion also clips to
+    * the largest float below 2^31.
+    */
+   template <typename Sample>
+   double tolerance(SampleFormat format)
+   {
+      return format == SampleFormat::Int32 && sizeof(Sample) == sizeof(float)
+         ? 128.0
+         : 0.0;
+   }
+
+   /**
+    * @brief Returns interleaved device samples covering the full range of the
+    * format, including its extremes. Float samples are exactly representable
+    * as floats.
+    */
+   std::vector<uint8_t>
+   randomSamples(SampleFormat format, size_t numSamples, std::mt19937& random)
+   {
+      std::vector<uint8_t> data(numSamples * sampleSize(format));
+      double scale = fullScale(format);
+      std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+      for (size_t i = 0; i < numSamples; ++i)
+      {
+         double raw;
+         if (i % 7 == 0)
+         {
+            raw = scale == 0.0 ? -1.0 : -scale;
+         }
+         else if (i % 7 == 1)
+         {
+            raw = scale == 0.0 ? 1.0 : scale - 1.0;
+         }
+         else if (scale == 0.0)
+         {
+            raw = float(distribution(random));
+         }
+         else
+         {
+            raw = std::floor(distribution(random) * scale);
+         }
+         writeRaw(data, format, i, raw);
+      }
+      return data;
+   }
+
+   template <typename Sample>
+   void fill(SampleBuffer<Sample>& buffer, Sample value)
+   {
+      for (uint32_t channel = 0; channel < buffer.getNumChannels(); ++channel)
+      {
+         Sample* samples = &buffer.getSample(channel, 0);
+         std::fill_n(samples, buffer.getNumFrames(), value);
+      }
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                      conversion                        */
+/* ------------------------------------------------------ */
+
+// Device samples are converted to exactly the scaled samples, leave the other
+// channels and frames of the buffer alone, and are restored when they are
+// converted back.
+template <typename Sample>
+void testRoundTrip()
+{
+   std::mt19937 random(1);
+   for (SampleFormat format : formats)
+   {
+      double scale = fullScale(format);
+      for (uint32_t numChannels = 1; numChannels <= maxChannels; ++numChannels)
+      {
+         for (uint32_t numFrames : frameCounts)
+         {
+            size_t numSamples = size_t(numChannels) * numFrames;
+            auto data = randomSamples(format, numSamples, random);
+
+            SampleBuffer<Sample> buffer(maxChannels + 1, maxFrames + 4);
+            fill(buffer, Sample(unwritten));
+            deinterleave(data.data(), format, numChannels, buffer, numFrames);
+
+            bool converted = true, untouched = true;
+            for (uint32_t channel = 0; channel <= maxChannels; ++channel)
+            {
+               for (uint32_t frame = 0; frame < maxFrames + 4; ++frame)
+               {
+                  Sample sample = buffer.getSample(channel, frame);
+                  if (channel >= numChannels || frame >= numFrames)
+                  {
+                     untouched = untouched && sample == Sample(unwritten);
+                     continue;
+                  }
+                  double raw
+                     = readRaw(data, format, frame * numChannels + channel);
+                  converted = converted
+                     && sample == Sample(scale == 0.0 ? raw : raw / scale);
+               }
+            }
+            IMRT_CHECK(converted);
+            IMRT_CHECK(untouched);
+
+            std::vector<uint8_t> restored(data.size() + 16, guardByte);
+            interleave(restored.data(), format, numChannels, buffer, numFrames);
+
+            bool equal = true, guarded = true;
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+               double error = readRaw(restored, format, i)
+                  - readRaw(data, format, i);
+               equal = equal && std::abs(error) <= tolerance<Sample>(format);
+            }
+            for (size_t i = data.size(); i < restored.size(); ++i)
+            {
+               guarded = guarded && restored[i] == guardByte;
+            }
+            IMRT_CHECK(equal);
+            IMRT_CHECK(guarded);
+         }
+      }
+   }
+}
+
+// Samples outside of the range [-1, 1] are clipped when they are converted to
+// integers and passed through unchanged when they are converted to floats.
+template <typename Sample>
+void testBounds()
+{
+   const Sample samples[] = { 2, 1, -1, -2, 0.5, -0.5, 0, 1e-9, -1e-9, 100 };
+   const uint32_t numSamples = sizeof(samples) / sizeof(samples[0]);
+
+   for (SampleFormat format : formats)
+   {
+      for (uint32_t numChannels = 1; numChannels <= maxChannels; ++numChannels)
+      {
+         for (uint32_t numFrames : frameCounts)
+         {
+            SampleBuffer<Sample> buffer(numChannels, numFrames);
+            for (uint32_t channel = 0; channel < numChannels; ++channel)
+            {
+               for (uint32_t frame = 0; frame < numFrames; ++frame)
+               {
+                  buffer.getSample(channel, frame)
+                     = samples[(frame + 3 * channel) % numSamples];
+               }
+            }
+
+            size_t size = size_t(numChannels) * numFrames * sampleSize(format);
+            std::vector<uint8_t> data(size + 16, guardByte);
+            interleave(data.data(), format, numChannels, buffer, numFrames);
+
+            bool clipped = true, guarded = true;
+            for (uint32_t channel = 0; channel < numChannels; ++channel)
+            {
+               for (uint32_t frame = 0; frame < numFrames; ++frame)
+               {
+                  double raw
+                     = readRaw(data, format, frame * numChannels + channel);
+                  double expected
+                     = expectedRaw(format, buffer.getSample(channel, frame));
+                  clipped = clipped
+                     && std::abs(raw - expected) <= tolerance<Sample>(format);
+               }
+            }
+            for (size_t i = size; i < data.size(); ++i)
+            {
+               guarded = guarded && data[i] == guardByte;
+            }
+            IMRT_CHECK(clipped);
+            IMRT_CHECK(guarded);
+         }
+      }
+   }
+}
+
+// The sample sizes match the packed formats.
+void testSampleSizes()
+{
+   IMRT_CHECK(sampleSize(SampleFormat::Int16) == 2);
+   IMRT_CHECK(sampleSize(SampleFormat::Int24) == 3);
+   IMRT_CHECK(sampleSize(SampleFormat::Int32) == 4);
+   IMRT_CHECK(sampleSize(SampleFormat::Float32) == 4);
+   IMRT_CHECK(sampleSize(SampleFormat::Float64) == 8);
+}
+
+int main()
+{
+   testSampleSizes();
+   testRoundTrip<float>();
+   testRoundTrip<double>();
+   testBounds<float>();
+   testBounds<double>();
+   return checkResult("convert");
+}
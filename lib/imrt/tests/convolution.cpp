@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "imrt-convolution.h"
+
+#include "check.h"
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                        signals                         */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const uint32_t numChannels = 2;
+
+   Buffer noise(uint32_t numChannels, uint32_t numFrames, uint32_t seed)
+   {
+      std::mt19937 random(seed);
+      std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+      Buffer buffer(numChannels, numFrames);
+      for (uint32_t channel = 0; channel < numChannels; ++channel)
+      {
+         for (uint32_t frame = 0; frame < numFrames; ++frame)
+         {
+            buffer.getSample(channel, frame) = distribution(random);
+         }
+      }
+      return buffer;
+   }
+
+   // A decaying noise, so every part of the impulse response matters.
+   Buffer impulseResponse(uint32_t length)
+   {
+      Buffer ir = noise(1, length, 1);
+      for (uint32_t frame = 0; frame < length; ++frame)
+      {
+         ir.getSample(0, frame) *= std::exp(-4.0f * frame / length);
+      }
+      return ir;
+   }
+
+   float directConvolution(
+      const Buffer& ir, const Buffer& input, uint32_t channel, uint32_t frame
+   )
+   {
+      double sum = 0.0;
+      for (uint32_t tap = 0; tap <= frame && tap < ir.getNumFrames(); ++tap)
+      {
+         sum += double(ir.getSample(0, tap))
+            * input.getSample(channel, frame - tap);
+      }
+      return static_cast<float>(sum);
+   }
+
+   /**
+    * @brief Passes the input to the convolver in chunks of varying size up
+    * to a tail partition, as a stream would, and returns the largest
+    * deviation from the direct convolution. The pause is taken after every
+    * chunk to give the worker time.
+    */
+   float process(
+      Convolver& convolver, const Buffer& ir, const Buffer& input,
+      std::chrono::microseconds pause = std::chrono::microseconds(0)
+   )
+   {
+      const uint32_t chunks[] = { 1, 37, 64, 200, 13, 256 };
+      uint32_t numFrames      = input.getNumFrames();
+
+      Buffer block(numChannels, 256);
+      float maxError = 0.0f;
+      uint32_t start = 0;
+      for (uint32_t i = 0; start < numFrames; ++i)
+      {
+         uint32_t n = std::min(chunks[i % 6], numFrames - start);
+         for (uint32_t channel = 0; channel < numChannels; ++channel)
+         {
+            for (uint32_t frame = 0; frame < n; ++frame)
+            {
+               block.getSample(channel, frame)
+                  = input.getSample(channel, start + frame);
+            }
+         }
+
+         convolver.process(block, n);
+
+         for (uint32_t channel = 0; channel < numChannels; ++channel)
+         {
+            for (uint32_t frame = 0; frame < n; ++frame)
+            {
+               float expected
+                  = directConvolution(ir, input, channel, start + frame);
+               maxError = std::max(
+                  maxError, std::abs(block.getSample(channel, frame) - expected)
+               );
+            }
+         }
+
+         start += n;
+         std::this_thread::sleep_for(pause);
+      }
+      return maxError;
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                        accuracy                        */
+/* ------------------------------------------------------ */
+
+// The head, the body and the tail together give the direct convolution, no
+// matter whether the tail is computed on the calling thread or the worker.
+void testAccuracy(bool backgroundTail)
+{
+   Buffer ir    = impulseResponse(3000);
+   Buffer input = noise(numChannels, 6000, 2);
+
+   ConvolverSettings settings;
+   settings.headSize          = 32;
+   settings.tailPartitionSize = 256;
+   settings.backgroundTail    = backgroundTail;
+
+   Convolver convolver;
+   convolver.prepare(ir, numChannels, settings);
+
+   // A tail partition takes far less than a millisecond, so the worker
+   // easily keeps up when every chunk is followed by a pause.
+   auto pause = std::chrono::microseconds(backgroundTail ? 1000 : 0);
+   float maxError = process(convolver, ir, input, pause);
+
+   IMRT_CHECK(convolver.numLateTails() == 0);
+   IMRT_CHECK(maxError < 1e-3f);
+}
+
+/* ------------------------------------------------------ */
+/*                      slow worker                       */
+/* ------------------------------------------------------ */
+
+// A worker that cannot keep up mutes the tail and drops its input instead
+// of racing with the audio thread on the input slots (run with the thread
+// sanitizer, cf. IMRT_SANITIZE_THREAD), and the tail resumes once the
+// worker has caught up.
+void testSlowWorker()
+{
+   const uint32_t partition = 256;
+
+   // The tail of a long impulse response in small partitions takes much
+   // longer than the head, so a caller that does not wait for real time
+   // runs ahead of the worker.
+   Buffer ir    = impulseResponse(48000);
+   Buffer input = noise(numChannels, partition, 3);
+
+   ConvolverSettings settings;
+   settings.headSize          = 64;
+   settings.tailPartitionSize = partition;
+
+   Convolver convolver;
+   convolver.prepare(ir, numChannels, settings);
+
+   Buffer block(numChannels, partition);
+   auto processBlock = [&]
+   {
+      for (uint32_t channel = 0; channel < numChannels; ++channel)
+      {
+         for (uint32_t frame = 0; frame < partition; ++frame)
+         {
+            block.getSample(channel, frame) = input.getSample(channel, frame);
+         }
+      }
+      convolver.process(block, partition);
+
+      bool finite = true;
+      for (uint32_t channel = 0; channel < numChannels; ++channel)
+      {
+         for (uint32_t frame = 0; frame < partition; ++frame)
+         {
+            finite = finite && std::isfinite(block.getSample(channel, frame));
+         }
+      }
+      IMRT_CHECK(finite);
+   };
+
+   for (int i = 0; i < 50; ++i)
+   {
+      processBlock();
+   }
+   IMRT_CHECK(convolver.numLateTails() > 0);
+
+   // Once the worker has caught up with the backlog, it stays in time.
+   int numInTime = 0;
+   for (int i = 0; i < 1000 && numInTime < 20; ++i)
+   {
+      uint64_t numLateTails = convolver.numLateTails();
+      processBlock();
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      numInTime = convolver.numLateTails() == numLateTails ? numInTime + 1 : 0;
+   }
+   IMRT_CHECK(numInTime == 20);
+}
+
+/* ------------------------------------------------------ */
+/*                          main                          */
+/* ------------------------------------------------------ */
+
+int main()
+{
+   testAccuracy(false);
+   testAccuracy(true);
+   testSlowWorker();
+   return checkResult("convolution");
+}
@@ -0,0 +1,197 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "imrt-osc.h"
+
+#include "check.h"
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                      osc packets                       */
+/* ------------------------------------------------------ */
+
+void appendString(std::vector<uint8_t>& packet, const std::string& text)
+{
+   packet.insert(packet.end(), text.begin(), text.end());
+   packet.resize((packet.size() + 4) & ~size_t(3)); // null-terminated, padded
+}
+
+void appendUint32(std::vector<uint8_t>& packet, uint32_t value)
+{
+   for (int shift = 24; shift >= 0; shift -= 8)
+   {
+      packet.push_back(static_cast<uint8_t>(value >> shift));
+   }
+}
+
+std::vector<uint8_t> message(const std::string& address, float value)
+{
+   uint32_t bits;
+   std::memcpy(&bits, &value, sizeof(float));
+
+   std::vector<uint8_t> packet;
+   appendString(packet, address);
+   appendString(packet, ",f");
+   appendUint32(packet, bits);
+   return packet;
+}
+
+std::vector<uint8_t> bundle(const std::vector<std::vector<uint8_t>>& elements)
+{
+   std::vector<uint8_t> packet;
+   appendString(packet, "#bundle");
+   appendUint32(packet, 0);
+   appendUint32(packet, 1); // time tag "immediately"
+   for (const auto& element : elements)
+   {
+      appendUint32(packet, static_cast<uint32_t>(element.size()));
+      packet.insert(packet.end(), element.begin(), element.end());
+   }
+   return packet;
+}
+
+/* ------------------------------------------------------ */
+/*                      address map                       */
+/* ------------------------------------------------------ */
+
+void testAddressMap()
+{
+   OscAddressMap map;
+   map.add("/imrt/1", 1);
+   map.add("/imrt/Gain", 1);
+   map.add("/imrt/2", 2);
+   map.build();
+
+   IMRT_CHECK(map.numParameters() == 2);
+
+   int32_t byId   = map.find("/imrt/1", 7);
+   int32_t byName = map.find("/imrt/Gain", 10);
+   IMRT_CHECK(byId >= 0 && byId == byName && map.paramId(byId) == 1);
+   IMRT_CHECK(map.paramId(map.find("/imrt/2", 7)) == 2);
+
+   // lookups use the given length, not a terminating null
+   IMRT_CHECK(map.find("/imrt/2x", 7) == map.find("/imrt/2", 7));
+   IMRT_CHECK(map.find("/imrt/3", 7) < 0);
+}
+
+/* ------------------------------------------------------ */
+/*                        loopback                        */
+/* ------------------------------------------------------ */
+
+#if !defined(_WIN32)
+
+// Waits until the server has received the given number of messages.
+bool waitForMessages(const OscServer& server, uint64_t numMessages)
+{
+   auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+   while (server.numMessages() < numMessages)
+   {
+      if (std::chrono::steady_clock::now() > deadline)
+      {
+         return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   // the batch is announced right after the packets were parsed
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   return true;
+}
+
+void testLoopback()
+{
+   DspParameters parameters;
+   ParameterLayout gain(1, "Gain", 0.0f, 1.0f, 0.5f);
+   ParameterLayout pan(2, "Pan", -1.0f, 1.0f, 0.0f);
+   parameters.addParameter(gain);
+   parameters.addParameter(pan);
+
+   OscServer server(parameters);
+   OscSettings settings;
+   settings.port = 0;
+   IMRT_CHECK(server.start(settings));
+   IMRT_CHECK(server.port() != 0);
+
+   int sender = socket(AF_INET, SOCK_DGRAM, 0);
+   IMRT_CHECK(sender >= 0);
+
+   sockaddr_in address {};
+   address.sin_family      = AF_INET;
+   address.sin_port        = htons(server.port());
+   address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   auto send = [&](const std::vector<uint8_t>& packet)
+   {
+      sendto(
+         sender, packet.data(), packet.size(), 0, (const sockaddr*)&address,
+         sizeof(address)
+      );
+   };
+
+   // a single message, addressed by ID
+   send(message("/imrt/1", 0.25f));
+   IMRT_CHECK(waitForMessages(server, 1));
+   IMRT_CHECK(parameters.updatedValue(1) == 0.25f);
+
+   // a bundle, addressed by name, with a nested bundle and a value that is
+   // constrained to the range of the parameter
+   send(bundle({ message("/imrt/Gain", 0.75f),
+                 bundle({ message("/imrt/Pan", -4.0f) }) }));
+   IMRT_CHECK(waitForMessages(server, 3));
+   IMRT_CHECK(parameters.updatedValue(1) == 0.75f);
+   IMRT_CHECK(parameters.updatedValue(2) == -1.0f);
+
+   // the changes are reported back to the GUI once the DSP consumed them
+   uint32_t numReported = 0;
+   parameters.receiveChanges([&](uint32_t, float) { ++numReported; });
+   IMRT_CHECK(numReported == 2);
+
+   // unknown addresses and malformed messages are rejected
+   std::vector<uint8_t> truncated = message("/imrt/1", 1.0f);
+   truncated.resize(truncated.size() - 4);
+   send(message("/imrt/3", 1.0f));
+   send(truncated);
+   IMRT_CHECK(waitForMessages(server, 5));
+   IMRT_CHECK(server.numRejected() == 2);
+   IMRT_CHECK(parameters.updatedValue(1) == 0.75f);
+
+   // parameters added and removed while the server runs are picked up
+   ParameterLayout width(3, "Width", 0.0f, 2.0f, 1.0f);
+   parameters.addParameter(width);
+   parameters.removeParameter(2);
+   send(message("/imrt/Width", 1.5f));
+   send(message("/imrt/2", 0.5f));
+   IMRT_CHECK(waitForMessages(server, 7));
+   IMRT_CHECK(server.numRejected() == 3);
+   IMRT_CHECK(parameters.updatedValue(3) == 1.5f);
+
+   close(sender);
+   server.stop();
+   IMRT_CHECK(server.port() == 0);
+}
+
+#endif
+
+/* ------------------------------------------------------ */
+/*                          main                          */
+/* ------------------------------------------------------ */
+
+int main()
+{
+   testAddressMap();
+#if !defined(_WIN32)
+   testLoopback();
+#endif
+   return checkResult("osc");
+}
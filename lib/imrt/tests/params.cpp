@@ -0,0 +1,189 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "imrt-params.h"
+
+#include "check.h"
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                         presets                        */
+/* ------------------------------------------------------ */
+
+// A change announced after a preset was published must survive the preset,
+// while changes announced before it are dropped.
+void testPresetKeepsLaterChanges()
+{
+   DspParameters parameters;
+   ParameterLayout a(1, "a", 0.0f, 1.0f, 0.0f);
+   ParameterLayout b(2, "b", 0.0f, 1.0f, 0.0f);
+   parameters.addParameter(a);
+   parameters.addParameter(b);
+
+   float before = 0.1f;
+   parameters.announceChange(1, before);
+   parameters.announceChange(2, before);
+
+   Preset preset;
+   preset.setValue(1, 0.5f);
+   preset.setValue(2, 0.5f);
+   parameters.publishPreset(preset);
+
+   float after = 0.9f;
+   parameters.announceChange(2, after);
+
+   parameters.applyPublishedPreset();
+   IMRT_CHECK(parameters.updatedValue(1) == 0.5f);
+   IMRT_CHECK(parameters.updatedValue(2) == 0.9f);
+
+   // the feedback reports the values the parameters ended up with
+   uint32_t numChanges = 0;
+   parameters.receiveChanges(
+      [&](uint32_t paramId, float value)
+      {
+         IMRT_CHECK(value == (paramId == 1 ? 0.5f : 0.9f));
+         ++numChanges;
+      }
+   );
+   IMRT_CHECK(numChanges == 2);
+}
+
+/* ------------------------------------------------------ */
+/*                   dynamic parameters                   */
+/* ------------------------------------------------------ */
+
+// Handles and shared GUI parameters keep a removed parameter alive and see
+// it as removed, also after the parameter tables have been reclaimed.
+void testRemovedParameterStaysAlive()
+{
+   DspParameters parameters;
+   ParameterLayout a(1, "a", 0.0f, 1.0f, 0.5f);
+   parameters.addParameter(a);
+
+   GuiParameters guiParameters(parameters);
+   std::shared_ptr<GuiParameter> guiParam = guiParameters.share(1);
+   ParameterHandle handle                  = parameters.handle(1);
+   IMRT_CHECK(!handle.removed() && !guiParam->removed);
+
+   IMRT_CHECK(parameters.removeParameter(1));
+   IMRT_CHECK(!parameters.removeParameter(1));
+   parameters.receiveChanges([](uint32_t, float) {});
+   parameters.updateAll();
+   IMRT_CHECK(guiParameters.update());
+
+   IMRT_CHECK(handle.removed() && handle.updatedValue() == 0.5f);
+   IMRT_CHECK(guiParam->removed && guiParam->value == 0.5f);
+   IMRT_CHECK(guiParameters.find(1) == nullptr);
+}
+
+// A parameter that is removed and added again while a change of the old one
+// is queued must not report the value of its fresh feedback slot.
+void testReaddedParameterFeedback()
+{
+   DspParameters parameters;
+   ParameterLayout a(1, "a", 0.0f, 1.0f, 0.5f);
+   parameters.addParameter(a);
+
+   parameters.setValue(1, 0.7f);
+   parameters.removeParameter(1);
+   parameters.addParameter(a);
+
+   uint32_t numChanges = 0;
+   parameters.receiveChanges([&](uint32_t, float) { ++numChanges; });
+   IMRT_CHECK(numChanges == 0);
+
+   parameters.setValue(1, 0.3f);
+   parameters.receiveChanges(
+      [&](uint32_t paramId, float value)
+      {
+         IMRT_CHECK(paramId == 1 && value == 0.3f);
+         ++numChanges;
+      }
+   );
+   IMRT_CHECK(numChanges == 1);
+}
+
+// The DSP thread reads and sets parameters while the GUI thread adds and
+// removes them, announces changes and receives the feedback. Run it with the
+// address or the thread sanitizer to catch a parameter deleted too early.
+void testAddRemoveWhileRunning()
+{
+   const uint32_t numIds = 8;
+
+   DspParameters parameters;
+   ParameterLayout removed(100, "removed", 0.0f, 1.0f, 0.0f);
+   parameters.addParameter(removed);
+   ParameterHandle handle = parameters.handle(100);
+
+   std::atomic<bool> running { true };
+   std::thread dsp(
+      [&]
+      {
+         while (running.load())
+         {
+            parameters.applyPublishedPreset();
+            parameters.updateAll();
+            if (!handle.removed())
+            {
+               handle.updatedValue();
+            }
+            for (uint32_t id = 1; id <= numIds; ++id)
+            {
+               parameters.setValue(id, 0.25f);
+            }
+            std::this_thread::yield();
+         }
+      }
+   );
+
+   GuiParameters guiParameters(parameters);
+   uint32_t numUnknown = 0;
+   for (uint32_t i = 0; i < 2000; ++i)
+   {
+      uint32_t id = 1 + i % numIds;
+      ParameterLayout layout(id, "p", 0.0f, 1.0f, 0.0f);
+      if (!parameters.addParameter(layout))
+      {
+         parameters.removeParameter(id);
+      }
+
+      float value = 0.5f;
+      parameters.announceChange(1 + (i + 3) % numIds, value);
+      if (i == 1000)
+      {
+         parameters.removeParameter(100);
+      }
+
+      // Only parameters in the collection are reported, which the GUI
+      // parameters know after the update.
+      guiParameters.update();
+      parameters.receiveChanges(
+         [&](uint32_t paramId, float value)
+         {
+            numUnknown += guiParameters.find(paramId) == nullptr;
+            IMRT_CHECK(value == 0.25f);
+         }
+      );
+      std::this_thread::yield();
+   }
+
+   running.store(false);
+   dsp.join();
+   IMRT_CHECK(handle.removed());
+   IMRT_CHECK(numUnknown == 0);
+}
+
+/* ------------------------------------------------------ */
+/*                          main                          */
+/* ------------------------------------------------------ */
+
+int main()
+{
+   testPresetKeepsLaterChanges();
+   testRemovedParameterStaysAlive();
+   testReaddedParameterFeedback();
+   testAddRemoveWhileRunning();
+   return checkResult("params");
+}
@@ -0,0 +1,135 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "imrt-regression.h"
+
+/* ------------------------------------------------------ */
+/*                     processor under test               */
+/* ------------------------------------------------------ */
+
+namespace {
+
+const uint32_t gainId   = 1;
+const uint32_t cutoffId = 2;
+const uint32_t numTaps  = 32;
+const float pi          = 3.14159265358979323846f;
+
+/**
+ * @brief A gain stage followed by a one-pole lowpass and a short FIR, so that
+ * every block does enough work for a meaningful timing baseline. The state is
+ * reset in prepare(), so every run starts from the same point.
+ */
+class RegressionDsp : public ImRt::Dsp<RegressionDsp>
+{
+public:
+   RegressionDsp()
+      : ImRt::Dsp<RegressionDsp>(settings())
+   {
+      ImRt::ParameterLayout gain(gainId, "Gain", 0.0f, 2.0f, 1.0f);
+      ImRt::ParameterLayout cutoff(
+         cutoffId, "Cutoff", 20.0f, 20000.0f, 1000.0f,
+         ImRt::ParameterCurve::Logarithmic
+      );
+      addParameter(gain);
+      addParameter(cutoff);
+
+      _gain   = parameterHandle(gainId);
+      _cutoff = parameterHandle(cutoffId);
+
+      for (uint32_t tap = 0; tap < numTaps; ++tap)
+      {
+         // Hann window, normalized to unity gain
+         float phase = 2.0f * pi * (tap + 0.5f) / numTaps;
+         _taps[tap]  = (1.0f - std::cos(phase)) / numTaps;
+      }
+   }
+
+   void prepare(uint32_t sampleRate, uint32_t /*maxNumFrames*/)
+   {
+      _sampleRate = float(sampleRate);
+      _lowpass    = 0.0f;
+      std::memset(_history, 0, sizeof(_history));
+   }
+
+   int process(ImRt::Buffer& in, ImRt::Buffer& out, uint32_t numFrames)
+   {
+      float gain = _gain.value();
+      float coefficient
+         = 1.0f - std::exp(-2.0f * pi * _cutoff.value() / _sampleRate);
+
+      for (uint32_t frame = 0; frame < numFrames; ++frame)
+      {
+         _lowpass += coefficient * (gain * in.getSample(0, frame) - _lowpass);
+
+         std::memmove(_history + 1, _history, (numTaps - 1) * sizeof(float));
+         _history[0] = _lowpass;
+
+         float sum = 0.0f;
+         for (uint32_t tap = 0; tap < numTaps; ++tap)
+         {
+            sum += _taps[tap] * _history[tap];
+         }
+         out.getSample(0, frame) = sum;
+      }
+      return 0;
+   }
+
+private:
+   ImRt::ParameterHandle _gain, _cutoff;
+   float _sampleRate = 48000.0f;
+   float _lowpass    = 0.0f;
+   float _taps[numTaps];
+   float _history[numTaps] = {};
+
+   static ImRt::DspSettings settings()
+   {
+      ImRt::DspSettings settings;
+      settings.numChannelsIn  = 1;
+      settings.numChannelsOut = 1;
+      return settings;
+   }
+};
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                          main                          */
+/* ------------------------------------------------------ */
+
+// Usage: imrt-test-regression <data directory> [--timing] [--record]
+//
+// --timing also compares the block timing with the baseline, which is only
+// meaningful in an optimized build on a machine like the one it was recorded
+// on. --record rewrites the golden file and the baseline.
+int main(int argc, char** argv)
+{
+   if (argc < 2)
+   {
+      std::printf("usage: %s <data directory> [--timing] [--record]\n", argv[0]);
+      return 2;
+   }
+
+   std::string data = std::string(argv[1]) + "/";
+   bool timing = false, record = false;
+   for (int i = 2; i < argc; ++i)
+   {
+      timing = timing || std::strcmp(argv[i], "--timing") == 0;
+      record = record || std::strcmp(argv[i], "--record") == 0;
+   }
+
+   ImRt::RegressionCase test;
+   test.input      = data + "sweep.wav";
+   test.automation = data + "sweep.automation";
+   test.golden     = data + "sweep.golden.wav";
+   test.timing     = timing || record ? data + "sweep.timing" : "";
+   test.record     = record;
+
+   RegressionDsp dsp;
+   ImRt::RegressionResult result = ImRt::runRegression(dsp, test);
+   ImRt::printRegressionResult("sweep", result);
+
+   return result.passed ? 0 : 1;
+}
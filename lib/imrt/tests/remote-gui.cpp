@@ -0,0 +1,20 @@
+#include "imrt-bridge.h"
+#include "imrt-gui.h"
+
+/* ------------------------------------------------------ */
+/*                       remote gui                       */
+/* ------------------------------------------------------ */
+
+// Not a test, but a check that a Gui runs on a RemoteDsp, i.e. that the
+// RemoteDsp offers every member of a Dsp<> that the Gui<> uses. It is
+// compiled only, since running it would open a window.
+class RemoteGui : public ImRt::Gui<RemoteGui, ImRt::RemoteDsp>
+{
+public:
+   using Gui::Gui;
+
+   void onStart() {}
+   void onUpdate() {}
+};
+
+template void ImRt::Gui<RemoteGui, ImRt::RemoteDsp>::run();
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "imrt-ring.h"
+
+#include "check.h"
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                          ring                          */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   // The check value makes items copied while they were written detectable.
+   struct Item
+   {
+      uint64_t sequence;
+      uint64_t check;
+   };
+
+   uint64_t checkValue(uint64_t sequence)
+   {
+      return sequence * 0x9e3779b97f4a7c15ull;
+   }
+
+   // The samples are integers, which floats represent exactly up to 2^24.
+   float sampleValue(uint64_t frame, uint32_t channel)
+   {
+      return static_cast<float>((frame * 8 + channel) % (1u << 24));
+   }
+
+} // namespace
+
+// The capacity is rounded up to a power of two, and batches are limited to
+// the free space resp. the available items and wrap around the end.
+void testRingBatches()
+{
+   Ring<int> ring;
+   ring.reset(5);
+   IMRT_CHECK(ring.capacity() == 8);
+   IMRT_CHECK(ring.size() == 0 && ring.space() == 8);
+
+   int items[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+   IMRT_CHECK(ring.push(items, 6) == 6);
+
+   int popped[10] = {};
+   IMRT_CHECK(ring.pop(popped, 4) == 4);
+   IMRT_CHECK(popped[0] == 0 && popped[3] == 3);
+
+   // 2 items are left, so only 6 fit, wrapping around the end.
+   IMRT_CHECK(ring.push(items, 10) == 6);
+   IMRT_CHECK(ring.size() == 8 && ring.space() == 0);
+   IMRT_CHECK(!ring.push(items[0]));
+
+   Ring<int>::Spans spans = ring.prepareRead(8);
+   IMRT_CHECK(spans.firstSize == 4 && spans.secondSize == 4);
+   IMRT_CHECK(spans.first[0] == 4 && spans.second[3] == 5);
+   ring.commitRead(3);
+
+   IMRT_CHECK(ring.pop(popped, 10) == 5);
+   IMRT_CHECK(popped[0] == 1 && popped[4] == 5);
+   IMRT_CHECK(ring.size() == 0 && !ring.pop(popped[0]));
+}
+
+// A producer and a consumer thread pass a long sequence in batches of random
+// sizes, which exercises every wrap-around and the reload of the position
+// of the other side. Run it with the thread sanitizer to check the memory
+// ordering (cf. IMRT_SANITIZE_THREAD).
+void testRingStress()
+{
+   const uint64_t numItems = 1000000;
+
+   Ring<Item> ring;
+   ring.reset(256);
+
+   std::thread producer(
+      [&]
+      {
+         std::minstd_rand random(1);
+         std::vector<Item> batch(300);
+         uint64_t sequence = 0;
+         while (sequence < numItems)
+         {
+            uint32_t n = static_cast<uint32_t>(
+               std::min<uint64_t>(1 + random() % 300, numItems - sequence)
+            );
+            for (uint32_t i = 0; i < n; ++i)
+            {
+               batch[i] = { sequence + i, checkValue(sequence + i) };
+            }
+
+            uint32_t pushed = ring.push(batch.data(), n);
+            if (pushed == 0)
+            {
+               std::this_thread::yield();
+            }
+            sequence += pushed;
+         }
+      }
+   );
+
+   std::minstd_rand random(2);
+   std::vector<Item> batch(300);
+   uint64_t sequence = 0;
+   bool inOrder      = true;
+   while (sequence < numItems)
+   {
+      uint32_t n = ring.pop(batch.data(), 1 + random() % 300);
+      if (n == 0)
+      {
+         std::this_thread::yield();
+      }
+      for (uint32_t i = 0; i < n; ++i)
+      {
+         inOrder = inOrder && batch[i].sequence == sequence
+            && batch[i].check == checkValue(sequence);
+         ++sequence;
+      }
+   }
+   producer.join();
+
+   IMRT_CHECK(inOrder);
+   IMRT_CHECK(ring.size() == 0);
+}
+
+/* ------------------------------------------------------ */
+/*                       frame ring                       */
+/* ------------------------------------------------------ */
+
+// The channels of the frames stay together when a producer and a consumer
+// thread pass them in blocks of random sizes.
+void testFrameRingStress()
+{
+   const uint64_t numFrames   = 500000;
+   const uint32_t numChannels = 3;
+
+   FrameRing ring;
+   ring.reset(numChannels, 1000);
+   IMRT_CHECK(ring.numChannels() == numChannels);
+
+   std::thread producer(
+      [&]
+      {
+         std::minstd_rand random(3);
+         std::vector<std::vector<float>> block(
+            numChannels, std::vector<float>(512)
+         );
+         std::vector<const float*> pointers(numChannels);
+         uint64_t frame = 0;
+         while (frame < numFrames)
+         {
+            uint32_t n = static_cast<uint32_t>(
+               std::min<uint64_t>(1 + random() % 512, numFrames - frame)
+            );
+            for (uint32_t channel = 0; channel < numChannels; ++channel)
+            {
+               for (uint32_t i = 0; i < n; ++i)
+               {
+                  block[channel][i] = sampleValue(frame + i, channel);
+               }
+               pointers[channel] = block[channel].data();
+            }
+            uint32_t written = ring.write(pointers.data(), n);
+            if (written == 0)
+            {
+               std::this_thread::yield();
+            }
+            frame += written;
+         }
+      }
+   );
+
+   std::minstd_rand random(4);
+   std::vector<std::vector<float>> block(numChannels, std::vector<float>(512));
+   std::vector<float*> pointers(numChannels);
+   for (uint32_t channel = 0; channel < numChannels; ++channel)
+   {
+      pointers[channel] = block[channel].data();
+   }
+
+   uint64_t frame = 0;
+   bool inOrder   = true;
+   while (frame < numFrames)
+   {
+      uint32_t n = ring.read(pointers.data(), 1 + random() % 512);
+      if (n == 0)
+      {
+         std::this_thread::yield();
+      }
+      for (uint32_t i = 0; i < n; ++i, ++frame)
+      {
+         for (uint32_t channel = 0; channel < numChannels; ++channel)
+         {
+            inOrder = inOrder
+               && block[channel][i] == sampleValue(frame, channel);
+         }
+      }
+   }
+   producer.join();
+
+   IMRT_CHECK(inOrder);
+   IMRT_CHECK(ring.size() == 0);
+}
+
+/* ------------------------------------------------------ */
+/*                          main                          */
+/* ------------------------------------------------------ */
+
+int main()
+{
+   testRingBatches();
+   testRingStress();
+   testFrameRingStress();
+   return checkResult("ring");
+}
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "imrt-streams.h"
+
+#include "check.h"
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                   simulated devices                    */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const double engineRate  = 48000.0;
+   const uint32_t blockSize = 256;
+   const double frequency   = 100.0;
+   const float amplitude    = 0.5f;
+   const double pi          = 3.14159265358979323846;
+
+   double simulatedTime = 0.0;
+
+   double simulatedClock()
+   {
+      return simulatedTime;
+   }
+
+   // The largest step between two samples of the test sine is about 0.0065,
+   // a gap or a skipped part of the stream causes a far larger step.
+   const float maxStep = 0.02f;
+
+   // The device output is filled with this value before every callback, so
+   // frames the stream does not write can be told from the sine.
+   const float unwritten = 1.0f;
+
+   /**
+    * @brief Drives both sides of an auxiliary stream by a simulated clock.
+    * The auxiliary device claims to run at the engine rate, but its clock
+    * deviates by the given number of ppm. Both sides send a sine and record
+    * the largest step between two consecutive samples they receive. The
+    * device buffers may be larger than the stream was prepared for.
+    */
+   struct Simulation
+   {
+      Simulation(double ppm)
+         : stream(settings())
+         , deviceRate(engineRate * (1.0 + ppm * 1e-6))
+         , engineBlock(2, blockSize)
+         , deviceInput(2 * maxDeviceBlockSize)
+         , deviceOutput(2 * maxDeviceBlockSize)
+      {
+         simulatedTime = 0.0;
+         stream.setClock(&simulatedClock);
+         stream.prepare(engineRate, blockSize);
+      }
+
+      static AuxiliaryStreamSettings settings()
+      {
+         AuxiliaryStreamSettings settings;
+         settings.sampleRate = static_cast<uint32_t>(engineRate);
+         settings.bufferSize = blockSize;
+         return settings;
+      }
+
+      /**
+       * @brief Runs the simulation for the given time. While the device
+       * stalls its buffers are lost, as if the driver dropped them.
+       */
+      void run(double seconds, bool deviceStalls = false)
+      {
+         double end = simulatedTime + seconds;
+         while (simulatedTime < end)
+         {
+            double nextDevice = deviceFrame / deviceRate;
+            double nextEngine = numEngineBlocks * blockSize / engineRate;
+
+            if (nextDevice <= nextEngine)
+            {
+               simulatedTime = nextDevice;
+               deviceBlock(deviceStalls);
+            }
+            else
+            {
+               simulatedTime = nextEngine;
+               engineBlockCallback();
+            }
+         }
+      }
+
+      void deviceBlock(bool stalls)
+      {
+         ++numDeviceBlocks;
+         for (uint32_t frame = 0; frame < deviceBlockSize; ++frame)
+         {
+            float sample = amplitude
+               * static_cast<float>(std::sin(
+                  2.0 * pi * frequency * deviceFrame++ / deviceRate
+               ));
+            deviceInput[2 * frame]     = sample;
+            deviceInput[2 * frame + 1] = -sample;
+         }
+
+         if (stalls)
+         {
+            return;
+         }
+
+         std::fill(deviceOutput.begin(), deviceOutput.end(), unwritten);
+         stream.deviceCallback(
+            deviceInput.data(), deviceOutput.data(), deviceBlockSize
+         );
+         for (uint32_t frame = 0; frame < deviceBlockSize; ++frame)
+         {
+            track(deviceOutput[2 * frame], lastDeviceOutput, maxDeviceStep);
+            numUnwritten += deviceOutput[2 * frame] == unwritten;
+         }
+      }
+
+      void engineBlockCallback()
+      {
+         ++numEngineBlocks;
+         stream.readInput(engineBlock, 0, blockSize);
+         for (uint32_t frame = 0; frame < blockSize; ++frame)
+         {
+            track(engineBlock.getSample(0, frame), lastEngineInput,
+                  maxEngineStep);
+         }
+
+         for (uint32_t frame = 0; frame < blockSize; ++frame)
+         {
+            float sample = amplitude
+               * static_cast<float>(std::sin(
+                  2.0 * pi * frequency * engineFrame++ / engineRate
+               ));
+            engineBlock.getSample(0, frame) = sample;
+            engineBlock.getSample(1, frame) = -sample;
+         }
+         stream.writeOutput(engineBlock, 0, blockSize);
+      }
+
+      static void track(float sample, float& last, float& maxStepSeen)
+      {
+         maxStepSeen = std::max(maxStepSeen, std::abs(sample - last));
+         last        = sample;
+      }
+
+      void resetSteps()
+      {
+         maxEngineStep = 0.0f;
+         maxDeviceStep = 0.0f;
+      }
+
+      static constexpr uint32_t maxDeviceBlockSize = 4 * blockSize;
+
+      AuxiliaryStream stream;
+      double deviceRate;
+      uint32_t deviceBlockSize = blockSize;
+      Buffer engineBlock;
+      std::vector<float> deviceInput;
+      std::vector<float> deviceOutput;
+
+      uint64_t numDeviceBlocks = 0;
+      uint64_t numEngineBlocks = 0;
+      uint64_t deviceFrame     = 0;
+      uint64_t engineFrame     = 0;
+      float lastEngineInput    = 0.0f;
+      float lastDeviceOutput   = 0.0f;
+      float maxEngineStep      = 0.0f;
+      float maxDeviceStep      = 0.0f;
+      uint64_t numUnwritten    = 0;
+   };
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                         drift                          */
+/* ------------------------------------------------------ */
+
+// The estimated drift converges to the deviation of the device clock, and
+// once it settled the streams pass without dropouts or discontinuities.
+void testDrift(double ppm)
+{
+   Simulation simulation(ppm);
+   simulation.run(120.0);
+
+   IMRT_CHECK(std::abs(simulation.stream.driftPpm() - ppm) < 25.0);
+
+   uint32_t numDropouts = simulation.stream.numDropouts();
+   simulation.resetSteps();
+   simulation.run(60.0);
+
+   IMRT_CHECK(std::abs(simulation.stream.driftPpm() - ppm) < 25.0);
+   IMRT_CHECK(simulation.stream.numDropouts() == numDropouts);
+   IMRT_CHECK(simulation.maxEngineStep < maxStep);
+   IMRT_CHECK(simulation.maxDeviceStep < maxStep);
+}
+
+/* ------------------------------------------------------ */
+/*                    oversized buffer                    */
+/* ------------------------------------------------------ */
+
+// A device buffer larger than the stream was prepared for is processed in
+// chunks, so all of its input reaches the engine and all of its output is
+// written. The rings are not sized for it, so the output may run empty.
+void testOversizedBuffer()
+{
+   Simulation simulation(0.0);
+   simulation.run(30.0);
+   simulation.resetSteps();
+
+   simulation.deviceBlockSize = 2 * blockSize + blockSize / 2 + 7;
+   simulation.deviceBlock(false);
+   simulation.deviceBlockSize = blockSize;
+   simulation.run(10.0);
+
+   IMRT_CHECK(simulation.numUnwritten == 0);
+   IMRT_CHECK(simulation.maxEngineStep < maxStep);
+}
+
+/* ------------------------------------------------------ */
+/*                        dropouts                        */
+/* ------------------------------------------------------ */
+
+// A stalled device is counted as a dropout, and the streams recover from it
+// without further dropouts.
+void testDropout()
+{
+   Simulation simulation(100.0);
+   simulation.run(60.0);
+
+   uint32_t numDropouts = simulation.stream.numDropouts();
+   simulation.run(0.05, true);
+   simulation.run(1.0);
+   IMRT_CHECK(simulation.stream.numDropouts() > numDropouts);
+   IMRT_CHECK(simulation.maxEngineStep > maxStep);
+
+   simulation.run(30.0);
+   numDropouts = simulation.stream.numDropouts();
+   simulation.resetSteps();
+   simulation.run(30.0);
+
+   IMRT_CHECK(simulation.stream.numDropouts() == numDropouts);
+   IMRT_CHECK(simulation.maxEngineStep < maxStep);
+   IMRT_CHECK(simulation.maxDeviceStep < maxStep);
+}
+
+/* ------------------------------------------------------ */
+/*                          main                          */
+/* ------------------------------------------------------ */
+
+int main()
+{
+   testDrift(200.0);
+   testDrift(-200.0);
+   testDrift(0.0);
+   testOversizedBuffer();
+   testDropout();
+   return checkResult("streams");
+}
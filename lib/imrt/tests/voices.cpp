@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "imrt-voices.h"
+
+#include "check.h"
+
+using namespace ImRt;
+
+/* ------------------------------------------------------ */
+/*                       rendering                        */
+/* ------------------------------------------------------ */
+
+namespace {
+
+   const uint32_t sampleRate = 48000;
+   const uint32_t blockSize  = 256;
+
+   /**
+    * @brief Renders the given number of blocks, passing the events with the
+    * first block, and returns the first channel. The channels must be equal.
+    */
+   std::vector<float> render(
+      VoicePool& voices, uint32_t numBlocks,
+      const std::vector<NoteEvent>& events = {}
+   )
+   {
+      std::vector<float> signal;
+      Buffer block(2, blockSize);
+      for (uint32_t i = 0; i < numBlocks; ++i)
+      {
+         for (uint32_t channel = 0; channel < 2; ++channel)
+         {
+            std::fill_n(&block.getSample(channel, 0), blockSize, 0.0f);
+         }
+
+         if (i == 0)
+         {
+            voices.process(
+               block, blockSize, events.data(),
+               static_cast<uint32_t>(events.size())
+            );
+         }
+         else
+         {
+            voices.process(block, blockSize);
+         }
+
+         for (uint32_t frame = 0; frame < blockSize; ++frame)
+         {
+            IMRT_CHECK(block.getSample(0, frame) == block.getSample(1, frame));
+            signal.push_back(block.getSample(0, frame));
+         }
+      }
+      return signal;
+   }
+
+   float peak(const std::vector<float>& signal, size_t begin, size_t end)
+   {
+      float peak = 0.0f;
+      for (size_t i = begin; i < end && i < signal.size(); ++i)
+      {
+         peak = std::max(peak, std::abs(signal[i]));
+      }
+      return peak;
+   }
+
+   float maxStep(const std::vector<float>& signal)
+   {
+      float step = 0.0f;
+      for (size_t i = 1; i < signal.size(); ++i)
+      {
+         step = std::max(step, std::abs(signal[i] - signal[i - 1]));
+      }
+      return step;
+   }
+
+} // namespace
+
+/* ------------------------------------------------------ */
+/*                        envelope                        */
+/* ------------------------------------------------------ */
+
+// A note starts at its offset, oscillates at its frequency, settles at the
+// sustain level and is freed once its release has decayed to silence.
+void testNote()
+{
+   VoiceSettings settings;
+   VoicePool voices;
+   voices.setSettings(settings);
+   voices.prepare(sampleRate, blockSize, 8);
+
+   // Two seconds and a block.
+   uint32_t numBlocks        = 2 * sampleRate / blockSize + 1;
+   std::vector<float> signal = render(voices, numBlocks, { { 100, 69, 1.0f } });
+   IMRT_CHECK(voices.numActiveVoices() == 1);
+   IMRT_CHECK(peak(signal, 0, 100) == 0.0f);
+   IMRT_CHECK(peak(signal, 100, 120) > 0.0f);
+
+   // After the decay, the level is the sustain level.
+   float sustain = peak(signal, sampleRate, signal.size());
+   IMRT_CHECK(std::abs(sustain - settings.gain * settings.sustain) < 0.01f);
+
+   // One second of A4 has 880 sign changes.
+   uint32_t numCrossings = 0;
+   for (size_t i = sampleRate; i < 2 * sampleRate - 1; ++i)
+   {
+      numCrossings += (signal[i] < 0.0f) != (signal[i + 1] < 0.0f);
+   }
+   IMRT_CHECK(numCrossings >= 878 && numCrossings <= 882);
+
+   signal = render(voices, 1, { { 0, 69, 0.0f } });
+   IMRT_CHECK(voices.numActiveVoices() == 1);
+
+   signal = render(voices, numBlocks);
+   IMRT_CHECK(voices.numActiveVoices() == 0);
+   IMRT_CHECK(peak(signal, signal.size() - blockSize, signal.size()) == 0.0f);
+}
+
+/* ------------------------------------------------------ */
+/*                        stealing                        */
+/* ------------------------------------------------------ */
+
+// When all voices are in use, a released voice is stolen before a playing
+// one, and stealing continues from the current level, so it does not click.
+void testStealing()
+{
+   VoicePool voices;
+   voices.prepare(sampleRate, blockSize, 4);
+
+   std::vector<NoteEvent> events;
+   for (uint32_t i = 0; i < 4; ++i)
+   {
+      events.push_back({ 0, 60 + i, 1.0f });
+   }
+   std::vector<float> signal = render(voices, 20, events);
+   IMRT_CHECK(voices.numActiveVoices() == 4);
+   IMRT_CHECK(voices.numStolenVoices() == 0);
+
+   // The released note 61 is stolen, so note 60 keeps playing and is the
+   // only voice left after all other notes were released.
+   signal = render(voices, 20, { { 0, 61, 0.0f }, { 128, 72, 1.0f } });
+   IMRT_CHECK(voices.numActiveVoices() == 4);
+   IMRT_CHECK(voices.numStolenVoices() == 1);
+
+   signal = render(
+      voices, 200, { { 0, 62, 0.0f }, { 0, 63, 0.0f }, { 0, 72, 0.0f } }
+   );
+   IMRT_CHECK(voices.numActiveVoices() == 1);
+
+   // Without a released voice, the oldest one, i.e. note 60, is stolen.
+   events.clear();
+   for (uint32_t i = 0; i < 4; ++i)
+   {
+      events.push_back({ 64 * i, 80 + i, 1.0f });
+   }
+   signal = render(voices, 20, events);
+   IMRT_CHECK(voices.numActiveVoices() == 4);
+   IMRT_CHECK(voices.numStolenVoices() == 2);
+
+   signal = render(voices, 200, { { 0, 60, 0.0f } });
+   IMRT_CHECK(voices.numActiveVoices() == 4);
+
+   // The largest step of four full-scale notes is far below a jump to or
+   // from zero.
+   IMRT_CHECK(maxStep(signal) < 0.1f);
+}
+
+/* ------------------------------------------------------ */
+/*                          gain                          */
+/* ------------------------------------------------------ */
+
+// A new gain is ramped over a block, and a note off for a note that is not
+// playing is ignored.
+void testGainRamp()
+{
+   VoicePool voices;
+   voices.prepare(sampleRate, blockSize, 8);
+   std::vector<float> signal = render(voices, 100, { { 0, 57, 1.0f } });
+   float step                = maxStep(signal);
+
+   VoiceSettings settings;
+   settings.gain = 1.0f;
+   voices.setSettings(settings);
+   signal = render(voices, 10, { { 0, 90, 0.0f } });
+
+   IMRT_CHECK(voices.numActiveVoices() == 1);
+   IMRT_CHECK(maxStep(signal) < 5.0f * step);
+   IMRT_CHECK(peak(signal, signal.size() - blockSize, signal.size()) > 0.5f);
+}
+
+/* ------------------------------------------------------ */
+/*                          main                          */
+/* ------------------------------------------------------ */
+
+int main()
+{
+   testNote();
+   testStealing();
+   testGainRamp();
+   return checkResult("voices");
+}